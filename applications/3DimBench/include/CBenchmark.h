@@ -0,0 +1,132 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef CBenchmark_H
+#define CBenchmark_H
+
+#include <VPL/Image/DensityVolume.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+////////////////////////////////////////////////////////////
+//! Options shared by all benchmarks.
+struct SBenchOptions
+{
+    //! Edge of synthetic volumes in voxels.
+    int size;
+
+    //! Number of measured runs of every variant.
+    int repeats;
+
+    //! Default options.
+    SBenchOptions() : size(256), repeats(5) {}
+};
+
+////////////////////////////////////////////////////////////
+//! Measures repeated runs of benchmark variants and prints their times.
+class CBenchmark
+{
+public:
+    //! Constructor prints the benchmark header.
+    CBenchmark(const std::string& name, const SBenchOptions& options)
+        : m_options(options)
+    {
+        std::cout << std::endl << "== " << name << " ==" << std::endl;
+    }
+
+    //! Runs the function once to warm up caches and then repeatedly,
+    //! prints the best and mean time and returns the best time in milliseconds.
+    template <class F>
+    double measure(const std::string& variant, F func)
+    {
+        func();
+        double best = 0.0, total = 0.0;
+        for (int i = 0; i < m_options.repeats; ++i)
+        {
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            func();
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            best = (0 == i) ? ms : std::min(best, ms);
+            total += ms;
+        }
+        std::cout << "  " << std::left << std::setw(40) << variant << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(10) << best << " ms best" << std::setw(10) << total / std::max(1, m_options.repeats) << " ms mean" << std::endl;
+        return best;
+    }
+
+    //! Prints ratio of two best times.
+    static void printSpeedup(const std::string& what, double reference, double time)
+    {
+        std::cout << "  speedup of " << what << ": " << std::fixed << std::setprecision(2) << (time > 0.0 ? reference / time : 0.0) << "x" << std::endl;
+    }
+
+    //! Prints an additional result line.
+    static void printResult(const std::string& what, double value)
+    {
+        std::cout << "  " << what << ": " << value << std::endl;
+    }
+
+    //! Fills volume with a deterministic CT like phantom: air, soft tissue
+    //! cylinder with noise and a few bone like spheres and rods.
+    static void makePhantom(vpl::img::CDensityVolume& volume, int size);
+
+protected:
+    //! Options.
+    SBenchOptions m_options;
+};
+
+////////////////////////////////////////////////////////////
+// Benchmarks
+
+//! Per-voxel versus batched voxel classification of marching cubes functors.
+void benchVoxelClassification(const SBenchOptions& options);
+
+//! File by file versus concurrent loading of a synthetic DICOM series.
+void benchDicomLoading(const SBenchOptions& options);
+
+//! Scan of a synthetic DICOM directory without, with empty and with filled index.
+void benchDicomIndex(const SBenchOptions& options);
+
+//! Density window and region overlay versus the fused slice colorizer.
+void benchSliceColorizer(const SBenchOptions& options);
+
+//! Storage invalidations dispatched one by one versus coalesced per frame.
+void benchStorageInvalidation(const SBenchOptions& options);
+
+//! Flood fill versus parallel union-find labelling of mesh components.
+void benchMeshComponents(const SBenchOptions& options);
+
+//! Per voxel loops versus the streaming volume rendering preprocessor.
+void benchVolumePreprocessing(const SBenchOptions& options);
+
+//! Octree Hausdorff distance with a search radius versus the exact BVH surface distance.
+void benchSurfaceDistance(const SBenchOptions& options);
+
+#endif // CBenchmark_H
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
@@ -0,0 +1,252 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+// Writes the phantom as a synthetic CT series and measures loading of its
+// files one by one and concurrently in batches, the way CExamination loads
+// series, and scanning of its directory without and with the DICOM index.
+// Requires the DCMTK build, the series is written by DCMTK.
+
+#include <CBenchmark.h>
+
+#include <data/CDicomLoader.h>
+#include <data/CSeries.h>
+
+#include <VPL/System/String.h>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QString>
+
+#if !defined( TRIDIM_USE_GDCM )
+#include <dcmtk/dcmdata/dctk.h>
+#endif
+
+#include <atomic>
+#include <sstream>
+#include <vector>
+
+#if !defined( TRIDIM_USE_GDCM )
+
+namespace
+{
+    //! Writes one file per slice of the volume, returns false on failure.
+    bool writeSeries(const vpl::img::CDensityVolume& volume, const std::string& dir)
+    {
+        char studyUid[100], seriesUid[100];
+        dcmGenerateUniqueIdentifier(studyUid, SITE_STUDY_UID_ROOT);
+        dcmGenerateUniqueIdentifier(seriesUid, SITE_SERIES_UID_ROOT);
+
+        const int xSize = volume.getXSize(), ySize = volume.getYSize();
+        std::vector<Uint16> pixels(size_t(xSize) * ySize);
+        std::ostringstream spacing;
+        spacing << volume.getDX() << "\\" << volume.getDY();
+        std::ostringstream thickness;
+        thickness << volume.getDZ();
+
+        for (vpl::tSize z = 0; z < volume.getZSize(); ++z)
+        {
+            for (vpl::tSize y = 0; y < ySize; ++y)
+            {
+                for (vpl::tSize x = 0; x < xSize; ++x)
+                {
+                    pixels[size_t(y) * xSize + x] = Uint16(volume.at(x, y, z));
+                }
+            }
+
+            char sopUid[100];
+            dcmGenerateUniqueIdentifier(sopUid, SITE_INSTANCE_UID_ROOT);
+            std::ostringstream position, number, name;
+            position << "0\\0\\" << z * volume.getDZ();
+            number << z + 1;
+            name << dir << "/slice" << z << ".dcm";
+
+            DcmFileFormat file;
+            DcmDataset *dataset = file.getDataset();
+            dataset->putAndInsertString(DCM_SOPClassUID, UID_CTImageStorage);
+            dataset->putAndInsertString(DCM_SOPInstanceUID, sopUid);
+            dataset->putAndInsertString(DCM_StudyInstanceUID, studyUid);
+            dataset->putAndInsertString(DCM_SeriesInstanceUID, seriesUid);
+            dataset->putAndInsertString(DCM_Modality, "CT");
+            dataset->putAndInsertString(DCM_PatientName, "Bench^Phantom");
+            dataset->putAndInsertString(DCM_PatientID, "3DimBench");
+            dataset->putAndInsertString(DCM_InstanceNumber, number.str().c_str());
+            dataset->putAndInsertString(DCM_ImagePositionPatient, position.str().c_str());
+            dataset->putAndInsertString(DCM_ImageOrientationPatient, "1\\0\\0\\0\\1\\0");
+            dataset->putAndInsertString(DCM_PixelSpacing, spacing.str().c_str());
+            dataset->putAndInsertString(DCM_SliceThickness, thickness.str().c_str());
+            dataset->putAndInsertString(DCM_RescaleIntercept, "0");
+            dataset->putAndInsertString(DCM_RescaleSlope, "1");
+            dataset->putAndInsertString(DCM_PhotometricInterpretation, "MONOCHROME2");
+            dataset->putAndInsertUint16(DCM_SamplesPerPixel, 1);
+            dataset->putAndInsertUint16(DCM_Rows, Uint16(ySize));
+            dataset->putAndInsertUint16(DCM_Columns, Uint16(xSize));
+            dataset->putAndInsertUint16(DCM_BitsAllocated, 16);
+            dataset->putAndInsertUint16(DCM_BitsStored, 16);
+            dataset->putAndInsertUint16(DCM_HighBit, 15);
+            dataset->putAndInsertUint16(DCM_PixelRepresentation, 1);
+            dataset->putAndInsertUint16Array(DCM_PixelData, &pixels[0], static_cast<unsigned long>(pixels.size()));
+            if (file.saveFile(name.str().c_str(), EXS_LittleEndianExplicit).bad())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //! Loads all files of a serie, batches of files are loaded concurrently
+    //! if bParallel is set. Returns the number of loaded slices.
+    int loadSerie(data::CSerieInfo& serie, bool bParallel)
+    {
+        const int numFiles = serie.getNumOfDicomFiles();
+        std::vector<data::tDicomSlices> files(numFiles);
+        std::atomic<bool> bFailed(false);
+        if (bParallel)
+        {
+            data::CSerieInfo::prepareParallelLoading();
+        }
+
+        #pragma omp parallel for schedule(dynamic) if (bParallel)
+        for (int i = 0; i < numFiles; ++i)
+        {
+            data::sExtendedTags tags;
+            if (!serie.loadDicomFile(i, files[i], tags, true))
+            {
+                bFailed = true;
+            }
+        }
+        if (bFailed)
+        {
+            return 0;
+        }
+
+        int slices = 0;
+        for (int i = 0; i < numFiles; ++i)
+        {
+            slices += int(files[i].size());
+        }
+        return slices;
+    }
+}
+
+void benchDicomLoading(const SBenchOptions& options)
+{
+    CBenchmark bench("DICOM series loading", options);
+
+    vpl::img::CDensityVolume volume;
+    CBenchmark::makePhantom(volume, options.size);
+
+    QDir dir(QDir::temp().filePath(QString("3DimBench_dicom_%1").arg(QCoreApplication::applicationPid())));
+    if (!dir.mkpath(".") || !writeSeries(volume, dir.absolutePath().toUtf8().constData()))
+    {
+        std::cout << "  ERROR: cannot write the series to " << dir.absolutePath().toUtf8().constData() << std::endl;
+        dir.removeRecursively();
+        return;
+    }
+
+    data::CDicomLoader loader;
+    data::CSeries::tSmartPtr spSeries(loader.preLoadDirectory(vpl::sys::tStringConv::fromUtf8(dir.absolutePath().toUtf8().constData())));
+    data::CSerieInfo *pSerie = (spSeries.get() && spSeries->getNumSeries() > 0) ? spSeries->getSerie(0) : NULL;
+    if (NULL == pSerie)
+    {
+        std::cout << "  ERROR: the written series was not found" << std::endl;
+        dir.removeRecursively();
+        return;
+    }
+
+    int slicesSerial = 0, slicesParallel = 0;
+    const double tSerial = bench.measure("file by file", [&]() { slicesSerial = loadSerie(*pSerie, false); });
+    const double tParallel = bench.measure("concurrent", [&]() { slicesParallel = loadSerie(*pSerie, true); });
+    CBenchmark::printSpeedup("concurrent loading", tSerial, tParallel);
+    CBenchmark::printResult("slices", double(slicesParallel));
+    if (slicesSerial != volume.getZSize() || slicesParallel != volume.getZSize())
+    {
+        std::cout << "  ERROR: loaded " << slicesSerial << " and " << slicesParallel << " of " << volume.getZSize() << " slices" << std::endl;
+    }
+
+    dir.removeRecursively();
+}
+
+void benchDicomIndex(const SBenchOptions& options)
+{
+    CBenchmark bench("DICOM directory scan with index", options);
+
+    vpl::img::CDensityVolume volume;
+    CBenchmark::makePhantom(volume, options.size);
+
+    QDir dir(QDir::temp().filePath(QString("3DimBench_dicomindex_%1").arg(QCoreApplication::applicationPid())));
+    QDir indexDir(dir.filePath("index"));
+    QDir seriesDir(dir.filePath("series"));
+    if (!seriesDir.mkpath(".") || !writeSeries(volume, seriesDir.absolutePath().toUtf8().constData()))
+    {
+        std::cout << "  ERROR: cannot write the series to " << seriesDir.absolutePath().toUtf8().constData() << std::endl;
+        dir.removeRecursively();
+        return;
+    }
+    const vpl::sys::tString sSeriesDir = vpl::sys::tStringConv::fromUtf8(seriesDir.absolutePath().toUtf8().constData());
+    const vpl::sys::tString sIndexDir = vpl::sys::tStringConv::fromUtf8(indexDir.absolutePath().toUtf8().constData());
+
+    // Returns number of files found in the series
+    auto scan = [&sSeriesDir](const vpl::sys::tString& sIndex) -> int
+    {
+        data::CDicomLoader loader;
+        loader.setIndexCacheDirectory(sIndex);
+        data::CSeries::tSmartPtr spSeries(loader.preLoadDirectory(sSeriesDir));
+        data::CSerieInfo *pSerie = (spSeries.get() && spSeries->getNumSeries() > 0) ? spSeries->getSerie(0) : NULL;
+        return (NULL != pSerie) ? pSerie->getNumOfDicomFiles() : 0;
+    };
+
+    // All headers are read from the file system cache, so the gain
+    // of the filled index is even larger on network drives
+    int filesNoIndex = 0, filesCold = 0, filesWarm = 0;
+    const double tNoIndex = bench.measure("no index", [&]() { filesNoIndex = scan(vpl::sys::tString()); });
+    const double tCold = bench.measure("empty index (cold)", [&]() { indexDir.removeRecursively(); indexDir.mkpath("."); filesCold = scan(sIndexDir); });
+    const double tWarm = bench.measure("filled index (warm)", [&]() { filesWarm = scan(sIndexDir); });
+    CBenchmark::printSpeedup("filled index", tNoIndex, tWarm);
+    CBenchmark::printSpeedup("filled over empty index", tCold, tWarm);
+    CBenchmark::printResult("files", double(filesWarm));
+    if (filesNoIndex != volume.getZSize() || filesCold != volume.getZSize() || filesWarm != volume.getZSize())
+    {
+        std::cout << "  ERROR: found " << filesNoIndex << ", " << filesCold << " and " << filesWarm << " of " << volume.getZSize() << " files" << std::endl;
+    }
+
+    dir.removeRecursively();
+}
+
+#else
+
+void benchDicomLoading(const SBenchOptions& options)
+{
+    CBenchmark bench("DICOM series loading", options);
+    std::cout << "  skipped, synthetic series are written by DCMTK" << std::endl;
+}
+
+void benchDicomIndex(const SBenchOptions& options)
+{
+    CBenchmark bench("DICOM directory scan with index", options);
+    std::cout << "  skipped, synthetic series are written by DCMTK" << std::endl;
+}
+
+#endif // TRIDIM_USE_GDCM
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
@@ -0,0 +1,180 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+// Compares the sequential flood fill over face neighbours, which used to
+// find mesh components, with the parallel union-find of CMeshComponents on
+// a fragmented mesh: a large grid and many small islands above it. Small
+// islands are then removed by face deletion with the garbage collection
+// and by the compaction pass of CMeshComponents.
+
+#include <CBenchmark.h>
+
+#include <alg/CMeshComponents.h>
+#include <geometry/base/CMesh.h>
+
+#include <deque>
+#include <vector>
+
+namespace
+{
+    //! Number of faces of a small island.
+    const int ISLAND_FACES = 8;
+
+    //! Adds a grid of quads split to triangles.
+    void addGrid(geometry::CMesh& mesh, float x0, float y0, float z, int cells, float step)
+    {
+        std::vector<geometry::CMesh::VertexHandle> vertices;
+        vertices.reserve((cells + 1) * (cells + 1));
+        for (int y = 0; y <= cells; ++y)
+        {
+            for (int x = 0; x <= cells; ++x)
+            {
+                vertices.push_back(mesh.add_vertex(geometry::CMesh::Point(x0 + x * step, y0 + y * step, z)));
+            }
+        }
+        for (int y = 0; y < cells; ++y)
+        {
+            for (int x = 0; x < cells; ++x)
+            {
+                const int i = y * (cells + 1) + x;
+                mesh.add_face(vertices[i], vertices[i + 1], vertices[i + cells + 2]);
+                mesh.add_face(vertices[i], vertices[i + cells + 2], vertices[i + cells + 1]);
+            }
+        }
+    }
+
+    //! Builds a large grid and size * size / 4 islands of two by two quads above it.
+    void makeFragmentedMesh(geometry::CMesh& mesh, int size)
+    {
+        addGrid(mesh, 0.0f, 0.0f, 0.0f, size, 1.0f);
+        const int islands = size / 2;
+        for (int y = 0; y < islands; ++y)
+        {
+            for (int x = 0; x < islands; ++x)
+            {
+                addGrid(mesh, 2.0f * x, 2.0f * y, 1.0f, 2, 0.5f);
+            }
+        }
+    }
+
+    //! Labels components by a flood fill over face neighbours.
+    int floodFill(const geometry::CMesh& mesh, std::vector<int>& labels)
+    {
+        labels.assign(mesh.n_faces(), -1);
+        std::deque<geometry::CMesh::FaceHandle> queue;
+        int count = 0;
+        for (geometry::CMesh::ConstFaceIter fit = mesh.faces_begin(); fit != mesh.faces_end(); ++fit)
+        {
+            if (labels[fit.handle().idx()] >= 0)
+            {
+                continue;
+            }
+            queue.push_back(fit.handle());
+            while (!queue.empty())
+            {
+                const geometry::CMesh::FaceHandle face = queue.front();
+                queue.pop_front();
+                if (labels[face.idx()] >= 0)
+                {
+                    continue;
+                }
+                labels[face.idx()] = count;
+                for (geometry::CMesh::ConstFaceFaceIter ffit = mesh.cff_iter(face); ffit; ++ffit)
+                {
+                    queue.push_back(ffit.handle());
+                }
+            }
+            ++count;
+        }
+        return count;
+    }
+}
+
+void benchMeshComponents(const SBenchOptions& options)
+{
+    CBenchmark bench("Mesh components", options);
+
+    geometry::CMesh mesh;
+    makeFragmentedMesh(mesh, options.size);
+    CBenchmark::printResult("faces", double(mesh.n_faces()));
+
+    std::vector<int> labels;
+    int filled = 0;
+    const double tFlood = bench.measure("flood fill", [&]()
+    {
+        filled = floodFill(mesh, labels);
+    });
+
+    CMeshComponents components;
+    const double tUnion = bench.measure("parallel union-find", [&]()
+    {
+        components.compute(mesh);
+    });
+    CBenchmark::printSpeedup("union-find", tFlood, tUnion);
+    CBenchmark::printResult("components", double(components.getNumOfComponents()));
+    if (size_t(filled) != components.getNumOfComponents())
+    {
+        std::cout << "  ERROR: flood fill found " << filled << " components" << std::endl;
+    }
+
+    // removal of islands, copying of the mesh is included in both variants
+    std::vector<unsigned char> keep(components.getNumOfComponents(), 0);
+    for (size_t i = 0; i < keep.size(); ++i)
+    {
+        keep[i] = (components.getComponent(i).faces > ISLAND_FACES);
+    }
+
+    size_t deletedFaces = 0, filteredFaces = 0;
+    const double tDelete = bench.measure("delete faces + garbage collection", [&]()
+    {
+        geometry::CMesh copy(mesh);
+        copy.request_vertex_status();
+        copy.request_edge_status();
+        copy.request_face_status();
+        const std::vector<int>& faceLabels = components.getFaceLabels();
+        for (size_t f = 0; f < faceLabels.size(); ++f)
+        {
+            if (!keep[faceLabels[f]])
+            {
+                copy.delete_face(geometry::CMesh::FaceHandle(int(f)), true);
+            }
+        }
+        copy.garbage_collection();
+        deletedFaces = copy.n_faces();
+    });
+    const double tFilter = bench.measure("compaction", [&]()
+    {
+        geometry::CMesh copy(mesh);
+        components.filter(copy, keep);
+        filteredFaces = copy.n_faces();
+    });
+    CBenchmark::printSpeedup("compaction", tDelete, tFilter);
+    CBenchmark::printResult("faces kept", double(filteredFaces));
+    if (deletedFaces != filteredFaces)
+    {
+        std::cout << "  ERROR: garbage collection kept " << deletedFaces << " faces" << std::endl;
+    }
+}
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
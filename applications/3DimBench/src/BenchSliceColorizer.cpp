@@ -0,0 +1,138 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+// Compares colorization of orthogonal slices by the density window followed
+// by the multi-class region overlay with the fused single pass of
+// CSliceColorizer. A few densities outside the density window range are
+// placed into every slice to check the lookup table bounds.
+
+#include <CBenchmark.h>
+
+#include <data/CSliceColorizer.h>
+#include <data/CDensityWindow.h>
+#include <data/CMultiClassRegionColoring.h>
+#include <data/CSlice.h>
+
+#include <VPL/Image/Image.h>
+#include <VPL/Image/PixelTraits.h>
+
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+    //! Returns the largest difference of color components of two images.
+    int maxDifference(const vpl::img::CRGBImage& a, const vpl::img::CRGBImage& b)
+    {
+        int result = 0;
+        for (vpl::tSize y = 0; y < a.getYSize(); ++y)
+        {
+            for (vpl::tSize x = 0; x < a.getXSize(); ++x)
+            {
+                const unsigned char *pa = reinterpret_cast<const unsigned char *>(&a(x, y));
+                const unsigned char *pb = reinterpret_cast<const unsigned char *>(&b(x, y));
+                for (int k = 0; k < 4; ++k)
+                {
+                    result = std::max(result, std::abs(int(pa[k]) - int(pb[k])));
+                }
+            }
+        }
+        return result;
+    }
+}
+
+void benchSliceColorizer(const SBenchOptions& options)
+{
+    CBenchmark bench("Slice colorization", options);
+
+    vpl::img::CDensityVolume volume;
+    CBenchmark::makePhantom(volume, options.size);
+    const vpl::tSize xSize = volume.getXSize(), ySize = volume.getYSize(), zSize = volume.getZSize();
+
+    // XY slices with densities beyond both ends of the density window range
+    // and a region mask with several overlapping regions
+    std::vector<vpl::img::CDImage> slices(zSize);
+    std::vector< vpl::img::CImage<data::tRegionVoxel> > regions(zSize);
+    for (vpl::tSize z = 0; z < zSize; ++z)
+    {
+        slices[z].resize(xSize, ySize);
+        regions[z].resize(xSize, ySize);
+        for (vpl::tSize y = 0; y < ySize; ++y)
+        {
+            for (vpl::tSize x = 0; x < xSize; ++x)
+            {
+                slices[z](x, y) = volume(x, y, z);
+                data::tRegionVoxel value = 0;
+                if (x < xSize / 2)
+                {
+                    value |= 1 << 1;
+                }
+                if (y < ySize / 3)
+                {
+                    value |= 1 << 3;
+                }
+                regions[z](x, y) = value;
+            }
+        }
+        slices[z](0, 0) = vpl::img::CPixelTraits<vpl::img::tDensityPixel>::getPixelMin();
+        slices[z](1, 0) = vpl::img::CPixelTraits<vpl::img::tDensityPixel>::getPixelMax();
+    }
+
+    data::CDensityWindow window;
+    data::CSlicePropertyContainer properties;
+    data::CMultiClassRegionColoring coloring;
+    coloring.resize(8);
+    coloring.setActiveRegion(3);
+
+    vpl::img::CRGBImage separate(xSize, ySize), fused(xSize, ySize);
+
+    const double tSeparate = bench.measure("density window + region overlay", [&]()
+    {
+        for (vpl::tSize z = 0; z < zSize; ++z)
+        {
+            window.colorize(separate, slices[z], properties, slices[z]);
+            coloring.colorize(separate, regions[z]);
+        }
+    });
+    const double tFused = bench.measure("fused colorizer", [&]()
+    {
+        data::CSliceColorizer colorizer(window);
+        colorizer.setMultiClassRegionColoring(coloring);
+        for (vpl::tSize z = 0; z < zSize; ++z)
+        {
+            colorizer.colorize(fused, slices[z], regions[z]);
+        }
+    });
+    CBenchmark::printSpeedup("fused colorizer", tSeparate, tFused);
+
+    // the last slice of both variants, rounding of the blending may differ by one
+    const int difference = maxDifference(separate, fused);
+    CBenchmark::printResult("max color difference", double(difference));
+    if (difference > 1)
+    {
+        std::cout << "  ERROR: colorized slices differ" << std::endl;
+    }
+}
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
@@ -0,0 +1,190 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+// Compares dispatching of storage invalidations one by one with coalescing
+// them per frame. A source entry is invalidated many times per frame like
+// a dragged slice position, its dependent entries regenerate an image and
+// observers access them like the renderer does. Dependent entries declare
+// a thread safe update, so they are regenerated ahead in parallel when the
+// coalesced invalidations are dispatched.
+
+#include <CBenchmark.h>
+
+#include <data/CDataStorage.h>
+#include <data/CObjectHolder.h>
+#include <data/CObjectPtr.h>
+#include <data/CStorableFactory.h>
+
+#include <VPL/Base/SharedPtr.h>
+#include <VPL/Module/Signal.h>
+
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    //! Synthetic entries and the simulated interaction.
+    enum
+    {
+        SOURCE_ID = data::Storage::MAX_ID - 16,
+        DEPENDENT_COUNT = 8,
+        INVALIDATIONS_PER_FRAME = 32,
+        FRAMES = 10
+    };
+
+    //! Number of updates of dependent entries and of observer notifications.
+    std::atomic<int> g_updates(0), g_notifications(0);
+
+    //! Entry invalidated repeatedly.
+    class CBenchSource : public vpl::base::CObject
+    {
+    public:
+        VPL_SHAREDPTR(CBenchSource);
+
+        CBenchSource() : m_value(0) {}
+        void update(const data::CChangedEntries& VPL_UNUSED(Changes)) {}
+        void init() { m_value = 0; }
+        bool checkDependency(data::CStorageEntry * VPL_UNUSED(pParent)) { return true; }
+        bool hasData() { return true; }
+
+        int m_value;
+    };
+
+    //! Entry regenerating an image from the source value.
+    class CBenchDependent : public vpl::base::CObject
+    {
+    public:
+        VPL_SHAREDPTR(CBenchDependent);
+
+        CBenchDependent() {}
+        void init() { m_image.clear(); }
+        bool checkDependency(data::CStorageEntry * VPL_UNUSED(pParent)) { return true; }
+        bool hasData() { return !m_image.empty(); }
+
+        void update(const data::CChangedEntries& VPL_UNUSED(Changes))
+        {
+            int value = 0;
+            {
+                data::CObjectPtr<CBenchSource> spSource(APP_STORAGE.getEntry(SOURCE_ID, data::Storage::NO_UPDATE));
+                value = spSource->m_value;
+            }
+            m_image.resize(s_pixels);
+            for (size_t i = 0; i < m_image.size(); ++i)
+            {
+                m_image[i] = std::sin(0.001f * float(i + value));
+            }
+            ++g_updates;
+        }
+
+        static size_t s_pixels;
+        std::vector<float> m_image;
+    };
+
+    size_t CBenchDependent::s_pixels = 0;
+
+    //! Observer accessing dependent entries when notified.
+    class CBenchObserver
+    {
+    public:
+        void changed(data::CStorageEntry *pEntry)
+        {
+            ++g_notifications;
+            data::CObjectPtr<CBenchDependent> spDependent(APP_STORAGE.getEntry(pEntry->getId()));
+        }
+    };
+
+    //! Invalidates the source entry like a dragged slider during given number of frames.
+    void simulateFrames(bool bCoalesce)
+    {
+        for (int f = 0; f < FRAMES; ++f)
+        {
+            for (int i = 0; i < INVALIDATIONS_PER_FRAME; ++i)
+            {
+                data::CObjectPtr<CBenchSource> spSource(APP_STORAGE.getEntry(SOURCE_ID, data::Storage::NO_UPDATE));
+                ++spSource->m_value;
+                APP_STORAGE.invalidate(spSource.getEntryPtr());
+            }
+            if (bCoalesce)
+            {
+                APP_STORAGE.flushInvalidation();
+            }
+        }
+    }
+}
+
+namespace data
+{
+    DECLARE_THREAD_SAFE_UPDATE(CBenchDependent);
+}
+
+void benchStorageInvalidation(const SBenchOptions& options)
+{
+    CBenchmark bench("Storage invalidation", options);
+
+    CBenchDependent::s_pixels = size_t(options.size) * size_t(options.size);
+
+    // source entry and entries depending on it
+    STORABLE_FACTORY.registerObject(SOURCE_ID, data::CObjectHolder<CBenchSource>::create);
+    for (int i = 1; i <= DEPENDENT_COUNT; ++i)
+    {
+        STORABLE_FACTORY.registerObject(SOURCE_ID + i, data::CObjectHolder<CBenchDependent>::create, data::CEntryDeps().insert(SOURCE_ID));
+    }
+
+    CBenchObserver observer;
+    std::vector<vpl::mod::tSignalConnection> connections;
+    APP_STORAGE.getEntry(SOURCE_ID);
+    for (int i = 1; i <= DEPENDENT_COUNT; ++i)
+    {
+        APP_STORAGE.getEntry(SOURCE_ID + i);
+        connections.push_back(APP_STORAGE.getEntrySignal(SOURCE_ID + i).connect(&observer, &CBenchObserver::changed));
+    }
+
+    const int runs = options.repeats + 1;
+    g_updates = g_notifications = 0;
+    const double tImmediate = bench.measure("invalidation one by one", [&]()
+    {
+        simulateFrames(false);
+    });
+    CBenchmark::printResult("dependent updates per frame", double(g_updates) / (runs * FRAMES));
+    CBenchmark::printResult("observer notifications per frame", double(g_notifications) / (runs * FRAMES));
+
+    APP_STORAGE.setInvalidationCoalescing(true);
+    g_updates = g_notifications = 0;
+    const double tCoalesced = bench.measure("coalesced per frame", [&]()
+    {
+        simulateFrames(true);
+    });
+    APP_STORAGE.setInvalidationCoalescing(false);
+    CBenchmark::printResult("dependent updates per frame", double(g_updates) / (runs * FRAMES));
+    CBenchmark::printResult("observer notifications per frame", double(g_notifications) / (runs * FRAMES));
+    CBenchmark::printSpeedup("coalesced invalidation", tImmediate, tCoalesced);
+
+    for (int i = 1; i <= DEPENDENT_COUNT; ++i)
+    {
+        APP_STORAGE.getEntrySignal(SOURCE_ID + i).disconnect(connections[i - 1]);
+    }
+}
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
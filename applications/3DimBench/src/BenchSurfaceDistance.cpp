@@ -0,0 +1,117 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+// Measures one mesh against a reference mesh by the octree based
+// HausdorffDistance with a search radius and by the exact BVH based
+// SurfaceDistance. The meshes are two spheres half a unit apart with
+// different tessellation, so the expected maximal distance is about 0.5.
+// Both variants include building their search structure.
+
+#include <CBenchmark.h>
+
+#include <geometry/base/CMesh.h>
+#include <geometry/metrics/hausdorff.h>
+#include <geometry/metrics/surfaceDistance.h>
+
+#include <VPL/Math/Base.h>
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    //! Number of samples taken from the measured mesh.
+    const size_t NUM_SAMPLES = 100000;
+
+    //! Adds a UV sphere centred at the origin with a given number of rings
+    //! and twice as many segments, faces are oriented outwards.
+    void makeSphere(geometry::CMesh& mesh, float radius, int rings)
+    {
+        const int segments = 2 * rings;
+        const geometry::CMesh::VertexHandle top = mesh.add_vertex(geometry::CMesh::Point(0.0f, 0.0f, radius));
+        const geometry::CMesh::VertexHandle bottom = mesh.add_vertex(geometry::CMesh::Point(0.0f, 0.0f, -radius));
+
+        std::vector<geometry::CMesh::VertexHandle> vertices;
+        vertices.reserve((rings - 1) * segments);
+        for (int r = 1; r < rings; ++r)
+        {
+            const double theta = vpl::math::PI * r / rings;
+            for (int s = 0; s < segments; ++s)
+            {
+                const double phi = 2.0 * vpl::math::PI * s / segments;
+                vertices.push_back(mesh.add_vertex(geometry::CMesh::Point(float(radius * std::sin(theta) * std::cos(phi)),
+                                                                          float(radius * std::sin(theta) * std::sin(phi)),
+                                                                          float(radius * std::cos(theta)))));
+            }
+        }
+
+        for (int s = 0; s < segments; ++s)
+        {
+            const int next = (s + 1) % segments;
+            mesh.add_face(top, vertices[s], vertices[next]);
+            for (int r = 0; r < rings - 2; ++r)
+            {
+                const int a = r * segments + s, b = r * segments + next;
+                mesh.add_face(vertices[a], vertices[a + segments], vertices[b + segments]);
+                mesh.add_face(vertices[a], vertices[b + segments], vertices[b]);
+            }
+            const int last = (rings - 2) * segments;
+            mesh.add_face(bottom, vertices[last + next], vertices[last + s]);
+        }
+    }
+}
+
+void benchSurfaceDistance(const SBenchOptions& options)
+{
+    CBenchmark bench("Surface distance", options);
+
+    geometry::CMesh reference, mesh;
+    makeSphere(reference, 10.0f, vpl::math::getMax(options.size / 2, 4));
+    makeSphere(mesh, 10.5f, vpl::math::getMax(options.size / 2, 4) + 3);
+    CBenchmark::printResult("reference faces", double(reference.n_faces()));
+    CBenchmark::printResult("measured faces", double(mesh.n_faces()));
+
+    double maxOctree = 0.0, maxBVH = 0.0;
+    const double tOctree = bench.measure("octree, search radius 1", [&]()
+    {
+        geometry::HausdorffDistance distance(mesh, reference, NUM_SAMPLES);
+        distance.setSampleType(true, true);
+        distance.setDistanceSearch(1.0);
+        distance.compute();
+        maxOctree = distance.getMaxDistance();
+    });
+    const double tBVH = bench.measure("BVH, exact", [&]()
+    {
+        geometry::SurfaceDistance distance(reference);
+        distance.setSampleType(true, true);
+        distance.setSampleCount(NUM_SAMPLES);
+        distance.compute(mesh);
+        maxBVH = distance.getMaxDistance();
+    });
+    CBenchmark::printSpeedup("BVH", tOctree, tBVH);
+    CBenchmark::printResult("max distance, octree", maxOctree);
+    CBenchmark::printResult("max distance, BVH", maxBVH);
+}
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
@@ -0,0 +1,253 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+// Compares the per voxel loops PSVolumeRendering used to prepare volume
+// rendering data with the streaming pass of CVolumeRenderingPreprocessor:
+// the (1 3 1) smoothing or the trilinear resampling to 16 bits followed by
+// the block min/max and the Sobel magnitude of the skipping volume. The
+// stage needs no OpenGL context, both variants run on the CPU only.
+
+#include <CBenchmark.h>
+
+#include <alg/CVolumeRenderingPreprocessor.h>
+
+#include <VPL/Image/VolumeFilters/Sobel.h>
+#include <VPL/Math/Base.h>
+
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+    //! Rounding of volume sizes used by the renderer.
+    const int ROUNDING_MASK = ~3;
+
+    //! Range of densities.
+    const float DENSITY_MIN = float(vpl::img::CPixelTraits<vpl::img::tDensityPixel>::getPixelMin());
+    const float DENSITY_MAX = float(vpl::img::CPixelTraits<vpl::img::tDensityPixel>::getPixelMax());
+
+    //! Scaling of densities to 16 bits and of 16-bit values to 8 bits.
+    const float DATA_SCALE = 65536.0f / (DENSITY_MAX - DENSITY_MIN);
+    const float SKIP_SCALE = 255.0f / 65536.0f;
+
+    //! Allocates volumes of the size the renderer uses for a given subsampling.
+    void allocate(const vpl::img::CDensityVolume& source, float subSampling,
+                  CVolumeRenderingPreprocessor::tVolume& volume, CVolumeRenderingPreprocessor::tAuxVolume& aux)
+    {
+        const int xSize = vpl::math::round2Int(float(source.getXSize()) * subSampling) & ROUNDING_MASK;
+        const int ySize = vpl::math::round2Int(float(source.getYSize()) * subSampling) & ROUNDING_MASK;
+        const int zSize = vpl::math::round2Int(float(source.getZSize()) * subSampling) & ROUNDING_MASK;
+        volume.resize(xSize, ySize, zSize, 0);
+        aux.resize(((xSize + 7) / 8 + 3) & ROUNDING_MASK, ((ySize + 7) / 8 + 3) & ROUNDING_MASK, ((zSize + 7) / 8 + 3) & ROUNDING_MASK, 0);
+    }
+
+    //! The 3x3x3 (1 3 1) filter evaluated per voxel.
+    float filteredValue(const vpl::img::CDensityVolume& source, int x, int y, int z)
+    {
+        const vpl::tSize xOff = source.getXOffset();
+        int zSums[3] = { };
+        for (int dz = -1; dz <= 1; ++dz)
+        {
+            int ySums[3] = { };
+            for (int dy = -1; dy <= 1; ++dy)
+            {
+                const vpl::tSize idx = source.getIdx(x, y + dy, z + dz);
+                ySums[dy + 1] = source.at(idx - xOff) + 3 * source.at(idx) + source.at(idx + xOff);
+            }
+            zSums[dz + 1] = ySums[0] + 3 * ySums[1] + ySums[2];
+        }
+        return float(zSums[0] + 3 * zSums[1] + zSums[2]) / 125.0f;
+    }
+
+    //! Normalizes a density to 16 bits.
+    vpl::img::tPixel16 normalized(float value)
+    {
+        return vpl::img::tPixel16(vpl::math::getMin(vpl::math::getMax((value - DENSITY_MIN) * DATA_SCALE, 0.0f), 65535.0f));
+    }
+
+    //! The former loops: filtering or resampling, block min/max and Sobel passes.
+    void legacyProcess(const vpl::img::CDensityVolume& source, bool resample,
+                       CVolumeRenderingPreprocessor::tVolume& volume, CVolumeRenderingPreprocessor::tAuxVolume& aux)
+    {
+        const int xSize = volume.getXSize(), ySize = volume.getYSize(), zSize = volume.getZSize();
+
+        // the block minimum starts at the top so that it is comparable
+        // with the preprocessor, the renderer used to start it at zero
+        aux.fillEntire(vpl::img::tRGBPixel(0));
+        for (vpl::tSize i = 0; i < aux.getZSize(); ++i)
+        {
+            for (vpl::tSize j = 0; j < aux.getYSize(); ++j)
+            {
+                for (vpl::tSize k = 0; k < aux.getXSize(); ++k)
+                {
+                    aux(k, j, i).r() = 255;
+                }
+            }
+        }
+
+        if (resample)
+        {
+            const double xStep = double(source.getXSize() - 1) / (xSize - 1);
+            const double yStep = double(source.getYSize() - 1) / (ySize - 1);
+            const double zStep = double(source.getZSize() - 1) / (zSize - 1);
+#pragma omp parallel for schedule(static)
+            for (int z = 0; z < zSize; ++z)
+            {
+                vpl::img::CPoint3D point(0.0, 0.0, z * zStep);
+                for (int y = 0; y < ySize; ++y, point.y() += yStep)
+                {
+                    point.x() = 0.0;
+                    for (int x = 0; x < xSize; ++x, point.x() += xStep)
+                    {
+                        volume(x, y, z) = normalized(float(source.interpolate(point)));
+                    }
+                }
+            }
+        }
+        else
+        {
+#pragma omp parallel for schedule(static)
+            for (int z = 0; z < zSize; ++z)
+            {
+                for (int y = 0; y < ySize; ++y)
+                {
+                    for (int x = 0; x < xSize; ++x)
+                    {
+                        volume(x, y, z) = normalized(filteredValue(source, x, y, z));
+                    }
+                }
+            }
+        }
+
+        // block min/max, the chunks cover whole block layers
+#pragma omp parallel for schedule(static, 8)
+        for (int z = 0; z < zSize; ++z)
+        {
+            for (int y = 0; y < ySize; ++y)
+            {
+                for (int x = 0; x < xSize; ++x)
+                {
+                    vpl::img::tRGBPixel& block = aux(x / 8, y / 8, z / 8);
+                    const int skip = int(SKIP_SCALE * float(volume(x, y, z)));
+                    block.r() = vpl::img::tRGBPixel::tComponent(vpl::math::getMin<int>(block.r(), vpl::math::getMax(skip - 1, 0)));
+                    block.g() = vpl::img::tRGBPixel::tComponent(vpl::math::getMax<int>(block.g(), vpl::math::getMin(skip + 1, 255)));
+                }
+            }
+        }
+
+        // gradient magnitude at odd voxels
+        vpl::img::CVolumeSobelX<CVolumeRenderingPreprocessor::tVolume> sobelX;
+        vpl::img::CVolumeSobelY<CVolumeRenderingPreprocessor::tVolume> sobelY;
+        vpl::img::CVolumeSobelZ<CVolumeRenderingPreprocessor::tVolume> sobelZ;
+        const float gradScale = 0.33f * SKIP_SCALE;
+#pragma omp parallel for schedule(static, 8)
+        for (int z = 1; z < zSize - 1; z += 2)
+        {
+            for (int y = 1; y < ySize - 1; y += 2)
+            {
+                for (int x = 1; x < xSize - 1; x += 2)
+                {
+                    vpl::img::tRGBPixel& block = aux(x / 8, y / 8, z / 8);
+                    const float mag = vpl::math::getAbs(float(sobelX.getResponse(volume, x, y, z)))
+                                    + vpl::math::getAbs(float(sobelY.getResponse(volume, x, y, z)))
+                                    + vpl::math::getAbs(float(sobelZ.getResponse(volume, x, y, z)));
+                    block.b() = vpl::math::getMax(block.b(), vpl::img::tRGBPixel::tComponent(gradScale * mag));
+                }
+            }
+        }
+    }
+
+    //! Prints the largest difference of normalized volumes and the number of differing blocks,
+    //! one 16-bit step may move a value across an 8-bit boundary of the skipping volume.
+    void compare(const CVolumeRenderingPreprocessor::tVolume& volume0, const CVolumeRenderingPreprocessor::tAuxVolume& aux0,
+                 const CVolumeRenderingPreprocessor::tVolume& volume1, const CVolumeRenderingPreprocessor::tAuxVolume& aux1)
+    {
+        int maxDiff = 0;
+        for (vpl::tSize z = 0; z < volume0.getZSize(); ++z)
+        {
+            for (vpl::tSize y = 0; y < volume0.getYSize(); ++y)
+            {
+                for (vpl::tSize x = 0; x < volume0.getXSize(); ++x)
+                {
+                    maxDiff = vpl::math::getMax(maxDiff, std::abs(int(volume0(x, y, z)) - int(volume1(x, y, z))));
+                }
+            }
+        }
+
+        // blocks outside the volume are left empty by the preprocessor
+        const int xBlocks = (volume0.getXSize() + 7) / 8, yBlocks = (volume0.getYSize() + 7) / 8, zBlocks = (volume0.getZSize() + 7) / 8;
+        int blocks = 0;
+        for (int z = 0; z < zBlocks; ++z)
+        {
+            for (int y = 0; y < yBlocks; ++y)
+            {
+                for (int x = 0; x < xBlocks; ++x)
+                {
+                    const vpl::img::tRGBPixel& a = aux0(x, y, z);
+                    const vpl::img::tRGBPixel& b = aux1(x, y, z);
+                    blocks += (a.r() != b.r() || a.g() != b.g() || a.b() != b.b()) ? 1 : 0;
+                }
+            }
+        }
+
+        CBenchmark::printResult("max difference of 16-bit values", double(maxDiff));
+        CBenchmark::printResult("differing skipping blocks", double(blocks));
+        if (maxDiff > 1)
+        {
+            std::cout << "  ERROR: results differ" << std::endl;
+        }
+    }
+}
+
+void benchVolumePreprocessing(const SBenchOptions& options)
+{
+    CBenchmark bench("Volume rendering preprocessing", options);
+
+    vpl::img::CDensityVolume source;
+    CBenchmark::makePhantom(source, options.size);
+
+    CVolumeRenderingPreprocessor::tVolume legacyVolume, volume;
+    CVolumeRenderingPreprocessor::tAuxVolume legacyAux, aux;
+
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        const bool resample = (1 == pass);
+        const std::string suffix = resample ? " (resampling to 1/2)" : " (smoothing)";
+        allocate(source, resample ? 0.5f : 1.0f, legacyVolume, legacyAux);
+        allocate(source, resample ? 0.5f : 1.0f, volume, aux);
+
+        const double tLegacy = bench.measure("per voxel loops" + suffix, [&]()
+        {
+            legacyProcess(source, resample, legacyVolume, legacyAux);
+        });
+        const double tStream = bench.measure("streaming preprocessor" + suffix, [&]()
+        {
+            CVolumeRenderingPreprocessor::process(source, resample, volume, aux);
+        });
+        CBenchmark::printSpeedup("preprocessor", tLegacy, tStream);
+        compare(legacyVolume, legacyAux, volume, aux);
+    }
+}
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
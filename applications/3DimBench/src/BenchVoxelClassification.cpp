@@ -0,0 +1,153 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+// Compares classification of marching cubes voxels through the per-voxel
+// virtual operator() with the batched classifyRow() kernels and measures
+// the whole surface extraction with both interfaces.
+
+#include <CBenchmark.h>
+
+#include <alg/CMarchingCubes.h>
+#include <geometry/base/CMesh.h>
+
+#include <VPL/Image/Volume.h>
+
+#include <vector>
+
+namespace
+{
+    //! Hides batched classification of a functor, so that the default
+    //! per-voxel implementation of classifyRow() is used.
+    class CPerVoxelFunctor : public IMarchingCubesFunctor
+    {
+    public:
+        explicit CPerVoxelFunctor(const IMarchingCubesFunctor *functor) : m_functor(functor) {}
+
+        virtual unsigned char operator()(int x, int y, int z) const { return (*m_functor)(x, y, z); }
+        virtual vpl::img::CSize3i getVolumeDimensions() const { return m_functor->getVolumeDimensions(); }
+        virtual vpl::img::CSize3d getVoxelSize() const { return m_functor->getVoxelSize(); }
+
+    protected:
+        const IMarchingCubesFunctor *m_functor;
+    };
+
+    //! Classifies all voxels row by row, returns number of voxels inside.
+    size_t classifyVolume(const IMarchingCubesFunctor &functor, std::vector<CVoxelRowClassifier::tWord> &bits)
+    {
+        const vpl::img::CSize3i size = functor.getVolumeDimensions();
+        const int count = size.x() + 2;
+        bits.resize(CVoxelRowClassifier::wordCount(count));
+
+        size_t inside = 0;
+        for (int z = 0; z < size.z(); ++z)
+        {
+            for (int y = 0; y < size.y(); ++y)
+            {
+                // the same row span as marching cubes workers classify
+                functor.classifyRow(-1, y, z, count, &bits[0]);
+                for (size_t i = 0; i < bits.size(); ++i)
+                {
+                    for (CVoxelRowClassifier::tWord w = bits[i]; w != 0; w &= w - 1)
+                    {
+                        ++inside;
+                    }
+                }
+            }
+        }
+        return inside;
+    }
+
+    //! Measures both interfaces of a functor.
+    void compare(CBenchmark &bench, const std::string &name, const IMarchingCubesFunctor &functor)
+    {
+        CPerVoxelFunctor perVoxel(&functor);
+        std::vector<CVoxelRowClassifier::tWord> bits;
+        size_t insideVoxel = 0, insideBatched = 0;
+
+        const double tVoxel = bench.measure(name + " per voxel", [&]() { insideVoxel = classifyVolume(perVoxel, bits); });
+        const double tBatched = bench.measure(name + " batched", [&]() { insideBatched = classifyVolume(functor, bits); });
+        CBenchmark::printSpeedup(name, tVoxel, tBatched);
+        if (insideVoxel != insideBatched)
+        {
+            std::cout << "  ERROR: " << name << " classifications differ (" << insideVoxel << " != " << insideBatched << ")" << std::endl;
+        }
+    }
+}
+
+void benchVoxelClassification(const SBenchOptions& options)
+{
+    CBenchmark bench("Marching cubes voxel classification", options);
+
+    vpl::img::CDensityVolume volume;
+    CBenchmark::makePhantom(volume, options.size);
+    const vpl::img::CSize3d voxelSize(volume.getDX(), volume.getDY(), volume.getDZ());
+
+    // region like mask selecting the left half of the volume
+    typedef vpl::img::CVolume<vpl::img::tPixel32> tMaskVolume;
+    tMaskVolume mask(volume.getXSize(), volume.getYSize(), volume.getZSize(), volume.getMargin());
+    mask.fillEntire(0);
+    for (vpl::tSize z = 0; z < mask.getZSize(); ++z)
+    {
+        for (vpl::tSize y = 0; y < mask.getYSize(); ++y)
+        {
+            for (vpl::tSize x = 0; x < mask.getXSize() / 2; ++x)
+            {
+                mask.set(x, y, z, 5);
+            }
+        }
+    }
+
+    CThresholdFunctor<vpl::img::CDensityVolume, vpl::img::tDensityPixel> threshold(300, 3000, &volume, voxelSize);
+    CMaskedThresholdFunctor<vpl::img::CDensityVolume, vpl::img::tDensityPixel, tMaskVolume, vpl::img::tPixel32>
+        masked(300, 3000, &volume, 4, 4, &mask, voxelSize, 0.5, 0);
+
+    compare(bench, "threshold", threshold);
+    compare(bench, "masked threshold", masked);
+
+    // whole bone surface extraction
+    CPerVoxelFunctor perVoxel(&threshold);
+    size_t trianglesVoxel = 0, trianglesBatched = 0;
+    const double tVoxel = bench.measure("marching cubes per voxel", [&]()
+    {
+        geometry::CMesh mesh;
+        CMarchingCubes mc;
+        mc.generateMesh(mesh, &perVoxel, false);
+        trianglesVoxel = mesh.n_faces();
+    });
+    const double tBatched = bench.measure("marching cubes batched", [&]()
+    {
+        geometry::CMesh mesh;
+        CMarchingCubes mc;
+        mc.generateMesh(mesh, &threshold, false);
+        trianglesBatched = mesh.n_faces();
+    });
+    CBenchmark::printSpeedup("marching cubes", tVoxel, tBatched);
+    CBenchmark::printResult("triangles", double(trianglesBatched));
+    if (trianglesVoxel != trianglesBatched)
+    {
+        std::cout << "  ERROR: meshes differ (" << trianglesVoxel << " != " << trianglesBatched << " triangles)" << std::endl;
+    }
+}
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
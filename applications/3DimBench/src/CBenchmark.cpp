@@ -0,0 +1,83 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <CBenchmark.h>
+
+#include <cmath>
+
+void CBenchmark::makePhantom(vpl::img::CDensityVolume& volume, int size)
+{
+    volume.resize(size, size, size, 3);
+    volume.setDX(0.5);
+    volume.setDY(0.5);
+    volume.setDZ(0.5);
+    volume.fillEntire(-1000);
+
+    const double c = 0.5 * size;
+    const double body = 0.42 * size;
+    const double bone = 0.06 * size;
+
+    // spheres and a rod along z playing the role of bones
+    const double spheres[][3] = { { 0.35, 0.4, 0.3 }, { 0.65, 0.45, 0.5 }, { 0.5, 0.7, 0.7 }, { 0.4, 0.6, 0.55 } };
+
+#pragma omp parallel for
+    for (int z = 0; z < size; ++z)
+    {
+        // deterministic noise independent on the number of threads
+        unsigned seed = 12345u + unsigned(z) * 7919u;
+        for (int y = 0; y < size; ++y)
+        {
+            for (int x = 0; x < size; ++x)
+            {
+                seed = seed * 1103515245u + 12345u;
+                const double noise = double((seed >> 16) & 0xff) - 128.0;
+
+                const double rx = x - c, ry = y - c;
+                if (rx * rx + ry * ry > body * body)
+                {
+                    continue;
+                }
+                double value = 40.0 + 0.5 * noise;
+
+                const double dx = x - 0.5 * size, dy = y - 0.3 * size;
+                if (dx * dx + dy * dy < bone * bone)
+                {
+                    value = 1200.0 + noise;
+                }
+                for (int i = 0; i < 4; ++i)
+                {
+                    const double sx = x - spheres[i][0] * size, sy = y - spheres[i][1] * size, sz = z - spheres[i][2] * size;
+                    const double r = std::sqrt(sx * sx + sy * sy + sz * sz) / (1.5 * bone);
+                    if (r < 1.0)
+                    {
+                        value = std::max(value, 1600.0 * (1.0 - r) + 300.0 + noise);
+                    }
+                }
+                volume.set(x, y, z, vpl::img::tDensityPixel(value));
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
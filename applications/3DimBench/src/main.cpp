@@ -0,0 +1,135 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+// Benchmarks of performance critical algorithms on synthetic data.
+//
+// Usage: 3DimBench [options] [<name> ...]
+//   name selects benchmarks whose name contains it, all are run by default
+//
+// Options:
+//   --size <voxels>    edge of synthetic volumes (256)
+//   --repeats <count>  number of measured runs of every variant (5)
+//   --list             print names of benchmarks
+
+#include <CBenchmark.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    //! Registered benchmark.
+    struct SBenchEntry
+    {
+        const char *name;
+        void (*func)(const SBenchOptions&);
+    };
+
+    //! List of all benchmarks.
+    const SBenchEntry g_benchmarks[] =
+    {
+        { "classification", benchVoxelClassification },
+        { "dicom", benchDicomLoading },
+        { "dicomindex", benchDicomIndex },
+        { "colorizer", benchSliceColorizer },
+        { "storage", benchStorageInvalidation },
+        { "components", benchMeshComponents },
+        { "volumerender", benchVolumePreprocessing },
+        { "surfacedistance", benchSurfaceDistance },
+    };
+
+    void printUsage()
+    {
+        std::cout << "Usage: 3DimBench [options] [<name> ...]" << std::endl
+                  << "  name selects benchmarks whose name contains it" << std::endl
+                  << "Options:" << std::endl
+                  << "  --size <voxels>    edge of synthetic volumes (256)" << std::endl
+                  << "  --repeats <count>  number of measured runs of every variant (5)" << std::endl
+                  << "  --list             print names of benchmarks" << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    SBenchOptions options;
+    std::vector<std::string> filters;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const bool bHasValue = i + 1 < argc;
+        if (arg == "--help" || arg == "-h")
+        {
+            printUsage();
+            return EXIT_SUCCESS;
+        }
+        else if (arg == "--size" && bHasValue)
+        {
+            options.size = std::max(16, atoi(argv[++i]));
+        }
+        else if (arg == "--repeats" && bHasValue)
+        {
+            options.repeats = std::max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--list")
+        {
+            for (const SBenchEntry& entry : g_benchmarks)
+            {
+                std::cout << entry.name << std::endl;
+            }
+            return EXIT_SUCCESS;
+        }
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            std::cerr << "Unknown option " << arg << std::endl;
+            printUsage();
+            return EXIT_FAILURE;
+        }
+        else
+        {
+            filters.push_back(arg);
+        }
+    }
+
+    std::cout << "Volume size " << options.size << "^3, " << options.repeats << " repeats" << std::endl;
+    for (const SBenchEntry& entry : g_benchmarks)
+    {
+        bool bSelected = filters.empty();
+        for (size_t i = 0; i < filters.size() && !bSelected; ++i)
+        {
+            bSelected = std::string(entry.name).find(filters[i]) != std::string::npos;
+        }
+        if (bSelected)
+        {
+            entry.func(options);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
@@ -0,0 +1,171 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef CMeshBatchJob_H
+#define CMeshBatchJob_H
+
+#include <data/CDensityData.h>
+
+#include <VPL/Image/PixelTypes.h>
+
+#include <string>
+
+///////////////////////////////////////////////////////////////////////////////
+//! Parameters shared by all jobs of a batch run.
+
+struct SMeshBatchParams
+{
+    //! Density threshold range.
+    vpl::img::tDensityPixel low, high;
+
+    //! Submeshes with less triangles are removed (0 disables the step).
+    int minSubmeshSize;
+
+    //! Number of smoothing loops (0 disables the step).
+    int smoothingLoops;
+
+    //! Percentage of triangles kept by the decimation (100 disables the step).
+    int decimationPercent;
+
+    //! Output file extension, also selects the writer (stl, ctm, ply, obj).
+    std::string format;
+
+    //! Output directory, the directory of the input is used if empty.
+    std::string outputDir;
+
+    //! Directory with indexes of scanned DICOM directories (disabled if empty).
+    std::string dicomIndexDir;
+
+    //! Edge of the volume rendered MIP thumbnail in pixels (0 disables the step).
+    int thumbnailSize;
+
+    //! Default constructor, matches the defaults of the viewer.
+    SMeshBatchParams()
+        : low(500)
+        , high(2000)
+        , minSubmeshSize(500)
+        , smoothingLoops(10)
+        , decimationPercent(20)
+        , format("stl")
+        , thumbnailSize(0)
+    { }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! Converts one study (VLM file or DICOM directory) to a surface mesh
+//! using the same pipeline as the viewer, i.e. thresholding, marching cubes,
+//! small submesh reduction, smoothing and decimation.
+//! - Optionally renders a thumbnail of the study by the software raycaster.
+//! - Does not touch the data storage, so jobs can run concurrently.
+//! - DICOM loaders change the process working directory, so DICOM inputs are
+//!   scanned and loaded by one job at a time and all paths must be absolute.
+
+class CMeshBatchJob
+{
+public:
+    //! Pipeline stages.
+    enum EStage
+    {
+        STAGE_LOAD = 0,
+        STAGE_THUMBNAIL,
+        STAGE_MARCHING_CUBES,
+        STAGE_REDUCE,
+        STAGE_SMOOTH,
+        STAGE_DECIMATE,
+        STAGE_WRITE,
+        STAGE_COUNT
+    };
+
+public:
+    //! Constructor, mask is an optional VLM file whose nonzero voxels restrict the thresholding.
+    CMeshBatchJob(const std::string& input, const std::string& mask, const SMeshBatchParams& params);
+
+    //! Runs the whole pipeline.
+    bool run();
+
+    //! Returns the input file or directory.
+    const std::string& getInput() const { return m_input; }
+
+    //! Returns the written file name.
+    const std::string& getOutput() const { return m_output; }
+
+    //! Returns the written thumbnail file name.
+    const std::string& getThumbnail() const { return m_thumbnail; }
+
+    //! Returns description of the failure.
+    const std::string& getError() const { return m_error; }
+
+    //! Returns duration of a stage in seconds.
+    double getStageTime(int stage) const { return m_stageTimes[stage]; }
+
+    //! Returns name of a stage.
+    static const char *getStageName(int stage);
+
+    //! Returns single line summary of the job.
+    std::string getReport() const;
+
+protected:
+    //! Loads the input volume.
+    bool loadInput(data::CDensityData& volume);
+
+    //! Loads a VLM file, either bricked or serialized.
+    bool loadVLM(const std::string& fileName, data::CDensityData& volume);
+
+    //! Loads the largest DICOM serie found in the input.
+    bool loadDicom(data::CDensityData& volume);
+
+    //! Renders the MIP thumbnail of the volume and writes it as a PNG file.
+    bool writeThumbnail(const data::CDensityData& volume);
+
+    //! Builds an output file name from the input name and a given suffix.
+    std::string makeOutputName(const std::string& suffix) const;
+
+    //! Progress callback, the batch never cancels.
+    bool progress(int, int) { return true; }
+
+protected:
+    //! Input file or directory.
+    std::string m_input;
+
+    //! Mask file.
+    std::string m_mask;
+
+    //! Output file.
+    std::string m_output;
+
+    //! Thumbnail file.
+    std::string m_thumbnail;
+
+    //! Error message.
+    std::string m_error;
+
+    //! Parameters.
+    SMeshBatchParams m_params;
+
+    //! Duration of stages in seconds.
+    double m_stageTimes[STAGE_COUNT];
+
+    //! Mesh size after the last stage.
+    int m_numVertices, m_numFaces;
+};
+
+#endif // CMeshBatchJob_H
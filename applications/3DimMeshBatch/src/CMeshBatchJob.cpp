@@ -0,0 +1,480 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <CMeshBatchJob.h>
+
+#include <data/CBrickedVolumeFile.h>
+#include <data/CDicomLoader.h>
+#include <data/CDicomVolumeLoader.h>
+#include <data/CSeries.h>
+
+#include <alg/CMarchingCubes.h>
+#include <alg/CDecimator.h>
+#include <alg/CSmoothing.h>
+#include <alg/CReduceSmallSubmeshes.h>
+
+#include <geometry/base/CMesh.h>
+
+#include <render/CLookupTable.h>
+#include <render/PSVRraycaster.h>
+
+#include <VPL/Math/Base.h>
+#include <VPL/ImageIO/DicomSlice.h>
+#include <VPL/Module/Serialization.h>
+
+#include <OpenMesh/Core/IO/MeshIO.hh>
+
+#include <QFileInfo>
+#include <QDir>
+#include <QImage>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <iomanip>
+
+namespace
+{
+    //! Returns seconds elapsed since a given time point.
+    double secondsSince(const std::chrono::steady_clock::time_point& start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    //! Serializes scanning and loading of DICOM files. CDicomLoader and CSeries
+    //! change the working directory of the whole process while reading files.
+    std::mutex g_dicomMutex;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+CMeshBatchJob::CMeshBatchJob(const std::string& input, const std::string& mask, const SMeshBatchParams& params)
+    : m_input(input)
+    , m_mask(mask)
+    , m_params(params)
+    , m_numVertices(0)
+    , m_numFaces(0)
+{
+    std::fill(m_stageTimes, m_stageTimes + STAGE_COUNT, 0.0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+const char *CMeshBatchJob::getStageName(int stage)
+{
+    static const char *names[STAGE_COUNT] = { "load", "thumb", "mc", "reduce", "smooth", "decimate", "write" };
+    return (stage >= 0 && stage < STAGE_COUNT) ? names[stage] : "";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+std::string CMeshBatchJob::getReport() const
+{
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    ss << m_input << ":";
+    double total = 0.0;
+    for (int i = 0; i < STAGE_COUNT; ++i)
+    {
+        ss << " " << getStageName(i) << " " << m_stageTimes[i] << "s";
+        total += m_stageTimes[i];
+    }
+    ss << ", total " << total << "s";
+    if (m_error.empty())
+    {
+        ss << ", " << m_numVertices << " vertices, " << m_numFaces << " faces -> " << m_output;
+        if (!m_thumbnail.empty())
+        {
+            ss << ", thumbnail -> " << m_thumbnail;
+        }
+    }
+    else
+    {
+        ss << ", FAILED: " << m_error;
+    }
+    return ss.str();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool CMeshBatchJob::run()
+{
+    vpl::mod::CProgress::tProgressFunc ProgressFunc(this, &CMeshBatchJob::progress);
+
+    // Load the density data and the optional mask
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    data::CDensityData Volume;
+    data::CDensityData Mask;
+    bool bLoaded = loadInput(Volume);
+    if (bLoaded && !m_mask.empty())
+    {
+        bLoaded = loadVLM(m_mask, Mask);
+        if (bLoaded && (Mask.getXSize() != Volume.getXSize() || Mask.getYSize() != Volume.getYSize() || Mask.getZSize() != Volume.getZSize()))
+        {
+            m_error = "mask size differs from the volume size";
+            bLoaded = false;
+        }
+        if (bLoaded)
+        {
+            // Any nonzero voxel belongs to the mask
+            for (vpl::tSize z = 0; z < Mask.getZSize(); ++z)
+            {
+                for (vpl::tSize y = 0; y < Mask.getYSize(); ++y)
+                {
+                    for (vpl::tSize x = 0; x < Mask.getXSize(); ++x)
+                    {
+                        Mask(x, y, z) = (Mask(x, y, z) != 0) ? 1 : 0;
+                    }
+                }
+            }
+        }
+    }
+    m_stageTimes[STAGE_LOAD] = secondsSince(start);
+    if (!bLoaded)
+    {
+        if (m_error.empty())
+        {
+            m_error = "cannot load input data";
+        }
+        return false;
+    }
+
+    // Render the thumbnail before the volume is released
+    start = std::chrono::steady_clock::now();
+    if (m_params.thumbnailSize > 0 && !writeThumbnail(Volume))
+    {
+        m_stageTimes[STAGE_THUMBNAIL] = secondsSince(start);
+        return false;
+    }
+    m_stageTimes[STAGE_THUMBNAIL] = secondsSince(start);
+
+    // Create the surface
+    start = std::chrono::steady_clock::now();
+    geometry::CMesh Mesh;
+    {
+        CMarchingCubes mc;
+        mc.registerProgressFunc(ProgressFunc);
+        vpl::img::CSize3d voxelSize = vpl::img::CSize3d(Volume.getDX(), Volume.getDY(), Volume.getDZ());
+        bool bGenerated = false;
+        if (m_mask.empty())
+        {
+            CThresholdFunctor<vpl::img::CDensityVolume, vpl::img::tDensityPixel> ThresholdFunc(m_params.low, m_params.high, &Volume, voxelSize);
+            bGenerated = mc.generateMesh(Mesh, &ThresholdFunc, true);
+        }
+        else
+        {
+            CMaskedThresholdFunctor<vpl::img::CDensityVolume, vpl::img::tDensityPixel, vpl::img::CDensityVolume, vpl::img::tDensityPixel>
+                ThresholdFunc(m_params.low, m_params.high, &Volume, 1, 1, &Mask, voxelSize, 0.5, 0);
+            bGenerated = mc.generateMesh(Mesh, &ThresholdFunc, true);
+        }
+        if (!bGenerated || Mesh.n_faces() == 0)
+        {
+            m_stageTimes[STAGE_MARCHING_CUBES] = secondsSince(start);
+            m_error = "no surface was found";
+            return false;
+        }
+    }
+    Volume.resize(0, 0, 0, 0);
+    Mask.resize(0, 0, 0, 0);
+    m_stageTimes[STAGE_MARCHING_CUBES] = secondsSince(start);
+
+    // Remove small parts
+    start = std::chrono::steady_clock::now();
+    if (m_params.minSubmeshSize > 0)
+    {
+        CSmallSubmeshReducer rc;
+        rc.reduce(Mesh, m_params.minSubmeshSize);
+    }
+    m_stageTimes[STAGE_REDUCE] = secondsSince(start);
+
+    // Smooth model
+    start = std::chrono::steady_clock::now();
+    if (m_params.smoothingLoops > 0)
+    {
+        CSmoothing sm;
+        sm.registerProgressFunc(ProgressFunc);
+        if (!sm.Smooth(Mesh, m_params.smoothingLoops))
+        {
+            m_stageTimes[STAGE_SMOOTH] = secondsSince(start);
+            m_error = "smoothing failed";
+            return false;
+        }
+    }
+    m_stageTimes[STAGE_SMOOTH] = secondsSince(start);
+
+    // Decimate model
+    start = std::chrono::steady_clock::now();
+    if (m_params.decimationPercent < 100)
+    {
+        CDecimator dc;
+        dc.registerProgressFunc(ProgressFunc);
+        int output_mesh_size_tri = int((Mesh.n_faces() * m_params.decimationPercent) / 100);
+        int output_mesh_size_vert = 1;
+        if (!dc.Reduce(Mesh, output_mesh_size_vert, output_mesh_size_tri))
+        {
+            m_stageTimes[STAGE_DECIMATE] = secondsSince(start);
+            m_error = "decimation failed";
+            return false;
+        }
+    }
+    m_stageTimes[STAGE_DECIMATE] = secondsSince(start);
+
+    // Save model
+    start = std::chrono::steady_clock::now();
+    m_output = makeOutputName("." + m_params.format);
+    m_numVertices = int(Mesh.n_vertices());
+    m_numFaces = int(Mesh.n_faces());
+
+    OpenMesh::IO::Options wopt = OpenMesh::IO::Options::Binary;
+    if (m_params.format == "ply" || m_params.format == "obj")
+    {
+        wopt = OpenMesh::IO::Options::Default;
+    }
+    if (m_params.format == "ctm" && !Mesh.has_vertex_normals())
+    {
+        Mesh.request_vertex_normals();  //writer needs per vertex normals..
+        Mesh.update_normals();
+    }
+    bool bWritten = OpenMesh::IO::write_mesh(Mesh, m_output, wopt);
+    m_stageTimes[STAGE_WRITE] = secondsSince(start);
+    if (!bWritten)
+    {
+        m_error = "cannot write " + m_output;
+        return false;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool CMeshBatchJob::loadInput(data::CDensityData& volume)
+{
+    QFileInfo fi(QString::fromUtf8(m_input.c_str()));
+    if (!fi.exists())
+    {
+        m_error = "input does not exist";
+        return false;
+    }
+    if (!fi.isDir() && 0 == fi.suffix().compare("vlm", Qt::CaseInsensitive))
+    {
+        return loadVLM(m_input, volume);
+    }
+    return loadDicom(volume);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool CMeshBatchJob::loadVLM(const std::string& fileName, data::CDensityData& volume)
+{
+    vpl::mod::CProgress::tProgressFunc ProgressFunc(this, &CMeshBatchJob::progress);
+    const vpl::sys::tString sFileName = vpl::sys::tStringConv::fromUtf8(fileName);
+
+    if (data::CBrickedVolumeFile::isBrickedFile(sFileName))
+    {
+        data::CBrickedVolumeFile BrickedFile;
+        if (!BrickedFile.open(sFileName))
+        {
+            m_error = "invalid bricked VLM file " + fileName;
+            return false;
+        }
+        BrickedFile.prepare(volume);
+        bool bResult = BrickedFile.readRemaining(volume, ProgressFunc);
+        BrickedFile.close();
+        if (bResult)
+        {
+            volume.mirrorMargin();
+        }
+        return bResult;
+    }
+
+    try
+    {
+        // Try to load vlm with metadata first
+        {
+            vpl::mod::CFileChannelU Channel(vpl::mod::CH_IN, sFileName);
+            if (!Channel.connect())
+            {
+                m_error = "cannot open " + fileName;
+                return false;
+            }
+            if (vpl::mod::read(volume, Channel, ProgressFunc))
+            {
+                volume.mirrorMargin();
+                return true;
+            }
+        }
+
+        // Then voxel data only
+        vpl::mod::CFileChannelU Channel(vpl::mod::CH_IN, sFileName);
+        vpl::img::CDensityVolume VolumeData;
+        if (!Channel.connect() || !vpl::mod::read(VolumeData, Channel, ProgressFunc))
+        {
+            m_error = "cannot read " + fileName;
+            return false;
+        }
+        volume.makeRef(VolumeData);
+        volume.clearDicomData();
+        volume.mirrorMargin();
+    }
+    catch (const vpl::base::CException&)
+    {
+        m_error = "cannot read " + fileName;
+        return false;
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool CMeshBatchJob::loadDicom(data::CDensityData& volume)
+{
+    // Only one job at a time may read DICOM files, see g_dicomMutex
+    std::lock_guard<std::mutex> lock(g_dicomMutex);
+
+    // Find all series
+    data::CDicomLoader Loader;
+    if (!m_params.dicomIndexDir.empty())
+    {
+        Loader.setIndexCacheDirectory(vpl::sys::tStringConv::fromUtf8(m_params.dicomIndexDir));
+    }
+    data::CSeries::tSmartPtr spSeries;
+    const vpl::sys::tString sInput = vpl::sys::tStringConv::fromUtf8(m_input);
+    if (QFileInfo(QString::fromUtf8(m_input.c_str())).isDir())
+    {
+        spSeries = Loader.preLoadDirectory(sInput);
+    }
+    else
+    {
+        spSeries = Loader.preLoadFile(sInput);
+    }
+    if (!spSeries.get() || spSeries->getNumSeries() <= 0)
+    {
+        m_error = "no valid DICOM dataset found";
+        return false;
+    }
+
+    // Take the serie with the most files, that is the scan in a typical study
+    data::CSerieInfo *pSerie = NULL;
+    for (int i = 0; i < spSeries->getNumSeries(); ++i)
+    {
+        data::CSerieInfo *pCandidate = spSeries->getSerie(i);
+        if (NULL != pCandidate && (NULL == pSerie || pCandidate->getNumOfDicomFiles() > pSerie->getNumOfDicomFiles()))
+        {
+            pSerie = pCandidate;
+        }
+    }
+    if (NULL == pSerie || pSerie->getNumOfDicomFiles() <= 0)
+    {
+        m_error = "no valid DICOM dataset found";
+        return false;
+    }
+
+    // The same loader as in the viewer checks orientation and positions of slices
+    vpl::mod::CProgress::tProgressFunc ProgressFunc(this, &CMeshBatchJob::progress);
+    data::sExtendedTags tags;
+    vpl::img::CDicomSlice RepSlice;
+    data::CDicomVolumeLoader VolumeLoader;
+    if (!VolumeLoader.load(pSerie, tags, ProgressFunc, volume, RepSlice))
+    {
+        m_error = "cannot load DICOM files";
+        return false;
+    }
+    volume.mirrorMargin();
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool CMeshBatchJob::writeThumbnail(const data::CDensityData& volume)
+{
+    // About two voxels per pixel are enough, larger data are subsampled
+    const int maxSize = vpl::math::getMax<int>(volume.getXSize(), volume.getYSize(), volume.getZSize());
+    const float subSampling = vpl::math::getMin(1.0f, float(2 * m_params.thumbnailSize) / float(vpl::math::getMax(maxSize, 1)));
+
+    PSVR::PSVolumeRaycaster raycaster;
+    if (!raycaster.setData(volume, subSampling))
+    {
+        m_error = "no data for the thumbnail";
+        return false;
+    }
+
+    // The "MIP hard" lookup table of the viewer
+    std::map<std::string, CLookupTable> lookupTables;
+    createBuiltinLookupTables(lookupTables);
+    raycaster.setLookupTable(lookupTables["MIP_HARD"]);
+    raycaster.getParams().mode = PSVR::PSVolumeRaycaster::EMode::MIP;
+
+    // Frontal view, the patient is looked at from the anterior side
+    vpl::img::CRGBImage rendered;
+    if (!raycaster.renderThumbnail(osg::Vec3(0.0f, 1.0f, 0.0f), osg::Vec3(0.0f, 0.0f, 1.0f), m_params.thumbnailSize, rendered))
+    {
+        m_error = "cannot render the thumbnail";
+        return false;
+    }
+
+    QImage image(rendered.getXSize(), rendered.getYSize(), QImage::Format_RGBA8888);
+    for (vpl::tSize y = 0; y < rendered.getYSize(); ++y)
+    {
+        uchar *line = image.scanLine(y);
+        for (vpl::tSize x = 0; x < rendered.getXSize(); ++x)
+        {
+            const vpl::img::tRGBPixel& pixel = rendered(x, y);
+            line[4 * x] = pixel.r();
+            line[4 * x + 1] = pixel.g();
+            line[4 * x + 2] = pixel.b();
+            line[4 * x + 3] = pixel.a();
+        }
+    }
+
+    m_thumbnail = makeOutputName("_thumbnail.png");
+    if (!image.save(QString::fromUtf8(m_thumbnail.c_str()), "PNG"))
+    {
+        m_error = "cannot write " + m_thumbnail;
+        return false;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+std::string CMeshBatchJob::makeOutputName(const std::string& suffix) const
+{
+    QFileInfo fi(QString::fromUtf8(m_input.c_str()));
+    QString baseName = fi.isDir() ? QDir(fi.absoluteFilePath()).dirName() : fi.completeBaseName();
+    QString dir = m_params.outputDir.empty() ? fi.absolutePath() : QString::fromUtf8(m_params.outputDir.c_str());
+    QString name = QDir(dir).filePath(baseName + QString::fromStdString(suffix));
+    return name.toStdString();
+}
@@ -0,0 +1,279 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Headless batch conversion of studies to surface meshes.
+//
+// Usage: 3DimMeshBatch [options] <input> [<input> ...]
+//   input is a VLM file or a DICOM directory (or file)
+//
+// Options:
+//   --low <value>          lower density threshold (500)
+//   --high <value>         upper density threshold (2000)
+//   --min-submesh <count>  remove parts with less triangles, 0 disables (500)
+//   --smooth <loops>       smoothing loops, 0 disables (10)
+//   --decimate <percent>   percentage of triangles kept, 100 disables (20)
+//   --format <ext>         stl, ctm, ply or obj (stl)
+//   --output <dir>         output directory (directory of the input)
+//   --list <file>          text file with one "<input> [<mask.vlm>]" per line
+//   --dicom-index <dir>    keep headers of scanned DICOM files for later runs
+//   --jobs <count>         number of studies processed concurrently,
+//                          DICOM inputs are still read one at a time
+//   --thumbnail <pixels>   also render a MIP thumbnail of the volume, 0 disables (0)
+
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
+#include <CMeshBatchJob.h>
+
+#include <geometry/base/CTMWriter.h>
+
+#include <VPL/Base/Logging.h>
+#include <VPL/Math/Base.h>
+
+#include <QCoreApplication>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+    //! Input and optional mask of a single job.
+    struct SJobInput
+    {
+        std::string input;
+        std::string mask;
+    };
+
+    void printUsage()
+    {
+        std::cout << "Usage: 3DimMeshBatch [options] <input> [<input> ...]" << std::endl
+                  << "  input is a VLM file or a DICOM directory" << std::endl
+                  << "Options:" << std::endl
+                  << "  --low <value>          lower density threshold (500)" << std::endl
+                  << "  --high <value>         upper density threshold (2000)" << std::endl
+                  << "  --min-submesh <count>  remove parts with less triangles, 0 disables (500)" << std::endl
+                  << "  --smooth <loops>       smoothing loops, 0 disables (10)" << std::endl
+                  << "  --decimate <percent>   percentage of triangles kept, 100 disables (20)" << std::endl
+                  << "  --format <ext>         stl, ctm, ply or obj (stl)" << std::endl
+                  << "  --output <dir>         output directory (directory of the input)" << std::endl
+                  << "  --list <file>          text file with one \"<input> [<mask.vlm>]\" per line" << std::endl
+                  << "  --dicom-index <dir>    keep headers of scanned DICOM files for later runs" << std::endl
+                  << "  --jobs <count>         number of studies processed concurrently" << std::endl
+                  << "  --thumbnail <pixels>   also render a MIP thumbnail of the volume, 0 disables (0)" << std::endl;
+    }
+
+    //! Returns absolute version of a path, empty path stays empty.
+    std::string absolutePath(const std::string& path)
+    {
+        if (path.empty())
+        {
+            return path;
+        }
+        return QFileInfo(QString::fromUtf8(path.c_str())).absoluteFilePath().toUtf8().constData();
+    }
+
+    //! Reads job list, empty lines and lines starting with # are skipped.
+    bool readJobList(const std::string& fileName, std::vector<SJobInput>& jobs)
+    {
+        std::ifstream file(fileName.c_str());
+        if (!file.is_open())
+        {
+            return false;
+        }
+        std::string line;
+        while (std::getline(file, line))
+        {
+            std::istringstream ss(line);
+            SJobInput job;
+            if (!(ss >> job.input) || job.input[0] == '#')
+            {
+                continue;
+            }
+            ss >> job.mask;
+            jobs.push_back(job);
+        }
+        return true;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // Qt is used for file system access and image writing only, no display is needed
+    QCoreApplication app(argc, argv);
+
+    // Reference the writer so that it gets registered by OpenMesh
+    OpenMesh::IO::CTMWriter();
+
+    SMeshBatchParams params;
+    std::vector<SJobInput> inputs;
+    int numJobs = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const bool bHasValue = i + 1 < argc;
+        if (arg == "--help" || arg == "-h")
+        {
+            printUsage();
+            return EXIT_SUCCESS;
+        }
+        else if (arg == "--low" && bHasValue)
+        {
+            params.low = vpl::img::tDensityPixel(atoi(argv[++i]));
+        }
+        else if (arg == "--high" && bHasValue)
+        {
+            params.high = vpl::img::tDensityPixel(atoi(argv[++i]));
+        }
+        else if (arg == "--min-submesh" && bHasValue)
+        {
+            params.minSubmeshSize = atoi(argv[++i]);
+        }
+        else if (arg == "--smooth" && bHasValue)
+        {
+            params.smoothingLoops = atoi(argv[++i]);
+        }
+        else if (arg == "--decimate" && bHasValue)
+        {
+            params.decimationPercent = vpl::math::getMax(1, vpl::math::getMin(100, atoi(argv[++i])));
+        }
+        else if (arg == "--format" && bHasValue)
+        {
+            params.format = argv[++i];
+            std::transform(params.format.begin(), params.format.end(), params.format.begin(), ::tolower);
+        }
+        else if (arg == "--output" && bHasValue)
+        {
+            params.outputDir = argv[++i];
+        }
+        else if (arg == "--list" && bHasValue)
+        {
+            if (!readJobList(argv[++i], inputs))
+            {
+                std::cerr << "Cannot read job list " << argv[i] << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if (arg == "--dicom-index" && bHasValue)
+        {
+            params.dicomIndexDir = argv[++i];
+        }
+        else if (arg == "--jobs" && bHasValue)
+        {
+            numJobs = atoi(argv[++i]);
+        }
+        else if (arg == "--thumbnail" && bHasValue)
+        {
+            params.thumbnailSize = vpl::math::getMax(0, atoi(argv[++i]));
+        }
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            std::cerr << "Unknown option " << arg << std::endl;
+            printUsage();
+            return EXIT_FAILURE;
+        }
+        else
+        {
+            SJobInput job;
+            job.input = arg;
+            inputs.push_back(job);
+        }
+    }
+
+    if (inputs.empty())
+    {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+    if (params.format != "stl" && params.format != "ctm" && params.format != "ply" && params.format != "obj")
+    {
+        std::cerr << "Unsupported output format " << params.format << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // DICOM loaders change the working directory of the process while another
+    // job may be opening its files, so no job may depend on relative paths
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        inputs[i].input = absolutePath(inputs[i].input);
+        inputs[i].mask = absolutePath(inputs[i].mask);
+    }
+    params.outputDir = absolutePath(params.outputDir);
+    params.dicomIndexDir = absolutePath(params.dicomIndexDir);
+
+    // Studies are processed concurrently, the remaining cores are left
+    // to the parallel loops inside the pipeline
+#ifdef _OPENMP
+    const int numProcs = omp_get_num_procs();
+    if (numJobs <= 0)
+    {
+        numJobs = vpl::math::getMax(1, numProcs / 4);
+    }
+    numJobs = vpl::math::getMin(numJobs, int(inputs.size()));
+    const int numInnerThreads = vpl::math::getMax(1, numProcs / numJobs);
+    omp_set_nested(1);
+#else
+    numJobs = 1;
+#endif
+
+    std::cout << "Processing " << inputs.size() << " studies, " << numJobs << " at a time" << std::endl;
+
+    int numFailed = 0;
+    #pragma omp parallel for schedule(dynamic) num_threads(numJobs) reduction(+:numFailed)
+    for (int i = 0; i < int(inputs.size()); ++i)
+    {
+#ifdef _OPENMP
+        omp_set_num_threads(numInnerThreads);
+#endif
+        CMeshBatchJob job(inputs[i].input, inputs[i].mask, params);
+        std::string report;
+        try
+        {
+            if (!job.run())
+            {
+                ++numFailed;
+            }
+            report = job.getReport();
+        }
+        catch (const std::exception& e)
+        {
+            ++numFailed;
+            report = inputs[i].input + ": FAILED: " + e.what();
+            VPL_LOG_INFO("Batch job " << inputs[i].input << " failed: " << e.what());
+        }
+
+        #pragma omp critical(batch_output)
+        {
+            std::cout << report << std::endl;
+        }
+    }
+
+    std::cout << "Done, " << numFailed << " of " << inputs.size() << " studies failed" << std::endl;
+
+    return numFailed > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
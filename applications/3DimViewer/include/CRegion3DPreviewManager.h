@@ -11,7 +11,7 @@
 #include <VPL/System/Condition.h>
 #include <VPL/System/Mutex.h>
 #include <data/CMultiClassRegionData.h>
-#include <geometry/base/CTrianglesContainer.h>
+#include <geometry/base/CIndexedMesh.h>
 #include <alg/CMarchingCubesFast.h>
 
 
@@ -30,11 +30,11 @@ class CRegion3DPreviewManager : public vpl::base::CLockableObject<CRegion3DPrevi
 public:
     vpl::base::CFunctor<void> *onStart;
     vpl::base::CFunctor<void> *onUpdate;
-    vpl::base::CFunctor<void, geometry::CTrianglesContainer&> *onStop;
+    vpl::base::CFunctor<void, geometry::CIndexedMesh&> *onStop;
 
 private:
-    //! Container for storing result of fast marching cubes.
-    geometry::CTrianglesContainer *m_container;
+    //! Mesh storing result of fast marching cubes.
+    geometry::CIndexedMesh *m_mesh;
 
     //! Region index, for wich the preview will be created.
     data::CMultiClassRegionData::tVoxel m_bitIndex;
@@ -116,6 +116,22 @@ public:
             }
         }
 
+        //! Classifies whole row of voxels at once.
+        void classifyRow(int x, int y, int z, int count, CVoxelRowClassifier::tWord *bits) const override
+        {
+            if (m_volume->getXOffset() != 1)
+            {
+                IMarchingCubesFastFunctor::classifyRow(x, y, z, count, bits);
+                return;
+            }
+            int offset;
+            if (!CVoxelRowClassifier::clipRow(x, y, z, count, bits, offset, m_volume->getSize()))
+            {
+                return;
+            }
+            CVoxelRowClassifier::bitLayer(&m_volume->at(x, y, z), count, T(T(1) << m_layerBitIndex), bits, offset);
+        }
+
         virtual vpl::img::CSize3i getVolumeDimensions() const override
         {
             return m_volume->getSize();
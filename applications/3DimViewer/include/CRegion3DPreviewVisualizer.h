@@ -26,7 +26,7 @@
 #include <osg/CTriMesh.h>
 #include <osg/COnOffNode.h>
 #include <osg/Geometry>
-#include <geometry/base/types.h>
+#include <geometry/base/CIndexedMesh.h>
 
 namespace osg
 {
@@ -48,12 +48,12 @@ namespace osg
         //! Sets the given color.
         void update(const osg::Vec4& color);
 
-        //! Copies verticies and indicies from given vectors.
-        void setData(const std::vector<geometry::Vec3>& vertices, const std::vector<int>& indicies);
+        //! Takes verticies and indicies of the given mesh, the mesh is left empty.
+        void setData(geometry::CIndexedMesh& mesh);
 
     protected:
-        std::vector<geometry::Vec3> m_vertices;
-        std::vector<int> m_indicies;
+        std::vector<float> m_vertices;
+        std::vector<unsigned int> m_indicies;
 
         osg::ref_ptr<osg::Geometry> m_trianglesGeometry;
         osg::ref_ptr<osg::Geode> m_pTransform;
@@ -30,6 +30,9 @@
 #include <QDirIterator>
 #include <mainwindow.h>
 #include <C3DimApplication.h>
+#include <data/CDicomMemoryFiles.h>
+#include <memory>
+#include <vector>
 
 // simple helper class for dicom data loading from zip archive
 class CZipLoader
@@ -37,6 +40,24 @@ class CZipLoader
 protected:
     QString m_archive;
     QString m_tempDir;
+    //! Entries inflated by decompressToMemory
+    std::unique_ptr<data::CDicomMemoryFiles> m_memoryFiles;
+
+    //! opens the archive, name is set to the one that succeeded
+    unzFile openArchive(std::string& str) const
+    {
+        str = m_archive.toStdString();
+        unzFile hZIP = unzOpen(str.c_str());
+#ifdef _WIN32
+        if (!hZIP) // try acp
+        {
+            std::wstring uniName = (const wchar_t*)m_archive.utf16();
+            str = C3DimApplication::wcs2ACP(uniName);
+            hZIP = unzOpen(str.c_str());
+        }
+#endif
+        return hZIP;
+    }
 public:
     //! Constructor
     CZipLoader() {}
@@ -92,16 +113,8 @@ public:
 
         bool bDecompressedSomething = false;
 
-        std::string str = m_archive.toStdString();
-        unzFile hZIP = unzOpen(str.c_str());
-#ifdef _WIN32
-        if (!hZIP) // try acp
-        {
-            std::wstring uniName = (const wchar_t*)m_archive.utf16();
-            str = C3DimApplication::wcs2ACP(uniName);
-            hZIP = unzOpen(str.c_str());
-        }
-#endif
+        std::string str;
+        unzFile hZIP = openArchive(str);
         if (hZIP)
         {
 #define CUSTOM_MAX_PATH 4096
@@ -179,6 +192,70 @@ public:
             return m_archive; // return original zip name
         }
     }
+    //! inflates zip archive entries into memory, several entries are decoded concurrently
+    //! - returns virtual directory of the files which is valid while this object exists,
+    //!   or an empty string if nothing was decompressed
+    QString decompressToMemory()
+    {
+        std::string str;
+        unzFile hZIP = openArchive(str);
+        if (!hZIP)
+            return QString();
+
+        // the central directory is walked sequentially, remember where the entries are
+        std::vector<unz_file_pos> positions;
+        std::vector<uLong> sizes;
+        bool bContinue = (UNZ_OK == unzGoToFirstFile(hZIP));
+        while (bContinue)
+        {
+            unz_file_info fi = {};
+            unz_file_pos pos = {};
+            if (unzGetCurrentFileInfo(hZIP, &fi, NULL, 0, NULL, 0, NULL, 0) == UNZ_OK && fi.uncompressed_size > 0 &&
+                unzGetFilePos(hZIP, &pos) == UNZ_OK)
+            {
+                positions.push_back(pos);
+                sizes.push_back(fi.uncompressed_size);
+            }
+            bContinue = (UNZ_OK == unzGoToNextFile(hZIP));
+        }
+        unzClose(hZIP);
+
+        // minizip handles can't be shared, so every thread opens the archive on its own
+        const int numEntries = int(positions.size());
+        std::vector<data::CDicomMemoryFiles::tBuffer> buffers(numEntries);
+#pragma omp parallel
+        {
+            unzFile hThreadZIP = unzOpen(str.c_str());
+#pragma omp for schedule(dynamic)
+            for (int i = 0; i < numEntries; ++i)
+            {
+                if (!hThreadZIP || unzGoToFilePos(hThreadZIP, &positions[i]) != UNZ_OK || unzOpenCurrentFile(hThreadZIP) != UNZ_OK)
+                    continue;
+                data::CDicomMemoryFiles::tBuffer& buffer = buffers[i];
+                buffer.resize(sizes[i]);
+                int nRead = unzReadCurrentFile(hThreadZIP, &buffer[0], unsigned(sizes[i]));
+                if (UNZ_CRCERROR == unzCloseCurrentFile(hThreadZIP))
+                    nRead = 0;
+                buffer.resize(nRead > 0 ? nRead : 0);
+            }
+            if (hThreadZIP)
+                unzClose(hThreadZIP);
+        }
+
+        // keep the archive order, series are sorted the same way as extracted files
+        m_memoryFiles.reset(new data::CDicomMemoryFiles);
+        for (int i = 0; i < numEntries; ++i)
+        {
+            if (!buffers[i].empty())
+                m_memoryFiles->addFile(buffers[i]);
+        }
+        if (0 == m_memoryFiles->getNumOfFiles())
+        {
+            m_memoryFiles.reset();
+            return QString();
+        }
+        return QString::fromStdString(vpl::sys::tStringConv::toUtf8(m_memoryFiles->getDirectory()));
+    }
     //! removeDir erases specified directory and all subdirectories
     static bool removeDir(const QString& dirName, bool bContinueOnFail) 
     {
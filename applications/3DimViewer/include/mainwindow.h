@@ -59,7 +59,7 @@
 
 #include <CRegion3DPreviewVisualizer.h>
 #include <CRegion3DPreviewManager.h>
-#include <geometry/base/CTrianglesContainer.h>
+#include <geometry/base/CIndexedMesh.h>
 
 #ifdef USE_PSVR
    #include <render/CSceneVolumeRendering.h>
@@ -304,6 +304,9 @@ private:
     // helpers
     QTimer                          m_timer;
 
+    //! Timer dispatching coalesced storage invalidations once per frame
+    QTimer                          m_invalidationTimer;
+
 	//! Signal connection for volume data change
 	vpl::mod::tSignalConnection m_Connection, m_Connection2DCanvasLeave;
 
@@ -459,11 +462,11 @@ private:
 
     vpl::base::CFunctor<void> *m_on3DPreviewStart;
     vpl::base::CFunctor<void> *m_on3DPreviewUpdate;
-    vpl::base::CFunctor<void, geometry::CTrianglesContainer&> *m_on3DPreviewStop;
+    vpl::base::CFunctor<void, geometry::CIndexedMesh&> *m_on3DPreviewStop;
 
     void on3DPreviewStart();
     void on3DPreviewUpdate();
-    void on3DPreviewStop(geometry::CTrianglesContainer& container);
+    void on3DPreviewStop(geometry::CIndexedMesh& mesh);
 
     void setUpRegion3DPreview();
     void destroyRegion3DPreview();
@@ -725,6 +728,9 @@ private slots:
     //! update for osg canvases called on timer (necessary for OSG event queue to work properly)
     void            show_frame(); // OSG animation
 
+    //! dispatches storage invalidations coalesced during the last frame
+    void            flush_invalidation();
+
 // Basic show/hide implementations
     //! Show/hide toolbars
     void            showMainToolBar();
@@ -57,6 +57,8 @@ private slots:
 
     void on_yzSliceModeCombo_currentIndexChanged(int index);
 
+    void on_slabSpinBox_valueChanged(int value);
+
     void on_pushButtonAlignXY_clicked();
     void on_pushButtonAlignXZ_clicked();
     void on_pushButtonAlignYZ_clicked();
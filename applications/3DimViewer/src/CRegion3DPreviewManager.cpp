@@ -21,13 +21,13 @@ CRegion3DPreviewManager::CRegion3DPreviewManager()
     , m_canUpdate(true)
     , m_redrawInterval(2)
 {
-    m_container = new geometry::CTrianglesContainer();
+    m_mesh = new geometry::CIndexedMesh();
 }
 
 void CRegion3DPreviewManager::init(const vpl::img::CSize3d &voxelSize, const data::CMultiClassRegionData::tVoxel &bitIndex)
 {
     m_mutex.lock();
-    m_container->init();
+    m_mesh->clear();
     m_bitIndex = bitIndex;
     m_voxelSize = voxelSize;
     m_mutex.unlock();
@@ -36,7 +36,7 @@ void CRegion3DPreviewManager::init(const vpl::img::CSize3d &voxelSize, const dat
 CRegion3DPreviewManager::~CRegion3DPreviewManager()
 {
     m_thread.terminate(true);
-    delete m_container;
+    delete m_mesh;
 }
 
 void CRegion3DPreviewManager::run()
@@ -100,8 +100,8 @@ void CRegion3DPreviewManager::stopProgress()
 {
     if (onStop != NULL)
     {
-        (*onStop)(*m_container);
-        m_container->init();
+        (*onStop)(*m_mesh);
+        m_mesh->clear();
     }
 }
 
@@ -140,8 +140,8 @@ VPL_THREAD_ROUTINE(CRegion3DPreviewManager::backgroundWorker)
 
         pManager->m_dataChanged = false;
         data::CMultiClassRegionData::tVoxel bitIndex = pManager->m_bitIndex;
-        geometry::CTrianglesContainer* container = pManager->m_container;
-        container->init();
+        geometry::CIndexedMesh* mesh = pManager->m_mesh;
+        mesh->clear();
         vpl::img::CSize3d voxelSize = pManager->m_voxelSize;
         int redraw = pManager->m_redrawInterval;
 
@@ -157,9 +157,11 @@ VPL_THREAD_ROUTINE(CRegion3DPreviewManager::backgroundWorker)
         {
             CBitLayerSelectFunctorPreview< data::CBitVolume<data::CMultiClassRegionData::tVoxel>, data::CMultiClassRegionData::tVoxel > functor(bitIndex, &volume, voxelSize);
 
-            CMarchingCubesFast<geometry::CTrianglesContainer> marchingCubes;
-            if (marchingCubes.generateMesh(container, &functor))
+            CMarchingCubesFast<geometry::CIndexedMesh> marchingCubes;
+            if (marchingCubes.generateMesh(mesh, &functor))
             {
+                // share vertices on seams of worker blocks, so that normals are smooth there
+                mesh->weldVertices();
                 pManager->stopProgress();
             }
         }
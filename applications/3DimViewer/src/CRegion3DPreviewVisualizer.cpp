@@ -81,27 +81,24 @@ void osg::CRegion3DPreviewVisualizer::update(const osg::Vec4& color)
     m_geomIndices->clear();
     m_geomNormals->clear();
 
-    std::vector<int> normalsCnt;
-
-    size_t verticesCnt = m_vertices.size();
+    size_t verticesCnt = m_vertices.size() / 3;
     size_t indiciesCnt = m_indicies.size();
 
+    std::vector<int> normalsCnt(verticesCnt, 0);
+
+    m_geomVertices->reserve(verticesCnt);
+    m_geomNormals->resize(verticesCnt, osg::Vec3f(0.0, 0.0, 0.0));
     for (size_t i = 0; i < verticesCnt; ++i)
     {
-        m_geomVertices->push_back(geometry::convert3<osg::Vec3, geometry::Vec3>(m_vertices.at(i)));
-        m_geomNormals->push_back(osg::Vec3f(0.0, 0.0, 0.0));
-        normalsCnt.push_back(0);
+        m_geomVertices->push_back(osg::Vec3(m_vertices[i * 3], m_vertices[i * 3 + 1], m_vertices[i * 3 + 2]));
     }
 
+    m_geomIndices->assign(m_indicies.begin(), m_indicies.end());
     for (size_t i = 0; i < indiciesCnt; i += 3)
     {
-        int index1 = m_indicies[i];
-        int index2 = m_indicies[i + 1];
-        int index3 = m_indicies[i + 2];
-
-        m_geomIndices->push_back(index1);
-        m_geomIndices->push_back(index2);
-        m_geomIndices->push_back(index3);
+        unsigned int index1 = m_indicies[i];
+        unsigned int index2 = m_indicies[i + 1];
+        unsigned int index3 = m_indicies[i + 2];
 
         osg::Vec3 p1 = m_geomVertices->at(index1);
         osg::Vec3 p2 = m_geomVertices->at(index2);
@@ -125,8 +122,11 @@ void osg::CRegion3DPreviewVisualizer::update(const osg::Vec4& color)
 
     for (size_t i = 0; i < verticesCnt; ++i)
     {
-        assert(normalsCnt[i] > 0);
-        m_geomNormals->at(i) /= normalsCnt[i];
+        // welding may leave a vertex used by degenerated triangles only
+        if (normalsCnt[i] > 0)
+        {
+            m_geomNormals->at(i) /= normalsCnt[i];
+        }
     }
 
     (*m_geomVertexColors)[0] = color;
@@ -140,21 +140,11 @@ void osg::CRegion3DPreviewVisualizer::update(const osg::Vec4& color)
     m_trianglesGeometry->dirtyBound();
 }
 
-void osg::CRegion3DPreviewVisualizer::setData(const std::vector<geometry::Vec3>& vertices, const std::vector<int>& indicies)
+void osg::CRegion3DPreviewVisualizer::setData(geometry::CIndexedMesh& mesh)
 {
     std::lock_guard<std::mutex> lock(m_mutex);
 
-    m_vertices.clear();
-    m_vertices.resize(0);
-    for (size_t i = 0; i < vertices.size(); ++i)
-    {
-        m_vertices.push_back(vertices.at(i));
-    }
-
-    m_indicies.clear();
-    m_indicies.resize(0);
-    for (size_t i = 0; i < indicies.size(); ++i)
-    {
-        m_indicies.push_back(indicies.at(i));
-    }
+    m_vertices.swap(mesh.getVertices());
+    m_indicies.swap(mesh.getIndices());
+    mesh.clear();
 }
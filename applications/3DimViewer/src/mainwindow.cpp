@@ -63,6 +63,7 @@
 #include <QCheckBox>
 #include <QRadioButton>
 #include <data/CDicomLoader.h>
+#include <data/CDicomMemoryFiles.h>
 #include <data/CAppSettings.h>
 #include <data/CUndoManager.h>
 #include <data/CRegionData.h>
@@ -72,6 +73,7 @@
 #include <data/CVolumeTransformation.h>
 #include <data/CVolumeOfInterestData.h>
 #include <data/CPivot.h>
+#include <data/CBrickedVolumeFile.h>
 
 #include <VPL/Module/Progress.h>
 #include <VPL/Module/Serialization.h>
@@ -90,6 +92,9 @@
 #include <alg/CDecimator.h>
 #include <alg/CSmoothing.h>
 #include <alg/CReduceSmallSubmeshes.h>
+#include <geometry/metrics/surfaceDistance.h>
+
+#include <memory>
 
 #include <cpreferencesdialog.h>
 #include <cseriesselectiondialog.h>
@@ -114,6 +119,9 @@
 #include <osg/OSGTreeAnalyser.h>
 #include <osg/CPseudoMaterial.h>
 
+#include <atomic>
+#include <thread>
+
 //#define DUMP_OSG_TREE
 
 
@@ -582,6 +590,15 @@ MainWindow::MainWindow(QWidget *parent, CPluginManager* pPlugins) :
     connect(&m_timer, SIGNAL(timeout()), this, SLOT(show_frame()));
     m_timer.start();	
 
+    // optionally coalesce storage invalidations and dispatch them once per frame
+    if (settings.value("CoalesceInvalidation", false).toBool())
+    {
+        APP_STORAGE.setInvalidationCoalescing(true);
+        m_invalidationTimer.setInterval(16);
+        connect(&m_invalidationTimer, SIGNAL(timeout()), this, SLOT(flush_invalidation()));
+        m_invalidationTimer.start();
+    }
+
 	// first event will open files from command line etc
     QTimer::singleShot(0, this, SLOT(firstEvent()));
 
@@ -3102,6 +3119,11 @@ void MainWindow::show_frame()
     }
 }
 
+void MainWindow::flush_invalidation()
+{
+    APP_STORAGE.flushInvalidation();
+}
+
 void MainWindow::fixBadSliceSliderPos()
 {
     // Workaround for bug https://jic.3dim-laboratory.cz/mantis/view.php?id=9
@@ -3169,12 +3191,18 @@ bool MainWindow::openDICOMZIP(QString fileName)
     QString realName = fileName;
     QFileInfo pathInfo( fileName );
 
-    // if the selected item is a zip archive, decompress it to a temp directory
+    // if the selected item is a zip archive, decompress it to memory (dcmtk parses the buffers directly)
+    // or to a temp directory
     CZipLoader loader;
     if (loader.setZipArchive(fileName))
     {
         QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
+#if !defined( TRIDIM_USE_GDCM )
+        QString memoryDir = loader.decompressToMemory();
+        fileName = memoryDir.isEmpty() ? loader.decompress() : memoryDir;
+#else
         fileName = loader.decompress();
+#endif
         QApplication::restoreOverrideCursor();
     }
     
@@ -3189,9 +3217,11 @@ bool MainWindow::openDICOM(const QString& fileName, const QString& realName, boo
 	setVOIVisibility(false);
 
     QString fileNameIn(fileName);
+    // files inflated from a zip archive are kept in memory under a virtual directory
+    const bool bInMemory = data::CDicomMemoryFiles::isMemoryDirectory(vpl::sys::tStringConv::fromUtf8(fileNameIn.toStdString()));
     // make sure that we pass in directory name and not a file name
     QFileInfo fi(fileNameIn);
-    if (!fi.isDir())
+    if (!fi.isDir() && !bInMemory)
 #if(0)
     {
         fileNameIn = fi.dir().absolutePath();
@@ -3231,10 +3261,17 @@ bool MainWindow::openDICOM(const QString& fileName, const QString& realName, boo
         data::CDicomLoader Loader;
         Loader.registerProgressFunc( vpl::mod::CProgress::tProgressFunc( &progress, &CProgress::Entry ) );
 
+        // headers of scanned files are indexed, so that repeated scans of large directories are fast
+        QString indexDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/dicomindex";
+        if (QDir().mkpath(indexDir))
+            Loader.setIndexCacheDirectory(vpl::sys::tStringConv::fromUtf8(indexDir.toUtf8().constData()));
+
         // preload data from the selected directory
         data::CSeries::tSmartPtr spSeries;
         fi = QFileInfo(fileNameIn);
-        if (!fi.isDir())
+        if (bInMemory)
+            spSeries = Loader.preLoadMemoryFiles(vpl::sys::tStringConv::fromUtf8(str));
+        else if (!fi.isDir())
             spSeries = Loader.preLoadFile(vpl::sys::tStringConv::fromUtf8(str));
         else
             spSeries = Loader.preLoadDirectory(vpl::sys::tStringConv::fromUtf8(str));
@@ -3525,6 +3562,17 @@ bool MainWindow::openVLM()
 }
 
 
+//! Progress of a task running in a worker thread, polled by the UI thread
+class CWorkerProgress
+{
+public:
+	std::atomic<int> m_Count, m_Max;
+	std::atomic<bool> m_bCancelled;
+	CWorkerProgress() : m_Count(0), m_Max(1), m_bCancelled(false) { }
+	bool Entry(int iCount, int iMax)	{	m_Count = iCount; m_Max = iMax; return !m_bCancelled;	}
+};
+
+
 //! File Channel implementation with seek support
 class CFileChannelEx : public vpl::mod::CFileChannelU
 {
@@ -3567,15 +3615,100 @@ bool MainWindow::openVLM(const QString &wsFileName)
 
     // Load the data
     bool bResult = false;
+    bool bCancelled = false;
     try 
     {
-        APP_STORAGE.reset();        
 #if(0)
         bResult = m_Examination.loadDensityDataU(vpl::sys::tStringConv::fromUtf8(ansiName),
                                                 ProgressFunc,
                                                 data::PATIENT_DATA
                                                 );
 #else
+		// Chunked VLM container - bricks of the ortho slices (centered on new data) are read
+		// first and the volume is published, the rest is read by a worker thread and the data
+		// are invalidated as bricks arrive
+		data::CBrickedVolumeFile BrickedFile;
+		if (data::CBrickedVolumeFile::isBrickedFile(vpl::sys::tStringConv::fromUtf8(ansiName)))
+		{
+			if (BrickedFile.open(vpl::sys::tStringConv::fromUtf8(ansiName)))
+			{
+				{
+					data::CDensityData Volume;
+					BrickedFile.prepare(Volume);
+					BrickedFile.readBricksForSlices(Volume, Volume.getZSize() / 2, Volume.getYSize() / 2, Volume.getXSize() / 2);
+
+					APP_STORAGE.reset();
+					data::CObjectPtr<data::CDensityData> spVolume( APP_STORAGE.getEntry(data::PATIENT_DATA) );
+					spVolume->makeRef(Volume);
+					spVolume->clearDicomData();
+					BrickedFile.readMetadata(*spVolume);
+					APP_STORAGE.invalidate(spVolume.getEntryPtr() );
+				}
+				m_Examination.onDataLoad( data::PATIENT_DATA );
+
+				// the worker locks the published volume for every layer of bricks,
+				// so readers never see a brick being copied
+				CWorkerProgress WorkerProgress;
+				const int LayerCount = BrickedFile.getLayerCount();
+				WorkerProgress.m_Max = LayerCount;
+				std::atomic<bool> bDone(false);
+				std::thread Worker([&]()
+				{
+					bool bOk = true;
+					for (int bz = 0; bOk && bz < LayerCount; ++bz)
+					{
+						{
+							data::CObjectPtr<data::CDensityData> spVolume( APP_STORAGE.getEntry(data::PATIENT_DATA, data::Storage::NO_UPDATE) );
+							BrickedFile.readBrickLayer(*spVolume, bz);
+							if (bz + 1 == LayerCount)
+							{
+								spVolume->mirrorMargin();
+							}
+						}
+						bOk = WorkerProgress.Entry(bz + 1, LayerCount);
+					}
+					bResult = bOk;
+					bDone = true;
+				});
+
+				// views are refreshed a few times per second while bricks arrive
+				int InvalidatedCount = 0;
+				QElapsedTimer InvalidationTimer;
+				InvalidationTimer.start();
+				while (!bDone)
+				{
+					if (!progress.Entry(WorkerProgress.m_Count, WorkerProgress.m_Max))
+					{
+						WorkerProgress.m_bCancelled = true;
+					}
+					if (WorkerProgress.m_Count != InvalidatedCount && InvalidationTimer.elapsed() > 500)
+					{
+						InvalidatedCount = WorkerProgress.m_Count;
+						InvalidationTimer.restart();
+						APP_STORAGE.invalidate(APP_STORAGE.getEntry(data::PATIENT_DATA, data::Storage::NO_UPDATE).get());
+					}
+					QApplication::processEvents(QEventLoop::AllEvents, 20);
+					QThread::msleep(10);
+				}
+				Worker.join();
+				bCancelled = WorkerProgress.m_bCancelled;
+
+				if (bResult)
+				{
+					APP_STORAGE.invalidate(APP_STORAGE.getEntry(data::PATIENT_DATA, data::Storage::NO_UPDATE).get());
+				}
+				else
+				{
+					// an incomplete volume is not kept
+					APP_STORAGE.reset();
+				}
+				BrickedFile.close();
+			}
+		}
+		else
+		{
+		APP_STORAGE.reset();
+
 		// Open input file channel
 		CFileChannelEx Channel(vpl::mod::CH_IN, vpl::sys::tStringConv::fromUtf8(ansiName));
 		if( Channel.connect() )
@@ -3641,6 +3774,7 @@ bool MainWindow::openVLM(const QString &wsFileName)
 			// O.K.
 			bResult = true;
 		}
+		}
 #endif
     }
     catch( const vpl::base::CFullException& /*Exception*/ )
@@ -3651,7 +3785,8 @@ bool MainWindow::openVLM(const QString &wsFileName)
     }
     if (!bResult)
     {
-        showMessageBox(QMessageBox::Critical,tr("Failed to read input volumetric data!"));
+        if (!bCancelled)
+            showMessageBox(QMessageBox::Critical,tr("Failed to read input volumetric data!"));
 		enableMenuActions();
         return false;
     }
@@ -3668,9 +3803,14 @@ bool MainWindow::saveVLMAs()
     QSettings settings;
     QString previousDir = getSaveLoadPath("VLMdir");
     previousDir = appendSaveNameHint(previousDir,".vlm");
-    QString fileName = QFileDialog::getSaveFileName(this,tr("Choose an output file..."),previousDir,tr("Volume Data (*.vlm)"));
+    // the legacy format is the default one, bricked files can't be opened by older versions
+    const QString sLegacyFilter = tr("Volume Data (*.vlm)");
+    const QString sBrickedFilter = tr("Bricked Volume Data for faster loading (*.vlm)");
+    QString sSelectedFilter = sLegacyFilter;
+    QString fileName = QFileDialog::getSaveFileName(this,tr("Choose an output file..."),previousDir,sLegacyFilter + ";;" + sBrickedFilter,&sSelectedFilter);
     if (fileName.isEmpty())
         return false;
+    const bool bBricked = (sSelectedFilter == sBrickedFilter);
 
     QFileInfo pathInfo( fileName );
     settings.setValue("VLMdir",pathInfo.dir().absolutePath());
@@ -3695,8 +3835,6 @@ bool MainWindow::saveVLMAs()
                                                  );
 #else	 // save volumetric data with metadata (in format compatible with m_Examination.loadDensityDataU)
 		 bResult = false;
-		 vpl::mod::CFileChannelU Channel(vpl::mod::CH_OUT, vpl::sys::tStringConv::fromUtf8(ansiName));
-		 if( Channel.connect() )
 		 {
 			 data::CObjectPtr<data::CDensityData> spVolume( APP_STORAGE.getEntry(data::PATIENT_DATA) );
 			 // because vlm doesn't save data::CVolumeTransformation, we apply it on the tag saved in the patient data
@@ -3705,8 +3843,18 @@ bool MainWindow::saveVLMAs()
 			 osg::Matrix volTransform = spVolumeTransformation->getTransformation();
 			 osg::Vec3 offLoad = - volTransform.getTrans();
 			 spVolume->m_ImagePosition += vpl::img::CVector3D(offLoad[0],offLoad[1],offLoad[2]);
-			 // serialization
-			 bResult = vpl::mod::write(*spVolume, Channel, ProgressFunc);
+			 if (bBricked)
+			 {
+				 // chunked VLM container, faster to load
+				 bResult = data::CBrickedVolumeFile::write(*spVolume, vpl::sys::tStringConv::fromUtf8(ansiName), ProgressFunc);
+			 }
+			 else
+			 {
+				 // serialization
+				 vpl::mod::CFileChannelU Channel(vpl::mod::CH_OUT, vpl::sys::tStringConv::fromUtf8(ansiName));
+				 if( Channel.connect() )
+					 bResult = vpl::mod::write(*spVolume, Channel, ProgressFunc);
+			 }
 			 // restore original image position value
 			 spVolume->m_ImagePosition = pos;
 		 }
@@ -5882,8 +6030,26 @@ void MainWindow::createSurfaceModel()
     // Decimate model
     CDecimator dc;
     dc.registerProgressFunc(vpl::mod::CProgress::tProgressFunc(progress, &CProgress::Entry));
+    dc.setParallel(true);
     int output_mesh_size_tri = (pMesh->n_faces() * 20) / 100;
     int output_mesh_size_vert = 1;
+
+    // optionally check the parallel decimation against the serial one
+    // and keep the smoothed surface to color the model by the decimation error
+    std::unique_ptr<geometry::SurfaceDistance> spDistance;
+    if (QSettings().value("DecimationQA", false).toBool())
+    {
+        spDistance.reset(new geometry::SurfaceDistance(*pMesh));
+
+        CDecimator::SQuality quality;
+        if (dc.compareWithSerial(*pMesh, output_mesh_size_vert, output_mesh_size_tri, -1.0f, quality))
+        {
+            VPL_LOG_INFO("Decimation QA: serial " << quality.serialVertices << " vertices, " << quality.serialFaces << " faces, " << quality.serialTime << " ms; "
+                         << "parallel " << quality.parallelVertices << " vertices, " << quality.parallelFaces << " faces, " << quality.parallelTime << " ms; "
+                         << "distance max " << quality.maxDistance << ", mean " << quality.meanDistance << ", rms " << quality.rmsDistance);
+        }
+    }
+
     if (!dc.Reduce(*pMesh, output_mesh_size_vert, output_mesh_size_tri))
     {
         delete pMesh;
@@ -5891,6 +6057,13 @@ void MainWindow::createSurfaceModel()
         return;
     }
 
+    bool bDistanceColors = false;
+    if (spDistance && spDistance->compute(*pMesh) && spDistance->computeVertexDistances(*pMesh))
+    {
+        VPL_LOG_INFO("Decimation QA: distance to the smoothed model max " << spDistance->getMaxDistance() << ", mean " << spDistance->getMeanDistance());
+        bDistanceColors = geometry::SurfaceDistance::colorVertices(*pMesh, float(spDistance->getMaxDistance()));
+    }
+
     delete progress;
 
     data::CObjectPtr<data::CModel> spModel(APP_STORAGE.getEntry(id));
@@ -5903,6 +6076,10 @@ void MainWindow::createSurfaceModel()
     spModel->setVisibility(true);
     spModel->setLinkedWithRegion(false);
     spModel->setRegionId(-1);
+    if (bDistanceColors)
+    {
+        spModel->setUseVertexColors(true);
+    }
     APP_STORAGE.invalidate(spModel.getEntryPtr());
 
     // if model-region linking is not enabled, hide previously created models on creation of a new one
@@ -8550,7 +8727,7 @@ void MainWindow::setUpRegion3DPreview()
 
     m_on3DPreviewStart = new vpl::base::CFunctor<void>(this, &MainWindow::on3DPreviewStart);
     m_on3DPreviewUpdate = new vpl::base::CFunctor<void>(this, &MainWindow::on3DPreviewUpdate);
-    m_on3DPreviewStop = new vpl::base::CFunctor<void, geometry::CTrianglesContainer&>(this, &MainWindow::on3DPreviewStop);
+    m_on3DPreviewStop = new vpl::base::CFunctor<void, geometry::CIndexedMesh&>(this, &MainWindow::on3DPreviewStop);
 
     m_region3DPreviewManager->onStart = m_on3DPreviewStart;
     m_region3DPreviewManager->onUpdate = m_on3DPreviewUpdate;
@@ -8575,9 +8752,9 @@ void MainWindow::on3DPreviewUpdate()
 
 }
 
-void MainWindow::on3DPreviewStop(geometry::CTrianglesContainer& container)
+void MainWindow::on3DPreviewStop(geometry::CIndexedMesh& mesh)
 {
-    m_region3DPreviewVisualizer->setData(container.getVertices(), container.getIndicies());
+    m_region3DPreviewVisualizer->setData(mesh);
 
     QMetaObject::invokeMethod(this, "update3DPreview");
 }
@@ -274,6 +274,11 @@ void COrthoSlicesWidget::on_yzSliceModeCombo_currentIndexChanged(int index)
     VPL_SIGNAL(SigSetSliceModeYZ).invoke(static_cast<data::COrthoSlice::EMode>(index));
 }
 
+void COrthoSlicesWidget::on_slabSpinBox_valueChanged(int value)
+{
+    VPL_SIGNAL(SigSetSliceSlabThickness).invoke(value);
+}
+
 void COrthoSlicesWidget::on_pushButtonAlignXY_clicked()
 {
     data::CObjectPtr<data::CArbitrarySlice> spSlice(APP_STORAGE.getEntry(data::Storage::ArbitrarySlice::Id));
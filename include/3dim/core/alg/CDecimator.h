@@ -41,24 +41,67 @@ class CDecimator;
 ////////////////////////////////////////////////////////////
 //! Tri mesh decimating algorithm implementation class.
 //! Implements Volume error metrics polygonal surface simplification.
+//! - In the parallel mode the mesh is split into slabs which are
+//!   decimated concurrently with vertices on slab borders locked,
+//!   the border zones are decimated by a final serial pass.
 class CDecimator : public vpl::mod::CProgress
 {
+public:
+    //! Meshes with less faces are always decimated serially.
+    enum { MIN_PARALLEL_FACES = 100000 };
+
+    //! Comparison of the parallel and the serial decimation.
+    struct SQuality
+    {
+        //! Size of the serial result.
+        int serialVertices, serialFaces;
+        //! Size of the parallel result.
+        int parallelVertices, parallelFaces;
+        //! Symmetric distances between both results.
+        double maxDistance, meanDistance, rmsDistance;
+        //! Duration of both decimations in milliseconds.
+        unsigned long serialTime, parallelTime;
+    };
+
 private:
     int m_step;
     int m_progress;
     bool m_success;
 
+    //! Is the parallel mode enabled?
+    bool m_parallel;
+
+    //! Number of slabs in the parallel mode, zero for twice the number of threads.
+    int m_partitions;
+
 public:
     //! Decimating class constructor.
-    CDecimator() {}
+    CDecimator() : m_parallel(false), m_partitions(0) {}
 
     //! Decimating class destructor.
     ~CDecimator() {}
 
     //! Reduce input tri mesh using Volume error metrics polygonal surface simplification.
+    //! - Uses the parallel mode if it is enabled.
     bool Reduce(geometry::CMesh &mesh, int final_vert_number, int final_tri_number, float maxHausdorffDist = -1.0);
 
+    //! Enables the parallel mode.
+    void setParallel(bool parallel, int partitions = 0) { m_parallel = parallel; m_partitions = partitions; }
+
+    //! Is the parallel mode enabled?
+    bool isParallel() const { return m_parallel; }
+
+    //! Decimates copies of the mesh serially and in parallel and compares the results.
+    bool compareWithSerial(const geometry::CMesh &mesh, int final_vert_number, int final_tri_number, float maxHausdorffDist, SQuality &quality, size_t samples = 100000);
+
     bool makeProgress(int step);
+
+protected:
+    //! Serial decimation by a single decimater.
+    bool reduceSerial(geometry::CMesh &mesh, int final_vert_number, int final_tri_number, float maxHausdorffDist);
+
+    //! Parallel decimation of slabs followed by the border pass.
+    bool reduceParallel(geometry::CMesh &mesh, int final_vert_number, int final_tri_number, float maxHausdorffDist);
 };
 
 template <typename tDecimater>
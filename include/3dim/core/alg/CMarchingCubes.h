@@ -27,6 +27,7 @@
 // Includes
 
 #include <geometry/base/CMesh.h>
+#include <alg/CVoxelRowClassifier.h>
 
 // VPL
 #include <VPL/Image/DensityVolume.h>
@@ -38,6 +39,8 @@
 #include <vector>
 #include <set>
 #include <map>
+#include <algorithm>
+#include <cstring>
 
 ////////////////////////////////////////////////////////////
 //! Enum for marking each vertex of mesh.
@@ -58,6 +61,22 @@ public:
     virtual unsigned char operator()(int x, int y, int z) const = 0;
     virtual vpl::img::CSize3i getVolumeDimensions() const = 0;
     virtual vpl::img::CSize3d getVoxelSize() const = 0;
+
+    //! Classifies row of voxels [x, x + count) at (y, z) into a bitmask, state of voxel x + i
+    //! is stored in bit i (see CVoxelRowClassifier). All CVoxelRowClassifier::wordCount(count) words are written.
+    //! Coordinates may lie outside the volume, such voxels must be classified as 0.
+    //! Default implementation calls operator() for every voxel, functors should override it with a batched version.
+    virtual void classifyRow(int x, int y, int z, int count, CVoxelRowClassifier::tWord *bits) const
+    {
+        std::memset(bits, 0, CVoxelRowClassifier::wordCount(count) * sizeof(CVoxelRowClassifier::tWord));
+        for (int i = 0; i < count; ++i)
+        {
+            if (operator()(x + i, y, z))
+            {
+                CVoxelRowClassifier::setBit(bits, i);
+            }
+        }
+    }
 };
 
 ////////////////////////////////////////////////////////////
@@ -78,8 +97,18 @@ private:
     unsigned char *m_down_cube_code_matrix;
 
     //! Pointer on voxels state matrix, up and down.
-    unsigned char *m_state_matrix_up;
-    unsigned char *m_state_matrix_down;
+    //! Every row is a bitmask of m_state_row_words words, bit c holds state of voxel c - 1.
+    CVoxelRowClassifier::tWord *m_state_matrix_up;
+    CVoxelRowClassifier::tWord *m_state_matrix_down;
+
+    //! Number of words of one state matrix row.
+    int m_state_row_words;
+
+    //! Bitmask of one classified row.
+    CVoxelRowClassifier::tWord *m_row_bits;
+
+    //! States of the actual run of 32 cubes, rows y and y + 1 of down and up state matrix.
+    vpl::sys::tUInt64 m_run_states[4];
 
     //! Actual cube vertices coordinates.
     geometry::CMesh::Point m_cube_vertices[8];
@@ -156,6 +185,13 @@ protected:
     //! Create actual cube code and save it into code matrix
     unsigned char makeCubeCode(int x, int y);
 
+    //! Loads states of the run of cubes [x, x + 32) used by makeCubeCode, x must be a multiple of 32.
+    //! Returns true if all cubes of the run have the same code 0 or 255, the code is saved into code matrix.
+    bool loadCubeRun(int x, int y);
+
+    //! Classifies row of voxels and saves it into up state matrix.
+    void classifyStateRow(const IMarchingCubesFunctor *volumeFunctor, int y, int z, int volume_size_x);
+
     //! Calculate number of nodes for cube code.
     int cubeCodeNodeNumber(unsigned char cube_code);
 
@@ -207,6 +243,9 @@ public:
     //! Marching cubes triangle mesh generation.
     bool generateMesh(geometry::CMesh &mesh, const IMarchingCubesFunctor *volumeFunctor, bool reduceFlatAreas, int numOfIterations = 1, bool eliminateNearVertices = true, float maxEdgeLength = 0.0f);
 
+    //! merge meshes of all workers into targetMesh, workers are flattened concurrently and seam vertices are resolved by global edge keys
+    bool mergeWorkerMeshes(std::vector<CMarchingCubesWorker> &workers, geometry::CMesh &targetMesh, std::vector<geometry::CMesh::VertexHandle> &seamVertices);
+
     //! merge sourceMesh into targetMesh
     void mergeMeshes(geometry::CMesh &sourceMesh, std::set<std::pair<geometry::CMesh::VertexHandle, int> > &openEdgeVertices, geometry::CMesh &targetMesh, std::map<int, std::set<std::pair<geometry::CMesh::VertexHandle, int> > > &vertexMap, std::vector<geometry::CMesh::VertexHandle> &seamVertices);
 };
@@ -256,6 +295,22 @@ public:
         }
     }
 
+    //! Classifies whole row of voxels at once.
+    virtual void classifyRow(int x, int y, int z, int count, CVoxelRowClassifier::tWord *bits) const
+    {
+        if (m_volume->getXOffset() != 1)
+        {
+            IMarchingCubesFunctor::classifyRow(x, y, z, count, bits);
+            return;
+        }
+        int offset;
+        if (!CVoxelRowClassifier::clipRow(x, y, z, count, bits, offset, m_volume->getSize()))
+        {
+            return;
+        }
+        CVoxelRowClassifier::threshold(&m_volume->at(x, y, z), count, m_low_threshold, m_high_threshold, bits, offset);
+    }
+
     //! Set volume
     void SetVolume(V *volume)
     {
@@ -447,6 +502,64 @@ public:
         return 0;
     }
 
+    //! Classifies whole row of voxels at once.
+    virtual void classifyRow(int x, int y, int z, int count, CVoxelRowClassifier::tWord *bits) const
+    {
+        vpl::img::CSize3i size = m_volume->getSize();
+        if (NULL != m_mask_volume)
+        {
+            size.x() = std::min(size.x(), m_mask_volume->getXSize());
+            size.y() = std::min(size.y(), m_mask_volume->getYSize());
+            size.z() = std::min(size.z(), m_mask_volume->getZSize());
+        }
+        int offset;
+        if (!CVoxelRowClassifier::clipRow(x, y, z, count, bits, offset, size))
+        {
+            return;
+        }
+
+        // without supersampling the neighbourhood analysis reduces to a plain threshold
+        const bool plainThreshold = (0 == m_samples && m_limit < 1.0 && 1 == m_volume->getXOffset());
+        if (plainThreshold)
+        {
+            CVoxelRowClassifier::threshold(&m_volume->at(x, y, z), count, m_low_threshold, m_high_threshold, bits, offset);
+        }
+        else
+        {
+            CVoxelRowClassifier::fill(bits, offset, count);
+        }
+
+        if (NULL != m_mask_volume)
+        {
+            if (1 == m_mask_volume->getXOffset())
+            {
+                CVoxelRowClassifier::applyMask(&m_mask_volume->at(x, y, z), count, m_mask_value, m_mask_bit, bits, offset);
+            }
+            else
+            {
+                for (int i = 0; i < count; ++i)
+                {
+                    if ((m_mask_volume->at(x + i, y, z) & m_mask_value) != m_mask_bit)
+                    {
+                        CVoxelRowClassifier::clearBit(bits, offset + i);
+                    }
+                }
+            }
+        }
+
+        if (!plainThreshold)
+        {
+            // sample only voxels which passed the mask
+            for (int i = 0; i < count; ++i)
+            {
+                if (CVoxelRowClassifier::testBit(bits, offset + i) && !operator()(x + i, y, z))
+                {
+                    CVoxelRowClassifier::clearBit(bits, offset + i);
+                }
+            }
+        }
+    }
+
     //! Set volume
     void SetVolume(V *volume, MV *mask_volume)
     {
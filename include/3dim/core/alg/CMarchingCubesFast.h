@@ -26,6 +26,7 @@
 ////////////////////////////////////////////////////////////
 // Includes
 #include <geometry/base/types.h>
+#include <alg/CVoxelRowClassifier.h>
 
 // VPL
 #include <VPL/Image/DensityVolume.h>
@@ -46,6 +47,21 @@ public:
     virtual unsigned char operator()(int x, int y, int z) const = 0;
     virtual vpl::img::CSize3i getVolumeDimensions() const = 0;
     virtual vpl::img::CSize3d getVoxelSize() const = 0;
+
+    //! Classifies row of voxels [x, x + count) at (y, z) into a bitmask, state of voxel x + i
+    //! is stored in bit i (see CVoxelRowClassifier). All CVoxelRowClassifier::wordCount(count) words are written.
+    //! Default implementation calls operator() for every voxel, functors should override it with a batched version.
+    virtual void classifyRow(int x, int y, int z, int count, CVoxelRowClassifier::tWord *bits) const
+    {
+        std::memset(bits, 0, CVoxelRowClassifier::wordCount(count) * sizeof(CVoxelRowClassifier::tWord));
+        for (int i = 0; i < count; ++i)
+        {
+            if (operator()(x + i, y, z))
+            {
+                CVoxelRowClassifier::setBit(bits, i);
+            }
+        }
+    }
 };
 
 ////////////////////////////////////////////////////////////
@@ -66,8 +82,18 @@ private:
     unsigned char *m_down_cube_code_matrix;
 
     //! Pointer on voxels state matrix, up and down.
-    unsigned char *m_state_matrix_up;
-    unsigned char *m_state_matrix_down;
+    //! Every row is a bitmask of m_state_row_words words, bit c holds state of voxel c - 1.
+    CVoxelRowClassifier::tWord *m_state_matrix_up;
+    CVoxelRowClassifier::tWord *m_state_matrix_down;
+
+    //! Number of words of one state matrix row.
+    int m_state_row_words;
+
+    //! Bitmask of one classified row.
+    CVoxelRowClassifier::tWord *m_row_bits;
+
+    //! States of the actual run of 32 cubes, rows y and y + 1 of down and up state matrix.
+    vpl::sys::tUInt64 m_run_states[4];
 
     //! Actual cube vertices coordinates.
     geometry::Vec3 m_cube_vertices[8];
@@ -145,6 +171,13 @@ protected:
     //! Create actual cube code and save it into code matrix
     unsigned char makeCubeCode(int x, int y);
 
+    //! Loads states of the run of cubes [x, x + 32) used by makeCubeCode, x must be a multiple of 32.
+    //! Returns true if all cubes of the run have the same code 0 or 255, the code is saved into code matrix.
+    bool loadCubeRun(int x, int y);
+
+    //! Classifies row of voxels and saves it into up state matrix.
+    void classifyStateRow(const IMarchingCubesFastFunctor *volumeFunctor, int y, int z, int volume_size_x);
+
     //! Calculate number of nodes for cube code.
     int cubeCodeNodeNumber(unsigned char cube_code);
 };
@@ -154,7 +187,8 @@ protected:
 //! Generates mesh using parallel by using CMarchingCubesWorkerFast.
 //! Simplified algorithm with no postprocessing.
 //! Uses tpContainer for output and fill it with final vertices and indices of the triangles.
-//! Output container must have methods addVertex(double, double, double) and addIndex(int).
+//! Output container must have methods reserve(size_t, size_t), addVertex(double, double, double) and addIndex(int).
+//! geometry::CIndexedMesh can be used to get compact arrays that are converted to CMesh only when needed.
 template<class tpContainer>
 class CMarchingCubesFast
 {
@@ -224,6 +258,15 @@ public:
             workers[i].generateMesh(xCoords[i], yCoords[i], zCoords[i], indicies[i], volumeFunctor);
         }
 
+        size_t verticesTotal = 0;
+        size_t indiciesTotal = 0;
+        for (int i = 0; i < workerCount; ++i)
+        {
+            verticesTotal += xCoords[i].size();
+            indiciesTotal += indicies[i].size();
+        }
+        output->reserve(verticesTotal, indiciesTotal / 3);
+
         int verticesSum = 0;
 
         for (int i = 0; i < workerCount; ++i)
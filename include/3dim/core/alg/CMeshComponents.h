@@ -0,0 +1,89 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef CMeshComponents_H
+#define CMeshComponents_H
+
+////////////////////////////////////////////////////////////
+// Includes
+
+#include <geometry/base/CMesh.h>
+
+// STL
+#include <vector>
+
+////////////////////////////////////////////////////////////
+//! Connected components of a triangle mesh.
+//! - Faces sharing an edge belong to the same component, faces touching
+//!   only at a vertex do not.
+//! - Components are labelled by a parallel union-find over faces and
+//!   their edge neighbours instead of a sequential flood fill.
+//! - Labels are numbered from zero in the order of the lowest face
+//!   index of the component, deleted faces get label -1.
+
+class CMeshComponents
+{
+public:
+    //! Statistics of one component.
+    struct SComponent
+    {
+        //! Number of faces.
+        int faces;
+
+        //! Bounding box.
+        geometry::CMesh::Point min, max;
+    };
+
+public:
+    //! Labels components of a given mesh.
+    void compute(const geometry::CMesh &mesh);
+
+    //! Returns number of components.
+    size_t getNumOfComponents() const { return m_components.size(); }
+
+    //! Returns statistics of a component.
+    const SComponent &getComponent(size_t i) const { return m_components[i]; }
+
+    //! Returns component labels of all faces.
+    const std::vector<int> &getFaceLabels() const { return m_faceLabels; }
+
+    //! Returns label of the component with most faces, -1 for an empty mesh.
+    int getLargestComponent() const;
+
+    //! Removes faces of components which are not kept, in one compaction pass.
+    //! - Keep contains a flag for every component.
+    //! - The mesh is rebuilt, values of custom properties are not preserved.
+    //! - Returns number of removed faces.
+    int filter(geometry::CMesh &mesh, const std::vector<unsigned char> &keep) const;
+
+protected:
+    //! Component label of every face.
+    std::vector<int> m_faceLabels;
+
+    //! Statistics of components.
+    std::vector<SComponent> m_components;
+};
+
+#endif // CMeshComponents_H
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
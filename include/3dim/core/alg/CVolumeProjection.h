@@ -0,0 +1,86 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef CVolumeProjection_H
+#define CVolumeProjection_H
+
+////////////////////////////////////////////////////////////
+// Includes
+
+// VPL
+#include <VPL/Image/Image.h>
+#include <VPL/Image/Volume.h>
+#include <VPL/Image/PixelTypes.h>
+
+////////////////////////////////////////////////////////////
+//! Projections of a density volume along one of its axes, used by MIP
+//! and RTG modes of ortho slices.
+//! - The volume is always read in contiguous rows, parallel over rows
+//!   of the output image.
+//! - Projection can be limited to a slab of slices [first, last].
+//! - Output image is resized to the plane perpendicular to the axis,
+//!   i.e. XY for AXIS_Z, XZ for AXIS_Y and YZ for AXIS_X.
+class CVolumeProjection
+{
+public:
+    //! Projection axis.
+    enum EAxis
+    {
+        AXIS_X = 0,
+        AXIS_Y = 1,
+        AXIS_Z = 2
+    };
+
+    //! Voxels below this density are ignored by the average projection.
+    enum { AVERAGE_THRESHOLD = -1000 };
+
+public:
+    //! Maximum intensity projection of slices [First, Last] along a given axis.
+    static void maximum(const vpl::img::CDVolume& Volume, int Axis, int First, int Last, vpl::img::CDImage& Image);
+
+    //! Average of voxels not below Threshold, of slices [First, Last] along a given axis.
+    //! - Pixels without any such voxel get the minimal density.
+    static void average(const vpl::img::CDVolume& Volume, int Axis, int First, int Last, vpl::img::CDImage& Image, int Threshold = AVERAGE_THRESHOLD);
+
+    //! Returns number of slices along a given axis.
+    static int getNumOfSlices(const vpl::img::CDVolume& Volume, int Axis);
+
+    //! Clamps slab around position to the volume, thickness <= 0 selects all slices.
+    static void getSlab(const vpl::img::CDVolume& Volume, int Axis, int Position, int Thickness, int& First, int& Last);
+
+    //! Per element maximum of a row and the accumulator.
+    static void maxRow(const vpl::img::tDensityPixel *src, int count, vpl::img::tDensityPixel *acc);
+
+    //! Returns maximum of a row, count must be positive.
+    static vpl::img::tDensityPixel maxOfRow(const vpl::img::tDensityPixel *src, int count);
+
+    //! Adds voxels not below threshold to per element sums and sample counts.
+    static void sumRow(const vpl::img::tDensityPixel *src, int count, vpl::img::tDensityPixel threshold, int *sum, int *samples);
+
+    //! Sums voxels of a row not below threshold.
+    static void sumOfRow(const vpl::img::tDensityPixel *src, int count, vpl::img::tDensityPixel threshold, int& sum, int& samples);
+};
+
+#endif // CVolumeProjection_H
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef CVolumeRenderingPreprocessor_H
+#define CVolumeRenderingPreprocessor_H
+
+////////////////////////////////////////////////////////////
+// Includes
+
+// VPL
+#include <VPL/Image/Volume.h>
+#include <VPL/Image/PixelTypes.h>
+
+////////////////////////////////////////////////////////////
+//! Preparation of volume rendering data from a density volume.
+//! - Produces the normalized 16-bit volume and the auxiliary skipping
+//!   volume in one pass, the source is read once.
+//! - Slices are streamed along Z through small per thread ring buffers,
+//!   work is split over slabs of whole skipping blocks.
+//! - Needs no OpenGL context.
+class CVolumeRenderingPreprocessor
+{
+public:
+    //! Normalized volume.
+    typedef vpl::img::CVolume<vpl::img::tPixel16> tVolume;
+
+    //! Auxiliary volume, one voxel per block of BLOCK_SIZE^3 voxels:
+    //! - r, g - minimum and maximum of the block scaled to 8 bits, widened by one,
+    //! - b - maximum Sobel gradient magnitude sampled at odd voxels.
+    typedef vpl::img::CVolume<vpl::img::tRGBPixel> tAuxVolume;
+
+    //! Size of a block of the auxiliary volume.
+    enum { BLOCK_SIZE = 8 };
+
+public:
+    //! Fills allocated volumes from the source.
+    //! - With Resample set the source is trilinearly resampled to the size
+    //!   of Volume, otherwise it is smoothed by the 3x3x3 (1 3 1) filter.
+    //! - The auxiliary volume has to cover all blocks of Volume.
+    //! - Returns false and clears both volumes if the source holds only
+    //!   the minimal density.
+    static bool process(const vpl::img::CDVolume& Source, bool Resample, tVolume& Volume, tAuxVolume& Aux);
+
+    //! Horizontal (1 3 1) filter of a row, reads src[-1] and src[count].
+    static void filterRow(const vpl::img::tDensityPixel *src, int count, int *dst);
+
+    //! Weighted (1 3 1) sum of three rows.
+    static void sumRows(const int *row0, const int *row1, const int *row2, int count, int *dst);
+
+    //! Normalizes (1 3 1) sums of three filtered rows to 16 bits.
+    static void normalizeRows(const int *row0, const int *row1, const int *row2, int count, vpl::img::tPixel16 *dst);
+
+    //! Normalizes a density to 16 bits.
+    static vpl::img::tPixel16 normalize(float value);
+
+    //! Scales a normalized value to 8 bits of the skipping volume.
+    static int toSkip(int value);
+};
+
+#endif // CVolumeRenderingPreprocessor_H
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
@@ -0,0 +1,265 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef CVoxelRowClassifier_H
+#define CVoxelRowClassifier_H
+
+////////////////////////////////////////////////////////////
+// Includes
+
+// VPL
+#include <VPL/Image/Size.h>
+#include <VPL/Image/PixelTypes.h>
+#include <VPL/Base/Types.h>
+
+// STL
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VOXEL_ROW_CLASSIFIER_SSE2
+#endif
+
+////////////////////////////////////////////////////////////
+//! Row kernels used by marching cubes functors to classify a whole row
+//! of voxels at once. Voxel states are stored as a bitmask, bit i of the
+//! row lives in word i / 32 at position i % 32, which is the layout of
+//! the marching cubes state matrices.
+class CVoxelRowClassifier
+{
+public:
+    //! Type of a bitmask word.
+    typedef vpl::sys::tUInt32 tWord;
+
+    //! Number of bits stored in one word.
+    enum { WORD_BITS = 32 };
+
+    //! Returns number of words needed to store count bits.
+    static int wordCount(int count)
+    {
+        return (count + WORD_BITS - 1) / WORD_BITS;
+    }
+
+    //! Returns state of i-th bit.
+    static bool testBit(const tWord *bits, int i)
+    {
+        return 0 != ((bits[i / WORD_BITS] >> (i % WORD_BITS)) & 1);
+    }
+
+    //! Sets i-th bit.
+    static void setBit(tWord *bits, int i)
+    {
+        bits[i / WORD_BITS] |= tWord(1) << (i % WORD_BITS);
+    }
+
+    //! Clears i-th bit.
+    static void clearBit(tWord *bits, int i)
+    {
+        bits[i / WORD_BITS] &= ~(tWord(1) << (i % WORD_BITS));
+    }
+
+    //! Sets bits [offset, offset + count).
+    static void fill(tWord *bits, int offset, int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            setBit(bits, offset + i);
+        }
+    }
+
+    //! Copies count bits from the beginning of src to dst starting at bit dstOffset.
+    //! Words of dst must be cleared before, unused bits of the last src word must be zero.
+    static void copyBits(const tWord *src, int count, tWord *dst, int dstOffset)
+    {
+        const int words = wordCount(count);
+        const int shift = dstOffset % WORD_BITS;
+        dst += dstOffset / WORD_BITS;
+        if (0 == shift)
+        {
+            std::memcpy(dst, src, words * sizeof(tWord));
+            return;
+        }
+        for (int i = 0; i < words; ++i)
+        {
+            dst[i] |= src[i] << shift;
+            dst[i + 1] |= src[i] >> (WORD_BITS - shift);
+        }
+    }
+
+    //! Clips row [x, x + count) at (y, z) to the volume and zeroes all its
+    //! bits. Adjusts x and count so that they describe the inner part only,
+    //! offset is set to the bit of the first inner voxel. Returns false if
+    //! nothing is left.
+    static bool clipRow(int &x, int y, int z, int &count, tWord *bits, int &offset, const vpl::img::CSize3i &size)
+    {
+        offset = 0;
+        if (count <= 0)
+        {
+            return false;
+        }
+        std::memset(bits, 0, wordCount(count) * sizeof(tWord));
+        if (y < 0 || y >= size.y() || z < 0 || z >= size.z() || x >= size.x() || x + count <= 0)
+        {
+            return false;
+        }
+        if (x < 0)
+        {
+            offset = -x;
+            count += x;
+            x = 0;
+        }
+        if (x + count > size.x())
+        {
+            count = size.x() - x;
+        }
+        return count > 0;
+    }
+
+    //! Sets bits of voxels inside [low, high], bits must be cleared before.
+    template <typename T>
+    static void threshold(const T *src, int count, T low, T high, tWord *bits, int offset)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            if (src[i] >= low && src[i] <= high)
+            {
+                setBit(bits, offset + i);
+            }
+        }
+    }
+
+    //! Clears bits of voxels whose masked value differs from maskBit.
+    template <typename T>
+    static void applyMask(const T *src, int count, T maskValue, T maskBit, tWord *bits, int offset)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            if ((src[i] & maskValue) != maskBit)
+            {
+                clearBit(bits, offset + i);
+            }
+        }
+    }
+
+    //! Sets bits of voxels that have any of bits in mask set, bits must be cleared before.
+    template <typename T>
+    static void bitLayer(const T *src, int count, T mask, tWord *bits, int offset)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            if (src[i] & mask)
+            {
+                setBit(bits, offset + i);
+            }
+        }
+    }
+
+#ifdef VOXEL_ROW_CLASSIFIER_SSE2
+    //! SSE2 version of threshold for density data.
+    static void threshold(const vpl::img::tDensityPixel *src, int count, vpl::img::tDensityPixel low, vpl::img::tDensityPixel high, tWord *bits, int offset)
+    {
+        const __m128i vLow = _mm_set1_epi16(low);
+        const __m128i vHigh = _mm_set1_epi16(high);
+        int i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 8));
+            const __m128i outA = _mm_or_si128(_mm_cmplt_epi16(a, vLow), _mm_cmpgt_epi16(a, vHigh));
+            const __m128i outB = _mm_or_si128(_mm_cmplt_epi16(b, vLow), _mm_cmpgt_epi16(b, vHigh));
+            const int out = _mm_movemask_epi8(_mm_packs_epi16(outA, outB));
+            orBits16(bits, offset + i, tWord(~out & 0xFFFF));
+        }
+        threshold<vpl::img::tDensityPixel>(src + i, count - i, low, high, bits, offset + i);
+    }
+
+    //! SSE2 version of mask test for region data.
+    static void applyMask(const vpl::img::tPixel32 *src, int count, vpl::img::tPixel32 maskValue, vpl::img::tPixel32 maskBit, tWord *bits, int offset)
+    {
+        const __m128i vValue = _mm_set1_epi32(int(maskValue));
+        const __m128i vBit = _mm_set1_epi32(int(maskBit));
+        int i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            __m128i eq[4];
+            for (int j = 0; j < 4; ++j)
+            {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + j * 4));
+                eq[j] = _mm_cmpeq_epi32(_mm_and_si128(v, vValue), vBit);
+            }
+            const int keep = _mm_movemask_epi8(_mm_packs_epi16(_mm_packs_epi32(eq[0], eq[1]), _mm_packs_epi32(eq[2], eq[3])));
+            clearBits16(bits, offset + i, tWord(~keep & 0xFFFF));
+        }
+        applyMask<vpl::img::tPixel32>(src + i, count - i, maskValue, maskBit, bits, offset + i);
+    }
+
+    //! SSE2 version of bit layer test for region data.
+    static void bitLayer(const vpl::img::tPixel32 *src, int count, vpl::img::tPixel32 mask, tWord *bits, int offset)
+    {
+        const __m128i vMask = _mm_set1_epi32(int(mask));
+        const __m128i vZero = _mm_setzero_si128();
+        int i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            __m128i empty[4];
+            for (int j = 0; j < 4; ++j)
+            {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + j * 4));
+                empty[j] = _mm_cmpeq_epi32(_mm_and_si128(v, vMask), vZero);
+            }
+            const int none = _mm_movemask_epi8(_mm_packs_epi16(_mm_packs_epi32(empty[0], empty[1]), _mm_packs_epi32(empty[2], empty[3])));
+            orBits16(bits, offset + i, tWord(~none & 0xFFFF));
+        }
+        bitLayer<vpl::img::tPixel32>(src + i, count - i, mask, bits, offset + i);
+    }
+
+protected:
+    //! Sets 16 bits given by value at bit position pos.
+    static void orBits16(tWord *bits, int pos, tWord value)
+    {
+        const int shift = pos % WORD_BITS;
+        bits += pos / WORD_BITS;
+        bits[0] |= value << shift;
+        if (shift > WORD_BITS - 16)
+        {
+            bits[1] |= value >> (WORD_BITS - shift);
+        }
+    }
+
+    //! Clears 16 bits given by value at bit position pos.
+    static void clearBits16(tWord *bits, int pos, tWord value)
+    {
+        const int shift = pos % WORD_BITS;
+        bits += pos / WORD_BITS;
+        bits[0] &= ~(value << shift);
+        if (shift > WORD_BITS - 16)
+        {
+            bits[1] &= ~(value >> (WORD_BITS - shift));
+        }
+    }
+#endif
+};
+
+#endif // CVoxelRowClassifier_H
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
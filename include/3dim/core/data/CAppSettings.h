@@ -27,6 +27,7 @@
 #include <osg/Vec4f>
 
 #include <data/CStorageInterface.h>
+#include <data/CStorageProfiler.h>
 #include <data/storage_ids_core.h>
 
 namespace data
@@ -83,6 +84,12 @@ public:
     //! Get whether NPOT textures are enabled
     bool getNPOTTextures() const { return m_bNPOTTextures; } 
 
+    //! Enable profiling of storage entry updates and notifications
+    void setStorageProfiling(bool bEnable) { CStorageProfiler::enable(bEnable); }
+
+    //! Get whether storage profiling is enabled
+    bool getStorageProfiling() const { return CStorageProfiler::isEnabled(); }
+
 protected:
     //! Window clear color
     osg::Vec4f m_clearColor;
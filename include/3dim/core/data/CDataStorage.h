@@ -209,6 +209,26 @@ public:
 	//! Is invalidation locked
 	bool invalidationLocked() const { return !m_bCanInvalidate; }
 
+    //! Enables or disables coalescing of invalidations.
+    //! - The invalidated entry is made dirty and its observers are notified
+    //!   immediately, changes of dependent entries are recorded and merged
+    //!   per entry until flushInvalidation() is called, typically once per frame.
+    //! - Invalidations with the FORCE_UPDATE flag are never postponed.
+    //! - Pending invalidations are dispatched when coalescing is disabled.
+    void setInvalidationCoalescing(bool bEnable);
+
+    //! Returns true if invalidations are coalesced.
+    bool isInvalidationCoalescing() const { return m_bCoalesceInvalidation; }
+
+    //! Dispatches invalidations coalesced since the last call.
+    //! - Dependent entries are made dirty and updated lazily as usual,
+    //!   only entries declaring a thread safe update are regenerated ahead,
+    //!   independent ones of the same dependency level in parallel.
+    //! - Observers of each entry are notified once, from the calling thread
+    //!   and in dependency order.
+    //! - Does nothing while the invalidation is locked.
+    void flushInvalidation();
+
 protected:
 	//! Invalidated entries map
 	typedef std::map< int, CChangedEntries > tInvalidatedEntriesMap;
@@ -226,6 +246,9 @@ protected:
 	//! Is storage invalidation disabled
 	bool m_bCanInvalidate;
 
+    //! Are invalidations coalesced until flushInvalidation()?
+    bool m_bCoalesceInvalidation;
+
 	//! Invalidated entries vector - used for postponed invalidation
 	tInvalidatedEntriesMap m_invalidatedEntries, m_invalidatedDeps;
 
@@ -255,6 +278,10 @@ protected:
 	//! Store dependent entries to the list
 	void storeDependencies(CStorageEntry *pRoot, CEntryDeps& List);
 
+    //! Returns level of an entry in the dependency graph of invalidated entries,
+    //! entries without invalidated parents have level zero.
+    int getUpdateLevel(int Id, const tInvalidatedEntriesMap& Changes, std::map<int, int>& Levels);
+
 private:
     //! Private constructor.
     //! - Initializes the vector of storage entries.
@@ -32,6 +32,35 @@
 namespace data
 {
 
+///////////////////////////////////////////////////////////////////////////////
+//! Tells whether update() of objects of a given type may run on a worker
+//! thread concurrently with updates of other storage entries.
+//! - Types opt in using the DECLARE_THREAD_SAFE_UPDATE() macro.
+
+template <typename T>
+class CUpdateTraits
+{
+public:
+    static bool isThreadSafe()
+    {
+        return false;
+    }
+};
+
+//! Declares that update() of a given type is thread safe.
+//! - Must be used inside the data namespace.
+#define DECLARE_THREAD_SAFE_UPDATE( type ) \
+    template <> \
+    class CUpdateTraits<type> \
+    { \
+    public: \
+        static bool isThreadSafe() \
+        { \
+            return true; \
+        } \
+    }
+
+
 ///////////////////////////////////////////////////////////////////////////////
 //! Class derived from CStorableData holding pointer to some other class.
 //! - A reference counting smart pointer must be declared inside the T type
@@ -106,6 +135,12 @@ public:
         return m_spObject->hasData();  
     }
 
+    //! Returns true if the object type declares a thread safe update.
+    virtual bool isUpdateThreadSafe()
+    {
+        return CUpdateTraits<T>::isThreadSafe();
+    }
+
     //! Serialize. 
     virtual void serialize(vpl::mod::CBinarySerializer &Writer)
     {
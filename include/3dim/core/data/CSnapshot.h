@@ -143,6 +143,10 @@ public:
     //! Should be invalidated
     bool shouldInvalidate() { return m_invalidate; }
 
+    //! Additional flags passed to the storage when the entry is invalidated
+    //! after the last restore.
+    virtual int getInvalidationFlags() { return 0; }
+
     //! Set storage id
     void setStorageId(int storageID) { m_storageId = storageID; }
 
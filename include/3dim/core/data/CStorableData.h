@@ -104,6 +104,16 @@ public:
         return true;
     }
 
+    //! Returns true if update() may run on a worker thread concurrently
+    //! with updates of other entries.
+    //! - The storage then regenerates the object ahead when dispatching
+    //!   coalesced invalidations, other objects are updated lazily.
+    //! - See DECLARE_THREAD_SAFE_UPDATE() for objects held by CObjectHolder.
+    virtual bool isUpdateThreadSafe()
+    {
+        return false;
+    }
+
     //! Serialize. 
     virtual void serialize(vpl::mod::CBinarySerializer & VPL_UNUSED(Writer))
     { }
@@ -34,6 +34,7 @@
 #include "CEntryDeps.h"
 #include "CEntryChangeLog.h"
 #include "CStorableData.h"
+#include "CStorageProfiler.h"
 
 
 namespace data
@@ -289,7 +290,10 @@ public:
                 getChanges(m_Version, Changes);
 
                 vpl::sys::tScopedLock dataLock(m_DataLock);
-                m_spData->update(Changes);
+                {
+                    CStorageProfiler::CScope Profile(this, CStorageProfiler::EVENT_UPDATE);
+                    m_spData->update(Changes);
+                }
                 
                 // Clear the dirty flag and actualize the version number
                 clearDirty();
@@ -297,6 +301,12 @@ public:
         }
     }
 
+    //! Returns true if the data may be updated concurrently with other entries.
+    bool isUpdateThreadSafe()
+    {
+        return (m_spData.get()) ? m_spData->isUpdateThreadSafe() : false;
+    }
+
 	//! Initializes the data to its default state.
     void init()
     {
@@ -360,6 +370,7 @@ public:
         // Locking should not be necessary
 //        tLock Lock(*this);
 
+        CStorageProfiler::CScope Profile(this, CStorageProfiler::EVENT_NOTIFY);
         m_Signal.invoke(this);
     }
 
@@ -0,0 +1,136 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef CStorageProfiler_H
+#define CStorageProfiler_H
+
+// STL
+#include <atomic>
+#include <string>
+
+
+namespace data
+{
+
+class CStorageEntry;
+
+///////////////////////////////////////////////////////////////////////////////
+//! Profiler of the data storage.
+//! - Records number and wall time of entry updates and observer notifications,
+//!   and the number of entries invalidated by every invalidate() call.
+//! - Statistics can be exported as a CSV summary, individual events
+//!   as a Chrome trace (chrome://tracing, Perfetto).
+//! - Disabled by default, every hook costs a single flag test then.
+//! - Setting the STORAGE_PROFILE environment variable to a file name
+//!   enables the profiler at startup and writes name.json and name.csv
+//!   on exit.
+
+class CStorageProfiler
+{
+public:
+    //! Profiled events.
+    enum EEvent
+    {
+        EVENT_UPDATE = 0,
+        EVENT_NOTIFY = 1
+    };
+
+    //! Maximal number of recorded trace events, statistics are collected
+    //! even when the limit is reached.
+    enum { MAX_EVENTS = 1 << 20 };
+
+    //! Name of the environment variable.
+    static const char *ENV_VARIABLE;
+
+    //! Measures duration of a scope.
+    class CScope
+    {
+    public:
+        //! Starts the measurement if the profiler is enabled.
+        CScope(CStorageEntry *pEntry, int Event)
+            : m_pEntry(pEntry)
+            , m_Event(Event)
+            , m_Start(isEnabled() ? now() : -1)
+        {}
+
+        //! Records the event.
+        ~CScope()
+        {
+            if( m_Start >= 0 )
+            {
+                record(m_pEntry, m_Event, m_Start, now());
+            }
+        }
+
+    private:
+        CStorageEntry *m_pEntry;
+        int m_Event;
+        long long m_Start;
+    };
+
+public:
+    //! Returns true if the profiler is enabled.
+    static bool isEnabled() { return s_bEnabled.load(std::memory_order_relaxed); }
+
+    //! Enables or disables the profiler, recorded data are kept.
+    static void enable(bool bEnable);
+
+    //! Enables the profiler if the environment variable is set.
+    static void initFromEnvironment();
+
+    //! Drops all recorded data.
+    static void clear();
+
+    //! Returns current time in microseconds.
+    static long long now();
+
+    //! Records an event of a given entry.
+    static void record(CStorageEntry *pEntry, int Event, long long Start, long long End);
+
+    //! Records invalidation of an entry and number of invalidated dependent entries.
+    static void recordInvalidation(int Id, int FanOut);
+
+    //! Writes recorded events as a Chrome trace JSON file.
+    static bool exportTrace(const std::string& ssFilename);
+
+    //! Writes per entry statistics as a CSV file.
+    static bool exportSummary(const std::string& ssFilename);
+
+private:
+    //! Recorded data.
+    struct SData;
+
+    //! Returns the recorded data.
+    static SData& getData();
+
+    //! Is the profiler enabled? Tested by every hook without locking,
+    //! recorded data are guarded by their own mutex.
+    static std::atomic<bool> s_bEnabled;
+};
+
+
+} // namespace data
+
+#endif // CStorageProfiler_H
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
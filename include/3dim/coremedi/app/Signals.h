@@ -73,6 +73,7 @@ VPL_DECLARE_SIGNAL_1(104, void, int, SigSetSliceYZ);
 VPL_DECLARE_SIGNAL_1(105, void, int, SigSetSliceModeXY);
 VPL_DECLARE_SIGNAL_1(106, void, int, SigSetSliceModeXZ);
 VPL_DECLARE_SIGNAL_1(107, void, int, SigSetSliceModeYZ);
+VPL_DECLARE_SIGNAL_1(117, void, int, SigSetSliceSlabThickness);
 
 // Limiter dialog
 VPL_DECLARE_SIGNAL_1(108, void, int, SigSetMinX);
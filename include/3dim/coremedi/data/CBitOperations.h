@@ -23,6 +23,12 @@
 #ifndef CBitOperations_H
 #define CBitOperations_H
 
+#include <VPL/Base/Types.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 namespace data
 {
 
@@ -64,6 +70,45 @@ void clearBitInValue(tPixel& value, tPixel bitIndex)
     value &= ~(tPixel(1) << bitIndex);
 }
 
+//! Returns index of the lowest set bit, value must not be zero.
+inline int getLowestBitIndex(vpl::sys::tUInt32 value)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return int(index);
+#elif defined(__GNUC__)
+    return __builtin_ctz(value);
+#else
+    int index = 0;
+    while (!(value & 1))
+    {
+        value >>= 1;
+        ++index;
+    }
+    return index;
+#endif
+}
+
+//! Returns index of the highest set bit, value must not be zero.
+inline int getHighestBitIndex(vpl::sys::tUInt32 value)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse(&index, value);
+    return int(index);
+#elif defined(__GNUC__)
+    return 31 - __builtin_clz(value);
+#else
+    int index = 0;
+    while (value >>= 1)
+    {
+        ++index;
+    }
+    return index;
+#endif
+}
+
 }
 
 #endif // CBitOperations_H
@@ -0,0 +1,696 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef CBrickedBitVolume_H
+#define CBrickedBitVolume_H
+
+#include <VPL/Base/Lock.h>
+#include <VPL/Image/Volume.h>
+#include <VPL/System/Mutex.h>
+
+#include <data/CBitOperations.h>
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+namespace data
+{
+
+///////////////////////////////////////////////////////////////////////////////
+//! Sparse volume of bit masks, storage of segmented data snapshots
+//! (see CVolumeUndo::enableBrickSnapshots()), region data themselves
+//! are kept in a dense CBitVolume.
+//! - Volume is divided into bricks of BRICK_SIZE^3 voxels.
+//! - Brick is allocated on the first write of a value different from its
+//!   uniform value, bricks never written cost no voxel memory.
+//! - Copies share bricks, a shared brick is duplicated on write, so a copy
+//!   can be used as a cheap snapshot of the whole volume.
+//! - Bricks sealed by seal() are never written again, a background thread
+//!   packs them using run-length encoding. Reading a sealed brick locks it,
+//!   so voxel access is slower than in a dense volume.
+//! - Modified bricks are marked dirty until clearDirty() is called,
+//!   copies take over modification flags of the source volume.
+//! - Indexes returned by getIdx() address voxels inside bricks, they are not
+//!   compatible with indexes of vpl::img::CVolume.
+//! - Concurrent writes are allowed only to different bricks.
+
+template <typename tVoxel>
+class CBrickedBitVolume
+{
+public:
+    //! Brick size.
+    enum { BRICK_SHIFT = 4, BRICK_SIZE = 1 << BRICK_SHIFT, BRICK_VOXELS = BRICK_SIZE * BRICK_SIZE * BRICK_SIZE };
+
+    //! Dense volume type.
+    typedef vpl::img::CVolume<tVoxel> tDenseVolume;
+
+protected:
+    //! Voxels of an allocated brick.
+    struct SVoxels
+    {
+        //! Unpacked voxels, empty if the brick is packed.
+        std::vector<tVoxel> voxels;
+
+        //! Packed voxels, pairs of a run length and a value.
+        std::vector< std::pair<vpl::sys::tUInt16, tVoxel> > runs;
+
+        //! Sealed brick is never written and it may be packed at any time.
+        std::atomic<bool> bSealed;
+
+        //! Must be locked when a sealed brick is accessed.
+        std::mutex mutex;
+
+        SVoxels() : bSealed(false) {}
+        SVoxels(const tVoxel *pVoxels) : voxels(pVoxels, pVoxels + BRICK_VOXELS), bSealed(false) {}
+    };
+
+    //! Brick, either uniform value or allocated voxels.
+    struct SBrick
+    {
+        tVoxel uniform;
+        std::shared_ptr<SVoxels> voxels;
+
+        SBrick() : uniform(0) {}
+    };
+
+    //! Background thread packing sealed bricks.
+    class CCompressor
+    {
+    public:
+        //! Returns the compressor, the thread is started on the first use.
+        //! The instance is never destroyed, the thread just waits for work.
+        static CCompressor& getInstance()
+        {
+            static CCompressor *pInstance = new CCompressor;
+            return *pInstance;
+        }
+
+        //! Schedules bricks for packing.
+        void push(std::vector< std::weak_ptr<SVoxels> >& bricks)
+        {
+            if (bricks.empty())
+            {
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_queue.insert(m_queue.end(), bricks.begin(), bricks.end());
+            }
+            m_condition.notify_one();
+        }
+
+    protected:
+        CCompressor()
+        {
+            std::thread(&CCompressor::run, this).detach();
+        }
+
+        //! Packs scheduled bricks that are still alive.
+        void run()
+        {
+            std::vector< std::weak_ptr<SVoxels> > bricks;
+            for (;;)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_condition.wait(lock, [this] { return !m_queue.empty(); });
+                    bricks.swap(m_queue);
+                }
+                for (size_t i = 0; i < bricks.size(); ++i)
+                {
+                    std::shared_ptr<SVoxels> spVoxels = bricks[i].lock();
+                    if (spVoxels)
+                    {
+                        pack(*spVoxels);
+                    }
+                }
+                bricks.clear();
+            }
+        }
+
+        //! Replaces voxels of a sealed brick by runs if it saves memory.
+        static void pack(SVoxels& brick)
+        {
+            std::lock_guard<std::mutex> lock(brick.mutex);
+            if (brick.voxels.empty())
+            {
+                return;
+            }
+
+            std::vector< std::pair<vpl::sys::tUInt16, tVoxel> > runs;
+            for (size_t i = 0; i < brick.voxels.size(); ++i)
+            {
+                if (runs.empty() || runs.back().second != brick.voxels[i])
+                {
+                    runs.push_back(std::make_pair(vpl::sys::tUInt16(0), brick.voxels[i]));
+                }
+                ++runs.back().first;
+            }
+            if (runs.size() * sizeof(runs[0]) < brick.voxels.size() * sizeof(tVoxel))
+            {
+                brick.runs.assign(runs.begin(), runs.end());
+                std::vector<tVoxel>().swap(brick.voxels);
+            }
+        }
+
+    protected:
+        //! Bricks waiting for packing.
+        std::vector< std::weak_ptr<SVoxels> > m_queue;
+
+        //! Guards the queue.
+        std::mutex m_mutex;
+
+        //! Signals new bricks in the queue.
+        std::condition_variable m_condition;
+    };
+
+public:
+    //! Default constructor creates volume of zero size.
+    CBrickedBitVolume()
+        : m_Size(0, 0, 0)
+        , m_Bricks(0, 0, 0)
+        , m_sizeMutex(false)
+    {}
+
+    //! Constructor creates empty volume of a given size.
+    CBrickedBitVolume(vpl::tSize XSize, vpl::tSize YSize, vpl::tSize ZSize)
+        : m_Size(0, 0, 0)
+        , m_Bricks(0, 0, 0)
+        , m_sizeMutex(false)
+    {
+        resize(XSize, YSize, ZSize);
+    }
+
+    //! Copy constructor, bricks are shared until written.
+    CBrickedBitVolume(const CBrickedBitVolume& Volume)
+        : m_Size(Volume.m_Size)
+        , m_Bricks(Volume.m_Bricks)
+        , m_data(Volume.m_data)
+        , m_dirty(Volume.m_dirty)
+        , m_sizeMutex(false)
+    {}
+
+    //! Assignment operator, bricks are shared until written.
+    CBrickedBitVolume& operator=(const CBrickedBitVolume& Volume)
+    {
+        if (this != &Volume)
+        {
+            m_Size = Volume.m_Size;
+            m_Bricks = Volume.m_Bricks;
+            m_data = Volume.m_data;
+            m_dirty = Volume.m_dirty;
+        }
+        return *this;
+    }
+
+    ~CBrickedBitVolume() {}
+
+    //! Returns mutex, which must be locked before resizing the volume.
+    vpl::sys::CMutex& getSizeMutex() { return m_sizeMutex; }
+
+    //! Resizes the volume, all voxels are cleared.
+    CBrickedBitVolume& resize(vpl::tSize XSize, vpl::tSize YSize, vpl::tSize ZSize)
+    {
+        m_Size = vpl::img::CSize3i(XSize, YSize, ZSize);
+        m_Bricks = vpl::img::CSize3i((XSize + BRICK_SIZE - 1) >> BRICK_SHIFT, (YSize + BRICK_SIZE - 1) >> BRICK_SHIFT, (ZSize + BRICK_SIZE - 1) >> BRICK_SHIFT);
+        m_data.clear();
+        m_data.resize(vpl::tSize(m_Bricks.x()) * m_Bricks.y() * m_Bricks.z());
+        m_dirty.assign(m_data.size(), 1);
+        return *this;
+    }
+
+    //! Returns volume size.
+    const vpl::img::CSize3i& getSize() const { return m_Size; }
+    vpl::tSize getXSize() const { return m_Size.x(); }
+    vpl::tSize getYSize() const { return m_Size.y(); }
+    vpl::tSize getZSize() const { return m_Size.z(); }
+
+    //! Returns number of bricks in each direction.
+    const vpl::img::CSize3i& getBricks() const { return m_Bricks; }
+
+    //! Returns total number of bricks.
+    vpl::tSize getNumOfBricks() const { return vpl::tSize(m_data.size()); }
+
+    //! Returns index of a brick containing given voxel.
+    vpl::tSize getBrickIdx(vpl::tSize x, vpl::tSize y, vpl::tSize z) const
+    {
+        return ((z >> BRICK_SHIFT) * m_Bricks.y() + (y >> BRICK_SHIFT)) * m_Bricks.x() + (x >> BRICK_SHIFT);
+    }
+
+    //! Returns index of a given voxel.
+    vpl::tSize getIdx(vpl::tSize x, vpl::tSize y, vpl::tSize z) const
+    {
+        return getBrickIdx(x, y, z) * BRICK_VOXELS + getLocalIdx(x, y, z);
+    }
+
+    //! Returns voxel value.
+    tVoxel at(vpl::tSize i) const
+    {
+        const SBrick& brick = m_data[i / BRICK_VOXELS];
+        if (!brick.voxels)
+        {
+            return brick.uniform;
+        }
+
+        SVoxels& voxels = *brick.voxels;
+        const vpl::tSize local = i % BRICK_VOXELS;
+        if (!voxels.bSealed)
+        {
+            return voxels.voxels[local];
+        }
+
+        std::lock_guard<std::mutex> lock(voxels.mutex);
+        if (!voxels.voxels.empty())
+        {
+            return voxels.voxels[local];
+        }
+        vpl::tSize end = 0;
+        for (size_t r = 0; r < voxels.runs.size(); ++r)
+        {
+            end += voxels.runs[r].first;
+            if (local < end)
+            {
+                return voxels.runs[r].second;
+            }
+        }
+        return brick.uniform;
+    }
+
+    //! Returns voxel value.
+    tVoxel at(vpl::tSize x, vpl::tSize y, vpl::tSize z) const
+    {
+        return at(getIdx(x, y, z));
+    }
+
+    //! Is bit set?
+    bool at(vpl::tSize i, vpl::tSize bitIndex) const
+    {
+        return data::getBitFromValue<tVoxel>(at(i), tVoxel(bitIndex)) > 0;
+    }
+
+    //! Is bit set?
+    bool at(vpl::tSize x, vpl::tSize y, vpl::tSize z, vpl::tSize bitIndex) const
+    {
+        return at(getIdx(x, y, z), bitIndex);
+    }
+
+    //! Sets voxel value.
+    CBrickedBitVolume& set(vpl::tSize i, tVoxel value)
+    {
+        SBrick& brick = m_data[i / BRICK_VOXELS];
+        if (!brick.voxels && brick.uniform == value)
+        {
+            return *this;
+        }
+        writable(i / BRICK_VOXELS)[i % BRICK_VOXELS] = value;
+        return *this;
+    }
+
+    //! Sets voxel value.
+    CBrickedBitVolume& set(vpl::tSize x, vpl::tSize y, vpl::tSize z, tVoxel value)
+    {
+        return set(getIdx(x, y, z), value);
+    }
+
+    //! Sets the subscripted bit in voxel (to 1).
+    CBrickedBitVolume& setBit(vpl::tSize x, vpl::tSize y, vpl::tSize z, vpl::tSize bitIndex)
+    {
+        const vpl::tSize i = getIdx(x, y, z);
+        tVoxel value = at(i);
+        data::setBitInValue<tVoxel>(value, tVoxel(bitIndex));
+        return set(i, value);
+    }
+
+    //! Clears the subscripted bit in voxel (to 0).
+    CBrickedBitVolume& clearBit(vpl::tSize x, vpl::tSize y, vpl::tSize z, vpl::tSize bitIndex)
+    {
+        const vpl::tSize i = getIdx(x, y, z);
+        tVoxel value = at(i);
+        data::clearBitInValue<tVoxel>(value, tVoxel(bitIndex));
+        return set(i, value);
+    }
+
+    //! Sets all voxels to a given value, voxel memory is released.
+    CBrickedBitVolume& fillEntire(tVoxel value)
+    {
+        for (size_t b = 0; b < m_data.size(); ++b)
+        {
+            m_data[b].voxels.reset();
+            m_data[b].uniform = value;
+        }
+        m_dirty.assign(m_data.size(), 1);
+        return *this;
+    }
+
+    //! Returns true if a given brick is stored as a single value.
+    bool isBrickUniform(vpl::tSize b) const { return !m_data[b].voxels; }
+
+    //! Releases voxels of bricks that contain a single value only.
+    void compact()
+    {
+        const int count = int(m_data.size());
+#pragma omp parallel for schedule(dynamic)
+        for (int b = 0; b < count; ++b)
+        {
+            SBrick& brick = m_data[b];
+            if (!brick.voxels)
+            {
+                continue;
+            }
+            tVoxel voxels[BRICK_VOXELS];
+            readBrick(b, voxels);
+            if (std::find_if(voxels, voxels + BRICK_VOXELS, [&voxels](tVoxel v) { return v != voxels[0]; }) == voxels + BRICK_VOXELS)
+            {
+                brick.uniform = voxels[0];
+                brick.voxels.reset();
+            }
+        }
+    }
+
+    //! Seals all allocated bricks, they are never written again and the background
+    //! thread packs them. Writing a voxel of a sealed brick makes its unpacked copy.
+    void seal()
+    {
+        std::vector< std::weak_ptr<SVoxels> > bricks;
+        for (size_t b = 0; b < m_data.size(); ++b)
+        {
+            const std::shared_ptr<SVoxels>& spVoxels = m_data[b].voxels;
+            if (spVoxels && !spVoxels->bSealed)
+            {
+                spVoxels->bSealed = true;
+                bricks.push_back(spVoxels);
+            }
+        }
+        CCompressor::getInstance().push(bricks);
+    }
+
+    //! Returns number of bytes used by voxels of a given brick.
+    size_t getBrickSize(vpl::tSize b) const
+    {
+        const SBrick& brick = m_data[b];
+        if (!brick.voxels)
+        {
+            return 0;
+        }
+
+        SVoxels& voxels = *brick.voxels;
+        if (!voxels.bSealed)
+        {
+            return voxels.voxels.size() * sizeof(tVoxel);
+        }
+
+        std::lock_guard<std::mutex> lock(voxels.mutex);
+        return voxels.voxels.size() * sizeof(tVoxel) + voxels.runs.size() * sizeof(voxels.runs[0]);
+    }
+
+    //! Returns number of bytes used by voxels of allocated bricks.
+    size_t getAllocatedSize() const
+    {
+        size_t size = 0;
+        for (size_t b = 0; b < m_data.size(); ++b)
+        {
+            size += getBrickSize(vpl::tSize(b));
+        }
+        return size;
+    }
+
+    //! Is brick modified since the last clearDirty()?
+    bool isBrickDirty(vpl::tSize b) const { return m_dirty[b] != 0; }
+
+    //! Marks a brick as modified.
+    void setBrickDirty(vpl::tSize b) { m_dirty[b] = 1; }
+
+    //! Returns indexes of modified bricks.
+    void getDirtyBricks(std::vector<vpl::tSize>& bricks) const
+    {
+        bricks.clear();
+        for (size_t b = 0; b < m_dirty.size(); ++b)
+        {
+            if (m_dirty[b])
+            {
+                bricks.push_back(vpl::tSize(b));
+            }
+        }
+    }
+
+    //! Returns bounding box of modified bricks in voxels.
+    //! \return False if no brick is modified.
+    bool getDirtyBox(vpl::img::CPoint3i& min, vpl::img::CPoint3i& max) const
+    {
+        bool bAny = false;
+        for (vpl::tSize bz = 0, b = 0; bz < m_Bricks.z(); ++bz)
+        {
+            for (vpl::tSize by = 0; by < m_Bricks.y(); ++by)
+            {
+                for (vpl::tSize bx = 0; bx < m_Bricks.x(); ++bx, ++b)
+                {
+                    if (!m_dirty[b])
+                    {
+                        continue;
+                    }
+                    if (!bAny)
+                    {
+                        min = vpl::img::CPoint3i(bx, by, bz);
+                        max = min;
+                        bAny = true;
+                    }
+                    min = vpl::img::CPoint3i(vpl::math::getMin(min.x(), bx), vpl::math::getMin(min.y(), by), vpl::math::getMin(min.z(), bz));
+                    max = vpl::img::CPoint3i(vpl::math::getMax(max.x(), bx), vpl::math::getMax(max.y(), by), vpl::math::getMax(max.z(), bz));
+                }
+            }
+        }
+        if (bAny)
+        {
+            min = vpl::img::CPoint3i(min.x() << BRICK_SHIFT, min.y() << BRICK_SHIFT, min.z() << BRICK_SHIFT);
+            max = vpl::img::CPoint3i(vpl::math::getMin(((max.x() + 1) << BRICK_SHIFT), m_Size.x()) - 1,
+                                     vpl::math::getMin(((max.y() + 1) << BRICK_SHIFT), m_Size.y()) - 1,
+                                     vpl::math::getMin(((max.z() + 1) << BRICK_SHIFT), m_Size.z()) - 1);
+        }
+        return bAny;
+    }
+
+    //! Clears modification flags of all bricks.
+    void clearDirty() { m_dirty.assign(m_data.size(), 0); }
+
+    //! Fills the volume from a dense volume of the same size.
+    //! Bricks containing a single value are not allocated.
+    CBrickedBitVolume& fromVolume(const tDenseVolume& volume)
+    {
+        resize(volume.getXSize(), volume.getYSize(), volume.getZSize());
+
+        const int count = int(m_data.size());
+#pragma omp parallel for schedule(dynamic)
+        for (int b = 0; b < count; ++b)
+        {
+            brickFromVolume(b, volume);
+        }
+        return *this;
+    }
+
+    //! Copies the volume to a dense volume, which is resized if necessary.
+    void toVolume(tDenseVolume& volume) const
+    {
+        if (volume.getXSize() != m_Size.x() || volume.getYSize() != m_Size.y() || volume.getZSize() != m_Size.z())
+        {
+            volume.resize(m_Size.x(), m_Size.y(), m_Size.z(), volume.getMargin());
+        }
+
+        const int count = int(m_data.size());
+#pragma omp parallel for schedule(dynamic)
+        for (int b = 0; b < count; ++b)
+        {
+            brickToVolume(b, volume);
+        }
+    }
+
+    //! Copies one brick to a dense volume of the same size.
+    void brickToVolume(vpl::tSize b, tDenseVolume& volume) const
+    {
+        vpl::tSize x0, y0, z0, x1, y1, z1;
+        getBrickBox(b, x0, y0, z0, x1, y1, z1);
+
+        tVoxel voxels[BRICK_VOXELS];
+        readBrick(b, voxels);
+        for (vpl::tSize z = z0; z < z1; ++z)
+        {
+            for (vpl::tSize y = y0; y < y1; ++y)
+            {
+                for (vpl::tSize x = x0; x < x1; ++x)
+                {
+                    volume.at(x, y, z) = voxels[getLocalIdx(x, y, z)];
+                }
+            }
+        }
+    }
+
+    //! Updates one brick from a dense volume of the same size.
+    //! A changed brick gets new voxels, copies keep the original ones.
+    //! \return True if any voxel of the brick has changed.
+    bool brickFromVolume(vpl::tSize b, const tDenseVolume& volume)
+    {
+        vpl::tSize x0, y0, z0, x1, y1, z1;
+        getBrickBox(b, x0, y0, z0, x1, y1, z1);
+
+        tVoxel voxels[BRICK_VOXELS];
+        readBrick(b, voxels);
+
+        const tVoxel first = volume.at(x0, y0, z0);
+        bool bChanged = false, bUniform = true;
+        for (vpl::tSize z = z0; z < z1; ++z)
+        {
+            for (vpl::tSize y = y0; y < y1; ++y)
+            {
+                for (vpl::tSize x = x0; x < x1; ++x)
+                {
+                    const tVoxel value = volume.at(x, y, z);
+                    tVoxel& voxel = voxels[getLocalIdx(x, y, z)];
+                    bChanged |= (voxel != value);
+                    bUniform &= (value == first);
+                    voxel = value;
+                }
+            }
+        }
+        if (!bChanged)
+        {
+            return false;
+        }
+
+        SBrick& brick = m_data[b];
+        if (bUniform)
+        {
+            brick.voxels.reset();
+            brick.uniform = first;
+        }
+        else
+        {
+            brick.voxels = std::make_shared<SVoxels>(voxels);
+        }
+        m_dirty[b] = 1;
+        return true;
+    }
+
+    //! Returns true if a brick of another volume of the same size is known
+    //! to have the same content (it is shared or uniform with the same value).
+    bool isBrickShared(vpl::tSize b, const CBrickedBitVolume& other) const
+    {
+        const SBrick& brick = m_data[b];
+        const SBrick& otherBrick = other.m_data[b];
+        return brick.voxels == otherBrick.voxels && (brick.voxels || brick.uniform == otherBrick.uniform);
+    }
+
+    //! Makes a brick shared with a brick of another volume of the same size.
+    void shareBrick(vpl::tSize b, const CBrickedBitVolume& other)
+    {
+        m_data[b] = other.m_data[b];
+        m_dirty[b] = 1;
+    }
+
+    //! Returns voxel range [x0, x1) x [y0, y1) x [z0, z1) of a given brick.
+    void getBrickBox(vpl::tSize b, vpl::tSize& x0, vpl::tSize& y0, vpl::tSize& z0, vpl::tSize& x1, vpl::tSize& y1, vpl::tSize& z1) const
+    {
+        x0 = (b % m_Bricks.x()) << BRICK_SHIFT;
+        y0 = ((b / m_Bricks.x()) % m_Bricks.y()) << BRICK_SHIFT;
+        z0 = (b / (m_Bricks.x() * m_Bricks.y())) << BRICK_SHIFT;
+        x1 = vpl::math::getMin<vpl::tSize>(x0 + BRICK_SIZE, m_Size.x());
+        y1 = vpl::math::getMin<vpl::tSize>(y0 + BRICK_SIZE, m_Size.y());
+        z1 = vpl::math::getMin<vpl::tSize>(z0 + BRICK_SIZE, m_Size.z());
+    }
+
+protected:
+    //! Returns index of a given voxel inside its brick.
+    static vpl::tSize getLocalIdx(vpl::tSize x, vpl::tSize y, vpl::tSize z)
+    {
+        return (((z & (BRICK_SIZE - 1)) << BRICK_SHIFT | (y & (BRICK_SIZE - 1))) << BRICK_SHIFT) | (x & (BRICK_SIZE - 1));
+    }
+
+    //! Copies all voxels of a brick, packed bricks are decoded.
+    void readBrick(vpl::tSize b, tVoxel *pVoxels) const
+    {
+        const SBrick& brick = m_data[b];
+        if (!brick.voxels)
+        {
+            std::fill(pVoxels, pVoxels + BRICK_VOXELS, brick.uniform);
+            return;
+        }
+
+        SVoxels& voxels = *brick.voxels;
+        if (!voxels.bSealed)
+        {
+            std::copy(voxels.voxels.begin(), voxels.voxels.end(), pVoxels);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(voxels.mutex);
+        if (!voxels.voxels.empty())
+        {
+            std::copy(voxels.voxels.begin(), voxels.voxels.end(), pVoxels);
+            return;
+        }
+        for (size_t r = 0; r < voxels.runs.size(); ++r)
+        {
+            pVoxels = std::fill_n(pVoxels, voxels.runs[r].first, voxels.runs[r].second);
+        }
+    }
+
+    //! Returns voxels of a brick that can be written, allocates the brick
+    //! or makes its private copy if it is shared or sealed. Marks the brick dirty.
+    std::vector<tVoxel>& writable(vpl::tSize b)
+    {
+        SBrick& brick = m_data[b];
+        if (!brick.voxels || brick.voxels->bSealed || brick.voxels.use_count() > 1)
+        {
+            tVoxel voxels[BRICK_VOXELS];
+            readBrick(b, voxels);
+            brick.voxels = std::make_shared<SVoxels>(voxels);
+        }
+        m_dirty[b] = 1;
+        return brick.voxels->voxels;
+    }
+
+protected:
+    //! Volume size in voxels.
+    vpl::img::CSize3i m_Size;
+
+    //! Number of bricks in each direction.
+    vpl::img::CSize3i m_Bricks;
+
+    //! Bricks.
+    std::vector<SBrick> m_data;
+
+    //! Modification flags of bricks.
+    std::vector<unsigned char> m_dirty;
+
+    //! Must be locked before resizing volume.
+    vpl::sys::CMutex m_sizeMutex;
+};
+
+} // namespace data
+
+#endif // CBrickedBitVolume_H
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
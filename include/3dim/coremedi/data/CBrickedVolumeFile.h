@@ -0,0 +1,132 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef CBrickedVolumeFile_H
+#define CBrickedVolumeFile_H
+
+#include <data/CDensityData.h>
+
+#include <VPL/Base/Types.h>
+#include <VPL/Module/Progress.h>
+
+#include <vector>
+
+namespace data
+{
+
+///////////////////////////////////////////////////////////////////////////////
+//! Chunked VLM container (VLM version 2).
+//! - Fixed size header followed by a brick index, page aligned raw bricks
+//!   of density voxels and a block with DICOM metadata.
+//! - Files are memory mapped when read, so that bricks needed by the current
+//!   ortho slices can be copied to the volume before the rest of the file.
+//! - Older VLM files are still read by the serialization framework.
+
+class CBrickedVolumeFile
+{
+public:
+    //! Edge length of a brick in voxels.
+    enum { BRICK_SIZE = 32 };
+
+    //! Current container version.
+    enum { VERSION = 1 };
+
+    //! File header, stored as is at the beginning of the file.
+    struct SHeader
+    {
+        char magic[8];
+        vpl::sys::tUInt32 version;
+        vpl::sys::tUInt32 headerSize;
+        vpl::sys::tInt32 size[3];
+        vpl::sys::tInt32 brickSize;
+        vpl::sys::tInt32 bricks[3];
+        double voxelSize[3];
+        vpl::sys::tUInt64 indexOffset;
+        vpl::sys::tUInt64 metadataOffset;
+        vpl::sys::tUInt64 metadataSize;
+        char reserved[32];
+    };
+
+public:
+    //! Constructor.
+    CBrickedVolumeFile();
+
+    //! Destructor, unmaps the file.
+    ~CBrickedVolumeFile();
+
+    //! Returns true if the file starts with the bricked VLM header.
+    static bool isBrickedFile(const vpl::sys::tString& sFileName);
+
+    //! Writes the density data including metadata.
+    static bool write(const CDensityData& Data, const vpl::sys::tString& sFileName, vpl::mod::CProgress::tProgressFunc& Progress);
+
+    //! Maps the file and validates its header and brick index.
+    bool open(const vpl::sys::tString& sFileName);
+
+    //! Unmaps the file.
+    void close();
+
+    //! Is a file mapped?
+    bool isOpen() const { return m_pData != NULL; }
+
+    //! Resizes the volume, sets voxel size and metadata.
+    void prepare(CDensityData& Data) const;
+
+    //! Copies bricks that intersect given planes (negative position means none) into the volume.
+    //! Loaded bricks are marked, so that readBrickLayer() and readRemaining() skip them.
+    void readBricksForSlices(CDensityData& Data, int xyPosition, int xzPosition, int yzPosition);
+
+    //! Returns number of brick layers along the z axis.
+    int getLayerCount() const { return m_Header.bricks[2]; }
+
+    //! Copies bricks of a layer not loaded yet into the volume.
+    void readBrickLayer(CDensityData& Data, int bz);
+
+    //! Copies all bricks not loaded yet into the volume.
+    bool readRemaining(CDensityData& Data, vpl::mod::CProgress::tProgressFunc& Progress);
+
+    //! Reads metadata block.
+    void readMetadata(CDensityData& Data) const;
+
+protected:
+    //! Copies one brick from the mapped file.
+    void readBrick(CDensityData& Data, int bx, int by, int bz);
+
+protected:
+    //! File header
+    SHeader m_Header;
+
+    //! Mapped file
+    const char *m_pData;
+    vpl::sys::tUInt64 m_Size;
+
+    //! Platform handles of the mapping
+    void *m_hFile;
+    void *m_hMapping;
+
+    //! Already loaded bricks
+    std::vector<unsigned char> m_Loaded;
+};
+
+} // namespace data
+
+#endif // CBrickedVolumeFile_H
@@ -71,6 +71,9 @@ public:
     virtual long saveToBuffer(char * buffer, long length) override;
     virtual bool compressLosslessJPEG() override;
 
+    //! Parses a dicom file kept in memory, name is used in place of the file name.
+    bool loadBuffer(const char * data, size_t size, const std::string & name);
+
 
     ///////////////////////////////////////////////////////////////////////////////
     // Dicom dataset loader.
@@ -102,6 +105,10 @@ public:
     //! Retrieves data from dicom file tags
     static bool getDicomFileInfo(const vpl::sys::tString &dir, const std::string &filename, int& nFrames);
 
+    //! Registers JPEG decoders once for the whole process.
+    //! - Loaders call it themselves, call it before loading files in parallel.
+    static void registerDecoders();
+
 private:
     //! Pointer to the DCMTk main handle
     DcmFileFormat *m_pHandle;
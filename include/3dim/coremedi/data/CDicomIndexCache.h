@@ -0,0 +1,98 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef CDicomIndexCache_H
+#define CDicomIndexCache_H
+
+#include <data/CSeries.h>
+
+#include <VPL/Base/Types.h>
+#include <VPL/System/String.h>
+
+#include <map>
+#include <string>
+
+namespace data
+{
+
+///////////////////////////////////////////////////////////////////////////////
+//! On-disk index of dicom file headers found in a directory tree.
+//! - Entries are keyed by the file path and stay valid while size
+//!   and modification time of the file don't change.
+//! - Only files that were found by the last scan are written back,
+//!   so entries of removed files are dropped.
+
+class CDicomIndexCache
+{
+public:
+    //! Current index file version.
+    enum { VERSION = 1 };
+
+public:
+    //! Constructor.
+    CDicomIndexCache();
+
+    //! Reads the index of a given directory tree from the cache directory.
+    //! - Returns false if there is no valid index yet.
+    bool load(const vpl::sys::tString& cacheDir, const vpl::sys::tString& root);
+
+    //! Writes entries found or inserted since load() if anything changed.
+    bool save();
+
+    //! Returns header information of an unchanged file or NULL.
+    const SDicomFileInfo *find(const vpl::sys::tString& path, vpl::sys::tUInt64 size, vpl::sys::tInt64 mtime);
+
+    //! Adds header information of a parsed file.
+    void insert(const vpl::sys::tString& path, vpl::sys::tUInt64 size, vpl::sys::tInt64 mtime, const SDicomFileInfo& info);
+
+    //! Returns size and modification time of a file.
+    static bool getFileStamp(const vpl::sys::tString& path, vpl::sys::tUInt64& size, vpl::sys::tInt64& mtime);
+
+protected:
+    //! Cached information about a single file.
+    struct SEntry
+    {
+        vpl::sys::tUInt64 size;
+        vpl::sys::tInt64 mtime;
+        SDicomFileInfo info;
+    };
+
+    //! Entries indexed by utf8 path.
+    typedef std::map<std::string, SEntry> tEntries;
+
+protected:
+    //! Index file name.
+    vpl::sys::tString m_sFileName;
+
+    //! Entries read from the index file.
+    tEntries m_Loaded;
+
+    //! Entries found by the current scan.
+    tEntries m_Current;
+
+    //! Was anything inserted?
+    bool m_bModified;
+};
+
+} // namespace data
+
+#endif // CDicomIndexCache_H
@@ -32,11 +32,13 @@
 
 // STL
 #include <set>
+#include <vector>
 
 
 namespace data
 {
     class CSeries;
+    struct SDicomFileInfo;
 }
 
 namespace data
@@ -85,6 +87,10 @@ public:
     //! Runs through a file and finds all dicom series.
     CSeries * preLoadFile( const vpl::sys::tString & path );
 
+    //! Finds all dicom series among files kept in memory,
+    //! dir is the virtual directory of a CDicomMemoryFiles object.
+    CSeries * preLoadMemoryFiles( const vpl::sys::tString & dir );
+
     //! Adds yet another dicom file extension.
     void addDicomExtension( const vpl::sys::tString & extension );
 
@@ -103,6 +109,18 @@ public:
     //! Adds an empty extension.
     void allowNumExtension(bool bValue = true);
 
+    //! Sets directory where indexes of scanned directories are kept,
+    //! empty string (default) disables the index.
+    void setIndexCacheDirectory(const vpl::sys::tString& dir);
+
+protected:
+    //! List of files, pairs of directory and file name.
+    typedef std::vector< std::pair<vpl::sys::tString, vpl::sys::tString> > tFileList;
+
+    //! Reads headers of selected files, states are set to 1 for dicom files and 2 otherwise.
+    //! - Returns false if canceled.
+    bool readFileInfos(const tFileList& files, const std::vector<int>& toRead, std::vector<SDicomFileInfo>& infos, std::vector<char>& states);
+
 protected:
     //! Allowed dicom extensions
     std::set< vpl::sys::tString > m_DicomExtensions;
@@ -115,6 +133,9 @@ protected:
 
     //! Allows any extension of dicom files.
     bool m_bAllowAnyExtension;
+
+    //! Directory with dicom indexes.
+    vpl::sys::tString m_sIndexCacheDir;
 };
 
 } // namespace data
@@ -0,0 +1,96 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef CDicomMemoryFiles_H
+#define CDicomMemoryFiles_H
+
+#include <VPL/System/String.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace data
+{
+
+///////////////////////////////////////////////////////////////////////////////
+//! Set of dicom files kept in memory, e.g. entries inflated from a zip archive.
+//! - Files are published under a virtual directory, so that series built
+//!   from them can be loaded the same way as files on disk.
+//! - The virtual directory is valid while the object exists, files must not
+//!   be added once loading started.
+
+class CDicomMemoryFiles
+{
+public:
+    //! File contents.
+    typedef std::vector<char> tBuffer;
+
+public:
+    //! Constructor, registers a new unique virtual directory.
+    CDicomMemoryFiles();
+
+    //! Destructor, unregisters the virtual directory.
+    ~CDicomMemoryFiles();
+
+    //! Returns the virtual directory.
+    const vpl::sys::tString& getDirectory() const { return m_sDirectory; }
+
+    //! Adds a file, contents of the buffer are taken over.
+    //! - Returns name of the file within the virtual directory.
+    std::string addFile(tBuffer& data);
+
+    //! Returns number of files.
+    int getNumOfFiles() const { return int(m_Files.size()); }
+
+    //! Returns name of the i-th file.
+    std::string getFileName(int i) const;
+
+    //! Returns true if a given directory is a registered virtual directory.
+    static bool isMemoryDirectory(const vpl::sys::tString& dir);
+
+    //! Finds a file in a virtual directory.
+    static bool findFile(const vpl::sys::tString& dir, const std::string& filename, const char *& data, size_t& size);
+
+    //! Returns files registered under a given virtual directory or NULL.
+    static const CDicomMemoryFiles *find(const vpl::sys::tString& dir);
+
+protected:
+    //! Returns index of a file given its name or -1.
+    static int getFileIndex(const std::string& filename);
+
+private:
+    //! Not copyable, the object is referenced by the registry.
+    CDicomMemoryFiles(const CDicomMemoryFiles&);
+    CDicomMemoryFiles& operator=(const CDicomMemoryFiles&);
+
+protected:
+    //! Virtual directory.
+    vpl::sys::tString m_sDirectory;
+
+    //! File contents, files are named by their index.
+    std::vector<tBuffer> m_Files;
+};
+
+} // namespace data
+
+#endif // CDicomMemoryFiles_H
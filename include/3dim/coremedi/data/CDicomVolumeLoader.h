@@ -0,0 +1,88 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef CDicomVolumeLoader_H
+#define CDicomVolumeLoader_H
+
+#include <data/CDensityData.h>
+#include <data/CDicomLoader.h>
+
+#include <VPL/ImageIO/DicomSlice.h>
+#include <VPL/Module/Progress.h>
+
+namespace data
+{
+
+class CSerieInfo;
+
+///////////////////////////////////////////////////////////////////////////////
+//! Assembles a density volume from all dicom files of a serie.
+//! - Slices of a different orientation and wrongly positioned boundary
+//!   slices are skipped, missing slices are interpolated.
+//! - Oblique data are transformed to an orthogonal volume.
+//! - Files are decoded concurrently, progress is reported on the calling thread.
+
+class CDicomVolumeLoader
+{
+public:
+    //! Default constructor.
+    CDicomVolumeLoader();
+
+    //! In the streaming mode, image data of each file are decoded directly into
+    //! their final planes of the volume, so the serie is never held in memory twice.
+    void setStreaming(bool bEnable) { m_bStreaming = bEnable; }
+
+    //! Enables the compatibility mode of the dicom library.
+    void setCompatibilityMode(bool bEnable) { m_bCompatibilityMode = bEnable; }
+
+    //! Size of the orthogonal volume is rounded up to a multiple of a given value.
+    void setSizeMultiple(vpl::tSize multiple) { m_sizeMultiple = vpl::math::getMax<vpl::tSize>(multiple, 1); }
+
+    //! Loads the serie.
+    //! - Data receive the volume including the voxel size and position.
+    //! - RepSlice receives the representative slice with dicom meta data.
+    //! - Returns false on failure or if the loading was cancelled.
+    bool load(CSerieInfo *serie,
+              sExtendedTags& tags,
+              vpl::mod::CProgress::tProgressFunc& Progress,
+              CDensityData& Data,
+              vpl::img::CDicomSlice& RepSlice
+              );
+
+protected:
+    //! Is the streaming mode enabled?
+    bool m_bStreaming;
+
+    //! Is the compatibility mode enabled?
+    bool m_bCompatibilityMode;
+
+    //! Volume size multiple.
+    vpl::tSize m_sizeMultiple;
+};
+
+} // namespace data
+
+#endif // CDicomVolumeLoader_H
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
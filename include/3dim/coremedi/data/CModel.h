@@ -35,6 +35,7 @@
 #include "geometry/base/CMesh.h"
 #include "geometry/base/CArmature.h"
 #include <geometry/base/kdtree/kdtree.h>
+#include <geometry/base/CMeshSlicer.h>
 #include <data/CSnapshot.h>
 
 #include <data/CStorageInterface.h>
@@ -117,6 +118,9 @@ namespace data
         //! Returns the model geometry and clears Destroy flag in smart pointer
         geometry::CMesh *releaseMesh();
 
+        //! Returns the slicing index shared by all cuts of the model, access is serialized by the storage entry lock
+        geometry::CMeshSlicer &getSlicer() { return m_slicer; }
+
         //! Fills given mesh with mesh deformed by current armature. It should keep properties and just apply matrices given by armature if requested.
         void getDeformedMesh(geometry::CMesh &mesh, bool keepProperties = false);
 
@@ -831,6 +835,9 @@ namespace data
         //! Should be kd tree updated (is mesh "dirty")?
         bool m_mesh_dirty;
 
+        //! Slicing index of the mesh shared by XY, XZ and YZ cuts
+        geometry::CMeshSlicer m_slicer;
+
         std::map<std::string, vpl::img::CRGBAImage::tSmartPtr> m_textures;
     };
 
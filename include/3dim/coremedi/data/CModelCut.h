@@ -79,6 +79,9 @@ protected:
 	//! Clears geometry data
     void clear();
 
+    //! Cuts the model mesh by a plane perpendicular to a given axis using the slicer shared by the model
+    void cutByAxis(data::CModel &model, geometry::CMesh *mesh, int axis, float planePosition);
+
 public:
     //! Returns true if changes of a given parent entry may affect this object.
     bool checkDependency(CStorageEntry *pParent)
@@ -46,6 +46,10 @@ typedef vpl::img::tPixel32 tRegionVoxel;
 //! Every region is represented by one bit in voxel, so there can be maximum of sizeof(tRegionVoxel) overlapping regions.
 //! When resizing manually, m_sizeMutex must be locked!!! (because of region 3D preview)
 //! Rather, use method resizeSafe, which hadles it itself.
+//! Voxels are stored densely, slices, preview functors and classifiers address them
+//! through the vpl::img::CVolume layout. Bricked storage (CBrickedBitVolume) is used
+//! only by undo snapshots, changed areas are reported to undo and statistics
+//! as modified XY planes (see markModifiedPlanes() and getPlaneStamp()).
 class CMultiClassRegionData : public CBitVolume<tRegionVoxel>
 {
 public:
@@ -68,9 +72,34 @@ public:
     //! Initial number of regions.
     enum { MAX_REGIONS = 32 };
 
+    //! Helper flag passed to the invalidate() method (only voxels in planes
+    //! marked by markModifiedPlanes() have been changed).
+    enum
+    {
+        PLANES_MODIFIED = 1 << 2
+    };
+
 	//! Volume snapshot provider type
 	typedef data::CVolumeUndo< vpl::img::CVolume<tRegionVoxel> > tVolumeUndo;
 
+    //! Volume snapshot provider marking planes restored by undo/redo as modified.
+    class CRegionUndo : public tVolumeUndo
+    {
+    public:
+        //! Constructor
+        CRegionUndo(CMultiClassRegionData *pData);
+
+        //! Restores the snapshot and marks the affected planes.
+        virtual void restore(CSnapshot *snapshot);
+
+        //! Restored data are invalidated with PLANES_MODIFIED flag.
+        virtual int getInvalidationFlags() { return PLANES_MODIFIED; }
+
+    protected:
+        //! Region data
+        CMultiClassRegionData *m_pData;
+    };
+
 public:
     //! Default constructor.
     CMultiClassRegionData();
@@ -150,6 +179,19 @@ public:
     //! Get snapshot of the plane YZ 
     data::CSnapshot * getPlaneYZSnapshot( int position ) { return m_volumeUndo.getSnapshotYZ( position ); }
 
+    //! Marks XY planes [zMin, zMax] as modified.
+    //! Editors should call it before invalidating the data with PLANES_MODIFIED flag,
+    //! undo/redo marks restored planes itself. The next volume snapshot compares
+    //! only bricks of marked planes unless the data are invalidated without the flag.
+    void markModifiedPlanes(vpl::tSize zMin, vpl::tSize zMax);
+
+    //! Returns modification stamp of a given XY plane. Stamp changes whenever
+    //! the plane is marked as modified, zero means the plane was never marked.
+    vpl::sys::tUInt32 getPlaneStamp(vpl::tSize z) const
+    {
+        return (z >= 0 && z < vpl::tSize(m_planeStamps.size())) ? m_planeStamps[z] : 0;
+    }
+
     //! Fills region volume from another volume.
     //! Volumes must be of the same size.
     //! Gets labels from source volumes and converts them to bits.
@@ -255,6 +297,10 @@ public:
         return volume;
     }
 
+protected:
+    //! Changes modification stamps of XY planes [zMin, zMax] without marking them for undo.
+    void stampPlanes(vpl::tSize zMin, vpl::tSize zMax);
+
 protected:
     //! Is the coloring enabled?
     bool m_bColoringEnabled;
@@ -263,7 +309,13 @@ protected:
     vpl::sys::CMutex m_sizeMutex;
 
     //! Volume undo object
-    tVolumeUndo m_volumeUndo;
+    CRegionUndo m_volumeUndo;
+
+    //! Modification stamps of XY planes
+    std::vector<vpl::sys::tUInt32> m_planeStamps;
+
+    //! Last used modification stamp
+    vpl::sys::tUInt32 m_lastStamp;
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
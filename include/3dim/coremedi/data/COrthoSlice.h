@@ -28,6 +28,7 @@
 
 #include "CSlice.h"
 #include "CDensityData.h"
+#include "COrthoSliceCache.h"
 #include <data/storage_ids_core.h>
 
 namespace data
@@ -63,7 +64,7 @@ public:
 
 public:
     //! Constructor.
-    COrthoSlice(EPlane Plane) : m_Plane(Plane), m_Position(0), m_Mode(DEFAULT_MODE), m_bUseDensityWindow(true) {}
+    COrthoSlice(EPlane Plane) : m_Plane(Plane), m_Position(0), m_Mode(DEFAULT_MODE), m_bUseDensityWindow(true), m_SlabThickness(0), m_ProjectedFirst(-1), m_ProjectedLast(-1), m_Cache(Plane) {}
 
     //! Destructor.
     virtual ~COrthoSlice() {}
@@ -108,6 +109,17 @@ public:
     //! Returns current rendering mode.
     int getMode() const { return m_Mode; }
 
+    //! Changes number of slices around the position projected in MIP and RTG modes.
+    //! - Zero or negative thickness projects the whole volume.
+    COrthoSlice& setSlabThickness(int Thickness)
+    {
+        m_SlabThickness = Thickness;
+        return *this;
+    }
+
+    //! Returns number of slices projected in MIP and RTG modes.
+    int getSlabThickness() const { return m_SlabThickness; }
+
 
     //! Regenerates the object state according to any changes in the data storage.
     virtual void update(const CChangedEntries& Changes) = 0;
@@ -127,6 +139,14 @@ public:
     //! - RTG (X-Ray mode) mode.
     virtual void updateRTG(const CDensityData& Volume) = 0;
 
+protected:
+    //! Returns slices of the slab around the current position along a given axis.
+    void getSlab(const CDensityData& Volume, int Axis, int& First, int& Last) const;
+
+    //! Returns true if the slab around the current position differs
+    //! from the last projected one.
+    bool isSlabChanged(const CDensityData& Volume, int Axis) const;
+
 protected:
     //! Current plane.
     EPlane m_Plane;
@@ -139,6 +159,15 @@ protected:
 
     //! Should be density window applied when recomputing MIP and RTG?
     bool m_bUseDensityWindow;
+
+    //! Number of slices projected in MIP and RTG modes, zero means all.
+    int m_SlabThickness;
+
+    //! Slab of the last MIP or RTG projection, negative if there is none.
+    int m_ProjectedFirst, m_ProjectedLast;
+
+    //! Planes extracted ahead while scrolling.
+    COrthoSliceCache m_Cache;
 };
 
 
@@ -0,0 +1,190 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef COrthoSliceCache_H
+#define COrthoSliceCache_H
+
+////////////////////////////////////////////////////////////
+// Includes
+
+#include <VPL/Image/Image.h>
+#include <VPL/System/Mutex.h>
+#include <VPL/System/Condition.h>
+#include <VPL/System/Thread.h>
+
+#include <data/CMultiClassRegionData.h>
+#include <data/CDataStorage.h>
+
+// STL
+#include <list>
+
+namespace data
+{
+
+///////////////////////////////////////////////////////////////////////////////
+//! Cache of planes extracted from the density and region volumes along one
+//! axis. While the user scrolls, a helper thread predicts the scroll
+//! direction and extracts the next planes in advance.
+//! - Planes are stored as extracted, colorization still happens per update,
+//!   so density window changes don't invalidate the cache.
+//! - Every plane remembers the active dataset and versions of the storage
+//!   entries it was read from, planes read from older data are never returned.
+//! - Least recently used planes are dropped when the memory budget is exceeded.
+
+class COrthoSliceCache
+{
+public:
+    //! Default number of planes extracted ahead of the current position.
+    enum { DEFAULT_PREFETCH = 4 };
+
+    //! Default memory budget in bytes.
+    enum { DEFAULT_BUDGET = 64 * 1024 * 1024 };
+
+    //! Identification of data the planes are extracted from.
+    struct SSource
+    {
+        //! Active dataset.
+        int datasetId;
+
+        //! Are region planes extracted?
+        bool bRegion;
+
+        //! Are multi-class region planes extracted?
+        bool bMultiClass;
+
+        //! Versions of the storage entries.
+        unsigned densityVersion;
+        unsigned regionVersion;
+        unsigned multiClassVersion;
+
+        //! Default constructor.
+        SSource();
+
+        //! Returns true if both sources describe the same data.
+        bool operator==(const SSource& Source) const;
+        bool operator!=(const SSource& Source) const { return !(*this == Source); }
+    };
+
+public:
+    //! Constructor, plane is one of COrthoSlice::EPlane values.
+    COrthoSliceCache(int Plane, int Prefetch = DEFAULT_PREFETCH, long long Budget = DEFAULT_BUDGET);
+
+    //! Destructor stops the helper thread.
+    ~COrthoSliceCache();
+
+    //! Returns source describing the current state of the storage.
+    //! - Must be called from the thread updating the slices.
+    static SSource getSource(int DatasetId);
+
+    //! Extracts planes at a given position.
+    //! - Region planes are left empty if they are disabled or don't match the density volume.
+    //! - Flags are passed to the storage when entries are looked up.
+    static bool extract(int Plane, int Position, const SSource& Source, vpl::img::CDImage& Density, vpl::img::CImage16& Region, vpl::img::CImage<tRegionVoxel>& MultiClass, int Flags = Storage::CRUP);
+
+    //! Copies cached planes of a given position if they were extracted from the source.
+    bool get(int Position, const SSource& Source, vpl::img::CDImage& Density, vpl::img::CImage16& Region, vpl::img::CImage<tRegionVoxel>& MultiClass);
+
+    //! Tells the cache which position is displayed, the helper thread
+    //! then extracts planes in the predicted scroll direction.
+    void prefetch(int Position, int NumPositions, const SSource& Source);
+
+    //! Drops all cached planes.
+    void clear();
+
+protected:
+    //! Planes extracted at one position.
+    struct SPlanes
+    {
+        int position;
+        SSource source;
+        vpl::img::CDImage density;
+        vpl::img::CImage16 region;
+        vpl::img::CImage<tRegionVoxel> multiClass;
+
+        //! Returns memory occupied by the planes.
+        long long getSize() const;
+    };
+
+    //! List of cached planes, the most recently used first.
+    typedef std::list<SPlanes> tPlanes;
+
+protected:
+    //! Returns iterator to planes of a given position and source.
+    tPlanes::iterator find(int Position, const SSource& Source);
+
+    //! Drops least recently used planes over the budget.
+    void trim();
+
+    //! Reads the current versions of storage entries used by the source.
+    static SSource getVersions(const SSource& Source);
+
+    //! Helper thread extracting planes ahead.
+    static VPL_THREAD_ROUTINE(prefetchLoop);
+
+protected:
+    //! Axis of the planes.
+    int m_Plane;
+
+    //! Number of planes extracted ahead.
+    int m_Prefetch;
+
+    //! Memory budget.
+    long long m_Budget;
+
+    //! Cached planes.
+    tPlanes m_Planes;
+
+    //! Memory occupied by the cached planes.
+    long long m_Size;
+
+    //! Last displayed position and scroll direction.
+    int m_Position;
+    int m_Direction;
+
+    //! Number of positions along the axis.
+    int m_NumPositions;
+
+    //! Source of the last request.
+    SSource m_Source;
+
+    //! Incremented on every request, the helper thread drops outdated work.
+    unsigned m_Request;
+
+    //! Mutex guarding all members above.
+    vpl::sys::CMutex m_Mutex;
+
+    //! Condition signalled on a new request.
+    vpl::sys::CCondition m_Condition;
+
+    //! Helper thread.
+    vpl::sys::CThread m_Thread;
+
+    //! Was the helper thread started?
+    bool m_bRunning;
+};
+
+} // namespace data
+
+#endif // COrthoSliceCache_H
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
@@ -58,6 +58,28 @@ public:
 	std::string filename;
 };
 
+//! Header information of a dicom file needed to sort it into a serie.
+struct SDicomFileInfo
+{
+    //! Serie id.
+    std::string serieId;
+
+    //! Slice numbers of all frames stored in the file.
+    CDicom::tDicomNumList sliceIds;
+
+    //! Pixel spacing.
+    double pixelSpacing;
+
+    //! Bits allocated per pixel.
+    int bitsAllocated;
+
+    //! Number of frames.
+    int numOfFrames;
+
+    //! Default constructor.
+    SDicomFileInfo() : pixelSpacing(0.0), bitsAllocated(0), numOfFrames(0) {}
+};
+
 #ifdef WIN32 // for Windows file names that need to be in ACP
     std::string wcs2ACP(const std::wstring &wcsStr, bool bDoNotUseShortName = false);
     std::wstring ACP2wcs(const char *filename);
@@ -139,6 +161,10 @@ public:
     //! - Returns the number of succesfully read slices.
     int loadDicomFile(int FileNum, tDicomSlices& Slices, sExtendedTags& tags, bool bLoadImageData = true, bool bCompatibilityMode = false);
 
+    //! Prepares process wide state of the dicom library (e.g. decoders),
+    //! call it before files are loaded from several threads at once.
+    static void prepareParallelLoading();
+
 	//! Loads a single frame (i.e. slice) from a specified dicom file. 
 	//! Maps fileIndex to sliceId, so the slices in preview should be sorted.
 	bool loadDicomFileForPreview(int sliceIndex, vpl::img::CDicomSlice& Slice, sExtendedTags& tags, bool bLoadImageData = true, double pixelSpacing = 0.0);
@@ -219,6 +245,18 @@ public:
     //! - Returns pointer to an existing or newly created one serie.
     CSerieInfo * addDicomFile( const vpl::sys::tString &path );
     CSerieInfo * addDicomFile( const vpl::sys::tString &dir, const vpl::sys::tString &filename );
+
+    //! Adds dicom file whose header was already read.
+    //! - Returns NULL if the file doesn't belong to any serie.
+    CSerieInfo * addDicomFile( const vpl::sys::tString &dir, const vpl::sys::tString &filename, const SDicomFileInfo &info );
+
+    //! Reads header of a dicom file given by its directory and name.
+    //! - Doesn't change the working directory, so it can be called concurrently.
+    static bool readDicomFileInfo( const vpl::sys::tString &dir, const vpl::sys::tString &filename, SDicomFileInfo &info );
+
+protected:
+    //! Retrieves header information of a loaded dicom file.
+    static void getDicomFileInfo( CDicom &dicom, SDicomFileInfo &info );
     
 protected:
     //! Internal list of series.
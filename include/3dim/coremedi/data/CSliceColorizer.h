@@ -0,0 +1,242 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSliceColorizer_H
+#define CSliceColorizer_H
+
+////////////////////////////////////////////////////////////
+// Includes
+
+#include <VPL/Base/Types.h>
+#include <VPL/Image/Image.h>
+#include <VPL/Image/PixelTypes.h>
+#include <VPL/Math/Base.h>
+
+#include <data/CBitOperations.h>
+#include <data/CMultiClassRegionData.h>
+
+// STL
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SLICE_COLORIZER_SSE2
+#endif
+
+namespace data
+{
+
+class CDensityWindow;
+class CRegionColoring;
+class CMultiClassRegionColoring;
+
+///////////////////////////////////////////////////////////////////////////////
+//! Colorizes a slice in a single pass per row. The density window lookup,
+//! the region color lookup and the blending of regions over the density
+//! colors are done while the row is still in cache.
+//! - Colors are handled as packed RGBA words in the memory layout of CColor4b.
+//! - Only density windows whose coloring is fully cached in the color vector
+//!   can be used, see canColorize().
+
+class CSliceColorizer
+{
+public:
+    //! Packed RGBA color.
+    typedef vpl::sys::tUInt32 tPacked;
+
+public:
+    //! Constructor, density window colors are used directly, so the window
+    //! must not change while the colorizer is used.
+    CSliceColorizer(const CDensityWindow& window);
+
+    //! Returns true if the density window colors do not depend on anything
+    //! else than the density itself.
+    static bool canColorize(CDensityWindow& window);
+
+    //! Overlays regions of the region coloring.
+    void setRegionColoring(CRegionColoring& coloring);
+
+    //! Overlays regions of the multi-class region coloring.
+    void setMultiClassRegionColoring(CMultiClassRegionColoring& coloring);
+
+    //! Colorizes the slice without any region overlay.
+    void colorize(vpl::img::CRGBImage& rgbImage, const vpl::img::CDImage& densityImage);
+
+    //! Colorizes the slice and overlays region data.
+    //! - setRegionColoring() must be called first.
+    void colorize(vpl::img::CRGBImage& rgbImage, const vpl::img::CDImage& densityImage, const vpl::img::CImage16& regionImage);
+
+    //! Colorizes the slice and overlays multi-class region data.
+    //! - setMultiClassRegionColoring() must be called first.
+    void colorize(vpl::img::CRGBImage& rgbImage, const vpl::img::CDImage& densityImage, const vpl::img::CImage<tRegionVoxel>& regionImage);
+
+    //! Looks up colors of a row of densities, lut is indexed by density - minDensity.
+    //! Densities outside [minDensity, maxDensity] get colors of the nearest bound.
+    static void densityRow(const vpl::img::tDensityPixel *src, int count, const tPacked *lut, int minDensity, int maxDensity, tPacked *dst)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            const int density = vpl::math::getMin(vpl::math::getMax(int(src[i]), minDensity), maxDensity);
+            dst[i] = lut[density - minDensity];
+        }
+    }
+
+    //! Looks up colors of a row of region indexes, indexes outside the table get color outside.
+    static void regionRow(const vpl::img::tPixel16 *src, int count, const tPacked *table, int tableSize, tPacked outside, tPacked *dst)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            const int index = int(src[i]);
+            dst[i] = (index < tableSize) ? table[index] : outside;
+        }
+    }
+
+    //! Looks up colors of a row of multi-class region voxels.
+    //! - Active region wins if its bit is set, otherwise the highest visible region is used.
+    static void multiClassRow(const tRegionVoxel *src, int count, const tPacked *table, int tableSize, tRegionVoxel visibleMask, int active, tPacked dummy, tPacked *dst)
+    {
+        const tRegionVoxel activeMask = (active >= 0 && active < 32) ? (tRegionVoxel(1) << active) : 0;
+        const tPacked activeColor = (active >= 0 && active < tableSize) ? table[active] : dummy;
+        for (int i = 0; i < count; ++i)
+        {
+            const tRegionVoxel value = src[i];
+            if (value == 0)
+            {
+                dst[i] = dummy;
+            }
+            else if (value & activeMask)
+            {
+                dst[i] = activeColor;
+            }
+            else
+            {
+                const tRegionVoxel visible = value & visibleMask;
+                const int index = visible ? getHighestBitIndex(visible) : tableSize;
+                dst[i] = (index < tableSize) ? table[index] : dummy;
+            }
+        }
+    }
+
+    //! Blends row of colors over dst with respect to alpha of the blended color,
+    //! the same as blendColors() but in exact integer arithmetic.
+    static void blendRow(const tPacked *src, int count, tPacked *dst)
+    {
+        int i = 0;
+#ifdef SLICE_COLORIZER_SSE2
+        const __m128i vZero = _mm_setzero_si128();
+        const __m128i vAlphaMask = _mm_set1_epi32(int(alphaMask()));
+        const __m128i v255 = _mm_set1_epi16(255);
+        const __m128i vOne = _mm_set1_epi16(1);
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m128i over = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+
+            // fully transparent overlay is the most common case
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(over, vAlphaMask), vZero)) == 0xFFFF)
+            {
+                continue;
+            }
+
+            __m128i *pDst = reinterpret_cast<__m128i *>(dst + i);
+            const __m128i under = _mm_loadu_si128(pDst);
+            __m128i result[2];
+            for (int j = 0; j < 2; ++j)
+            {
+                const __m128i c1 = j ? _mm_unpackhi_epi8(over, vZero) : _mm_unpacklo_epi8(over, vZero);
+                const __m128i c2 = j ? _mm_unpackhi_epi8(under, vZero) : _mm_unpacklo_epi8(under, vZero);
+
+                // broadcast alpha of each pixel over its four components
+                __m128i a = _mm_shufflelo_epi16(c1, _MM_SHUFFLE(3, 3, 3, 3));
+                a = _mm_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+
+                // x = a * c1 + (255 - a) * c2 fits 16 bits, x / 255 = (x + 1 + (x >> 8)) >> 8
+                __m128i x = _mm_add_epi16(_mm_mullo_epi16(a, c1), _mm_mullo_epi16(_mm_sub_epi16(v255, a), c2));
+                x = _mm_add_epi16(_mm_add_epi16(x, vOne), _mm_srli_epi16(x, 8));
+                result[j] = _mm_srli_epi16(x, 8);
+            }
+            _mm_storeu_si128(pDst, _mm_packus_epi16(result[0], result[1]));
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            dst[i] = blend(src[i], dst[i]);
+        }
+    }
+
+    //! Blends color c1 over c2.
+    static tPacked blend(tPacked c1, tPacked c2)
+    {
+        const unsigned char *p1 = reinterpret_cast<const unsigned char *>(&c1);
+        const unsigned char *p2 = reinterpret_cast<const unsigned char *>(&c2);
+        const unsigned a = p1[3];
+        if (a == 0)
+        {
+            return c2;
+        }
+        tPacked result;
+        unsigned char *pr = reinterpret_cast<unsigned char *>(&result);
+        for (int k = 0; k < 4; ++k)
+        {
+            pr[k] = (unsigned char)((a * p1[k] + (255 - a) * p2[k]) / 255);
+        }
+        return result;
+    }
+
+protected:
+    //! Returns packed word with all alpha bits set.
+    static tPacked alphaMask()
+    {
+        tPacked mask = 0;
+        reinterpret_cast<unsigned char *>(&mask)[3] = 0xFF;
+        return mask;
+    }
+
+    //! Colorizes rows using given region row kernel.
+    template <class tRegionRow>
+    void colorizeRows(vpl::img::CRGBImage& rgbImage, const vpl::img::CDImage& densityImage, int xSize, int ySize, tRegionRow regionRow);
+
+protected:
+    //! Density window colors, indexed by density - m_MinDensity.
+    const tPacked *m_DensityLut;
+
+    //! Minimal and maximal density.
+    int m_MinDensity, m_MaxDensity;
+
+    //! Region colors with visibility and selection applied.
+    std::vector<tPacked> m_RegionTable;
+
+    //! Color of voxels not covered by the region table.
+    tPacked m_RegionOutside;
+
+    //! Mask of visible multi-class regions.
+    tRegionVoxel m_VisibleMask;
+
+    //! Active multi-class region.
+    int m_ActiveRegion;
+};
+
+} // namespace data
+
+#endif // CSliceColorizer_H
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
@@ -29,6 +29,7 @@
 #include <data/CRLECompress.h>
 #include <data/CDataStorage.h>
 #include <data/ESnapshotType.h>
+#include <data/CBrickedBitVolume.h>
 
 namespace data
 {
@@ -66,6 +67,50 @@ protected:
 }; // class CVolumeUndo
 
 
+///////////////////////////////////////////////////////////////////////////////
+//! Snapshot of volume data made of bricks shared with other snapshots.
+//! Only bricks modified since the previous snapshot are stored, they are
+//! packed in the background, see CVolumeUndo::enableBrickSnapshots().
+
+template < class V >
+class CBrickSnapshot : public CSnapshot
+{
+public:
+    //! Voxel type
+    typedef typename V::tVoxel tVoxel;
+
+    //! Bricked volume type
+    typedef data::CBrickedBitVolume< tVoxel > tBricks;
+
+public:
+    //! Constructor
+    CBrickSnapshot( int type, const tBricks & bricks, const std::vector< vpl::tSize > & ownBricks, CUndoProvider * provider = NULL )
+        : CSnapshot( type, provider ), m_bricks( bricks ), m_ownBricks( ownBricks ) {}
+
+    //! Returns current size of bricks that are not shared with the previous snapshot
+    virtual long getDataSize()
+    {
+        size_t size = 0;
+        for( size_t i = 0; i < m_ownBricks.size(); ++i )
+        {
+            size += m_bricks.getBrickSize( m_ownBricks[i] );
+        }
+        return long( size );
+    }
+
+    //! Returns bricks
+    const tBricks & getBricks() const { return m_bricks; }
+
+protected:
+    //! Bricks of the volume
+    tBricks m_bricks;
+
+    //! Bricks allocated for this snapshot
+    std::vector< vpl::tSize > m_ownBricks;
+
+}; // class CBrickSnapshot
+
+
 ///////////////////////////////////////////////////////////////////////////////
 //! CLASS CPlaneXYSnapshot - do undo on XY plane.
 
@@ -205,13 +250,16 @@ public:
     //! Plane YZ snapshot type
     typedef data::CPlaneYZSnapshot< V > tSnapshotYZ;
 
+    //! Brick snapshot type
+    typedef data::CBrickSnapshot< V > tBrickSnapshot;
+
 public:
     //! Constructor
     CVolumeUndo( tVolume * ptrVolume, int InvalidationID = 0, bool invalidate = false ) 
-	    : CUndoProvider( InvalidationID, invalidate ), m_ptrVolume( ptrVolume ){}
+	    : CUndoProvider( InvalidationID, invalidate ), m_ptrVolume( ptrVolume ), m_bBrickSnapshots( false ), m_bAllModified( true ){}
 
     //! Default constructor. Volume pointer must be set before the first use
-    CVolumeUndo( ) {}
+    CVolumeUndo( ) : m_bBrickSnapshots( false ), m_bAllModified( true ) {}
 
     //! Virtual destructor.
     virtual ~CVolumeUndo() {}
@@ -219,12 +267,23 @@ public:
     //! Set volume pointer
     void setVolumePtr( tVolume * ptrVolume ) { m_ptrVolume = ptrVolume; } 
 
+    //! Volume snapshots share unmodified bricks instead of compressing the whole volume.
+    //! Only bricks in XY planes passed to markModified() are compared with the previous
+    //! snapshot, so the owner must report every change of the volume.
+    void enableBrickSnapshots( bool bEnable ) { m_bBrickSnapshots = bEnable; m_reference.resize( 0, 0, 0 ); markModified(); }
+
+    //! Marks XY planes [zMin, zMax] as modified since the last snapshot or restore.
+    void markModified( vpl::tSize zMin, vpl::tSize zMax );
+
+    //! Marks the whole volume as modified.
+    void markModified( ) { m_bAllModified = true; }
+
     //! Get snapshot - undo/redo phase
     virtual CSnapshot * getSnapshot( CSnapshot *  snapshot );
 
     //! Create snapshot of the current state
     virtual CSnapshot * getSnapshotVolume( ) 
-	    { return NULL==m_ptrVolume.get() ? NULL : new tSnapshot( data::UNDO_SEGMENTATION, m_ptrVolume.get(), this ); }
+	    { return NULL==m_ptrVolume.get() ? NULL : ( m_bBrickSnapshots ? getBrickSnapshot() : new tSnapshot( data::UNDO_SEGMENTATION, m_ptrVolume.get(), this ) ); }
 
     //! Create snapshot of plane XY
     virtual CSnapshot * getSnapshotXY( int position ) 
@@ -252,9 +311,34 @@ protected:
         }
     }*/
 
+protected:
+    //! Updates the reference copy and creates a snapshot sharing its bricks
+    CSnapshot * getBrickSnapshot( );
+
+    //! Copies bricks that differ from the snapshot back to the volume
+    void restoreBricks( tBrickSnapshot * snapshot );
+
+    //! Returns bricks lying in modified planes
+    void getModifiedBricks( std::vector< vpl::tSize > & bricks ) const;
+
+    //! Clears modification flags, the reference is equal to the volume
+    void clearModified( ) { m_modifiedLayers.assign( m_reference.getBricks().z(), 0 ); m_bAllModified = false; }
+
 protected:
     //! Volume pointer
     vpl::base::CSharedPtr< tVolume > m_ptrVolume;
+
+    //! Are brick snapshots used?
+    bool m_bBrickSnapshots;
+
+    //! Volume state at the time of the last brick snapshot or restore
+    typename tBrickSnapshot::tBricks m_reference;
+
+    //! Modification flags of XY layers of bricks
+    std::vector< unsigned char > m_modifiedLayers;
+
+    //! Is the whole volume modified?
+    bool m_bAllModified;
 };
 
 
@@ -195,6 +195,145 @@ bool CPlaneYZSnapshot< V >::restore( tVolume * ptrVolume )
     CLASS CVolumeUndo
 ******************************************************************************/
 
+///////////////////////////////////////////////////////////////////////////////
+// Mark modified planes
+
+template < class V >
+void CVolumeUndo< V >::markModified( vpl::tSize zMin, vpl::tSize zMax )
+{
+    const vpl::tSize layers = m_reference.getBricks().z();
+    if( vpl::tSize( m_modifiedLayers.size() ) != layers )
+    {
+        m_bAllModified = true;
+        return;
+    }
+
+    zMin = vpl::math::getMax< vpl::tSize >( zMin, 0 ) >> tBrickSnapshot::tBricks::BRICK_SHIFT;
+    zMax = vpl::math::getMin< vpl::tSize >( zMax >> tBrickSnapshot::tBricks::BRICK_SHIFT, layers - 1 );
+    for( vpl::tSize z = zMin; z <= zMax; ++z )
+    {
+        m_modifiedLayers[z] = 1;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Get bricks in modified planes
+
+template < class V >
+void CVolumeUndo< V >::getModifiedBricks( std::vector< vpl::tSize > & bricks ) const
+{
+    bricks.clear();
+
+    const vpl::tSize layerBricks = m_reference.getBricks().x() * m_reference.getBricks().y();
+    for( vpl::tSize z = 0; z < m_reference.getBricks().z(); ++z )
+    {
+        if( m_bAllModified || m_modifiedLayers[z] )
+        {
+            for( vpl::tSize b = z * layerBricks; b < ( z + 1 ) * layerBricks; ++b )
+            {
+                bricks.push_back( b );
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Create brick snapshot
+
+template < class V >
+CSnapshot * CVolumeUndo< V >::getBrickSnapshot( )
+{
+    tVolume * ptrVolume = m_ptrVolume.get();
+    std::vector< vpl::tSize > ownBricks;
+
+    if( m_reference.getXSize() != ptrVolume->getXSize() || m_reference.getYSize() != ptrVolume->getYSize() || m_reference.getZSize() != ptrVolume->getZSize() )
+    {
+        m_reference.fromVolume( *ptrVolume );
+        for( vpl::tSize b = 0; b < m_reference.getNumOfBricks(); ++b )
+        {
+            if( !m_reference.isBrickUniform( b ) )
+            {
+                ownBricks.push_back( b );
+            }
+        }
+    }
+    else
+    {
+        // only bricks in modified planes may differ, changed ones get new voxels, older snapshots keep the original ones
+        std::vector< vpl::tSize > bricks;
+        getModifiedBricks( bricks );
+
+        std::vector< unsigned char > changed( bricks.size(), 0 );
+        const int count = int( bricks.size() );
+#pragma omp parallel for schedule(dynamic)
+        for( int i = 0; i < count; ++i )
+        {
+            changed[i] = m_reference.brickFromVolume( bricks[i], *ptrVolume ) && !m_reference.isBrickUniform( bricks[i] );
+        }
+
+        for( int i = 0; i < count; ++i )
+        {
+            if( changed[i] )
+            {
+                ownBricks.push_back( bricks[i] );
+            }
+        }
+    }
+
+    // the reference shares bricks with snapshots, let them be packed in the background
+    m_reference.seal();
+    clearModified();
+
+    return new tBrickSnapshot( data::UNDO_SEGMENTATION, m_reference, ownBricks, this );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Restore brick snapshot
+
+template < class V >
+void CVolumeUndo< V >::restoreBricks( tBrickSnapshot * snapshot )
+{
+    tVolume * ptrVolume = m_ptrVolume.get();
+    const typename tBrickSnapshot::tBricks & bricks = snapshot->getBricks();
+
+    if( bricks.getXSize() != ptrVolume->getXSize() || bricks.getYSize() != ptrVolume->getYSize() || bricks.getZSize() != ptrVolume->getZSize() )
+    {
+        return;
+    }
+
+    if( m_reference.getXSize() != bricks.getXSize() || m_reference.getYSize() != bricks.getYSize() || m_reference.getZSize() != bricks.getZSize() )
+    {
+        bricks.toVolume( *ptrVolume );
+        m_reference = bricks;
+        clearModified();
+        return;
+    }
+
+    // the volume may have been modified after the last snapshot, so bring modified planes of the reference up to date first
+    std::vector< vpl::tSize > modified;
+    getModifiedBricks( modified );
+
+    int count = int( modified.size() );
+#pragma omp parallel for schedule(dynamic)
+    for( int i = 0; i < count; ++i )
+    {
+        m_reference.brickFromVolume( modified[i], *ptrVolume );
+    }
+
+    // bricks of the reference and the snapshot are compared by pointers only
+    count = int( m_reference.getNumOfBricks() );
+#pragma omp parallel for schedule(dynamic)
+    for( int b = 0; b < count; ++b )
+    {
+        if( !m_reference.isBrickShared( b, bricks ) )
+        {
+            bricks.brickToVolume( b, *ptrVolume );
+            m_reference.shareBrick( b, bricks );
+        }
+    }
+    clearModified();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Restore state from the snapshot
 
@@ -211,6 +350,14 @@ void CVolumeUndo< V >::restore( CSnapshot * snapshot )
         return;
     }
 
+    tBrickSnapshot * sb = dynamic_cast< tBrickSnapshot * >( snapshot );
+
+    if(sb)
+    {
+        restoreBricks( sb );
+        return;
+    }
+
     tSnapshotXY * sxy = dynamic_cast< tSnapshotXY * >( snapshot );
 
     if(sxy)
@@ -253,6 +400,10 @@ CSnapshot * CVolumeUndo< V >::getSnapshot( CSnapshot *  snapshot )
     if(s) 
         return getSnapshotVolume();
 
+    tBrickSnapshot * sb = dynamic_cast< tBrickSnapshot * >( snapshot );  
+    if(sb) 
+        return getSnapshotVolume();
+
     tSnapshotXY * sxy = dynamic_cast< tSnapshotXY * >( snapshot );  
     if(sxy) 
         return getSnapshotXY( sxy->getPosition() );
@@ -171,6 +171,10 @@ public:
     virtual void setSliceModeXZ(int Mode);
     virtual void setSliceModeYZ(int Mode);
 
+    //! Changes number of slices projected by all ortho slices in MIP and RTG modes.
+    //! - Zero thickness projects the whole volume.
+    virtual void setSliceSlabThickness(int Thickness);
+
 
     //! Loads the density data from a given file.
     virtual bool loadDensityData(const std::string & ssFilename,
@@ -219,6 +223,10 @@ public:
     //! Changes adapter ram information which affects subsampling
     virtual void setAdapterProperties(unsigned long long adapterRAM, unsigned long textureSize2D, unsigned long textureSize3D) { m_adapterRAM = adapterRAM; m_textureSize2D = textureSize2D; m_textureSize3D = textureSize3D; }
 
+    //! Enables streaming assembly of DICOM series - headers are read first and image data
+    //! are decoded straight into the final volume, which keeps peak memory close to the volume size.
+    virtual void setStreamingDicomLoading(bool bEnable) { m_bStreamingDicomLoading = bEnable; }
+
 private:
     //! Subsamples given volume (returns true if volume should fit into GPU, false otherwise)
     bool subsample(data::CDensityData &densityData, ESubsamplingType subsamplingType, vpl::img::CVector3d& subsampling);
@@ -242,6 +250,8 @@ private:
     unsigned long m_textureSize2D;
     //! Max 3D texture size
     unsigned long m_textureSize3D;
+    //! Streaming DICOM loading
+    bool m_bStreamingDicomLoading;
 };
 
 
@@ -37,6 +37,8 @@
 
 namespace data
 {
+class CMultiClassRegionData;
+class CDensityData;
 
 class CRegionDataCalculator : public vpl::base::CObject, public vpl::base::CLockableObject<CRegionDataCalculator>
 {
@@ -128,6 +130,34 @@ public:
 	}
 
 protected:
+	//! Statistics of a single region accumulated over a part of the volume.
+	struct SRegionStats
+	{
+		int voxelsCnt;
+		int minDensity, maxDensity;
+		double sumDensity, sumSqrDensity;
+		int minX, maxX, minY, maxY, minZ, maxZ;
+
+		//! Resets the accumulator to its initial (empty) state.
+		void reset();
+
+		//! Merges statistics of another part.
+		void merge(const SRegionStats& other);
+	};
+
+	//! Computes statistics of all regions in a given XY plane.
+	static void updatePlane(vpl::tSize z, CMultiClassRegionData& rVolume, CDensityData& spVolume, int numRegions, SRegionStats *stats);
+
+protected:
+	//! Per-plane statistics, numRegions records for every XY plane.
+	std::vector<SRegionStats> m_planeStats;
+
+	//! Modification stamps of planes the statistics were computed for.
+	std::vector<vpl::sys::tUInt32> m_planeStamps;
+
+	//! Number of regions and volume size the per-plane statistics belong to.
+	int m_numRegions;
+	vpl::img::CSize3i m_size;
 
 	std::vector<int> m_voxelsCnt;
 	std::vector<int> m_minDensity;
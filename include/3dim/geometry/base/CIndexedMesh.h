@@ -0,0 +1,100 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef CIndexedMesh_H
+#define CIndexedMesh_H
+
+#include <vector>
+#include <string>
+
+namespace geometry
+{
+class CMesh;
+
+//! Compact triangle mesh stored as flat float vertex and uint32 index arrays.
+//! Used as a marching cubes output when half-edge connectivity is not needed,
+//! conversion to CMesh is done only on request.
+class CIndexedMesh
+{
+public:
+    //! Constructor.
+    CIndexedMesh();
+
+    //! Destructor.
+    ~CIndexedMesh();
+
+    //! Removes all vertices and triangles.
+    void clear();
+
+    //! Reserves memory for given number of vertices and triangles.
+    void reserve(size_t vertices, size_t triangles);
+
+    //! Adds vertex, interface of marching cubes output container.
+    void addVertex(double x, double y, double z);
+
+    //! Adds index, interface of marching cubes output container.
+    void addIndex(int index);
+
+    //! Appends another mesh, its indices are shifted accordingly.
+    void append(const CIndexedMesh &other);
+
+    //! Returns number of vertices.
+    size_t n_vertices() const { return m_vertices.size() / 3; }
+
+    //! Returns number of triangles.
+    size_t n_faces() const { return m_indices.size() / 3; }
+
+    //! Returns vertex coordinates (x, y, z for each vertex).
+    const std::vector<float> &getVertices() const { return m_vertices; }
+    std::vector<float> &getVertices() { return m_vertices; }
+
+    //! Returns triangle indices (3 for each triangle).
+    const std::vector<unsigned int> &getIndices() const { return m_indices; }
+    std::vector<unsigned int> &getIndices() { return m_indices; }
+
+    //! Merges vertices with identical coordinates (e.g. duplicated on seams of marching cubes blocks).
+    void weldVertices();
+
+    //! Builds half-edge mesh, vertices are welded first so that the result is connected.
+    //! \return False if some triangles couldn't be added.
+    bool toMesh(geometry::CMesh &mesh);
+
+    //! Fills arrays from half-edge mesh.
+    void fromMesh(const geometry::CMesh &mesh);
+
+    //! Writes binary STL file.
+    bool saveSTL(const std::string &filename) const;
+
+protected:
+    //! Vertex coordinates.
+    std::vector<float> m_vertices;
+
+    //! Triangle indices.
+    std::vector<unsigned int> m_indices;
+
+    //! True when there are no duplicated vertices.
+    bool m_welded;
+};
+
+} // namespace geometry
+
+#endif // CIndexedMesh_H
@@ -302,6 +302,10 @@ public:
     //! updates octree of mesh
     void updateOctree(int version);
 
+    //! Drops the octree, must be called when faces were added or removed
+    //! without updating the octree, cutting falls back to all faces then
+    void invalidateOctree();
+
     //! Gets octree
     CMeshOctree *getOctree()
     {
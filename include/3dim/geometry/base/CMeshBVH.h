@@ -0,0 +1,158 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef CMeshBVH_H_included
+#define CMeshBVH_H_included
+
+#include <geometry/base/CMesh.h>
+
+// STL
+#include <vector>
+
+namespace geometry
+{
+
+///////////////////////////////////////////////////////////////////////////////
+//! Bounding volume hierarchy over triangles of a mesh.
+//! - Nodes are stored depth first in one array, the left child of an inner
+//!   node directly follows it, triangles are stored in the leaf order.
+//! - The tree is a snapshot, it has to be rebuilt when the mesh changes.
+//! - Queries are read only and may run concurrently.
+
+class CMeshBVH
+{
+public:
+    //! Maximal number of triangles in a leaf.
+    enum { MAX_LEAF_TRIANGLES = 4 };
+
+    //! Part of a triangle the closest point lies on.
+    enum EFeature
+    {
+        FEATURE_FACE = 0,
+        FEATURE_VERTEX0, FEATURE_VERTEX1, FEATURE_VERTEX2,
+        FEATURE_EDGE01, FEATURE_EDGE12, FEATURE_EDGE20
+    };
+
+    //! Tree node, 32 bytes.
+    struct SNode
+    {
+        //! Bounding box.
+        float min[3], max[3];
+
+        //! First triangle of a leaf, or index of the right child of an inner node.
+        int first;
+
+        //! Number of triangles of a leaf, zero for inner nodes.
+        int count;
+    };
+
+    //! Triangle with pseudo normals of its features used for the distance sign.
+    struct STriangle
+    {
+        CMesh::Point a, b, c;
+
+        //! Angle weighted normals of vertices.
+        CMesh::Point vertexNormals[3];
+
+        //! Normals of edges, sums of normals of adjacent faces.
+        CMesh::Point edgeNormals[3];
+
+        //! Face normal.
+        CMesh::Point normal;
+
+        //! Index of the face in the mesh.
+        int face;
+    };
+
+    //! Result of the closest point query.
+    struct SClosestPoint
+    {
+        //! Closest point on the mesh.
+        CMesh::Point point;
+
+        //! Distance to the closest point.
+        float distance;
+
+        //! Index of the triangle in the tree, -1 if nothing was found.
+        int triangle;
+
+        //! Feature of the triangle the point lies on.
+        int feature;
+    };
+
+public:
+    //! Builds the tree over all faces of a mesh which are not deleted.
+    void build(const CMesh &mesh);
+
+    //! Releases the tree.
+    void clear();
+
+    //! Returns true if there is no triangle in the tree.
+    bool isEmpty() const { return m_triangles.empty(); }
+
+    //! Returns number of triangles.
+    size_t getNumOfTriangles() const { return m_triangles.size(); }
+
+    //! Returns a triangle in the tree order.
+    const STriangle &getTriangle(int i) const { return m_triangles[i]; }
+
+    //! Returns nodes of the tree.
+    const std::vector<SNode> &getNodes() const { return m_nodes; }
+
+    //! Finds the exact closest point on the mesh not farther than maxDistance.
+    bool findClosest(const CMesh::Point &point, float maxDistance, SClosestPoint &result) const;
+
+    //! Finds the closest point without the distance limit.
+    bool findClosest(const CMesh::Point &point, SClosestPoint &result) const;
+
+    //! Returns distance to the mesh, positive outside and negative inside
+    //! of a closed consistently oriented mesh.
+    //! - Returns false if the tree is empty.
+    bool getSignedDistance(const CMesh::Point &point, float &distance) const;
+
+    //! Returns pseudo normal of the feature of a closest point.
+    const CMesh::Point &getPseudoNormal(const SClosestPoint &closest) const;
+
+    //! Closest point on a triangle, returns squared distance and the feature.
+    static float closestPointOnTriangle(const CMesh::Point &p, const CMesh::Point &a, const CMesh::Point &b, const CMesh::Point &c, CMesh::Point &closest, int &feature);
+
+    //! Squared distance of a point to a node bounding box.
+    static float boxDistance2(const SNode &node, const CMesh::Point &p);
+
+protected:
+    //! Builds a subtree over triangles [begin, end) of the order, returns index of the node.
+    int buildNode(std::vector<int> &order, int begin, int end, const std::vector<CMesh::Point> &centroids, const std::vector<STriangle> &triangles);
+
+protected:
+    //! Tree nodes.
+    std::vector<SNode> m_nodes;
+
+    //! Triangles in the leaf order.
+    std::vector<STriangle> m_triangles;
+};
+
+} // namespace geometry
+
+#endif // CMeshBVH_H_included
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
@@ -0,0 +1,123 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef CMeshQuery_H_included
+#define CMeshQuery_H_included
+
+#include <geometry/base/CMeshBVH.h>
+#include <geometry/base/functions.h>
+
+// STL
+#include <limits>
+#include <vector>
+
+namespace geometry
+{
+
+///////////////////////////////////////////////////////////////////////////////
+//! Spatial queries on a mesh answered by a BVH built once per mesh version.
+//! - Point in mesh and guide tube collision tests give the same answers
+//!   as isPointInsideMesh() and isGuideTubeInCollisionWithMesh().
+//! - Batched variants process queries in parallel.
+//! - Queries do not touch the mesh, it may change after update() as long
+//!   as the query is updated before its next use.
+
+class CMeshQuery
+{
+public:
+    //! Ray of a batched ray cast.
+    struct SRay
+    {
+        geometry::Vec3 origin, direction;
+    };
+
+    //! Nearest hit of a ray.
+    struct SRayHit
+    {
+        //! Distance along the ray in units of the direction vector.
+        double distance;
+
+        //! Hit point.
+        geometry::Vec3 point;
+
+        //! Index of the hit face in the mesh, -1 if nothing was hit.
+        int face;
+    };
+
+public:
+    //! Default constructor.
+    CMeshQuery();
+
+    //! Rebuilds acceleration structures for a given mesh.
+    void update(const geometry::CMesh &mesh);
+
+    //! Rebuilds acceleration structures only if the version differs from the last one.
+    void update(const geometry::CMesh &mesh, int version);
+
+    //! Returns version of the mesh the query was built for, -1 if unversioned.
+    int getVersion() const { return m_version; }
+
+    //! Returns the BVH.
+    const CMeshBVH &getBVH() const { return m_bvh; }
+
+    //! Checks if point is inside of mesh, see isPointInsideMesh().
+    bool isPointInside(const geometry::Vec3 &point, const geometry::Vec3 &upVector) const;
+
+    //! Classifies points, inside flags are resized to the number of points.
+    void arePointsInside(const std::vector<geometry::Vec3> &points, const geometry::Vec3 &upVector, std::vector<unsigned char> &inside) const;
+
+    //! Finds the nearest hit of a ray not farther than maxDistance.
+    bool raycast(const geometry::Vec3 &origin, const geometry::Vec3 &direction, SRayHit &hit, double maxDistance = std::numeric_limits<double>::max()) const;
+
+    //! Finds nearest hits of rays, hits are resized to the number of rays.
+    void raycast(const std::vector<SRay> &rays, std::vector<SRayHit> &hits) const;
+
+    //! Checks if any triangle intersects a cylinder.
+    bool isCylinderInCollision(const geometry::Vec3 &center, const geometry::Vec3 &direction, double height, double radius) const;
+
+    //! Checks collision of a guide tube, see isGuideTubeInCollisionWithMesh() and getGuideTubeCollision().
+    bool isGuideTubeInCollision(const geometry::SGuideTubeCollision &collision) const;
+
+    //! Checks collisions of guide tubes, results are resized to the number of guide tubes.
+    void areGuideTubesInCollision(const std::vector<geometry::SGuideTubeCollision> &collisions, std::vector<unsigned char> &results) const;
+
+protected:
+    //! Returns minimum and maximum of dot products of mesh vertices with a vector.
+    void getExtent(const geometry::Vec3 &direction, double &minDot, double &maxDot) const;
+
+    //! Point in mesh test with a known extent of mesh along upVector.
+    bool isPointInside(const geometry::Vec3 &point, const geometry::Vec3 &upVector, double minDot, double maxDot) const;
+
+protected:
+    //! BVH of mesh triangles.
+    CMeshBVH m_bvh;
+
+    //! Version of the mesh.
+    int m_version;
+};
+
+} // namespace geometry
+
+#endif // CMeshQuery_H_included
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
@@ -0,0 +1,169 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef CMeshSlicer_H_included
+#define CMeshSlicer_H_included
+
+#include <geometry/base/CMesh.h>
+
+// STL
+#include <vector>
+
+namespace geometry
+{
+
+///////////////////////////////////////////////////////////////////////////////
+//! Cuts a mesh by planes perpendicular to coordinate axes.
+//! - Extents of triangles along an axis are kept in an interval tree built
+//!   on the first cut along the axis after the mesh changes, a cut visits
+//!   only triangles crossing the plane.
+//! - Segments are stitched into polylines through shared mesh edges and
+//!   the polylines of recently used plane positions are cached per axis.
+//! - The slicer keeps a copy of mesh vertices, the mesh may change after
+//!   update() as long as the slicer is updated before its next use.
+//! - One slicer serves cuts along all axes, so it can be shared by all
+//!   cuts of a model; the caller serializes access.
+
+class CMeshSlicer
+{
+public:
+    //! Number of cached plane positions.
+    enum { CACHE_SIZE = 32 };
+
+    //! Polyline of a contour, closed polylines do not repeat the first point.
+    struct SPolyline
+    {
+        std::vector<osg::Vec3> points;
+        bool closed;
+    };
+
+    //! Node of the interval tree.
+    struct SNode
+    {
+        //! Triangles of the node contain this coordinate.
+        float center;
+
+        //! Children with triangles below and above the center, -1 if missing.
+        int left, right;
+
+        //! Range of node triangles in sorted arrays.
+        int first, count;
+    };
+
+public:
+    //! Default constructor.
+    CMeshSlicer();
+
+    //! Copies triangles of a given mesh, indices of all axes are dropped.
+    void build(const geometry::CMesh &mesh);
+
+    //! Copies the mesh only if the version differs from the last one.
+    //! - Version -1 forces the rebuild.
+    void update(const geometry::CMesh &mesh, int version);
+
+    //! Releases the mesh copy, indices and caches.
+    void clear();
+
+    //! Returns version of the mesh the slicer was built for.
+    int getVersion() const { return m_version; }
+
+    //! Returns contour polylines for a plane perpendicular to a given axis
+    //! (0 - x, 1 - y, 2 - z), computed ones are taken from the cache.
+    const std::vector<SPolyline> &slice(int axis, float position);
+
+    //! Appends the contour as line segments (pairs of indices) to given arrays.
+    bool cut(int axis, float position, osg::Vec3Array *vertices, osg::DrawElementsUInt *indices);
+
+protected:
+    //! Contour of a plane position stored in the cache.
+    struct SCacheEntry
+    {
+        float position;
+        unsigned int lastUse;
+        std::vector<SPolyline> polylines;
+    };
+
+    //! Segment of the contour, ends are identified by mesh edges they lie on.
+    struct SSegment
+    {
+        unsigned long long keys[2];
+        osg::Vec3 points[2];
+    };
+
+    //! Index and cached contours of one axis.
+    struct SAxis
+    {
+        //! Is the index built for the current mesh?
+        bool built;
+
+        //! Extents of triangles along the axis.
+        std::vector<float> min, max;
+
+        //! Interval tree, the root is the first node.
+        std::vector<SNode> nodes;
+
+        //! Triangles of nodes sorted by increasing minimum and by decreasing maximum.
+        std::vector<int> byMin, byMax;
+
+        //! Cached contours.
+        std::vector<SCacheEntry> cache;
+
+        //! Counter of cache accesses.
+        unsigned int useCounter;
+
+        SAxis() : built(false), useCounter(0) {}
+    };
+
+    //! Builds the interval tree of an axis.
+    void buildAxis(int axis);
+
+    //! Builds a subtree over triangles [begin, end) of the order, returns index of the node.
+    int buildNode(SAxis &index, std::vector<int> &order, int begin, int end);
+
+    //! Finds triangles crossing the plane.
+    void findTriangles(const SAxis &index, float position, std::vector<int> &triangles) const;
+
+    //! Intersects a triangle with the plane, returns false if there is no segment.
+    bool intersect(int axis, int triangle, float position, SSegment &segment) const;
+
+    //! Computes contour polylines of the plane.
+    void computeContour(int axis, float position, std::vector<SPolyline> &polylines) const;
+
+protected:
+    //! Mesh vertices.
+    std::vector<osg::Vec3> m_points;
+
+    //! Vertex indices of triangles.
+    std::vector<int> m_triangles;
+
+    //! Indices of the x, y and z axis.
+    SAxis m_axes[3];
+
+    int m_version;
+};
+
+} // namespace geometry
+
+#endif // CMeshSlicer_H_included
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
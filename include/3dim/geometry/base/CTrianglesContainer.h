@@ -42,6 +42,10 @@ public:
 
     void init();
 
+    //! Reserves memory.
+    //! \param vertices, triangles Expected number of vertices and triangles.
+    void reserve(size_t vertices, size_t triangles);
+
     //! Adds vertex.
     //! \param x, y, z Vertex coordinates.
     void addVertex(double x, double y, double z);
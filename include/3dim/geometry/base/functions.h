@@ -30,6 +30,24 @@
 
 namespace geometry
 {
+    // Intersection of a line with a mesh triangle, used by point in mesh tests
+    struct SLineIntersection
+    {
+        geometry::Vec3 point;
+        double distance;
+        bool faceUp;
+        bool invalid;
+    };
+
+    // Collision volume of a guide tube in model coordinates, two cylinders and their bounding box
+    struct SGuideTubeCollision
+    {
+        geometry::Vec3 center, upVector, direction;
+        geometry::Vec3 cylinderCenter[2];
+        double cylinderHeight[2], cylinderRadius[2];
+        geometry::Vec3 boxMin, boxMax;
+    };
+
     int isnan(double x);
     int isnan(const geometry::Vec2 &pt);
     int isnan(const geometry::Vec3 &pt);
@@ -55,9 +73,11 @@ namespace geometry
     bool pointInTriangle(const geometry::Vec3& point, const std::vector<geometry::Vec3>& triangle, const geometry::Vec3& triangleNormal);
     bool lineTriangleIntersection(const std::vector<geometry::Vec3>& triangle, const geometry::Vec3& triangleNormal, const geometry::Vec3& pointOnLine, const geometry::Vec3& lineDirection, geometry::Vec3& intersectionPoint, double& distance);
     bool isPointInsideMesh(geometry::CMesh& mesh, const geometry::Vec3& point, const geometry::Vec3& upVector);
+    bool isPointInsideIntersections(std::vector<SLineIntersection>& intersections, const geometry::Vec3& point, const geometry::Vec3& upVector, double minDist, double maxDist);
     geometry::CMesh* cutMeshByVerticesSubset(const geometry::CMesh& mesh, std::vector<geometry::CMesh::VertexHandle>& handles);
     geometry::Vec3 toEuler(const geometry::Quat &q);
     bool compareMatrices(const geometry::Matrix &a, const geometry::Matrix &b);
+    void getGuideTubeCollision(const geometry::Matrix &modelMatrix, const double GTOffset, const double GTHeight, const double GTDistance, const double GTAllowance, const double MCHeight, const double MCDiameter, const double MCLipWidth, const geometry::Vec3& IPosition, const geometry::Vec3& IDirection, SGuideTubeCollision& collision);
     bool isGuideTubeInCollisionWithMesh(geometry::CMesh& mesh, const geometry::Matrix &modelMatrix, const double GTOffset, const double GTHeight, const double GTDistance, const double GTAllowance, const double MCHeight, const double MCDiameter, const double MCLipWidth, const geometry::Vec3& IPosition, const geometry::Vec3& IDirection);
 
     /////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <geometry/base/CMesh.h>
+#include <geometry/base/CMeshBVH.h>
+#include <string>
+
+namespace geometry
+{
+//! Distance of a mesh surface to a reference mesh.
+//! - Distances are exact point-triangle distances found in a BVH over the reference mesh.
+//! - Samples are taken from vertices and from faces (area weighted), measured in parallel.
+//! - Unlike HausdorffDistance there is no search radius, every sample finds its closest point.
+class SurfaceDistance
+{
+public:
+    //! Name of the default vertex property with signed distances.
+    static const char *DISTANCE_PROPERTY;
+
+public:
+    //! Builds the BVH over the reference mesh.
+    explicit SurfaceDistance(const CMesh& reference);
+
+    //! Set in once all sampling methods.
+    void setSampleType(bool isVertexSampling, bool isFaceSampling);
+
+    //! Number of face samples, vertex sampling uses at most this number of vertices.
+    void setSampleCount(size_t sampleCount);
+
+    //! Seed of the sample generator, results are reproducible for a given seed.
+    void setSeed(unsigned seed);
+
+    //! Measures distances from samples of a given mesh to the reference mesh.
+    bool compute(const CMesh& mesh);
+
+    //! Minimal distance of samples.
+    double getMinDistance() const;
+    //! Maximal distance of samples, i.e. one sided Hausdorff distance.
+    double getMaxDistance() const;
+    //! Mean distance of samples.
+    double getMeanDistance() const;
+    //! Root mean square distance of samples.
+    double getRmsDistance() const;
+    //! Number of measured samples.
+    size_t getSamplesCount() const;
+
+    //! Stores signed distance of every vertex of a mesh to the reference mesh
+    //! in a float vertex property, positive outside of the reference.
+    //! - The property is created if needed, persistent properties are saved with the mesh.
+    bool computeVertexDistances(CMesh& mesh, const std::string& propertyName = DISTANCE_PROPERTY, bool isPersistent = false) const;
+
+    //! Maps signed vertex distances stored by computeVertexDistances() to vertex colors.
+    //! - Zero distance is white, distances beyond the range are red outside
+    //!   and blue inside of the reference.
+    //! - Returns false if the property does not exist or the range is not positive.
+    static bool colorVertices(CMesh& mesh, float range, const std::string& propertyName = DISTANCE_PROPERTY);
+
+    //! Returns the BVH of the reference mesh.
+    const CMeshBVH& getBVH() const;
+
+private:
+    //! Generates sample points of a mesh.
+    void generateSamples(const CMesh& mesh, std::vector<CMesh::Point>& samples) const;
+
+    //! BVH of the reference mesh.
+    CMeshBVH m_bvh;
+
+    bool m_isVertexSample;
+    bool m_isFaceSample;
+
+    //! Upper bound for sampling points.
+    size_t m_maxSamples;
+
+    //! Seed of the generator.
+    unsigned m_seed;
+
+    double m_min;
+    double m_max;
+    double m_sum;
+    double m_sum2;
+    size_t m_samplesCount;
+};
+}
@@ -28,6 +28,8 @@
 // 
 #include <osg/Array>
 #include <vector>
+#include <map>
+#include <string>
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -329,6 +331,9 @@ private:
 };
 
 
+//! fills built-in lookup tables of the volume renderer (MIP_SOFT, MIP_HARD, XRAY_SOFT, ...), other tables are kept
+void createBuiltinLookupTables(std::map<std::string, CLookupTable> &lookupTables);
+
 //! helper function for sorting control points
 static bool pointSort(const CLookupTablePoint pointA, const CLookupTablePoint pointB);
 
@@ -0,0 +1,224 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef PSVRraycaster_H
+#define PSVRraycaster_H
+
+#include <alg/CVolumeRenderingPreprocessor.h>
+#include <render/CLookupTable.h>
+
+#include <VPL/Image/DensityVolume.h>
+#include <VPL/Image/Image.h>
+
+#include <osg/Matrix>
+#include <osg/Vec4>
+
+#include <vector>
+
+namespace PSVR
+{
+
+///////////////////////////////////////////////////////////////////////////////
+//! Software raycaster producing the same images as the PSVR shaders.
+//! - Uses the normalized volume and the skipping volume prepared by
+//!   CVolumeRenderingPreprocessor and the lookup table row sampled by shaders.
+//! - Follows the shader ray loop: coarse steps over the skipping volume,
+//!   fine steps inside meaningful blocks, early termination of opaque rays.
+//! - The image is rendered in tiles by all threads, no OpenGL context
+//!   is needed, so it can be used to render snapshots on headless machines.
+class PSVolumeRaycaster
+{
+public:
+    //! Supported rendering modes, match PSVolumeRendering::EShaders.
+    enum class EMode
+    {
+        XRAY = 0,
+        MIP,
+        SHADING,
+        SURFACE = 4
+    };
+
+    //! Predefined constants.
+    enum EConf
+    {
+        //! Number of lookup table entries, width of the lookup texture.
+        LUT_SIZE = 4096,
+
+        //! Height of the lookup texture, the row in the middle is used.
+        LUT_ROWS = 128,
+
+        //! Size of an image tile rendered by one thread.
+        TILE_SIZE = 16,
+
+        //! Maximal number of coarse steps along a ray.
+        MAX_COARSE_STEPS = 256,
+    };
+
+    //! Rendering parameters, the meaning matches shader uniforms.
+    struct SParams
+    {
+        //! Rendering mode.
+        EMode mode;
+
+        //! Remapping of normalized volume values (inputAdjustment).
+        float dataPreMultiplication, dataOffset;
+
+        //! Output color adjustment (imageAdjustment).
+        float imageBrightness, imageContrast;
+
+        //! Sampling step along a ray in voxels (textureSampling).
+        float samplingDistance;
+
+        //! Cutting plane in texture coordinates including its displacement (pl).
+        osg::Vec4 plane;
+
+        //! Surface detection parameters (surfacePar).
+        float surfaceNormalMult, surfaceNormalExp;
+
+        //! Rays are terminated when the transparency drops below this value (StopCondition).
+        float stopCondition;
+
+        //! Offsets ray starts by a deterministic per pixel noise, otherwise by a half of the step.
+        bool jitter;
+
+        //! Default parameters.
+        SParams();
+    };
+
+public:
+    //! Default constructor.
+    PSVolumeRaycaster();
+
+    //! Prepares volumes from density data the way PSVolumeRendering does.
+    //! - SubSampling is the data sampling coefficient of the rendering quality.
+    //! - Returns false if the data are empty.
+    bool setData(const vpl::img::CDensityVolume& Data, float SubSampling = 1.0f);
+
+    //! Copies already prepared volumes.
+    //! - Real sizes are extents of the volume in scene units.
+    void setVolumes(const CVolumeRenderingPreprocessor::tVolume& Volume,
+                    const CVolumeRenderingPreprocessor::tAuxVolume& Aux,
+                    float RealXSize, float RealYSize, float RealZSize);
+
+    //! Converts a transfer function the same way the GPU lookup texture is prepared.
+    void setLookupTable(const CLookupTable& LookupTable);
+
+    //! Sets the middle row of an internal RGBA lookup texture (alpha stored
+    //! as transparency) and the skip condition belonging to it.
+    void setLookupTable(const unsigned short *pRow, const osg::Vec4& SkipCondition);
+
+    //! Returns current parameters.
+    SParams& getParams() { return m_Params; }
+    const SParams& getParams() const { return m_Params; }
+
+    //! Changes parameters.
+    void setParams(const SParams& Params) { m_Params = Params; }
+
+    //! Returns true if volumes are ready.
+    bool hasData() const { return m_XSize > 0 && m_YSize > 0 && m_ZSize > 0; }
+
+    //! Renders the volume centered at the origin of the model space.
+    //! - Matrices are the OpenGL model-view and projection matrices the
+    //!   volume would be drawn with.
+    //! - The image is resized to Width x Height, the first row is the top one.
+    //! - Returns false if there are no data.
+    bool render(const osg::Matrix& ModelView, const osg::Matrix& Projection, int Width, int Height, vpl::img::CRGBImage& Image) const;
+
+    //! Renders a square thumbnail of the whole volume.
+    //! - The volume is viewed along a given direction by an orthographic
+    //!   camera, its bounding sphere fits the image.
+    //! - Returns false if there are no data.
+    bool renderThumbnail(const osg::Vec3& Direction, const osg::Vec3& Up, int Size, vpl::img::CRGBImage& Image) const;
+
+protected:
+    //! Entry of the lookup table, alpha is stored as transparency.
+    struct SLutEntry
+    {
+        float r, g, b, a;
+    };
+
+    //! Ray in texture coordinates.
+    struct SRay
+    {
+        osg::Vec3 start, end;
+        int x, y;
+    };
+
+    //! Samples the normalized volume at texture coordinates (linear, clamped to edge).
+    float sample(const osg::Vec3& pos) const;
+
+    //! Tests the skipping volume, returns false for empty blocks.
+    bool isMeaningful(const osg::Vec3& pos) const;
+
+    //! Returns the signed distance from the cutting plane.
+    float cuttingPlane(const osg::Vec3& pos) const;
+
+    //! Returns the remapped input value used as the lookup table index.
+    float remap(float value) const;
+
+    //! Returns the lookup table entry of a remapped value.
+    const SLutEntry& lookup(float value) const;
+
+    //! Shades a sample by its gradient and composites it front to back.
+    void composite(const osg::Vec3& pos, const osg::Vec3& light, const SLutEntry& entry, osg::Vec3& color, float& trans) const;
+
+    //! Casts a single ray, returns RGBA in <0, 1>.
+    osg::Vec4 castRay(const SRay& ray) const;
+
+    //! Updates sizes derived from volumes.
+    void updateSizes(float RealXSize, float RealYSize, float RealZSize);
+
+protected:
+    //! Rendering parameters.
+    SParams m_Params;
+
+    //! Normalized volume.
+    CVolumeRenderingPreprocessor::tVolume m_Volume;
+
+    //! Skipping volume.
+    CVolumeRenderingPreprocessor::tAuxVolume m_Aux;
+
+    //! Volume size in voxels.
+    int m_XSize, m_YSize, m_ZSize;
+
+    //! Skipping volume size in blocks.
+    int m_AuxXSize, m_AuxYSize, m_AuxZSize;
+
+    //! Real volume size.
+    float m_RealXSize, m_RealYSize, m_RealZSize;
+
+    //! Scale of texture coordinates to skipping blocks.
+    osg::Vec3 m_SkipScale;
+
+    //! Lookup table.
+    std::vector<SLutEntry> m_Lut;
+
+    //! Range of lookup table positions with non-zero opacity.
+    osg::Vec4 m_SkipCondition;
+};
+
+} // namespace PSVR
+
+#endif // PSVRraycaster_H
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
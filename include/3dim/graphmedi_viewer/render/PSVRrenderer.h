@@ -46,6 +46,8 @@ class OSGCanvas;
 
 namespace PSVR
 {
+class PSVolumeRaycaster;
+
 ///////////////////////////////////////////////////////////////////////////////
 //! Volume rendering routines suitable for OSG
 class PSVolumeRendering : public vpl::base::CLockableObject<PSVolumeRendering>, public CVolumeRenderer
@@ -235,6 +237,13 @@ public:
     float getRealYSize() const;
     float getRealZSize() const;
 
+    //! Prepares a software raycaster to render the current data with current settings.
+    //! - Volumes of the active data set are pre-processed again for the raycaster,
+    //!   the renderer frees its copies once they are uploaded to textures.
+    //! - Returns false if the selected shader is not supported by the raycaster
+    //!   or if there are no data.
+    bool setupRaycaster(PSVolumeRaycaster& raycaster);
+
     //! Renders the data.
     //! - This method is usually called during 'OSG drawable' rendering.
     void renderVolume(osg::RenderInfo& renderInfo);
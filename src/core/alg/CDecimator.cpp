@@ -34,10 +34,33 @@
 #include <OpenMesh/Tools/Decimater/ModIndependentSetsT.hh>
 #include <OpenMesh/Tools/Decimater/DecimaterT.hh>
 
+#include <geometry/metrics/surfaceDistance.h>
+
+#include <VPL/System/Stopwatch.h>
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 ////////////////////////////////////////////////////////////
 //
 
 bool CDecimator::Reduce(geometry::CMesh &mesh, int final_vert_number, int final_tri_number, float maxHausdorffDist /*= -1.0*/)
+{
+    if (m_parallel)
+    {
+        return reduceParallel(mesh, final_vert_number, final_tri_number, maxHausdorffDist);
+    }
+    return reduceSerial(mesh, final_vert_number, final_tri_number, maxHausdorffDist);
+}
+
+bool CDecimator::reduceSerial(geometry::CMesh &mesh, int final_vert_number, int final_tri_number, float maxHausdorffDist)
 {
 #if (OM_VERSION<0x020300)
     OpenMesh::Decimater::DecimaterT<geometry::CMesh> decimater(mesh);
@@ -142,3 +165,347 @@ bool CDecimator::makeProgress(int step)
 
     return true;
 }
+
+#if (OM_VERSION>=0x020300)
+namespace
+{
+
+//! Decimates a mesh with the modules of the serial decimation, without progress reporting.
+void decimate(geometry::CMesh &mesh, int final_vert_number, int final_tri_number, float maxHausdorffDist)
+{
+    OpenMesh::Decimater::DecimaterT<geometry::CMesh> decimater(mesh);
+    OpenMesh::Decimater::ModQuadricT<geometry::CMesh>::Handle modHandle0;
+    OpenMesh::Decimater::ModAspectRatioT<geometry::CMesh>::Handle modHandle1;
+    OpenMesh::Decimater::ModNormalFlippingT<geometry::CMesh>::Handle modHandle3;
+
+    decimater.add(modHandle0);
+    decimater.add(modHandle1);
+    decimater.add(modHandle3);
+
+    if (maxHausdorffDist > 0.0)
+    {
+        OpenMesh::Decimater::ModHausdorffT<geometry::CMesh>::Handle modHandleH;
+        decimater.add(modHandleH);
+        decimater.module(modHandleH).set_tolerance(maxHausdorffDist);
+    }
+
+    decimater.initialize();
+    decimater.decimate_to_faces(std::max(final_vert_number, 0), std::max(final_tri_number, 0));
+}
+
+}
+#endif
+
+bool CDecimator::reduceParallel(geometry::CMesh &mesh, int final_vert_number, int final_tri_number, float maxHausdorffDist)
+{
+#if (OM_VERSION<0x020300)
+    return reduceSerial(mesh, final_vert_number, final_tri_number, maxHausdorffDist);
+#else
+    // collect live faces
+    std::vector<geometry::CMesh::FaceHandle> faces;
+    faces.reserve(mesh.n_faces());
+    for (geometry::CMesh::FaceIter f_it = mesh.faces_begin(); f_it != mesh.faces_end(); ++f_it)
+    {
+        if (!mesh.has_face_status() || !mesh.status(f_it.handle()).deleted())
+        {
+            faces.push_back(f_it.handle());
+        }
+    }
+
+    const int nFaces = int(faces.size());
+    const int nVertices = mesh.n_vertices();
+#ifdef _OPENMP
+    int nParts = (m_partitions > 0) ? m_partitions : 2 * omp_get_max_threads();
+#else
+    int nParts = (m_partitions > 0) ? m_partitions : 1;
+#endif
+    if (nParts < 2 || nFaces < MIN_PARALLEL_FACES || final_tri_number >= nFaces)
+    {
+        return reduceSerial(mesh, final_vert_number, final_tri_number, maxHausdorffDist);
+    }
+
+    // ratio of the decimation
+    const double faceRatio = double(final_tri_number) / nFaces;
+    const double vertRatio = double(final_vert_number) / std::max(nVertices, 1);
+
+    // sort faces along the longest axis of the bounding box
+    geometry::CMesh::Point pmin(mesh.point(mesh.vertex_handle(0))), pmax(pmin);
+    for (geometry::CMesh::VertexIter v_it = mesh.vertices_begin(); v_it != mesh.vertices_end(); ++v_it)
+    {
+        pmin.minimize(mesh.point(v_it.handle()));
+        pmax.maximize(mesh.point(v_it.handle()));
+    }
+    const geometry::CMesh::Point extent = pmax - pmin;
+    const int axis = (extent[0] >= extent[1] && extent[0] >= extent[2]) ? 0 : (extent[1] >= extent[2] ? 1 : 2);
+
+    std::vector<float> keys(nFaces);
+#pragma omp parallel for
+    for (int i = 0; i < nFaces; ++i)
+    {
+        float key = 0.0f;
+        for (geometry::CMesh::FaceVertexIter fv_it = mesh.fv_iter(faces[i]); fv_it; ++fv_it)
+        {
+            key += mesh.point(fv_it.handle())[axis];
+        }
+        keys[i] = key;
+    }
+
+    std::vector<int> order(nFaces);
+    for (int i = 0; i < nFaces; ++i)
+    {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&keys](int a, int b) { return keys[a] < keys[b]; });
+
+    // slab i holds faces order[first[i]] .. order[first[i + 1] - 1]
+    std::vector<int> first(nParts + 1);
+    for (int i = 0; i <= nParts; ++i)
+    {
+        first[i] = int((long long)nFaces * i / nParts);
+    }
+
+    // vertices of faces from different slabs are locked in the parallel pass
+    std::vector<int> vertexPart(nVertices, -1);
+    std::vector<unsigned char> border(nVertices, 0);
+    for (int p = 0; p < nParts; ++p)
+    {
+        for (int i = first[p]; i < first[p + 1]; ++i)
+        {
+            for (geometry::CMesh::FaceVertexIter fv_it = mesh.fv_iter(faces[order[i]]); fv_it; ++fv_it)
+            {
+                const int v = fv_it.handle().idx();
+                if (vertexPart[v] < 0)
+                {
+                    vertexPart[v] = p;
+                }
+                else if (vertexPart[v] != p)
+                {
+                    border[v] = 1;
+                }
+            }
+        }
+    }
+
+    m_success = true;
+    this->setProgressMax(nParts + 2);
+    this->beginProgress();
+    this->progress();
+
+    // decimate slabs
+    std::vector<geometry::CMesh> parts(nParts);
+    std::vector<OpenMesh::VPropHandleT<int> > origins(nParts);
+    std::vector<unsigned char> valid(nParts, 1);
+    std::atomic<bool> cancelled(false);
+
+#pragma omp parallel for schedule(dynamic)
+    for (int p = 0; p < nParts; ++p)
+    {
+        if (cancelled)
+        {
+            continue;
+        }
+
+        geometry::CMesh &part = parts[p];
+        part.add_property(origins[p]);
+
+        // deleted flags must survive the decimater until the garbage collection
+        part.request_vertex_status();
+        part.request_edge_status();
+        part.request_face_status();
+
+        std::unordered_map<int, geometry::CMesh::VertexHandle> local;
+        std::vector<geometry::CMesh::VertexHandle> handles;
+        int lockedFaces = 0;
+        for (int i = first[p]; i < first[p + 1]; ++i)
+        {
+            bool locked = false;
+            handles.clear();
+            for (geometry::CMesh::FaceVertexIter fv_it = mesh.fv_iter(faces[order[i]]); fv_it; ++fv_it)
+            {
+                const int v = fv_it.handle().idx();
+                std::unordered_map<int, geometry::CMesh::VertexHandle>::iterator it = local.find(v);
+                if (it == local.end())
+                {
+                    geometry::CMesh::VertexHandle vh = part.add_vertex(mesh.point(fv_it.handle()));
+                    part.property(origins[p], vh) = v;
+                    part.status(vh).set_locked(border[v] != 0);
+                    it = local.insert(std::make_pair(v, vh)).first;
+                }
+                handles.push_back(it->second);
+                locked = locked || border[v];
+            }
+            if (!part.add_face(handles).is_valid())
+            {
+                valid[p] = 0;
+            }
+            lockedFaces += locked ? 1 : 0;
+        }
+
+        if (valid[p])
+        {
+            // locked faces stay, the rest is decimated at the global ratio
+            const int partFaces = part.n_faces();
+            const int targetFaces = int(faceRatio * (partFaces - lockedFaces)) + lockedFaces;
+            const int targetVertices = int(vertRatio * part.n_vertices());
+
+            part.request_face_normals();
+            part.update_face_normals();
+            decimate(part, targetVertices, targetFaces, maxHausdorffDist);
+            part.garbage_collection();
+        }
+
+#pragma omp critical
+        if (!cancelled && !progress())
+        {
+            cancelled = true;
+        }
+    }
+
+    if (cancelled)
+    {
+        m_success = false;
+        this->endProgress();
+        return false;
+    }
+
+    // merge slabs, locked vertices are shared
+    geometry::CMesh result;
+    std::vector<geometry::CMesh::VertexHandle> shared(nVertices);
+    std::vector<geometry::CMesh::VertexHandle> borderVertices;
+    bool merged = (std::find(valid.begin(), valid.end(), 0) == valid.end());
+    for (int p = 0; merged && p < nParts; ++p)
+    {
+        geometry::CMesh &part = parts[p];
+        std::vector<geometry::CMesh::VertexHandle> map(part.n_vertices());
+        for (geometry::CMesh::VertexIter v_it = part.vertices_begin(); v_it != part.vertices_end(); ++v_it)
+        {
+            const int v = part.property(origins[p], v_it.handle());
+            if (border[v])
+            {
+                if (!shared[v].is_valid())
+                {
+                    shared[v] = result.add_vertex(part.point(v_it.handle()));
+                    borderVertices.push_back(shared[v]);
+                }
+                map[v_it.handle().idx()] = shared[v];
+            }
+            else
+            {
+                map[v_it.handle().idx()] = result.add_vertex(part.point(v_it.handle()));
+            }
+        }
+
+        std::vector<geometry::CMesh::VertexHandle> handles;
+        for (geometry::CMesh::FaceIter f_it = part.faces_begin(); merged && f_it != part.faces_end(); ++f_it)
+        {
+            handles.clear();
+            for (geometry::CMesh::FaceVertexIter fv_it = part.fv_iter(f_it.handle()); fv_it; ++fv_it)
+            {
+                handles.push_back(map[fv_it.handle().idx()]);
+            }
+            merged = result.add_face(handles).is_valid();
+        }
+
+        // free memory early
+        part = geometry::CMesh();
+    }
+
+    // slabs which could not be represented separately, use the serial decimation
+    if (!merged)
+    {
+        this->endProgress();
+        return reduceSerial(mesh, final_vert_number, final_tri_number, maxHausdorffDist);
+    }
+
+    if (!progress())
+    {
+        m_success = false;
+        this->endProgress();
+        return false;
+    }
+
+    // border pass, only two rings around former slab borders may change
+    result.request_vertex_status();
+    result.request_edge_status();
+    result.request_face_status();
+    std::vector<unsigned char> zone(result.n_vertices(), 0);
+    for (int ring = 0; ring < 2; ++ring)
+    {
+        const size_t count = borderVertices.size();
+        for (size_t i = 0; i < count; ++i)
+        {
+            zone[borderVertices[i].idx()] = 1;
+            for (geometry::CMesh::VertexVertexIter vv_it = result.vv_iter(borderVertices[i]); vv_it; ++vv_it)
+            {
+                if (!zone[vv_it.handle().idx()])
+                {
+                    zone[vv_it.handle().idx()] = 1;
+                    borderVertices.push_back(vv_it.handle());
+                }
+            }
+        }
+    }
+    for (geometry::CMesh::VertexIter v_it = result.vertices_begin(); v_it != result.vertices_end(); ++v_it)
+    {
+        result.status(v_it.handle()).set_locked(!zone[v_it.handle().idx()]);
+    }
+
+    result.request_face_normals();
+    result.update_face_normals();
+    decimate(result, final_vert_number, final_tri_number, maxHausdorffDist);
+
+    for (geometry::CMesh::VertexIter v_it = result.vertices_begin(); v_it != result.vertices_end(); ++v_it)
+    {
+        result.status(v_it.handle()).set_locked(false);
+    }
+    result.garbage_collection();
+
+    mesh = result;
+
+    this->progress();
+    this->endProgress();
+
+    return m_success;
+#endif
+}
+
+bool CDecimator::compareWithSerial(const geometry::CMesh &mesh, int final_vert_number, int final_tri_number, float maxHausdorffDist, SQuality &quality, size_t samples)
+{
+    geometry::CMesh serial(mesh), parallel(mesh);
+    vpl::sys::CStopwatch sw;
+
+    sw.start();
+    if (!reduceSerial(serial, final_vert_number, final_tri_number, maxHausdorffDist))
+    {
+        return false;
+    }
+    quality.serialTime = sw.getDuration();
+
+    sw.start();
+    if (!reduceParallel(parallel, final_vert_number, final_tri_number, maxHausdorffDist))
+    {
+        return false;
+    }
+    quality.parallelTime = sw.getDuration();
+
+    quality.serialVertices = serial.n_vertices();
+    quality.serialFaces = serial.n_faces();
+    quality.parallelVertices = parallel.n_vertices();
+    quality.parallelFaces = parallel.n_faces();
+
+    // distances in both directions
+    geometry::SurfaceDistance toSerial(serial);
+    geometry::SurfaceDistance toParallel(parallel);
+    toSerial.setSampleCount(samples);
+    toParallel.setSampleCount(samples);
+    if (!toSerial.compute(parallel) || !toParallel.compute(serial))
+    {
+        return false;
+    }
+
+    quality.maxDistance = std::max(toSerial.getMaxDistance(), toParallel.getMaxDistance());
+    quality.meanDistance = 0.5 * (toSerial.getMeanDistance() + toParallel.getMeanDistance());
+    quality.rmsDistance = std::max(toSerial.getRmsDistance(), toParallel.getRmsDistance());
+
+    return true;
+}
@@ -32,6 +32,9 @@
 #include <VPL/Base/Logging.h>
 
 #include <chrono>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
 
 ////////////////////////////////////////////////////////////
 // scheme cubes with numbering conventions of nodes and edges
@@ -1594,17 +1597,12 @@ bool CMarchingCubes::generateMesh(
 
     // merge submeshes
     mesh.clear();
-    std::map<int, std::set<std::pair<geometry::CMesh::VertexHandle, int> > > vertexMap;
+    m_voxelSize = volumeFunctor->getVoxelSize();
     std::vector<geometry::CMesh::VertexHandle> seamVertices;
-    for (int i = 0; i < workerCount; ++i)
+    if (!mergeWorkerMeshes(workers, mesh, seamVertices))
     {
-        mergeMeshes(workers[i].getMesh(), workers[i].getOpenEdgeVertices(), mesh, vertexMap, seamVertices);
-
-        if (!progress())
-        {
-            endProgress();
-            return false;
-        }
+        endProgress();
+        return false;
     }
 
     //auto dur = std::chrono::high_resolution_clock::now() - start;
@@ -1763,11 +1761,215 @@ void CMarchingCubes::mergeMeshes(geometry::CMesh &sourceMesh, std::set<std::pair
     sourceMesh.remove_property(vProp_targetHandle);
 }
 
+//! Flat copy of one worker mesh prepared for merging.
+struct SMergedSubmesh
+{
+    //! Handle index -> index in the merged mesh (-1 for deleted vertices).
+    std::vector<int> targetIndex;
+
+    //! Global edge keys, usages and handle indices of open edge vertices in set order.
+    std::vector<std::pair<unsigned long long, int> > openKeys;
+    std::vector<int> openHandles;
+    std::vector<bool> isOpen;
+
+    //! Number of vertices not lying on a seam and index of the first one in the merged mesh.
+    int interiorCount;
+    int interiorBase;
+
+    //! Vertex handle indices of faces (3 per face), face flags and index of the first face in the merged mesh.
+    std::vector<int> faces;
+    std::vector<short> faceFlags;
+    int faceBase;
+};
+
+//! Position of a marching cubes vertex quantized to half of voxel, which identifies the voxel edge it lies on.
+static unsigned long long globalEdgeKey(const geometry::CMesh::Point &point, const vpl::img::CSize3d &voxelSize)
+{
+    const long long bias = 1 << 20;
+    const unsigned long long mask = (1 << 21) - 1;
+    const unsigned long long kx = (unsigned long long)((long long)std::floor(2.0 * point[0] / voxelSize.x() + 0.5) + bias) & mask;
+    const unsigned long long ky = (unsigned long long)((long long)std::floor(2.0 * point[1] / voxelSize.y() + 0.5) + bias) & mask;
+    const unsigned long long kz = (unsigned long long)((long long)std::floor(2.0 * point[2] / voxelSize.z() + 0.5) + bias) & mask;
+    return (kz << 42) | (ky << 21) | kx;
+}
+
+bool CMarchingCubes::mergeWorkerMeshes(std::vector<CMarchingCubesWorker> &workers, geometry::CMesh &targetMesh, std::vector<geometry::CMesh::VertexHandle> &seamVertices)
+{
+    const int workerCount = int(workers.size());
+    std::vector<SMergedSubmesh> submeshes(workerCount);
+    bool flagIsPresent = false;
+
+    // flatten worker meshes and compute edge keys of their open vertices
+    #pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < workerCount; ++i)
+    {
+        geometry::CMesh &sourceMesh = workers[i].getMesh();
+        std::set<std::pair<geometry::CMesh::VertexHandle, int> > &openEdgeVertices = workers[i].getOpenEdgeVertices();
+        SMergedSubmesh &submesh = submeshes[i];
+
+        submesh.targetIndex.assign(sourceMesh.n_vertices(), -1);
+        submesh.openKeys.reserve(openEdgeVertices.size());
+        submesh.openHandles.reserve(openEdgeVertices.size());
+        std::vector<bool> &isOpen = submesh.isOpen;
+        isOpen.assign(sourceMesh.n_vertices(), false);
+        for (std::set<std::pair<geometry::CMesh::VertexHandle, int> >::iterator oevit = openEdgeVertices.begin(); oevit != openEdgeVertices.end(); ++oevit)
+        {
+            submesh.openKeys.push_back(std::pair<unsigned long long, int>(globalEdgeKey(sourceMesh.point(oevit->first), m_voxelSize), oevit->second));
+            submesh.openHandles.push_back(oevit->first.idx());
+            isOpen[oevit->first.idx()] = true;
+        }
+
+        submesh.interiorCount = 0;
+        for (geometry::CMesh::VertexIter vit = sourceMesh.vertices_begin(); vit != sourceMesh.vertices_end(); ++vit)
+        {
+            if (!isOpen[vit.handle().idx()])
+            {
+                submesh.interiorCount++;
+            }
+        }
+
+        OpenMesh::FPropHandleT<short> fProp_flag;
+        const bool hasFlag = sourceMesh.get_property_handle(fProp_flag, "fProp_flag");
+        submesh.faces.reserve(sourceMesh.n_faces() * 3);
+        for (geometry::CMesh::FaceIter fit = sourceMesh.faces_begin(); fit != sourceMesh.faces_end(); ++fit)
+        {
+            for (geometry::CMesh::FaceVertexIter fvit = sourceMesh.fv_begin(fit.handle()); fvit != sourceMesh.fv_end(fit.handle()); ++fvit)
+            {
+                submesh.faces.push_back(fvit.handle().idx());
+            }
+            if (hasFlag)
+            {
+                submesh.faceFlags.push_back(sourceMesh.property(fProp_flag, fit.handle()));
+            }
+        }
+        assert(submesh.faces.size() % 3 == 0);
+
+        if (hasFlag && sourceMesh.n_vertices() > 0)
+        {
+            #pragma omp critical
+            flagIsPresent = true;
+        }
+    }
+
+    // resolve seam vertices in worker order, so that the merged mesh has the same vertex order as with sequential merging
+    typedef std::unordered_map<unsigned long long, std::pair<int, int> > tSeamMap;
+    tSeamMap seamMap;
+    std::vector<geometry::CMesh::Point> points;
+    std::vector<int> seamIndices;
+    int vertexCount = 0;
+    int faceCount = 0;
+    for (int i = 0; i < workerCount; ++i)
+    {
+        if (!progress())
+        {
+            return false;
+        }
+
+        SMergedSubmesh &submesh = submeshes[i];
+        geometry::CMesh &sourceMesh = workers[i].getMesh();
+        submesh.faceBase = faceCount;
+        faceCount += int(submesh.faces.size() / 3);
+        if (submesh.targetIndex.empty())
+        {
+            submesh.interiorBase = vertexCount;
+            continue;
+        }
+
+        for (size_t j = 0; j < submesh.openKeys.size(); ++j)
+        {
+            tSeamMap::iterator found = seamMap.find(submesh.openKeys[j].first);
+            if (found == seamMap.end())
+            {
+                submesh.targetIndex[submesh.openHandles[j]] = vertexCount;
+                seamIndices.push_back(vertexCount);
+                seamMap[submesh.openKeys[j].first] = std::pair<int, int>(vertexCount, submesh.openKeys[j].second - 1);
+                points.push_back(sourceMesh.point(geometry::CMesh::VertexHandle(submesh.openHandles[j])));
+                vertexCount++;
+            }
+            else
+            {
+                submesh.targetIndex[submesh.openHandles[j]] = found->second.first;
+                if (--found->second.second == 0)
+                {
+                    seamMap.erase(found);
+                }
+            }
+        }
+
+        // interior vertices follow right after new seam vertices of the same worker
+        submesh.interiorBase = vertexCount;
+        vertexCount += submesh.interiorCount;
+        points.resize(vertexCount);
+    }
+
+    // assign interior vertices and faces of all workers concurrently
+    std::vector<int> faces(faceCount * 3);
+    std::vector<short> faceFlags(flagIsPresent ? faceCount : 0, 0);
+    #pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < workerCount; ++i)
+    {
+        SMergedSubmesh &submesh = submeshes[i];
+        geometry::CMesh &sourceMesh = workers[i].getMesh();
+        int index = submesh.interiorBase;
+        for (geometry::CMesh::VertexIter vit = sourceMesh.vertices_begin(); vit != sourceMesh.vertices_end(); ++vit)
+        {
+            int &target = submesh.targetIndex[vit.handle().idx()];
+            if (!submesh.isOpen[vit.handle().idx()])
+            {
+                target = index++;
+                points[target] = sourceMesh.point(vit.handle());
+            }
+        }
+
+        for (size_t j = 0; j < submesh.faces.size(); ++j)
+        {
+            faces[submesh.faceBase * 3 + j] = submesh.targetIndex[submesh.faces[j]];
+        }
+        if (!submesh.faceFlags.empty())
+        {
+            std::copy(submesh.faceFlags.begin(), submesh.faceFlags.end(), faceFlags.begin() + submesh.faceBase);
+        }
+    }
+
+    // build the merged mesh in one pass
+    targetMesh.reserve(vertexCount, faceCount * 3 / 2, faceCount);
+    for (int i = 0; i < vertexCount; ++i)
+    {
+        targetMesh.add_vertex(points[i]);
+    }
+    seamVertices.reserve(seamVertices.size() + seamIndices.size());
+    for (size_t i = 0; i < seamIndices.size(); ++i)
+    {
+        seamVertices.push_back(geometry::CMesh::VertexHandle(seamIndices[i]));
+    }
+
+    OpenMesh::FPropHandleT<short> dst_fProp_flag;
+    if (flagIsPresent && !targetMesh.get_property_handle(dst_fProp_flag, "fProp_flag"))
+    {
+        targetMesh.add_property(dst_fProp_flag, "fProp_flag");
+    }
+    for (int i = 0; i < faceCount; ++i)
+    {
+        geometry::CMesh::FaceHandle newFace = targetMesh.add_face(
+            geometry::CMesh::VertexHandle(faces[i * 3]),
+            geometry::CMesh::VertexHandle(faces[i * 3 + 1]),
+            geometry::CMesh::VertexHandle(faces[i * 3 + 2]));
+
+        if (flagIsPresent && newFace.is_valid())
+        {
+            targetMesh.property(dst_fProp_flag, newFace) = faceFlags[i];
+        }
+    }
+
+    return true;
+}
+
 CMarchingCubesWorker::CMarchingCubesWorker()
 {
     // initialization of work matrices to NULL value
     m_state_matrix_up = NULL;
     m_state_matrix_down = NULL;
+    m_row_bits = NULL;
     m_node_matrix_up_h = NULL;
     m_node_matrix_up_v = NULL;
     m_node_matrix_down_h = NULL;
@@ -1862,16 +2064,19 @@ unsigned char CMarchingCubesWorker::getCubeCodeLeft(int x, int y)
 //! Create actual cube code and save it into code matrix
 unsigned char CMarchingCubesWorker::makeCubeCode(int x, int y)
 {
+    // states of the run loaded by loadCubeRun()
+    const int shift = x % CVoxelRowClassifier::WORD_BITS;
+    const unsigned down = unsigned(m_run_states[0] >> shift) & 3;
+    const unsigned down_next = unsigned(m_run_states[1] >> shift) & 3;
+    const unsigned up = unsigned(m_run_states[2] >> shift) & 3;
+    const unsigned up_next = unsigned(m_run_states[3] >> shift) & 3;
+
     // create cube code
     unsigned char code = 0;
-    code += m_state_matrix_down[y * m_work_matrices_size_x + x];
-    code += m_state_matrix_down[y * m_work_matrices_size_x + x + 1] << 1;
-    code += m_state_matrix_down[((y + 1) * m_work_matrices_size_x) + x + 1] << 2;
-    code += m_state_matrix_down[((y + 1) * m_work_matrices_size_x) + x] << 3;
-    code += m_state_matrix_up[y * m_work_matrices_size_x + x] << 4;
-    code += m_state_matrix_up[y * m_work_matrices_size_x + x + 1] << 5;
-    code += m_state_matrix_up[((y + 1) * m_work_matrices_size_x) + x + 1] << 6;
-    code += m_state_matrix_up[((y + 1) * m_work_matrices_size_x) + x] << 7;
+    code += down;
+    code += ((down_next & 1) << 3) | ((down_next & 2) << 1);
+    code += up << 4;
+    code += ((up_next & 1) << 7) | ((up_next & 2) << 5);
 
     // save cube code into code matrix
     m_cube_code_matrix[(y + 1) * m_work_matrices_size_x + x + 1] = code;
@@ -1879,6 +2084,72 @@ unsigned char CMarchingCubesWorker::makeCubeCode(int x, int y)
     return code;
 }
 
+//! Loads states of the run of cubes and checks whether it is uniform
+bool CMarchingCubesWorker::loadCubeRun(int x, int y)
+{
+    // cubes [x, x + 32) use state bits [x, x + 32] of rows y and y + 1
+    const int word = x / CVoxelRowClassifier::WORD_BITS;
+    const CVoxelRowClassifier::tWord *rows[4] = {
+        &m_state_matrix_down[y * m_state_row_words + word],
+        &m_state_matrix_down[(y + 1) * m_state_row_words + word],
+        &m_state_matrix_up[y * m_state_row_words + word],
+        &m_state_matrix_up[(y + 1) * m_state_row_words + word]
+    };
+
+    bool uniform = true;
+    for (int i = 0; i < 4; ++i)
+    {
+        m_run_states[i] = rows[i][0] | (vpl::sys::tUInt64(rows[i][1]) << CVoxelRowClassifier::WORD_BITS);
+        uniform = uniform && rows[i][0] == rows[0][0] && (rows[i][1] & 1) == (rows[0][0] & 1);
+    }
+    if (!uniform || (rows[0][0] != 0 && rows[0][0] != ~CVoxelRowClassifier::tWord(0)))
+    {
+        return false;
+    }
+
+    // cleared code matrix already holds zero codes
+    if (0 != rows[0][0])
+    {
+        memset(&m_cube_code_matrix[(y + 1) * m_work_matrices_size_x + x + 1], 255, CVoxelRowClassifier::WORD_BITS);
+    }
+
+    return true;
+}
+
+//! Classifies row of voxels and saves it into up state matrix.
+void CMarchingCubesWorker::classifyStateRow(const IMarchingCubesFunctor *volumeFunctor, int y, int z, int volume_size_x)
+{
+    CVoxelRowClassifier::tWord *row = &m_state_matrix_up[(y + 1) * m_state_row_words];
+
+    // voxels left of the volume are skipped, bit c of the row holds voxel c - 1
+    const int firstX = (m_volume_start_x == 0) ? 0 : -1;
+    const int count = volume_size_x - firstX + 1;
+    if (firstX < 0)
+    {
+        volumeFunctor->classifyRow(firstX + m_volume_start_x, y + m_volume_start_y, z + m_volume_start_z, count, row);
+    }
+    else
+    {
+        volumeFunctor->classifyRow(m_volume_start_x, y + m_volume_start_y, z + m_volume_start_z, count, m_row_bits);
+        CVoxelRowClassifier::copyBits(m_row_bits, count, row, 1);
+    }
+
+#if defined(_DEBUG) || defined(QT_DEBUG) || defined(DEBUG) || defined(NNDEBUG)
+    const vpl::img::CSize3i fullvolumeSize = volumeFunctor->getVolumeDimensions();
+    for (int x = firstX; x <= volume_size_x; ++x)
+    {
+        // check functor that it doesn't return non zero values for volume outside - if it does, fix your functor!
+        if (x + m_volume_start_x < 0 || x + m_volume_start_x >= fullvolumeSize.x() ||
+            y + m_volume_start_y < 0 || y + m_volume_start_y >= fullvolumeSize.y() ||
+            z + m_volume_start_z < 0 || z + m_volume_start_z >= fullvolumeSize.z())
+        {
+            assert(!CVoxelRowClassifier::testBit(row, x + 1));
+            CVoxelRowClassifier::clearBit(row, x + 1);
+        }
+    }
+#endif
+}
+
 //! Calculate number of nodes for cube code.
 int CMarchingCubesWorker::cubeCodeNodeNumber(unsigned char cube_code)
 {
@@ -1896,7 +2167,6 @@ int CMarchingCubesWorker::cubeCodeNodeNumber(unsigned char cube_code)
 bool CMarchingCubesWorker::generateMesh(const IMarchingCubesFunctor *volumeFunctor, bool markFaces)
 {
     m_voxelSize = volumeFunctor->getVoxelSize();
-    const vpl::img::CSize3i fullvolumeSize = volumeFunctor->getVolumeDimensions();
 
     // save pointer on actual tri mesh
     m_mesh.clear();
@@ -1932,28 +2202,8 @@ bool CMarchingCubesWorker::generateMesh(const IMarchingCubesFunctor *volumeFunct
                 continue;
             }
 
-            for (int x = -1; x <= volume_size_x; ++x)
-            {
-                if ((x < 0) && (m_volume_start_x == 0))
-                {
-                    continue;
-                }
-
-                // get volume voxel state and save it into up voxel state matrix
-                const int idx = ((y + 1) * m_work_matrices_size_x) + x + 1;
-                //assert(idx >= 0 && idx < m_work_matrices_size_x * m_work_matrices_size_y);
-                m_state_matrix_up[idx] = volumeFunctor->operator()(x + m_volume_start_x, y + m_volume_start_y, z + m_volume_start_z);
-#if defined(_DEBUG) || defined(QT_DEBUG) || defined(DEBUG) || defined(NNDEBUG)
-                // check functor that it doesn't return non zero values for volume outside - if it does, fix your functor!
-                if (x + m_volume_start_x < 0 || x + m_volume_start_x >= fullvolumeSize.x() ||
-                    y + m_volume_start_y < 0 || y + m_volume_start_y >= fullvolumeSize.y() || 
-                    z + m_volume_start_z < 0 || z + m_volume_start_z >= fullvolumeSize.z())
-                {
-                    assert(0 == m_state_matrix_up[idx]);
-                    m_state_matrix_up[idx] = 0;
-                }
-#endif
-            }
+            // get states of the whole row of volume voxels and save them into up voxel state matrix
+            classifyStateRow(volumeFunctor, y, z, volume_size_x);
         }
 
         if (z != -1)
@@ -1964,6 +2214,13 @@ bool CMarchingCubesWorker::generateMesh(const IMarchingCubesFunctor *volumeFunct
 
                 for (int x = 0; x <= volume_size_x; ++x)
                 {
+                    // skip runs of cubes lying completely outside or inside of the surface
+                    if (0 == x % CVoxelRowClassifier::WORD_BITS && loadCubeRun(x, y))
+                    {
+                        x += CVoxelRowClassifier::WORD_BITS - 1;
+                        continue;
+                    }
+
                     setCodeCoordinateX((x + m_volume_start_x - 0.5) * m_voxelSize.x(), m_voxelSize.x());
 
                     // code of actual cube
@@ -1984,7 +2241,7 @@ bool CMarchingCubesWorker::generateMesh(const IMarchingCubesFunctor *volumeFunct
         }
 
         // switch up and down state matrices
-        unsigned char *state_matrix_ptr = m_state_matrix_down;
+        CVoxelRowClassifier::tWord *state_matrix_ptr = m_state_matrix_down;
         m_state_matrix_down = m_state_matrix_up;
         m_state_matrix_up = state_matrix_ptr;
 
@@ -2003,7 +2260,7 @@ bool CMarchingCubesWorker::generateMesh(const IMarchingCubesFunctor *volumeFunct
         m_down_cube_code_matrix = cube_code_matrix_ptr;
 
         // clearing state, node and code matrices
-        memset(m_state_matrix_up, 0, m_work_matrices_size_x * m_work_matrices_size_y * sizeof(unsigned char));
+        memset(m_state_matrix_up, 0, m_state_row_words * m_work_matrices_size_y * sizeof(CVoxelRowClassifier::tWord));
         memset(m_cube_code_matrix, 0, m_work_matrices_size_x * m_work_matrices_size_y * sizeof(unsigned char));
 
         for (int i = 0; i < m_work_matrices_size_x * m_work_matrices_size_y; i++)
@@ -2117,8 +2374,11 @@ void CMarchingCubesWorker::allocWorktMem(int size_x, int size_y)
 
     // allocation of work matrices
     int workMatrixSize = m_work_matrices_size_x * m_work_matrices_size_y;
-    m_state_matrix_up = new unsigned char[workMatrixSize];
-    m_state_matrix_down = new unsigned char[workMatrixSize];
+    m_state_row_words = CVoxelRowClassifier::wordCount(m_work_matrices_size_x) + 1;
+    const int stateMatrixSize = m_state_row_words * m_work_matrices_size_y;
+    m_state_matrix_up = new CVoxelRowClassifier::tWord[stateMatrixSize];
+    m_state_matrix_down = new CVoxelRowClassifier::tWord[stateMatrixSize];
+    m_row_bits = new CVoxelRowClassifier::tWord[m_state_row_words];
     m_node_matrix_up_h = new geometry::CMesh::VertexHandle[workMatrixSize];
     m_node_matrix_up_v = new geometry::CMesh::VertexHandle[workMatrixSize];
     m_node_matrix_down_h = new geometry::CMesh::VertexHandle[workMatrixSize];
@@ -2128,8 +2388,8 @@ void CMarchingCubesWorker::allocWorktMem(int size_x, int size_y)
     m_down_cube_code_matrix = new unsigned char[workMatrixSize];
 
     // clearing work matrices
-    memset(m_state_matrix_up, 0, workMatrixSize * sizeof(unsigned char));
-    memset(m_state_matrix_down, 0, workMatrixSize * sizeof(unsigned char));
+    memset(m_state_matrix_up, 0, stateMatrixSize * sizeof(CVoxelRowClassifier::tWord));
+    memset(m_state_matrix_down, 0, stateMatrixSize * sizeof(CVoxelRowClassifier::tWord));
     memset(m_cube_code_matrix, 0, workMatrixSize * sizeof(unsigned char));
     memset(m_down_cube_code_matrix, 0, workMatrixSize * sizeof(unsigned char));
 }
@@ -2139,6 +2399,7 @@ void CMarchingCubesWorker::deallocWorktMem()
     // free allocated work matrices memory
     delete[] m_state_matrix_up;
     delete[] m_state_matrix_down;
+    delete[] m_row_bits;
     delete[] m_node_matrix_up_h;
     delete[] m_node_matrix_up_v;
     delete[] m_node_matrix_down_h;
@@ -2150,6 +2411,7 @@ void CMarchingCubesWorker::deallocWorktMem()
     // initialization of work matrices to NULL value
     m_state_matrix_up = NULL;
     m_state_matrix_down = NULL;
+    m_row_bits = NULL;
     m_node_matrix_up_h = NULL;
     m_node_matrix_up_v = NULL;
     m_node_matrix_down_h = NULL;
@@ -0,0 +1,299 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <alg/CMeshComponents.h>
+
+// STL
+#include <atomic>
+
+namespace
+{
+
+typedef std::vector<std::atomic<int> > tParents;
+
+//! Returns root of a face, halves the path on the way.
+int findRoot(tParents &parents, int v)
+{
+    for (;;)
+    {
+        int parent = parents[v].load(std::memory_order_relaxed);
+        if (parent == v)
+        {
+            return v;
+        }
+        const int grandparent = parents[parent].load(std::memory_order_relaxed);
+        if (grandparent != parent)
+        {
+            parents[v].compare_exchange_weak(parent, grandparent, std::memory_order_relaxed);
+        }
+        v = grandparent;
+    }
+}
+
+//! Joins sets of two faces, the larger root is always linked under
+//! the smaller one so concurrent links cannot form a cycle.
+void unite(tParents &parents, int a, int b)
+{
+    for (;;)
+    {
+        a = findRoot(parents, a);
+        b = findRoot(parents, b);
+        if (a == b)
+        {
+            return;
+        }
+        if (a < b)
+        {
+            std::swap(a, b);
+        }
+
+        // Fails if a stopped being a root in the meantime
+        int expected = a;
+        if (parents[a].compare_exchange_strong(expected, b, std::memory_order_relaxed))
+        {
+            return;
+        }
+    }
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CMeshComponents::compute(const geometry::CMesh &mesh)
+{
+    m_faceLabels.assign(mesh.n_faces(), -1);
+    m_components.clear();
+
+    const int numFaces = int(mesh.n_faces());
+    if (numFaces == 0)
+    {
+        return;
+    }
+
+    // Flat face-vertex index array, -1 for deleted faces
+    const bool hasStatus = mesh.has_face_status();
+    std::vector<int> indices(3 * size_t(numFaces), -1);
+
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (int f = 0; f < numFaces; ++f)
+    {
+        geometry::CMesh::FaceHandle fh(f);
+        if (hasStatus && mesh.status(fh).deleted())
+        {
+            continue;
+        }
+        int i = 0;
+        for (geometry::CMesh::ConstFaceVertexIter fvit = mesh.cfv_iter(fh); fvit && i < 3; ++fvit, ++i)
+        {
+            indices[3 * f + i] = fvit.handle().idx();
+        }
+    }
+
+    // Union-find over faces sharing an edge
+    tParents parents(numFaces);
+    for (int f = 0; f < numFaces; ++f)
+    {
+        parents[f].store(f, std::memory_order_relaxed);
+    }
+
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (int f = 0; f < numFaces; ++f)
+    {
+        if (indices[3 * f] < 0)
+        {
+            continue;
+        }
+        for (geometry::CMesh::ConstFaceFaceIter ffit = mesh.cff_iter(geometry::CMesh::FaceHandle(f)); ffit; ++ffit)
+        {
+            const int g = ffit.handle().idx();
+            if (g > f && indices[3 * g] >= 0)
+            {
+                unite(parents, f, g);
+            }
+        }
+    }
+
+    // Compact labels, roots are the smallest faces of their components
+    std::vector<int> rootLabels(numFaces, -1);
+    for (int f = 0; f < numFaces; ++f)
+    {
+        if (indices[3 * f] >= 0 && findRoot(parents, f) == f)
+        {
+            rootLabels[f] = int(m_components.size());
+
+            SComponent component;
+            component.faces = 0;
+            component.min = component.max = mesh.point(geometry::CMesh::VertexHandle(indices[3 * f]));
+            m_components.push_back(component);
+        }
+    }
+
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (int f = 0; f < numFaces; ++f)
+    {
+        if (indices[3 * f] >= 0)
+        {
+            m_faceLabels[f] = rootLabels[findRoot(parents, f)];
+        }
+    }
+
+    // Statistics
+    for (int f = 0; f < numFaces; ++f)
+    {
+        const int label = m_faceLabels[f];
+        if (label < 0)
+        {
+            continue;
+        }
+        SComponent &component = m_components[label];
+        ++component.faces;
+        for (int i = 0; i < 3; ++i)
+        {
+            const geometry::CMesh::Point &point = mesh.point(geometry::CMesh::VertexHandle(indices[3 * f + i]));
+            component.min.minimize(point);
+            component.max.maximize(point);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+int CMeshComponents::getLargestComponent() const
+{
+    int largest = -1;
+    for (size_t i = 0; i < m_components.size(); ++i)
+    {
+        if (largest < 0 || m_components[i].faces > m_components[largest].faces)
+        {
+            largest = int(i);
+        }
+    }
+    return largest;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+int CMeshComponents::filter(geometry::CMesh &mesh, const std::vector<unsigned char> &keep) const
+{
+    const int numFaces = int(m_faceLabels.size());
+    const int numVertices = int(mesh.n_vertices());
+
+    int removed = 0;
+    std::vector<unsigned char> usedVertices(numVertices, 0);
+    for (int f = 0; f < numFaces; ++f)
+    {
+        const int label = m_faceLabels[f];
+        if (label < 0)
+        {
+            continue;
+        }
+        if (!keep[label])
+        {
+            ++removed;
+            continue;
+        }
+        for (geometry::CMesh::FaceVertexIter fvit = mesh.fv_iter(geometry::CMesh::FaceHandle(f)); fvit; ++fvit)
+        {
+            usedVertices[fvit.handle().idx()] = 1;
+        }
+    }
+
+    if (removed == 0)
+    {
+        return 0;
+    }
+
+    // Rebuild the mesh from kept faces, vertex and face order is preserved
+    geometry::CMesh compact;
+    std::vector<geometry::CMesh::VertexHandle> vertexMap(numVertices);
+    compact.reserve(numVertices, 3 * (numFaces - removed) / 2, numFaces - removed);
+    for (int v = 0; v < numVertices; ++v)
+    {
+        if (usedVertices[v])
+        {
+            vertexMap[v] = compact.add_vertex(mesh.point(geometry::CMesh::VertexHandle(v)));
+        }
+    }
+
+    bool ok = true;
+    std::vector<geometry::CMesh::VertexHandle> face;
+    for (int f = 0; f < numFaces && ok; ++f)
+    {
+        const int label = m_faceLabels[f];
+        if (label < 0 || !keep[label])
+        {
+            continue;
+        }
+        face.clear();
+        for (geometry::CMesh::FaceVertexIter fvit = mesh.fv_iter(geometry::CMesh::FaceHandle(f)); fvit; ++fvit)
+        {
+            face.push_back(vertexMap[fvit.handle().idx()]);
+        }
+        ok = compact.add_face(face).is_valid();
+    }
+
+    if (ok)
+    {
+        const bool vertexNormals = mesh.has_vertex_normals();
+
+        // Only the OpenMesh part is replaced, mesh specific data are kept,
+        // the octree refers to the old faces though
+        static_cast<geometry::CBaseMesh &>(mesh) = compact;
+        mesh.invalidateOctree();
+
+        mesh.request_face_normals();
+        mesh.update_face_normals();
+        if (vertexNormals)
+        {
+            mesh.request_vertex_normals();
+            mesh.update_vertex_normals();
+        }
+        return removed;
+    }
+
+    // Topology the rebuild could not reproduce, delete faces one by one
+    mesh.request_vertex_status();
+    mesh.request_edge_status();
+    mesh.request_face_status();
+    for (int f = 0; f < numFaces; ++f)
+    {
+        const int label = m_faceLabels[f];
+        if (label >= 0 && !keep[label])
+        {
+            mesh.delete_face(geometry::CMesh::FaceHandle(f), true);
+        }
+    }
+    mesh.garbage_collection();
+    mesh.invalidateOctree();
+    mesh.release_face_status();
+    mesh.release_edge_status();
+    mesh.release_vertex_status();
+
+    return removed;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
@@ -27,6 +27,10 @@
 
 #include <OpenMesh/Tools/Smoother/JacobiLaplaceSmootherT.hh>
 
+// STL
+#include <cmath>
+#include <vector>
+
 ////////////////////////////////////////////////////////////
 //
 
@@ -66,78 +70,124 @@ bool CSmoothing::Smooth(geometry::CMesh &mesh, int loops)
     beginProgress();
     progress();
 
-    // add mesh custom property - new vertex position
-    OpenMesh::VPropHandleT<geometry::CMesh::Point>      new_positions_prop;
-    mesh.add_property(new_positions_prop);
+    const int nVertices = mesh.n_vertices();
+
+    // one-ring adjacency in the compressed sparse row format
+    std::vector<int> ring_offsets(nVertices + 1, 0);
+    std::vector<int> ring;
+
+    // positions as separate coordinate arrays, the second set receives new positions
+    std::vector<float> x(nVertices), y(nVertices), z(nVertices);
+    std::vector<float> new_x(nVertices), new_y(nVertices), new_z(nVertices);
 
-    geometry::CMesh::VertexIter                         v_end(mesh.vertices_end());               // mesh vertex iterator and end iterator        
-    bool                                                result = true;
+    // vertices which are never moved
+    std::vector<unsigned char> boundary(nVertices);
+
+#pragma omp parallel for
+    for (int iv = 0; iv < nVertices; iv++)
+    {
+        geometry::CMesh::VertexHandle v_it = mesh.vertex_handle(iv);
+        const geometry::CMesh::Point& point = mesh.point(v_it);
+        x[iv] = point[0];
+        y[iv] = point[1];
+        z[iv] = point[2];
+        boundary[iv] = mesh.is_boundary(v_it) ? 1 : 0;
+
+        int valence = 0;
+        for (geometry::CMesh::VertexVertexIter vv_it = mesh.vv_iter(v_it); vv_it; ++vv_it)
+        {
+            ++valence;
+        }
+        ring_offsets[iv + 1] = valence;
+    }
+
+    for (int iv = 0; iv < nVertices; iv++)
+    {
+        ring_offsets[iv + 1] += ring_offsets[iv];
+    }
+    ring.resize(ring_offsets[nVertices]);
+
+#pragma omp parallel for
+    for (int iv = 0; iv < nVertices; iv++)
+    {
+        int k = ring_offsets[iv];
+        for (geometry::CMesh::VertexVertexIter vv_it = mesh.vv_iter(mesh.vertex_handle(iv)); vv_it; ++vv_it)
+        {
+            ring[k++] = vv_it.handle().idx();
+        }
+    }
+
+    // exp(-d^2 / (2 * variance)) = exp(d^2 * weight_scale)
+    const float weight_scale = float(-1.0 / (2.0 * m_squared_smooth_factor));
+    const int * const offsets = ring_offsets.data();
+    const int * const neighbours = ring.data();
+    bool result = true;
 
     // smoothing iterations cycle
     for (int i = 0; i < loops; ++i)
     {
         // set first Taubin smoothing parameter
-        double smooth_factor = m_taubins_lambda;
+        float smooth_factor = float(m_taubins_lambda);
 
         // Taubin smoothing cycle
         for (int ts = 0; ts < 2; ++ts)
         {
-            // mesh vertices cycle
-            const int nVertices = mesh.n_vertices();
-#pragma omp parallel for
-            for(int iv = 0; iv < nVertices; iv++)
-            { 
-                geometry::CMesh::VertexHandle v_it = mesh.vertex_handle(iv);
-                mesh.property(new_positions_prop, v_it).vectorize(0.0f);
-                // vertex normalisation weight, sum of adjacent vertices weight
-                double normalisation_weight = 0.0;
-                // position of actual (center) point
-                const geometry::CMesh::Point centr_point = mesh.point(v_it);
-
-                // ring of vertices around actual vertex cycle
-                for (geometry::CMesh::VertexVertexIter vv_it = mesh.vv_iter(v_it); vv_it; ++vv_it)
+            const float *px = x.data(), *py = y.data(), *pz = z.data();
+            float *pnx = new_x.data(), *pny = new_y.data(), *pnz = new_z.data();
+
+#pragma omp parallel for schedule(static, 1024)
+            for (int iv = 0; iv < nVertices; iv++)
+            {
+                const float cx = px[iv], cy = py[iv], cz = pz[iv];
+                if (boundary[iv])
+                {
+                    pnx[iv] = cx;
+                    pny[iv] = cy;
+                    pnz[iv] = cz;
+                    continue;
+                }
+
+                // weighted sum of vectors to adjacent vertices and sum of weights
+                float sx = 0.0f, sy = 0.0f, sz = 0.0f, normalisation_weight = 0.0f;
+                const int end = offsets[iv + 1];
+                for (int k = offsets[iv]; k < end; ++k)
                 {
-                    // adjacent vertex vector calculation
-                     geometry::CMesh::Point vertex_vector = mesh.point(vv_it) - centr_point;
-                    // squared distance of actual vertex and adjacent actual vertex
-                    double vertex_vector_length_2 = vertex_vector.sqrnorm();
-                    // distance weight calculation
-                    double distance_weight = exp((vertex_vector_length_2) / (-2.0 * m_squared_smooth_factor));
+                    const int j = neighbours[k];
+                    const float dx = px[j] - cx, dy = py[j] - cy, dz = pz[j] - cz;
+                    const float distance_weight = std::exp((dx * dx + dy * dy + dz * dz) * weight_scale);
                     if (distance_weight != distance_weight)
                     {
-                        // nan
-                    }
-                    else
-                    {
-                        normalisation_weight += distance_weight;
-                        // adjacent vertex position cumulation
-                        mesh.property(new_positions_prop, v_it) += (vertex_vector * distance_weight);
+                        // nan, coincident vertices with zero smoothing factor
+                        continue;
                     }
+                    normalisation_weight += distance_weight;
+                    sx += dx * distance_weight;
+                    sy += dy * distance_weight;
+                    sz += dz * distance_weight;
                 }
 
                 // actual vertex new position weighting
-                if (fabs(normalisation_weight)>0.000001) // very low numbers produce nan
+                if (normalisation_weight > 0.000001f) // very low numbers produce nan
                 {
-                    mesh.property(new_positions_prop, v_it) *= (smooth_factor / normalisation_weight);
-                    mesh.property(new_positions_prop, v_it) += centr_point;
+                    const float scale = smooth_factor / normalisation_weight;
+                    pnx[iv] = cx + sx * scale;
+                    pny[iv] = cy + sy * scale;
+                    pnz[iv] = cz + sz * scale;
                 }
                 else
-                    mesh.property(new_positions_prop, v_it) = centr_point;
-            }
-   
-            // mesh vertices cycle to realise smoothing step
-#pragma omp parallel for
-            for (int iv = 0; iv < nVertices; iv++)
-            {
-                geometry::CMesh::VertexHandle v_it = mesh.vertex_handle(iv);
-                // boundary vertex test
-                if ( !mesh.is_boundary(v_it) )
-                    // set new position for actual vertex
-                    mesh.set_point( v_it, mesh.property(new_positions_prop,v_it) );
+                {
+                    pnx[iv] = cx;
+                    pny[iv] = cy;
+                    pnz[iv] = cz;
+                }
             }
 
+            x.swap(new_x);
+            y.swap(new_y);
+            z.swap(new_z);
+
             // set second Taubin smoothing parameter
-            smooth_factor = m_taubins_mu;
+            smooth_factor = float(m_taubins_mu);
         }
 
         // set progress value and test function termination
@@ -148,8 +198,18 @@ bool CSmoothing::Smooth(geometry::CMesh &mesh, int loops)
         }
     }
 
-    // free mesh custom property - new vertex position
-    mesh.remove_property(new_positions_prop);
+    // write new positions back to the mesh
+    if (result)
+    {
+#pragma omp parallel for
+        for (int iv = 0; iv < nVertices; iv++)
+        {
+            if (!boundary[iv])
+            {
+                mesh.set_point(mesh.vertex_handle(iv), geometry::CMesh::Point(x[iv], y[iv], z[iv]));
+            }
+        }
+    }
 
     // finish function progress
     endProgress();
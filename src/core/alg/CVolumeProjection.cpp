@@ -0,0 +1,356 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <alg/CVolumeProjection.h>
+
+// STL
+#include <algorithm>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VOLUME_PROJECTION_SSE2
+#endif
+
+namespace
+{
+
+//! Projection along X reduces whole rows, along Y and Z rows are accumulated.
+//! Reducer provides:
+//! - init(acc, count), add(row, count, acc) and store(acc, count, dst)
+//!   for accumulation of rows,
+//! - reduce(row, count) for the reduction of one row.
+template <class tReducer>
+void project(const vpl::img::CDVolume& Volume, int Axis, int First, int Last, vpl::img::CDImage& Image, const tReducer& Reducer)
+{
+    const int XSize = Volume.getXSize();
+    const int YSize = Volume.getYSize();
+    const int ZSize = Volume.getZSize();
+
+    switch (Axis)
+    {
+    case CVolumeProjection::AXIS_Z:
+        Image.resize(XSize, YSize);
+        break;
+
+    case CVolumeProjection::AXIS_Y:
+        Image.resize(XSize, ZSize);
+        break;
+
+    default:
+        Image.resize(YSize, ZSize);
+        break;
+    }
+
+    if (XSize <= 0 || YSize <= 0 || ZSize <= 0 || First > Last)
+    {
+        return;
+    }
+
+    if (Axis == CVolumeProjection::AXIS_X)
+    {
+        const int Count = Last - First + 1;
+
+#pragma omp parallel for schedule(dynamic)
+        for (int z = 0; z < ZSize; ++z)
+        {
+            for (int y = 0; y < YSize; ++y)
+            {
+                Image(y, z) = Reducer.reduce(&Volume(First, y, z), Count);
+            }
+        }
+        return;
+    }
+
+    // Rows of the output image, every one accumulates rows of the slab
+    const int NumRows = (Axis == CVolumeProjection::AXIS_Z) ? YSize : ZSize;
+
+#pragma omp parallel
+    {
+        std::vector<typename tReducer::tAccumulator> Acc(Reducer.getAccumulatorSize(XSize));
+
+#pragma omp for schedule(dynamic)
+        for (int j = 0; j < NumRows; ++j)
+        {
+            Reducer.init(&Acc[0], XSize);
+            for (int k = First; k <= Last; ++k)
+            {
+                const vpl::img::tDensityPixel *pRow = (Axis == CVolumeProjection::AXIS_Z) ? &Volume(0, j, k) : &Volume(0, k, j);
+                Reducer.add(pRow, XSize, &Acc[0]);
+            }
+            Reducer.store(&Acc[0], XSize, &Image(0, j));
+        }
+    }
+}
+
+//! Maximum of rows.
+struct SMaxReducer
+{
+    typedef vpl::img::tDensityPixel tAccumulator;
+
+    size_t getAccumulatorSize(int Count) const
+    {
+        return size_t(Count);
+    }
+
+    void init(tAccumulator *pAcc, int Count) const
+    {
+        std::fill(pAcc, pAcc + Count, vpl::img::CPixelTraits<vpl::img::tDensityPixel>::getPixelMin());
+    }
+
+    void add(const vpl::img::tDensityPixel *pRow, int Count, tAccumulator *pAcc) const
+    {
+        CVolumeProjection::maxRow(pRow, Count, pAcc);
+    }
+
+    void store(const tAccumulator *pAcc, int Count, vpl::img::tDensityPixel *pDst) const
+    {
+        std::copy(pAcc, pAcc + Count, pDst);
+    }
+
+    vpl::img::tDensityPixel reduce(const vpl::img::tDensityPixel *pRow, int Count) const
+    {
+        return CVolumeProjection::maxOfRow(pRow, Count);
+    }
+};
+
+//! Average of voxels not below threshold, sums are followed by sample counts.
+struct SAverageReducer
+{
+    typedef int tAccumulator;
+
+    vpl::img::tDensityPixel Threshold;
+
+    size_t getAccumulatorSize(int Count) const
+    {
+        return 2 * size_t(Count);
+    }
+
+    void init(tAccumulator *pAcc, int Count) const
+    {
+        std::fill(pAcc, pAcc + 2 * Count, 0);
+    }
+
+    void add(const vpl::img::tDensityPixel *pRow, int Count, tAccumulator *pAcc) const
+    {
+        CVolumeProjection::sumRow(pRow, Count, Threshold, pAcc, pAcc + Count);
+    }
+
+    void store(const tAccumulator *pAcc, int Count, vpl::img::tDensityPixel *pDst) const
+    {
+        for (int i = 0; i < Count; ++i)
+        {
+            pDst[i] = average(pAcc[i], pAcc[Count + i]);
+        }
+    }
+
+    vpl::img::tDensityPixel reduce(const vpl::img::tDensityPixel *pRow, int Count) const
+    {
+        int Sum, Samples;
+        CVolumeProjection::sumOfRow(pRow, Count, Threshold, Sum, Samples);
+        return average(Sum, Samples);
+    }
+
+    static vpl::img::tDensityPixel average(int Sum, int Samples)
+    {
+        return (Samples == 0) ? vpl::img::CPixelTraits<vpl::img::tDensityPixel>::getPixelMin() : vpl::img::tDensityPixel(Sum / Samples);
+    }
+};
+
+}
+
+////////////////////////////////////////////////////////////
+//
+
+void CVolumeProjection::maximum(const vpl::img::CDVolume& Volume, int Axis, int First, int Last, vpl::img::CDImage& Image)
+{
+    project(Volume, Axis, First, Last, Image, SMaxReducer());
+}
+
+////////////////////////////////////////////////////////////
+//
+
+void CVolumeProjection::average(const vpl::img::CDVolume& Volume, int Axis, int First, int Last, vpl::img::CDImage& Image, int Threshold)
+{
+    SAverageReducer Reducer;
+    Reducer.Threshold = vpl::img::tDensityPixel(Threshold);
+    project(Volume, Axis, First, Last, Image, Reducer);
+}
+
+////////////////////////////////////////////////////////////
+//
+
+int CVolumeProjection::getNumOfSlices(const vpl::img::CDVolume& Volume, int Axis)
+{
+    switch (Axis)
+    {
+    case AXIS_X:
+        return Volume.getXSize();
+
+    case AXIS_Y:
+        return Volume.getYSize();
+
+    default:
+        return Volume.getZSize();
+    }
+}
+
+////////////////////////////////////////////////////////////
+//
+
+void CVolumeProjection::getSlab(const vpl::img::CDVolume& Volume, int Axis, int Position, int Thickness, int& First, int& Last)
+{
+    const int NumOfSlices = getNumOfSlices(Volume, Axis);
+    if (Thickness <= 0 || Thickness >= NumOfSlices)
+    {
+        First = 0;
+        Last = NumOfSlices - 1;
+        return;
+    }
+
+    First = std::max(0, Position - Thickness / 2);
+    Last = std::min(NumOfSlices - 1, First + Thickness - 1);
+    First = std::max(0, Last - Thickness + 1);
+}
+
+////////////////////////////////////////////////////////////
+//
+
+void CVolumeProjection::maxRow(const vpl::img::tDensityPixel *src, int count, vpl::img::tDensityPixel *acc)
+{
+    int i = 0;
+#ifdef VOLUME_PROJECTION_SSE2
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128i *pAcc = reinterpret_cast<__m128i *>(acc + i);
+        _mm_storeu_si128(pAcc, _mm_max_epi16(_mm_loadu_si128(pAcc), v));
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        acc[i] = std::max(acc[i], src[i]);
+    }
+}
+
+////////////////////////////////////////////////////////////
+//
+
+vpl::img::tDensityPixel CVolumeProjection::maxOfRow(const vpl::img::tDensityPixel *src, int count)
+{
+    vpl::img::tDensityPixel Max = src[0];
+    int i = 0;
+#ifdef VOLUME_PROJECTION_SSE2
+    if (count >= 8)
+    {
+        __m128i vMax = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+        for (i = 8; i + 8 <= count; i += 8)
+        {
+            vMax = _mm_max_epi16(vMax, _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+        }
+        vpl::img::tDensityPixel Lanes[8];
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(Lanes), vMax);
+        Max = *std::max_element(Lanes, Lanes + 8);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        Max = std::max(Max, src[i]);
+    }
+    return Max;
+}
+
+////////////////////////////////////////////////////////////
+//
+
+void CVolumeProjection::sumRow(const vpl::img::tDensityPixel *src, int count, vpl::img::tDensityPixel threshold, int *sum, int *samples)
+{
+    int i = 0;
+#ifdef VOLUME_PROJECTION_SSE2
+    const __m128i vThreshold = _mm_set1_epi16(threshold);
+    const __m128i vOnes = _mm_set1_epi16(-1);
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        const __m128i valid = _mm_andnot_si128(_mm_cmplt_epi16(v, vThreshold), vOnes);
+        const __m128i masked = _mm_and_si128(v, valid);
+
+        // sign extension to 32 bits, valid lanes become -1
+        const __m128i sumLo = _mm_srai_epi32(_mm_unpacklo_epi16(masked, masked), 16);
+        const __m128i sumHi = _mm_srai_epi32(_mm_unpackhi_epi16(masked, masked), 16);
+        const __m128i cntLo = _mm_srai_epi32(_mm_unpacklo_epi16(valid, valid), 16);
+        const __m128i cntHi = _mm_srai_epi32(_mm_unpackhi_epi16(valid, valid), 16);
+
+        __m128i *pSum = reinterpret_cast<__m128i *>(sum + i);
+        __m128i *pSamples = reinterpret_cast<__m128i *>(samples + i);
+        _mm_storeu_si128(pSum, _mm_add_epi32(_mm_loadu_si128(pSum), sumLo));
+        _mm_storeu_si128(pSum + 1, _mm_add_epi32(_mm_loadu_si128(pSum + 1), sumHi));
+        _mm_storeu_si128(pSamples, _mm_sub_epi32(_mm_loadu_si128(pSamples), cntLo));
+        _mm_storeu_si128(pSamples + 1, _mm_sub_epi32(_mm_loadu_si128(pSamples + 1), cntHi));
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        if (src[i] >= threshold)
+        {
+            sum[i] += src[i];
+            ++samples[i];
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////
+//
+
+void CVolumeProjection::sumOfRow(const vpl::img::tDensityPixel *src, int count, vpl::img::tDensityPixel threshold, int& sum, int& samples)
+{
+    sum = 0;
+    samples = 0;
+    int i = 0;
+#ifdef VOLUME_PROJECTION_SSE2
+    if (count >= 8)
+    {
+        int Sums[8] = {};
+        int Counts[8] = {};
+        for (; i + 8 <= count; i += 8)
+        {
+            sumRow(src + i, 8, threshold, Sums, Counts);
+        }
+        for (int j = 0; j < 8; ++j)
+        {
+            sum += Sums[j];
+            samples += Counts[j];
+        }
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        if (src[i] >= threshold)
+        {
+            sum += src[i];
+            ++samples;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
@@ -0,0 +1,531 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <alg/CVolumeRenderingPreprocessor.h>
+
+// STL
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VR_PREPROCESSOR_SSE2
+#endif
+
+namespace
+{
+
+//! Range of densities.
+const float DensityMin = float(vpl::img::CPixelTraits<vpl::img::tDensityPixel>::getPixelMin());
+const float DensityMax = float(vpl::img::CPixelTraits<vpl::img::tDensityPixel>::getPixelMax());
+
+//! Scaling of densities to 16 bits.
+const float DataScale = 65536.0f / (DensityMax - DensityMin);
+
+//! Scaling of 16-bit values to the skipping volume.
+const float SkipScale = 255.0f / 65536.0f;
+
+//! Gradient normalization.
+const float GradScale = 0.33f * SkipScale;
+
+//! Sum of weights of the (1 3 1) filter in three dimensions.
+const float FilterDenom = 125.0f;
+
+//! Sum of smoothing weights of the Sobel operator, as in vpl::img::CVolumeSobelX.
+const float SobelDenom = 16.0f;
+
+//! Resampling of one axis, index of the lower sample and its weight.
+struct SAxisSampling
+{
+    std::vector<int> i0, i1;
+    std::vector<float> w;
+
+    void init(int SrcSize, int DstSize)
+    {
+        i0.resize(DstSize);
+        i1.resize(DstSize);
+        w.resize(DstSize);
+
+        const double Step = (DstSize > 1) ? double(SrcSize - 1) / (DstSize - 1) : 0.0;
+        for (int i = 0; i < DstSize; ++i)
+        {
+            const double p = i * Step;
+            i0[i] = std::min(int(p), SrcSize - 1);
+            i1[i] = std::min(i0[i] + 1, SrcSize - 1);
+            w[i] = float(p - i0[i]);
+        }
+    }
+};
+
+//! Ring buffer index of a slice, slices may start at -1.
+inline int ringIndex(int z)
+{
+    return ((z % 3) + 3) % 3;
+}
+
+//! Per slab state, every slab covers whole blocks of the auxiliary volume.
+class CSlabProcessor
+{
+public:
+    CSlabProcessor(const vpl::img::CDVolume& Source, bool Resample, CVolumeRenderingPreprocessor::tVolume& Volume, CVolumeRenderingPreprocessor::tAuxVolume& Aux,
+                   const SAxisSampling *Sampling)
+        : m_Source(Source)
+        , m_Resample(Resample)
+        , m_Volume(Volume)
+        , m_Aux(Aux)
+        , m_Sampling(Sampling)
+        , m_XSize(Volume.getXSize())
+        , m_YSize(Volume.getYSize())
+        , m_ZSize(Volume.getZSize())
+        , m_BlocksX((m_XSize + CVolumeRenderingPreprocessor::BLOCK_SIZE - 1) / CVolumeRenderingPreprocessor::BLOCK_SIZE)
+        , m_BlocksY((m_YSize + CVolumeRenderingPreprocessor::BLOCK_SIZE - 1) / CVolumeRenderingPreprocessor::BLOCK_SIZE)
+        , m_NonEmpty(false)
+    {
+        const size_t SliceSize = size_t(m_XSize) * m_YSize;
+        for (int i = 0; i < 3; ++i)
+        {
+            m_Slices[i].resize(SliceSize);
+            m_SourceTags[i] = INT_MIN;
+        }
+        if (m_Resample)
+        {
+            m_Row.resize(Source.getXSize());
+        }
+        else
+        {
+            for (int i = 0; i < 3; ++i)
+            {
+                m_SourceSlices[i].resize(SliceSize);
+            }
+            m_Rows.resize(size_t(m_XSize) * (m_YSize + 2));
+        }
+        m_S.resize(m_XSize);
+        m_Dy.resize(m_XSize);
+        m_Dz.resize(m_XSize);
+        m_BlockMin.resize(size_t(m_BlocksX) * m_BlocksY);
+        m_BlockMax.resize(m_BlockMin.size());
+        m_BlockGrad.resize(m_BlockMin.size());
+    }
+
+    //! Processes slices [Begin, End), Begin is a multiple of the block size.
+    void run(int Begin, int End)
+    {
+        resetBlocks();
+
+        // Slice z is normalized before slice z - 1 is finished, the gradient needs both neighbours
+        for (int z = std::max(Begin - 1, 0); z <= End; ++z)
+        {
+            if (z < m_ZSize)
+            {
+                normalizeSlice(z);
+            }
+
+            const int zc = z - 1;
+            if (zc < Begin)
+            {
+                continue;
+            }
+
+            storeSlice(zc);
+            if ((zc & 1) && zc < m_ZSize - 1)
+            {
+                gradientSlice(zc);
+            }
+            if ((zc % CVolumeRenderingPreprocessor::BLOCK_SIZE) == CVolumeRenderingPreprocessor::BLOCK_SIZE - 1 || zc == End - 1)
+            {
+                flushBlocks(zc / CVolumeRenderingPreprocessor::BLOCK_SIZE);
+                resetBlocks();
+            }
+        }
+    }
+
+    bool isNonEmpty() const { return m_NonEmpty; }
+
+protected:
+    //! Source slice filtered in X and Y, rows -1 and YSize are read from the volume margin.
+    const int *getSourceSlice(int z)
+    {
+        std::vector<int>& Slice = m_SourceSlices[ringIndex(z)];
+        if (m_SourceTags[ringIndex(z)] == z)
+        {
+            return &Slice[0];
+        }
+        m_SourceTags[ringIndex(z)] = z;
+
+        for (int y = -1; y <= m_YSize; ++y)
+        {
+            const vpl::img::tDensityPixel *pRow = &m_Source.at(m_Source.getIdx(0, y, z));
+            CVolumeRenderingPreprocessor::filterRow(pRow, m_XSize, &m_Rows[size_t(y + 1) * m_XSize]);
+        }
+        for (int y = 0; y < m_YSize; ++y)
+        {
+            const int *pRow = &m_Rows[size_t(y) * m_XSize];
+            CVolumeRenderingPreprocessor::sumRows(pRow, pRow + m_XSize, pRow + 2 * m_XSize, m_XSize, &Slice[size_t(y) * m_XSize]);
+        }
+        return &Slice[0];
+    }
+
+    //! Computes normalized slice z into the ring buffer.
+    void normalizeSlice(int z)
+    {
+        vpl::img::tPixel16 *pDst = &m_Slices[ringIndex(z)][0];
+
+        if (!m_Resample)
+        {
+            const int *p0 = getSourceSlice(z - 1);
+            const int *p1 = getSourceSlice(z);
+            const int *p2 = getSourceSlice(z + 1);
+            for (int y = 0; y < m_YSize; ++y)
+            {
+                const size_t Offset = size_t(y) * m_XSize;
+                CVolumeRenderingPreprocessor::normalizeRows(p0 + Offset, p1 + Offset, p2 + Offset, m_XSize, pDst + Offset);
+            }
+            return;
+        }
+
+        // Trilinear interpolation, rows are blended in Y and Z first
+        const SAxisSampling& SX = m_Sampling[0];
+        const SAxisSampling& SY = m_Sampling[1];
+        const SAxisSampling& SZ = m_Sampling[2];
+        const int SrcXSize = m_Source.getXSize();
+        const float wz = SZ.w[z];
+        for (int y = 0; y < m_YSize; ++y)
+        {
+            const float wy = SY.w[y];
+            const vpl::img::tDensityPixel *r00 = &m_Source(0, SY.i0[y], SZ.i0[z]);
+            const vpl::img::tDensityPixel *r10 = &m_Source(0, SY.i1[y], SZ.i0[z]);
+            const vpl::img::tDensityPixel *r01 = &m_Source(0, SY.i0[y], SZ.i1[z]);
+            const vpl::img::tDensityPixel *r11 = &m_Source(0, SY.i1[y], SZ.i1[z]);
+            float *pRow = &m_Row[0];
+            for (int x = 0; x < SrcXSize; ++x)
+            {
+                const float a = r00[x] + (r10[x] - r00[x]) * wy;
+                const float b = r01[x] + (r11[x] - r01[x]) * wy;
+                pRow[x] = a + (b - a) * wz;
+            }
+
+            vpl::img::tPixel16 *pOut = pDst + size_t(y) * m_XSize;
+            for (int x = 0; x < m_XSize; ++x)
+            {
+                const float a = pRow[SX.i0[x]];
+                pOut[x] = CVolumeRenderingPreprocessor::normalize(a + (pRow[SX.i1[x]] - a) * SX.w[x]);
+            }
+        }
+    }
+
+    //! Copies slice to the volume and updates minimum and maximum of blocks.
+    void storeSlice(int z)
+    {
+        const vpl::img::tPixel16 *pSlice = &m_Slices[ringIndex(z)][0];
+        for (int y = 0; y < m_YSize; ++y)
+        {
+            const vpl::img::tPixel16 *pRow = pSlice + size_t(y) * m_XSize;
+            std::memcpy(&m_Volume(0, y, z), pRow, m_XSize * sizeof(vpl::img::tPixel16));
+
+            int *pMin = &m_BlockMin[size_t(y / CVolumeRenderingPreprocessor::BLOCK_SIZE) * m_BlocksX];
+            int *pMax = &m_BlockMax[size_t(y / CVolumeRenderingPreprocessor::BLOCK_SIZE) * m_BlocksX];
+            for (int bx = 0; bx < m_BlocksX; ++bx)
+            {
+                const int First = bx * CVolumeRenderingPreprocessor::BLOCK_SIZE;
+                const int Last = std::min(First + int(CVolumeRenderingPreprocessor::BLOCK_SIZE), m_XSize);
+                int Min = pMin[bx], Max = pMax[bx];
+                for (int x = First; x < Last; ++x)
+                {
+                    Min = std::min(Min, int(pRow[x]));
+                    Max = std::max(Max, int(pRow[x]));
+                }
+                pMin[bx] = Min;
+                pMax[bx] = Max;
+            }
+        }
+    }
+
+    //! Sobel gradient magnitude at odd voxels of an odd inner slice.
+    void gradientSlice(int z)
+    {
+        const vpl::img::tPixel16 *pSlices[3] = { &m_Slices[ringIndex(z - 1)][0], &m_Slices[ringIndex(z)][0], &m_Slices[ringIndex(z + 1)][0] };
+        int *S = &m_S[0];
+        int *Dy = &m_Dy[0];
+        int *Dz = &m_Dz[0];
+
+        for (int y = 1; y < m_YSize - 1; y += 2)
+        {
+            const vpl::img::tPixel16 *R[3][3];
+            for (int dz = 0; dz < 3; ++dz)
+            {
+                for (int dy = 0; dy < 3; ++dy)
+                {
+                    R[dy][dz] = pSlices[dz] + size_t(y + dy - 1) * m_XSize;
+                }
+            }
+
+            // Smoothed rows, derivatives along Y and Z smoothed in the other direction
+            for (int x = 0; x < m_XSize; ++x)
+            {
+                const int c0 = R[0][0][x] + 2 * R[0][1][x] + R[0][2][x];
+                const int c1 = R[1][0][x] + 2 * R[1][1][x] + R[1][2][x];
+                const int c2 = R[2][0][x] + 2 * R[2][1][x] + R[2][2][x];
+                S[x] = c0 + 2 * c1 + c2;
+                Dy[x] = c2 - c0;
+                const int r0 = R[0][0][x] + 2 * R[1][0][x] + R[2][0][x];
+                const int r2 = R[0][2][x] + 2 * R[1][2][x] + R[2][2][x];
+                Dz[x] = r2 - r0;
+            }
+
+            int *pGrad = &m_BlockGrad[size_t(y / CVolumeRenderingPreprocessor::BLOCK_SIZE) * m_BlocksX];
+            for (int x = 1; x < m_XSize - 1; x += 2)
+            {
+                const int GradX = S[x + 1] - S[x - 1];
+                const int GradY = Dy[x - 1] + 2 * Dy[x] + Dy[x + 1];
+                const int GradZ = Dz[x - 1] + 2 * Dz[x] + Dz[x + 1];
+                const float GradMag = float(std::abs(GradX) + std::abs(GradY) + std::abs(GradZ)) / SobelDenom;
+                const int Grad = std::min(int(GradScale * GradMag), 255);
+                int& Block = pGrad[x / CVolumeRenderingPreprocessor::BLOCK_SIZE];
+                Block = std::max(Block, Grad);
+            }
+        }
+    }
+
+    //! Writes accumulated blocks to a layer of the auxiliary volume.
+    void flushBlocks(int sz)
+    {
+        for (int by = 0; by < m_BlocksY; ++by)
+        {
+            for (int bx = 0; bx < m_BlocksX; ++bx)
+            {
+                const size_t i = size_t(by) * m_BlocksX + bx;
+                if (m_BlockMax[i] > 0)
+                {
+                    m_NonEmpty = true;
+                }
+                vpl::img::tRGBPixel& Pixel = m_Aux(bx, by, sz);
+                Pixel.r() = vpl::img::tRGBPixel::tComponent(std::max(CVolumeRenderingPreprocessor::toSkip(m_BlockMin[i]) - 1, 0));
+                Pixel.g() = vpl::img::tRGBPixel::tComponent(std::min(CVolumeRenderingPreprocessor::toSkip(m_BlockMax[i]) + 1, 255));
+                Pixel.b() = vpl::img::tRGBPixel::tComponent(m_BlockGrad[i]);
+            }
+        }
+    }
+
+    void resetBlocks()
+    {
+        std::fill(m_BlockMin.begin(), m_BlockMin.end(), 65535);
+        std::fill(m_BlockMax.begin(), m_BlockMax.end(), 0);
+        std::fill(m_BlockGrad.begin(), m_BlockGrad.end(), 0);
+    }
+
+protected:
+    const vpl::img::CDVolume& m_Source;
+    bool m_Resample;
+    CVolumeRenderingPreprocessor::tVolume& m_Volume;
+    CVolumeRenderingPreprocessor::tAuxVolume& m_Aux;
+    const SAxisSampling *m_Sampling;
+
+    int m_XSize, m_YSize, m_ZSize;
+    int m_BlocksX, m_BlocksY;
+
+    //! Ring of normalized slices.
+    std::vector<vpl::img::tPixel16> m_Slices[3];
+
+    //! Ring of source slices filtered in X and Y, tagged by slice index.
+    std::vector<int> m_SourceSlices[3];
+    int m_SourceTags[3];
+
+    //! Source rows filtered in X.
+    std::vector<int> m_Rows;
+
+    //! Source row blended in Y and Z.
+    std::vector<float> m_Row;
+
+    //! Gradient rows.
+    std::vector<int> m_S, m_Dy, m_Dz;
+
+    //! Blocks of the current layer.
+    std::vector<int> m_BlockMin, m_BlockMax, m_BlockGrad;
+
+    bool m_NonEmpty;
+};
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+vpl::img::tPixel16 CVolumeRenderingPreprocessor::normalize(float value)
+{
+    const float Scaled = (value - DensityMin) * DataScale;
+    return vpl::img::tPixel16(std::min(std::max(Scaled, 0.0f), 65535.0f));
+}
+
+int CVolumeRenderingPreprocessor::toSkip(int value)
+{
+    return int(SkipScale * float(value));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CVolumeRenderingPreprocessor::filterRow(const vpl::img::tDensityPixel *src, int count, int *dst)
+{
+    int i = 0;
+#ifdef VR_PREPROCESSOR_SSE2
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i - 1));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 1));
+
+        // Sign extension to 32 bits
+        const __m128i aLo = _mm_srai_epi32(_mm_unpacklo_epi16(a, a), 16);
+        const __m128i aHi = _mm_srai_epi32(_mm_unpackhi_epi16(a, a), 16);
+        const __m128i bLo = _mm_srai_epi32(_mm_unpacklo_epi16(b, b), 16);
+        const __m128i bHi = _mm_srai_epi32(_mm_unpackhi_epi16(b, b), 16);
+        const __m128i cLo = _mm_srai_epi32(_mm_unpacklo_epi16(c, c), 16);
+        const __m128i cHi = _mm_srai_epi32(_mm_unpackhi_epi16(c, c), 16);
+
+        const __m128i sumLo = _mm_add_epi32(_mm_add_epi32(aLo, cLo), _mm_add_epi32(bLo, _mm_slli_epi32(bLo, 1)));
+        const __m128i sumHi = _mm_add_epi32(_mm_add_epi32(aHi, cHi), _mm_add_epi32(bHi, _mm_slli_epi32(bHi, 1)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), sumLo);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 4), sumHi);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        dst[i] = src[i - 1] + 3 * src[i] + src[i + 1];
+    }
+}
+
+void CVolumeRenderingPreprocessor::sumRows(const int *row0, const int *row1, const int *row2, int count, int *dst)
+{
+    int i = 0;
+#ifdef VR_PREPROCESSOR_SSE2
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + i));
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row2 + i));
+        const __m128i sum = _mm_add_epi32(_mm_add_epi32(a, c), _mm_add_epi32(b, _mm_slli_epi32(b, 1)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), sum);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        dst[i] = row0[i] + 3 * row1[i] + row2[i];
+    }
+}
+
+void CVolumeRenderingPreprocessor::normalizeRows(const int *row0, const int *row1, const int *row2, int count, vpl::img::tPixel16 *dst)
+{
+    int i = 0;
+#ifdef VR_PREPROCESSOR_SSE2
+    const __m128 vInvDenom = _mm_set1_ps(1.0f / FilterDenom);
+    const __m128 vMin = _mm_set1_ps(DensityMin);
+    const __m128 vScale = _mm_set1_ps(DataScale);
+    const __m128 vZero = _mm_setzero_ps();
+    const __m128 vMax = _mm_set1_ps(65535.0f);
+    const __m128i vBias = _mm_set1_epi32(32768);
+    const __m128i vFlip = _mm_set1_epi16(short(0x8000));
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i Packed[2];
+        for (int k = 0; k < 2; ++k)
+        {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + i + 4 * k));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + i + 4 * k));
+            const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row2 + i + 4 * k));
+            const __m128i sum = _mm_add_epi32(_mm_add_epi32(a, c), _mm_add_epi32(b, _mm_slli_epi32(b, 1)));
+
+            __m128 v = _mm_mul_ps(_mm_cvtepi32_ps(sum), vInvDenom);
+            v = _mm_mul_ps(_mm_sub_ps(v, vMin), vScale);
+            v = _mm_min_ps(_mm_max_ps(v, vZero), vMax);
+
+            // Unsigned 16-bit values are packed as signed ones shifted by 32768
+            Packed[k] = _mm_sub_epi32(_mm_cvttps_epi32(v), vBias);
+        }
+        const __m128i Result = _mm_xor_si128(_mm_packs_epi32(Packed[0], Packed[1]), vFlip);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), Result);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        dst[i] = normalize(float(row0[i] + 3 * row1[i] + row2[i]) / FilterDenom);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool CVolumeRenderingPreprocessor::process(const vpl::img::CDVolume& Source, bool Resample, tVolume& Volume, tAuxVolume& Aux)
+{
+    Aux.fillEntire(vpl::img::tRGBPixel(0));
+
+    const int ZSize = Volume.getZSize();
+    if (Volume.getXSize() <= 0 || Volume.getYSize() <= 0 || ZSize <= 0)
+    {
+        return false;
+    }
+
+    SAxisSampling Sampling[3];
+    if (Resample)
+    {
+        Sampling[0].init(Source.getXSize(), Volume.getXSize());
+        Sampling[1].init(Source.getYSize(), Volume.getYSize());
+        Sampling[2].init(Source.getZSize(), ZSize);
+    }
+
+    // Slabs of whole block layers, a few per thread to balance the load
+    const int NumLayers = (ZSize + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    int NumThreads = 1;
+#ifdef _OPENMP
+    NumThreads = omp_get_max_threads();
+#endif
+    const int NumSlabs = std::min(NumLayers, 2 * NumThreads);
+
+    int NonEmpty = 0;
+#pragma omp parallel for schedule(dynamic) reduction(|:NonEmpty)
+    for (int i = 0; i < NumSlabs; ++i)
+    {
+        const int Begin = (i * NumLayers / NumSlabs) * BLOCK_SIZE;
+        const int End = std::min(((i + 1) * NumLayers / NumSlabs) * BLOCK_SIZE, ZSize);
+
+        CSlabProcessor Processor(Source, Resample, Volume, Aux, Sampling);
+        Processor.run(Begin, End);
+        NonEmpty |= Processor.isNonEmpty() ? 1 : 0;
+    }
+
+    if (!NonEmpty)
+    {
+        Volume.fillEntire(tVolume::tVoxel(0));
+        Aux.fillEntire(vpl::img::tRGBPixel(0));
+        return false;
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
@@ -22,10 +22,13 @@
 
 #include <data/CDataStorage.h>
 #include <data/CStorageEntry.h>
+#include <data/CStorageProfiler.h>
 
 #include <VPL/Base/Logging.h>
 #include <VPL/System/Sleep.h>
 
+#include <algorithm>
+
 #define STORAGE_ENTRY_CLASS_FLAGS		16
 
 //#define DEBUG_OUTPUT_INITIALIZATION
@@ -36,12 +39,14 @@ namespace data
 ///////////////////////////////////////////////////////////////////////////////
 //
 
-CDataStorage::CDataStorage() : m_pFactory(NULL), m_bCanInvalidate(true)
+CDataStorage::CDataStorage() : m_pFactory(NULL), m_bCanInvalidate(true), m_bCoalesceInvalidation(false)
 {
     for( int i = 0; i <= Storage::MAX_ID; ++i )
     {
         m_Storage.push_back(CStorageEntry::tSmartPtr(new CStorageEntry));
     }
+
+    CStorageProfiler::initFromEnvironment();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -60,6 +65,21 @@ void CDataStorage::invalidate(CStorageEntry *pEntry, int Flags)
 		return;
 	}
 
+    // Coalesce invalidation of dependent entries, forced updates must be done immediately
+    if( m_bCoalesceInvalidation )
+    {
+        if( !(Flags & Storage::FORCE_UPDATE) )
+        {
+            pEntry->makeDirty(pEntry->getId(), Flags);
+            fakeInvaldateDeps(pEntry, Flags);
+
+            // Observers of the root entry are not delayed
+            pEntry->notify();
+            return;
+        }
+        flushInvalidation();
+    }
+
 //    tLock Lock(*this);
 
     // Make the entry dirty
@@ -69,6 +89,11 @@ void CDataStorage::invalidate(CStorageEntry *pEntry, int Flags)
     CEntryDeps Invalidated;
     invalidateDeps(pEntry, Invalidated, Flags);
 
+    if( CStorageProfiler::isEnabled() )
+    {
+        CStorageProfiler::recordInvalidation(pEntry->getId(), int(Invalidated.size()));
+    }
+
     // Should all dependent entries be updated now?
     if( Flags & Storage::FORCE_UPDATE )
     {
@@ -299,6 +324,14 @@ void CDataStorage::reset()
 {
     tLock Lock(*this);
 
+    // drop coalesced invalidations, the storage is invalidated completely
+    if (m_bCanInvalidate)
+    {
+        m_invalidatedDeps.clear();
+        m_invalidatedEntries.clear();
+        m_invalidationOrder.clear();
+    }
+
     tStorage::iterator it, itEnd = m_Storage.end();
 
     // drop all pending changes, because "old" changes can break flag checking
@@ -525,6 +558,12 @@ void CDataStorage::lockInvalidation()
 {
 	if( m_bCanInvalidate ) 
 	{
+        // Dispatch coalesced invalidations, postponing starts from scratch
+        if( m_bCoalesceInvalidation )
+        {
+            flushInvalidation();
+        }
+
         tLock Lock(*this);
 
     	if( m_bCanInvalidate ) 
@@ -537,5 +576,132 @@ void CDataStorage::lockInvalidation()
 	}
 }
 
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CDataStorage::setInvalidationCoalescing(bool bEnable)
+{
+    if( m_bCoalesceInvalidation == bEnable )
+    {
+        return;
+    }
+
+    if( !bEnable )
+    {
+        flushInvalidation();
+    }
+    m_bCoalesceInvalidation = bEnable;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CDataStorage::flushInvalidation()
+{
+    // Merge changes of all coalesced invalidations per entry
+    tInvalidatedEntriesMap Changes;
+    {
+        tLock Lock(*this);
+
+        if( !m_bCanInvalidate )
+        {
+            return;
+        }
+
+        tInvalidatedEntriesMap::iterator it, itEnd(m_invalidatedEntries.end());
+        for( it = m_invalidatedEntries.begin(); it != itEnd; ++it )
+        {
+            Changes[it->first].insert(it->second);
+        }
+        for( it = m_invalidatedDeps.begin(), itEnd = m_invalidatedDeps.end(); it != itEnd; ++it )
+        {
+            Changes[it->first].insert(it->second);
+        }
+
+        m_invalidationOrder.clear();
+        m_invalidatedEntries.clear();
+        m_invalidatedDeps.clear();
+    }
+
+    if( Changes.empty() )
+    {
+        return;
+    }
+
+    // Make all entries dirty and sort them by levels of the dependency graph
+    std::map<int, int> Levels;
+    std::vector< std::vector<int> > Order;
+    {
+        tInvalidatedEntriesMap::iterator it, itEnd(Changes.end());
+        for( it = Changes.begin(); it != itEnd; ++it )
+        {
+            m_Storage[it->first]->addChanges(it->second);
+
+            int Level = getUpdateLevel(it->first, Changes, Levels);
+            if( Level >= int(Order.size()) )
+            {
+                Order.resize(Level + 1);
+            }
+            Order[Level].push_back(it->first);
+        }
+    }
+
+    // Regenerate entries which allow it ahead, entries of one level are independent
+    for( size_t l = 0; l < Order.size(); ++l )
+    {
+        std::vector<int> Ids;
+        std::vector<int>::const_iterator it, itEnd(Order[l].end());
+        for( it = Order[l].begin(); it != itEnd; ++it )
+        {
+            if( m_Storage[*it]->isUpdateThreadSafe() )
+            {
+                Ids.push_back(*it);
+            }
+        }
+        const int Count = int(Ids.size());
+
+        SUpdateDeps Update(m_Storage);
+#pragma omp parallel for schedule(dynamic) if(Count > 1)
+        for( int i = 0; i < Count; ++i )
+        {
+            Update(Ids[i]);
+        }
+    }
+
+    // Notify observers once per entry
+    for( size_t l = 0; l < Order.size(); ++l )
+    {
+        std::for_each(Order[l].begin(), Order[l].end(), SNotifyDeps(m_Storage));
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+int CDataStorage::getUpdateLevel(int Id, const tInvalidatedEntriesMap& Changes, std::map<int, int>& Levels)
+{
+    std::map<int, int>::iterator itLevel = Levels.find(Id);
+    if( itLevel != Levels.end() )
+    {
+        return itLevel->second;
+    }
+
+    // Guard against cycles in the dependency graph
+    Levels[Id] = 0;
+
+    int Level = 0;
+    const CEntryDeps::tDeps& Parents = getFactory().getDeps(Id).getImpl();
+    CEntryDeps::tDeps::const_iterator it, itEnd(Parents.end());
+    for( it = Parents.begin(); it != itEnd; ++it )
+    {
+        if( *it != Id && Changes.find(*it) != Changes.end() )
+        {
+            Level = std::max(Level, getUpdateLevel(*it, Changes, Levels) + 1);
+        }
+    }
+
+    Levels[Id] = Level;
+    return Level;
+}
 
 } // namespace data
@@ -0,0 +1,338 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <data/CStorageProfiler.h>
+#include <data/CStorageEntry.h>
+
+#include <VPL/System/Mutex.h>
+#include <VPL/System/ScopedLock.h>
+
+// STL
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <thread>
+#include <vector>
+
+
+namespace data
+{
+
+namespace
+{
+
+//! Statistics of one entry.
+struct SEntryStats
+{
+    std::string name;
+    unsigned long long numUpdates, updateTime;
+    unsigned long long numNotifications, notifyTime;
+    unsigned long long numInvalidations, fanOut, maxFanOut;
+
+    SEntryStats()
+        : numUpdates(0), updateTime(0)
+        , numNotifications(0), notifyTime(0)
+        , numInvalidations(0), fanOut(0), maxFanOut(0)
+    {}
+};
+
+//! One recorded event.
+struct STraceEvent
+{
+    int id;
+    int event;
+    long long start, end;
+    size_t thread;
+};
+
+//! Escapes a string inside a JSON string literal.
+std::string escapeJson(const std::string& ssValue)
+{
+    std::string ssResult;
+    for( std::string::const_iterator it = ssValue.begin(); it != ssValue.end(); ++it )
+    {
+        if( *it == '"' || *it == '\\' )
+        {
+            ssResult += '\\';
+            ssResult += *it;
+        }
+        else if( static_cast<unsigned char>(*it) < 0x20 )
+        {
+            char Buffer[8];
+            snprintf(Buffer, sizeof(Buffer), "\\u%04x", static_cast<unsigned char>(*it));
+            ssResult += Buffer;
+        }
+        else
+        {
+            ssResult += *it;
+        }
+    }
+    return ssResult;
+}
+
+//! Escapes a string inside a quoted CSV field, quotes are doubled.
+std::string escapeCsv(const std::string& ssValue)
+{
+    std::string ssResult;
+    for( std::string::const_iterator it = ssValue.begin(); it != ssValue.end(); ++it )
+    {
+        if( *it == '"' )
+        {
+            ssResult += '"';
+        }
+        ssResult += *it;
+    }
+    return ssResult;
+}
+
+//! Returns name of an entry used in the output.
+std::string getEntryName(int Id, const std::map<int, SEntryStats>& Stats)
+{
+    std::map<int, SEntryStats>::const_iterator it = Stats.find(Id);
+    return (it != Stats.end() && !it->second.name.empty()) ? it->second.name : std::string("entry");
+}
+
+bool writeTrace(const std::string& ssFilename, const std::map<int, SEntryStats>& Stats, const std::vector<STraceEvent>& Events)
+{
+    std::ofstream File(ssFilename.c_str());
+    if( !File )
+    {
+        return false;
+    }
+
+    static const char *EventNames[] = { "update", "notify" };
+
+    File << "{\"traceEvents\":[\n";
+    for( size_t i = 0; i < Events.size(); ++i )
+    {
+        const STraceEvent& Event = Events[i];
+        File << (i > 0 ? ",\n" : "")
+             << "{\"name\":\"" << escapeJson(getEntryName(Event.id, Stats)) << " " << Event.id
+             << "\",\"cat\":\"" << EventNames[Event.event]
+             << "\",\"ph\":\"X\",\"ts\":" << Event.start
+             << ",\"dur\":" << (Event.end - Event.start)
+             << ",\"pid\":1,\"tid\":" << Event.thread
+             << ",\"args\":{\"id\":" << Event.id << "}}";
+    }
+    File << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    return bool(File);
+}
+
+bool writeSummary(const std::string& ssFilename, const std::map<int, SEntryStats>& Stats)
+{
+    std::ofstream File(ssFilename.c_str());
+    if( !File )
+    {
+        return false;
+    }
+
+    File << "id,name,updates,update_us,notifications,notify_us,invalidations,fan_out,max_fan_out\n";
+    std::map<int, SEntryStats>::const_iterator it, itEnd(Stats.end());
+    for( it = Stats.begin(); it != itEnd; ++it )
+    {
+        const SEntryStats& Entry = it->second;
+        File << it->first << ",\"" << escapeCsv(getEntryName(it->first, Stats)) << "\","
+             << Entry.numUpdates << "," << Entry.updateTime << ","
+             << Entry.numNotifications << "," << Entry.notifyTime << ","
+             << Entry.numInvalidations << "," << Entry.fanOut << "," << Entry.maxFanOut << "\n";
+    }
+
+    return bool(File);
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+//! Recorded data.
+struct CStorageProfiler::SData
+{
+    vpl::sys::CMutex mutex;
+    std::map<int, SEntryStats> stats;
+    std::vector<STraceEvent> events;
+
+    //! Output file name without extension, data are written on exit if set.
+    std::string ssFilename;
+
+    ~SData()
+    {
+        // Nothing may be recorded from now on
+        s_bEnabled = false;
+
+        if( !ssFilename.empty() )
+        {
+            writeTrace(ssFilename + ".json", stats, events);
+            writeSummary(ssFilename + ".csv", stats);
+        }
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+std::atomic<bool> CStorageProfiler::s_bEnabled(false);
+
+const char *CStorageProfiler::ENV_VARIABLE = "STORAGE_PROFILE";
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+CStorageProfiler::SData& CStorageProfiler::getData()
+{
+    static SData Data;
+    return Data;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CStorageProfiler::enable(bool bEnable)
+{
+    // Make sure the data outlive any profiled code
+    getData();
+
+    s_bEnabled = bEnable;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CStorageProfiler::initFromEnvironment()
+{
+    const char *pValue = getenv(ENV_VARIABLE);
+    if( !pValue || !*pValue )
+    {
+        return;
+    }
+
+    SData& Data = getData();
+    {
+        vpl::sys::tScopedLock Lock(Data.mutex);
+        Data.ssFilename = pValue;
+    }
+    enable(true);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CStorageProfiler::clear()
+{
+    SData& Data = getData();
+    vpl::sys::tScopedLock Lock(Data.mutex);
+
+    Data.stats.clear();
+    Data.events.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+long long CStorageProfiler::now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CStorageProfiler::record(CStorageEntry *pEntry, int Event, long long Start, long long End)
+{
+    if( !pEntry )
+    {
+        return;
+    }
+
+    const int Id = pEntry->getId();
+    const size_t Thread = std::hash<std::thread::id>()(std::this_thread::get_id());
+
+    SData& Data = getData();
+    vpl::sys::tScopedLock Lock(Data.mutex);
+
+    SEntryStats& Stats = Data.stats[Id];
+    if( Stats.name.empty() && pEntry->getStorableDataPtr() && pEntry->getStorableDataPtr()->getName() )
+    {
+        Stats.name = pEntry->getStorableDataPtr()->getName();
+    }
+
+    if( Event == EVENT_UPDATE )
+    {
+        ++Stats.numUpdates;
+        Stats.updateTime += End - Start;
+    }
+    else
+    {
+        ++Stats.numNotifications;
+        Stats.notifyTime += End - Start;
+    }
+
+    if( Data.events.size() < MAX_EVENTS )
+    {
+        STraceEvent TraceEvent = { Id, Event, Start, End, Thread };
+        Data.events.push_back(TraceEvent);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CStorageProfiler::recordInvalidation(int Id, int FanOut)
+{
+    SData& Data = getData();
+    vpl::sys::tScopedLock Lock(Data.mutex);
+
+    SEntryStats& Stats = Data.stats[Id];
+    ++Stats.numInvalidations;
+    Stats.fanOut += FanOut;
+    Stats.maxFanOut = std::max<unsigned long long>(Stats.maxFanOut, FanOut);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool CStorageProfiler::exportTrace(const std::string& ssFilename)
+{
+    SData& Data = getData();
+    vpl::sys::tScopedLock Lock(Data.mutex);
+
+    return writeTrace(ssFilename, Data.stats, Data.events);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool CStorageProfiler::exportSummary(const std::string& ssFilename)
+{
+    SData& Data = getData();
+    vpl::sys::tScopedLock Lock(Data.mutex);
+
+    return writeSummary(ssFilename, Data.stats);
+}
+
+
+} // namespace data
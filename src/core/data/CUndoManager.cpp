@@ -239,7 +239,7 @@ data::CSnapshot * data::CUndoManager::processSnapshot(CSnapshot *snapshot)
 
       if( entry.get() != 0 )
       {
-          APP_STORAGE.invalidate( entry.get(), data::StorageEntry::UNDOREDO );
+          APP_STORAGE.invalidate( entry.get(), data::StorageEntry::UNDOREDO | snapshot->getProvider()->getInvalidationFlags() );
       }
    }
 
@@ -0,0 +1,511 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <data/CBrickedVolumeFile.h>
+
+#include <VPL/Base/Logging.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#   include <windows.h>
+#else
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
+
+namespace data
+{
+
+namespace
+{
+    //! Magic string identifying the bricked VLM container.
+    const char BRICKED_VLM_MAGIC[8] = { '3', 'D', 'I', 'M', 'V', 'L', 'M', 'B' };
+
+    //! Alignment of bricks in the file (memory page).
+    const vpl::sys::tUInt64 BRICK_ALIGNMENT = 4096;
+
+    static_assert(sizeof(CBrickedVolumeFile::SHeader) == 128, "Unexpected bricked VLM header size");
+
+    //! Opens file using a native (possibly wide) file name.
+    FILE *openFile(const vpl::sys::tString& sFileName, bool bWrite)
+    {
+#if defined(_WIN32) && defined(UNICODE)
+        return _wfopen(sFileName.c_str(), bWrite ? L"wb" : L"rb");
+#else
+        return fopen(vpl::sys::tStringConv::toUtf8(sFileName).c_str(), bWrite ? "wb" : "rb");
+#endif
+    }
+
+    //! Helper writing metadata into a byte buffer.
+    class CMetadataWriter
+    {
+    public:
+        std::vector<char> m_Buffer;
+
+        void write(const void *pData, size_t Size)
+        {
+            const char *p = static_cast<const char *>(pData);
+            m_Buffer.insert(m_Buffer.end(), p, p + Size);
+        }
+        void write(const std::string& Value)
+        {
+            vpl::sys::tUInt32 Length = vpl::sys::tUInt32(Value.size());
+            write(&Length, sizeof(Length));
+            write(Value.data(), Value.size());
+        }
+        void write(const vpl::img::CVector3D& Value)
+        {
+            double v[3] = { Value.getX(), Value.getY(), Value.getZ() };
+            write(v, sizeof(v));
+        }
+    };
+
+    //! Helper reading metadata from a byte buffer, reads past the end return empty values.
+    class CMetadataReader
+    {
+    public:
+        CMetadataReader(const char *pData, size_t Size) : m_pData(pData), m_Size(Size), m_Pos(0) {}
+
+        bool read(void *pData, size_t Size)
+        {
+            if (m_Pos + Size > m_Size)
+            {
+                std::memset(pData, 0, Size);
+                m_Pos = m_Size;
+                return false;
+            }
+            std::memcpy(pData, m_pData + m_Pos, Size);
+            m_Pos += Size;
+            return true;
+        }
+        void read(std::string& Value)
+        {
+            vpl::sys::tUInt32 Length = 0;
+            read(&Length, sizeof(Length));
+            if (m_Pos + Length > m_Size)
+            {
+                Length = vpl::sys::tUInt32(m_Size - m_Pos);
+            }
+            Value.assign(m_pData + m_Pos, Length);
+            m_Pos += Length;
+        }
+        void read(vpl::img::CVector3D& Value)
+        {
+            double v[3];
+            read(v, sizeof(v));
+            Value.setXYZ(v[0], v[1], v[2]);
+        }
+
+    protected:
+        const char *m_pData;
+        size_t m_Size;
+        size_t m_Pos;
+    };
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+CBrickedVolumeFile::CBrickedVolumeFile()
+    : m_pData(NULL)
+    , m_Size(0)
+    , m_hFile(NULL)
+    , m_hMapping(NULL)
+{
+    std::memset(&m_Header, 0, sizeof(m_Header));
+}
+
+CBrickedVolumeFile::~CBrickedVolumeFile()
+{
+    close();
+}
+
+bool CBrickedVolumeFile::isBrickedFile(const vpl::sys::tString& sFileName)
+{
+    FILE *pFile = openFile(sFileName, false);
+    if (NULL == pFile)
+    {
+        return false;
+    }
+    char Magic[sizeof(BRICKED_VLM_MAGIC)];
+    const bool bResult = (sizeof(Magic) == fread(Magic, 1, sizeof(Magic), pFile)) && 0 == std::memcmp(Magic, BRICKED_VLM_MAGIC, sizeof(Magic));
+    fclose(pFile);
+    return bResult;
+}
+
+bool CBrickedVolumeFile::write(const CDensityData& Data, const vpl::sys::tString& sFileName, vpl::mod::CProgress::tProgressFunc& Progress)
+{
+    SHeader Header;
+    std::memset(&Header, 0, sizeof(Header));
+    std::memcpy(Header.magic, BRICKED_VLM_MAGIC, sizeof(Header.magic));
+    Header.version = VERSION;
+    Header.headerSize = sizeof(SHeader);
+    Header.size[0] = Data.getXSize();
+    Header.size[1] = Data.getYSize();
+    Header.size[2] = Data.getZSize();
+    Header.brickSize = BRICK_SIZE;
+    for (int i = 0; i < 3; ++i)
+    {
+        Header.bricks[i] = (Header.size[i] + BRICK_SIZE - 1) / BRICK_SIZE;
+    }
+    Header.voxelSize[0] = Data.getDX();
+    Header.voxelSize[1] = Data.getDY();
+    Header.voxelSize[2] = Data.getDZ();
+
+    const int BrickCount = Header.bricks[0] * Header.bricks[1] * Header.bricks[2];
+
+    // Brick offsets are page aligned and known in advance
+    std::vector<vpl::sys::tUInt64> Index(BrickCount);
+    Header.indexOffset = sizeof(SHeader);
+    vpl::sys::tUInt64 Offset = Header.indexOffset + BrickCount * sizeof(vpl::sys::tUInt64);
+    for (int bz = 0, i = 0; bz < Header.bricks[2]; ++bz)
+    {
+        for (int by = 0; by < Header.bricks[1]; ++by)
+        {
+            for (int bx = 0; bx < Header.bricks[0]; ++bx, ++i)
+            {
+                Offset = (Offset + BRICK_ALIGNMENT - 1) / BRICK_ALIGNMENT * BRICK_ALIGNMENT;
+                Index[i] = Offset;
+                const vpl::sys::tUInt64 sx = vpl::math::getMin<int>(BRICK_SIZE, Header.size[0] - bx * BRICK_SIZE);
+                const vpl::sys::tUInt64 sy = vpl::math::getMin<int>(BRICK_SIZE, Header.size[1] - by * BRICK_SIZE);
+                const vpl::sys::tUInt64 sz = vpl::math::getMin<int>(BRICK_SIZE, Header.size[2] - bz * BRICK_SIZE);
+                Offset += sx * sy * sz * sizeof(vpl::img::tDensityPixel);
+            }
+        }
+    }
+
+    // Metadata
+    CMetadataWriter Meta;
+    vpl::sys::tInt32 SeriesNumber = Data.m_iSeriesNumber;
+    Meta.write(&SeriesNumber, sizeof(SeriesNumber));
+    Meta.write(Data.m_sPatientName);
+    Meta.write(Data.m_sPatientId);
+    Meta.write(Data.m_sPatientBirthday);
+    Meta.write(Data.m_sPatientSex);
+    Meta.write(Data.m_sModality);
+    Meta.write(Data.m_sSeriesUid);
+    Meta.write(Data.m_sSeriesDate);
+    Meta.write(Data.m_sSeriesTime);
+    Meta.write(Data.m_sPatientPosition);
+    Meta.write(Data.m_sManufacturer);
+    Meta.write(Data.m_sModelName);
+    Meta.write(Data.m_ImagePosition);
+    Meta.write(Data.m_ImageOrientationX);
+    Meta.write(Data.m_ImageOrientationY);
+    Meta.write(Data.m_ImageSubSampling);
+    Meta.write(Data.m_sPatientDescription);
+    Meta.write(Data.m_sStudyUid);
+    Meta.write(Data.m_sStudyId);
+    Meta.write(Data.m_sStudyDate);
+    Meta.write(Data.m_sStudyDescription);
+    Meta.write(Data.m_sSeriesDescription);
+    Meta.write(Data.m_sScanOptions);
+    Meta.write(Data.m_sMediaStorage);
+    Header.metadataOffset = Offset;
+    Header.metadataSize = Meta.m_Buffer.size();
+
+    FILE *pFile = openFile(sFileName, true);
+    if (NULL == pFile)
+    {
+        return false;
+    }
+
+    bool bOk = (1 == fwrite(&Header, sizeof(Header), 1, pFile));
+    bOk = bOk && (BrickCount == 0 || BrickCount == int(fwrite(&Index[0], sizeof(vpl::sys::tUInt64), BrickCount, pFile)));
+
+    std::vector<vpl::img::tDensityPixel> Brick(BRICK_SIZE * BRICK_SIZE * BRICK_SIZE);
+    std::vector<char> Padding(BRICK_ALIGNMENT, 0);
+    vpl::sys::tUInt64 Written = Header.indexOffset + BrickCount * sizeof(vpl::sys::tUInt64);
+    for (int bz = 0, i = 0; bOk && bz < Header.bricks[2]; ++bz)
+    {
+        for (int by = 0; bOk && by < Header.bricks[1]; ++by)
+        {
+            for (int bx = 0; bOk && bx < Header.bricks[0]; ++bx, ++i)
+            {
+                bOk = bOk && (Index[i] == Written || 1 == fwrite(&Padding[0], size_t(Index[i] - Written), 1, pFile));
+                Written = Index[i];
+
+                const int x0 = bx * BRICK_SIZE, y0 = by * BRICK_SIZE, z0 = bz * BRICK_SIZE;
+                const int sx = vpl::math::getMin<int>(BRICK_SIZE, Header.size[0] - x0);
+                const int sy = vpl::math::getMin<int>(BRICK_SIZE, Header.size[1] - y0);
+                const int sz = vpl::math::getMin<int>(BRICK_SIZE, Header.size[2] - z0);
+                vpl::img::tDensityPixel *pDst = &Brick[0];
+                for (int z = 0; z < sz; ++z)
+                {
+                    for (int y = 0; y < sy; ++y)
+                    {
+                        for (int x = 0; x < sx; ++x)
+                        {
+                            *pDst++ = Data.at(x0 + x, y0 + y, z0 + z);
+                        }
+                    }
+                }
+                const size_t BrickBytes = size_t(sx) * sy * sz * sizeof(vpl::img::tDensityPixel);
+                bOk = bOk && (1 == fwrite(&Brick[0], BrickBytes, 1, pFile));
+                Written += BrickBytes;
+            }
+            if (!Progress(bz * Header.bricks[1] + by, Header.bricks[2] * Header.bricks[1]))
+            {
+                bOk = false;
+            }
+        }
+    }
+
+    bOk = bOk && (Meta.m_Buffer.empty() || 1 == fwrite(&Meta.m_Buffer[0], Meta.m_Buffer.size(), 1, pFile));
+    bOk = (0 == fclose(pFile)) && bOk;
+    return bOk;
+}
+
+bool CBrickedVolumeFile::open(const vpl::sys::tString& sFileName)
+{
+    close();
+
+#ifdef _WIN32
+#   ifdef UNICODE
+    HANDLE hFile = CreateFileW(sFileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+#   else
+    HANDLE hFile = CreateFileA(sFileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+#   endif
+    if (INVALID_HANDLE_VALUE == hFile)
+    {
+        return false;
+    }
+    LARGE_INTEGER FileSize;
+    if (!GetFileSizeEx(hFile, &FileSize) || FileSize.QuadPart < LONGLONG(sizeof(SHeader)))
+    {
+        CloseHandle(hFile);
+        return false;
+    }
+    HANDLE hMapping = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (NULL == hMapping)
+    {
+        CloseHandle(hFile);
+        return false;
+    }
+    const void *pView = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    if (NULL == pView)
+    {
+        CloseHandle(hMapping);
+        CloseHandle(hFile);
+        return false;
+    }
+    m_hFile = hFile;
+    m_hMapping = hMapping;
+    m_pData = static_cast<const char *>(pView);
+    m_Size = vpl::sys::tUInt64(FileSize.QuadPart);
+#else
+    int fd = ::open(vpl::sys::tStringConv::toUtf8(sFileName).c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat Stat;
+    if (0 != fstat(fd, &Stat) || Stat.st_size < off_t(sizeof(SHeader)))
+    {
+        ::close(fd);
+        return false;
+    }
+    void *pView = mmap(NULL, size_t(Stat.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (MAP_FAILED == pView)
+    {
+        return false;
+    }
+    m_pData = static_cast<const char *>(pView);
+    m_Size = vpl::sys::tUInt64(Stat.st_size);
+#endif
+
+    // Validate header and index
+    std::memcpy(&m_Header, m_pData, sizeof(m_Header));
+    bool bValid = 0 == std::memcmp(m_Header.magic, BRICKED_VLM_MAGIC, sizeof(m_Header.magic))
+        && m_Header.version <= VERSION
+        && m_Header.brickSize > 0;
+    vpl::sys::tUInt64 BrickCount = 0;
+    for (int i = 0; bValid && i < 3; ++i)
+    {
+        bValid = m_Header.size[i] > 0 && m_Header.bricks[i] == (m_Header.size[i] + m_Header.brickSize - 1) / m_Header.brickSize;
+    }
+    if (bValid)
+    {
+        BrickCount = vpl::sys::tUInt64(m_Header.bricks[0]) * m_Header.bricks[1] * m_Header.bricks[2];
+        bValid = m_Header.indexOffset + BrickCount * sizeof(vpl::sys::tUInt64) <= m_Size
+            && m_Header.metadataOffset + m_Header.metadataSize <= m_Size;
+    }
+    if (!bValid)
+    {
+        VPL_LOG_INFO("Invalid bricked VLM header");
+        close();
+        return false;
+    }
+
+    m_Loaded.assign(size_t(BrickCount), 0);
+    return true;
+}
+
+void CBrickedVolumeFile::close()
+{
+    if (NULL != m_pData)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(m_pData);
+        CloseHandle(static_cast<HANDLE>(m_hMapping));
+        CloseHandle(static_cast<HANDLE>(m_hFile));
+#else
+        munmap(const_cast<char *>(m_pData), size_t(m_Size));
+#endif
+    }
+    m_pData = NULL;
+    m_Size = 0;
+    m_hFile = NULL;
+    m_hMapping = NULL;
+    m_Loaded.clear();
+}
+
+void CBrickedVolumeFile::prepare(CDensityData& Data) const
+{
+    Data.resize(m_Header.size[0], m_Header.size[1], m_Header.size[2], Data.getMargin());
+    Data.fillEntire(vpl::img::CPixelTraits<vpl::img::tDensityPixel>::getPixelMin());
+    Data.setDX(m_Header.voxelSize[0]);
+    Data.setDY(m_Header.voxelSize[1]);
+    Data.setDZ(m_Header.voxelSize[2]);
+    readMetadata(Data);
+}
+
+void CBrickedVolumeFile::readBricksForSlices(CDensityData& Data, int xyPosition, int xzPosition, int yzPosition)
+{
+    const int bs = m_Header.brickSize;
+    for (int bz = 0; bz < m_Header.bricks[2]; ++bz)
+    {
+        for (int by = 0; by < m_Header.bricks[1]; ++by)
+        {
+            for (int bx = 0; bx < m_Header.bricks[0]; ++bx)
+            {
+                const bool bNeeded = (xyPosition >= 0 && xyPosition / bs == bz)
+                    || (xzPosition >= 0 && xzPosition / bs == by)
+                    || (yzPosition >= 0 && yzPosition / bs == bx);
+                if (bNeeded)
+                {
+                    readBrick(Data, bx, by, bz);
+                }
+            }
+        }
+    }
+}
+
+void CBrickedVolumeFile::readBrickLayer(CDensityData& Data, int bz)
+{
+    // Rows of bricks are independent, so they are copied concurrently
+    #pragma omp parallel for schedule(dynamic)
+    for (int by = 0; by < m_Header.bricks[1]; ++by)
+    {
+        for (int bx = 0; bx < m_Header.bricks[0]; ++bx)
+        {
+            readBrick(Data, bx, by, bz);
+        }
+    }
+}
+
+bool CBrickedVolumeFile::readRemaining(CDensityData& Data, vpl::mod::CProgress::tProgressFunc& Progress)
+{
+    const int Count = m_Header.bricks[1] * m_Header.bricks[2];
+
+    bool bContinue = true;
+    for (int bz = 0; bContinue && bz < m_Header.bricks[2]; ++bz)
+    {
+        readBrickLayer(Data, bz);
+        bContinue = Progress((bz + 1) * m_Header.bricks[1], Count);
+    }
+    return bContinue;
+}
+
+void CBrickedVolumeFile::readBrick(CDensityData& Data, int bx, int by, int bz)
+{
+    const size_t BrickIndex = (size_t(bz) * m_Header.bricks[1] + by) * m_Header.bricks[0] + bx;
+    if (m_Loaded[BrickIndex])
+    {
+        return;
+    }
+
+    const int bs = m_Header.brickSize;
+    const int x0 = bx * bs, y0 = by * bs, z0 = bz * bs;
+    const int sx = vpl::math::getMin(bs, m_Header.size[0] - x0);
+    const int sy = vpl::math::getMin(bs, m_Header.size[1] - y0);
+    const int sz = vpl::math::getMin(bs, m_Header.size[2] - z0);
+
+    vpl::sys::tUInt64 Offset;
+    std::memcpy(&Offset, m_pData + m_Header.indexOffset + BrickIndex * sizeof(vpl::sys::tUInt64), sizeof(Offset));
+    const vpl::sys::tUInt64 BrickBytes = vpl::sys::tUInt64(sx) * sy * sz * sizeof(vpl::img::tDensityPixel);
+    if (Offset + BrickBytes > m_Size)
+    {
+        VPL_LOG_INFO("Bricked VLM brick out of file bounds");
+        return;
+    }
+
+    // Pages are faulted in by the copy
+    const vpl::img::tDensityPixel *pSrc = reinterpret_cast<const vpl::img::tDensityPixel *>(m_pData + Offset);
+    for (int z = 0; z < sz; ++z)
+    {
+        for (int y = 0; y < sy; ++y, pSrc += sx)
+        {
+            std::memcpy(&Data.at(x0, y0 + y, z0 + z), pSrc, sx * sizeof(vpl::img::tDensityPixel));
+        }
+    }
+    m_Loaded[BrickIndex] = 1;
+}
+
+void CBrickedVolumeFile::readMetadata(CDensityData& Data) const
+{
+    CMetadataReader Meta(m_pData + m_Header.metadataOffset, size_t(m_Header.metadataSize));
+    vpl::sys::tInt32 SeriesNumber = 0;
+    Meta.read(&SeriesNumber, sizeof(SeriesNumber));
+    Data.m_iSeriesNumber = SeriesNumber;
+    Meta.read(Data.m_sPatientName);
+    Meta.read(Data.m_sPatientId);
+    Meta.read(Data.m_sPatientBirthday);
+    Meta.read(Data.m_sPatientSex);
+    Meta.read(Data.m_sModality);
+    Meta.read(Data.m_sSeriesUid);
+    Meta.read(Data.m_sSeriesDate);
+    Meta.read(Data.m_sSeriesTime);
+    Meta.read(Data.m_sPatientPosition);
+    Meta.read(Data.m_sManufacturer);
+    Meta.read(Data.m_sModelName);
+    Meta.read(Data.m_ImagePosition);
+    Meta.read(Data.m_ImageOrientationX);
+    Meta.read(Data.m_ImageOrientationY);
+    Meta.read(Data.m_ImageSubSampling);
+    Meta.read(Data.m_sPatientDescription);
+    Meta.read(Data.m_sStudyUid);
+    Meta.read(Data.m_sStudyId);
+    Meta.read(Data.m_sStudyDate);
+    Meta.read(Data.m_sStudyDescription);
+    Meta.read(Data.m_sSeriesDescription);
+    Meta.read(Data.m_sScanOptions);
+    Meta.read(Data.m_sMediaStorage);
+}
+
+} // namespace data
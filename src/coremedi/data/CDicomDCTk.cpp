@@ -25,10 +25,11 @@
 #include <data/CDicomDCTk.h>
 #include <data/DicomTags.h>
 #include <data/DicomTagUtils.h>
+#include <data/CDicomMemoryFiles.h>
+#include <data/CSeries.h>
 
 //VPL
 #include <VPL/ImageIO/DicomSlice.h>
-#include <VPL/System/FileBrowser.h>
 
 // DCMTK
 #ifdef __APPLE__
@@ -38,6 +39,7 @@
 #include <dcmtk/dcmdata/dcxfer.h>
 #include <dcmtk/dcmdata/dcfilefo.h>
 #include <dcmtk/dcmdata/dcostrmb.h>
+#include <dcmtk/dcmdata/dcistrmb.h>
 #include <dcmtk/dcmdata/dctk.h>
 #include <dcmtk/dcmdata/dcdeftag.h>
 #include <dcmtk/dcmdata/cmdlnarg.h>
@@ -60,6 +62,41 @@
 namespace data 
 {
 
+//=================================================================================================
+//! Parses a dicom file from a memory buffer.
+OFCondition loadFileFormatDCTk(DcmFileFormat & file_format, const char * data, size_t size)
+{
+    DcmInputBufferStream stream;
+    stream.setBuffer(data, offile_off_t(size));
+    stream.setEos();
+
+    file_format.transferInit();
+    OFCondition status = file_format.read(stream);
+    file_format.transferEnd();
+    return status;
+}
+
+//=================================================================================================
+//! Parses a dicom file, files of virtual directories are taken from memory.
+//! Files on disk are opened by their full path, the working directory is not
+//! changed, so that files may be loaded from several threads at once.
+OFCondition loadFileFormatDCTk(DcmFileFormat & file_format, const vpl::sys::tString & dir, const std::string & filename)
+{
+    const char * data = NULL;
+    size_t size = 0;
+    if (CDicomMemoryFiles::findFile(dir, filename, data, size))
+    {
+        return loadFileFormatDCTk(file_format, data, size);
+    }
+#ifdef WIN32
+    // filename is already converted to the active code page
+    const std::string path = wcs2ACP(dir) + "/" + filename;
+#else
+    const std::string path = vpl::sys::tStringConv::toUtf8(dir) + "/" + filename;
+#endif
+    return file_format.loadFile(path.c_str());
+}
+
 //=================================================================================================
 CDicomDCTk::CDicomDCTk(const std::string & file)
 :CDicom()
@@ -79,6 +116,25 @@ data::CDicomDCTk::CDicomDCTk()
     m_pHandle = new DcmFileFormat;
 }
 
+//=================================================================================================
+void data::CDicomDCTk::registerDecoders()
+{
+    // Registered once for the whole process and released on exit, loaders
+    // running in other threads must never see the codecs deregistered.
+    struct SDecoderRegistration
+    {
+        SDecoderRegistration()
+        {
+            DJDecoderRegistration::registerCodecs(EDC_photometricInterpretation, EUC_default, EPC_default, OFFalse);
+        }
+        ~SDecoderRegistration()
+        {
+            DJDecoderRegistration::cleanup();
+        }
+    };
+    static SDecoderRegistration registration;
+}
+
 //=================================================================================================
 data::CDicomDCTk::~CDicomDCTk()
 {
@@ -107,6 +163,22 @@ bool data::CDicomDCTk::loadFile(const std::string & file)
     }
 }
 
+//=================================================================================================
+bool data::CDicomDCTk::loadBuffer(const char * data, size_t size, const std::string & name)
+{
+    OFCondition status = loadFileFormatDCTk(*m_pHandle, data, size);
+    if( status.good() )
+    {
+        m_sFileName = name;
+        return (m_bOk = true);
+    }
+    else
+    {
+        // Cannot parse the buffer
+        return false;
+    }
+}
+
 //=================================================================================================
 long data::CDicomDCTk::saveToBuffer(char * buffer, long length)
 {
@@ -1355,10 +1427,6 @@ void readOrientTagDCTk(DcmDataset * dataset,
 
 bool CDicomDCTk::loadDicom(const vpl::sys::tString &dir, const std::string &filename, vpl::img::CDicomSlice &slice, sExtendedTags& tags, bool bLoadImageData)
 {
-    vpl::sys::CFileBrowserU browser;
-    vpl::sys::tString oldDir = browser.getDirectory();
-    browser.setDirectory(dir);
-
     // DCMTk image
     vpl::base::CScopedPtr<DicomImage> image(NULL);
 
@@ -1366,7 +1434,7 @@ bool CDicomDCTk::loadDicom(const vpl::sys::tString &dir, const std::string &file
     try
     {
         DcmFileFormat file_format;
-        OFCondition	status = file_format.loadFile(filename.c_str());
+        OFCondition	status = loadFileFormatDCTk(file_format, dir, filename);
         if (!status.good())
         {
             throw CDicomLoadingFailure();
@@ -1487,12 +1555,8 @@ bool CDicomDCTk::loadDicom(const vpl::sys::tString &dir, const std::string &file
         vpl::img::CVector3D position_vector(zero_point, slice.m_ImagePosition);
         slice.setPosition(normal_image.dotProduct(normal_image, position_vector));
 
-        // prepare for potential decompression
-        OFBool opt_verbose = OFFalse;
-        E_DecompressionColorSpaceConversion opt_decompCSconversion = EDC_photometricInterpretation;
-        E_UIDCreation opt_uidcreation = EUC_default;
-        E_PlanarConfiguration opt_planarconfig = EPC_default;
-        DJDecoderRegistration::registerCodecs(opt_decompCSconversion, opt_uidcreation, opt_planarconfig, opt_verbose);
+        // Prepare for potential decompression
+        registerDecoders();
 
         E_TransferSyntax es = dataset->getOriginalXfer();
         OFCondition error = dataset->chooseRepresentation(EXS_LittleEndianExplicit, NULL);
@@ -1596,23 +1660,15 @@ bool CDicomDCTk::loadDicom(const vpl::sys::tString &dir, const std::string &file
     // Any failure?
     catch (CDicomLoadingFailure &e)
     {
-        browser.setDirectory(oldDir);
-        DJDecoderRegistration::cleanup();
         return false;
     }
 
-    browser.setDirectory(oldDir);
-    DJDecoderRegistration::cleanup();
     return true;
 }
 
 //=============================================================================
 int CDicomDCTk::loadDicom(const vpl::sys::tString &dir, const std::string &filename, tDicomSlices &slices, sExtendedTags& tags, bool bLoadImageData, bool bIgnoreBitsStoredTag)
 {
-    vpl::sys::CFileBrowserU browser;
-    vpl::sys::tString oldDir = browser.getDirectory();
-    browser.setDirectory(dir);
-
     // DCMTk image
     vpl::base::CScopedPtr<DicomImage> image(NULL);
 
@@ -1620,7 +1676,7 @@ int CDicomDCTk::loadDicom(const vpl::sys::tString &dir, const std::string &filen
     try
     {
         DcmFileFormat file_format;
-        OFCondition	status = file_format.loadFile(filename.c_str());
+        OFCondition	status = loadFileFormatDCTk(file_format, dir, filename);
         if (!status.good())
         {
             throw CDicomLoadingFailure();
@@ -1731,20 +1787,6 @@ int CDicomDCTk::loadDicom(const vpl::sys::tString &dir, const std::string &filen
         slicetags.m_ImagePosition.setXYZ(0, 0, 0);
         slicetags.setPosition(0.0);
 
-        // Prepare for potential decompression
-        OFBool opt_verbose = OFFalse;
-        E_DecompressionColorSpaceConversion opt_decompCSconversion = EDC_photometricInterpretation;
-        E_UIDCreation opt_uidcreation = EUC_default;
-        E_PlanarConfiguration opt_planarconfig = EPC_default;
-        DJDecoderRegistration::registerCodecs(opt_decompCSconversion, opt_uidcreation, opt_planarconfig, opt_verbose);
-
-        E_TransferSyntax es = dataset->getOriginalXfer();
-        OFCondition error = dataset->chooseRepresentation(EXS_LittleEndianExplicit, NULL);
-        if (error.bad())
-        {
-            throw CDicomLoadingFailure();
-        }
-
         // Format conversion
         vpl::img::tDensityPixel pMin = vpl::img::CPixelTraits<vpl::img::tDensityPixel>::getPixelMin();
         vpl::img::tDensityPixel pMax = vpl::img::CPixelTraits<vpl::img::tDensityPixel>::getPixelMax();
@@ -1753,14 +1795,28 @@ int CDicomDCTk::loadDicom(const vpl::sys::tString &dir, const std::string &filen
         //        double dMinRelative = dMin;
         //        double dMaxRelative = dMax;
 
+        // Number of frames, header only loading takes it from the NumberOfFrames tag
+        // the same way DicomImage does, so that frames can be decoded later by their index
+        signed long frameCount = 1;
         if (bLoadImageData)
         {
+            // Prepare for potential decompression
+            registerDecoders();
+
+            E_TransferSyntax es = dataset->getOriginalXfer();
+            OFCondition error = dataset->chooseRepresentation(EXS_LittleEndianExplicit, NULL);
+            if (error.bad())
+            {
+                throw CDicomLoadingFailure();
+            }
+
             // - Load all frames from the dataset!
             image = new DicomImage(dataset, es, 0UL, 0UL, 0UL);
             if (!image.get() || image->getStatus() != EIS_Normal || (0 == poslist.card() && 0 == spacing) || 0 == image->getFrameCount() /*image->getFrameCount() != poslist.card()*/)
             {
                 throw CDicomLoadingFailure();
             }
+            frameCount = static_cast<signed long>(image->getFrameCount());
 
             // Setup the DCMTk image to read raw image data
             image->deleteDisplayLUT(0);
@@ -1774,10 +1830,18 @@ int CDicomDCTk::loadDicom(const vpl::sys::tString &dir, const std::string &filen
             // Format conversion
             //            image->getMinMaxValues( dMinRelative, dMaxRelative, 0 );
         }
+        else
+        {
+            Sint32 numberOfFrames = 0;
+            if (dataset->findAndGetSint32(DCM_NumberOfFrames, numberOfFrames).good() && numberOfFrames > 0)
+            {
+                frameCount = numberOfFrames;
+            }
+        }
 
         // Load all frames
         //for( unsigned long i = 0; i < poslist.card(); ++i ) // we have a file which has multiple frames but only one position record
-        for (signed long i = 0; i < image->getFrameCount(); ++i)
+        for (signed long i = 0; i < frameCount; ++i)
         {
             // Create a new slice
             vpl::img::CDicomSlicePtr pSlice = new vpl::img::CDicomSlice(slicetags);
@@ -1910,23 +1974,15 @@ int CDicomDCTk::loadDicom(const vpl::sys::tString &dir, const std::string &filen
     // Any failure?
     catch (CDicomLoadingFailure &)
     {
-        browser.setDirectory(oldDir);
-        DJDecoderRegistration::cleanup();
         return false;
     }
 
-    browser.setDirectory(oldDir);
-    DJDecoderRegistration::cleanup();
     return true;
 }
 
 //=============================================================================
 bool CDicomDCTk::getDicomFileInfo(const vpl::sys::tString &dir, const std::string &filename, int& nFrames)
 {
-    vpl::sys::CFileBrowserU browser;
-    vpl::sys::tString oldDir = browser.getDirectory();
-    browser.setDirectory(dir);
-
     // DCMTk image
     vpl::base::CScopedPtr<DicomImage> image(NULL);
 
@@ -1936,7 +1992,7 @@ bool CDicomDCTk::getDicomFileInfo(const vpl::sys::tString &dir, const std::strin
     try
     {
         DcmFileFormat file_format;
-        OFCondition	status = file_format.loadFile(filename.c_str());
+        OFCondition	status = loadFileFormatDCTk(file_format, dir, filename);
         if (!status.good())
         {
             throw CDicomLoadingFailure();
@@ -1961,13 +2017,9 @@ bool CDicomDCTk::getDicomFileInfo(const vpl::sys::tString &dir, const std::strin
     // Any failure?
     catch (CDicomLoadingFailure &)
     {
-        browser.setDirectory(oldDir);
-        DJDecoderRegistration::cleanup();
         return false;
     }
 
-    browser.setDirectory(oldDir);
-    DJDecoderRegistration::cleanup();
     return true;
 }
 
@@ -1975,10 +2027,6 @@ bool CDicomDCTk::getDicomFileInfo(const vpl::sys::tString &dir, const std::strin
 
 bool CDicomDCTk::loadDicomDCTk2D(const vpl::sys::tString &dir, const std::string &filename, vpl::img::CDicomSlice &slice, sExtendedTags& tags, bool bLoadImageData, int nDesiredBits)
 {
-    vpl::sys::CFileBrowserU browser;
-    vpl::sys::tString oldDir = browser.getDirectory();
-    browser.setDirectory(dir);
-
     // DCMTk image
     vpl::base::CScopedPtr<DicomImage> image(NULL);
 
@@ -1986,7 +2034,7 @@ bool CDicomDCTk::loadDicomDCTk2D(const vpl::sys::tString &dir, const std::string
     try
     {
         DcmFileFormat file_format;
-        OFCondition	status = file_format.loadFile(filename.c_str());
+        OFCondition	status = loadFileFormatDCTk(file_format, dir, filename);
         if (!status.good())
         {
             throw CDicomLoadingFailure();
@@ -2236,12 +2284,8 @@ bool CDicomDCTk::loadDicomDCTk2D(const vpl::sys::tString &dir, const std::string
         vpl::img::CVector3D position_vector(zero_point, slice.m_ImagePosition);
         slice.setPosition(normal_image.dotProduct(normal_image, position_vector));
 
-        // prepare for potential decompression
-        OFBool opt_verbose = OFFalse;
-        E_DecompressionColorSpaceConversion opt_decompCSconversion = EDC_photometricInterpretation;
-        E_UIDCreation opt_uidcreation = EUC_default;
-        E_PlanarConfiguration opt_planarconfig = EPC_default;
-        DJDecoderRegistration::registerCodecs(opt_decompCSconversion, opt_uidcreation, opt_planarconfig, opt_verbose);
+        // Prepare for potential decompression
+        registerDecoders();
 
         E_TransferSyntax es = dataset->getOriginalXfer();
         OFCondition error = dataset->chooseRepresentation(EXS_LittleEndianExplicit, NULL);
@@ -2400,13 +2444,9 @@ bool CDicomDCTk::loadDicomDCTk2D(const vpl::sys::tString &dir, const std::string
     // Any failure?
     catch (CDicomLoadingFailure &)
     {
-        browser.setDirectory(oldDir);
-        DJDecoderRegistration::cleanup();
         return false;
     }
 
-    browser.setDirectory(oldDir);
-    DJDecoderRegistration::cleanup();
     return true;
 }
 
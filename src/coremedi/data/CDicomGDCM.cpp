@@ -372,12 +372,12 @@ int CDicomGDCM::loadDicom(const vpl::sys::tString &dir,
 
     if (m_loader.isMultiframe())
     {
-        bOK = m_loader.loadMultiframeDicom(createFullPath(dir, filename), slices, true);
+        bOK = m_loader.loadMultiframeDicom(createFullPath(dir, filename), slices, bLoadImageData);
     }
     else
     {
         vpl::img::CDicomSlicePtr ptr(new vpl::img::CDicomSlice);
-        if ((bOK = m_loader.loadDicom(createFullPath(dir, filename), *ptr, true)))
+        if ((bOK = m_loader.loadDicom(createFullPath(dir, filename), *ptr, bLoadImageData)))
             slices.push_back(ptr);
     }
 
@@ -0,0 +1,269 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <data/CDicomIndexCache.h>
+
+#include <VPL/Base/Logging.h>
+
+#include <cstdio>
+#include <cstring>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+namespace data
+{
+
+namespace
+{
+    //! Magic string identifying the index file.
+    const char DICOM_INDEX_MAGIC[8] = { '3', 'D', 'I', 'M', 'D', 'I', 'D', 'X' };
+
+    //! Sanity limit of stored strings and lists.
+    const vpl::sys::tUInt32 MAX_ITEM_SIZE = 1 << 20;
+
+    //! Opens file using a native (possibly wide) file name.
+    FILE *openFile(const vpl::sys::tString& sFileName, bool bWrite)
+    {
+#if defined(_WIN32) && defined(UNICODE)
+        return _wfopen(sFileName.c_str(), bWrite ? L"wb" : L"rb");
+#else
+        return fopen(vpl::sys::tStringConv::toUtf8(sFileName).c_str(), bWrite ? "wb" : "rb");
+#endif
+    }
+
+    //! Replaces one file by another one.
+    bool replaceFile(const vpl::sys::tString& sFrom, const vpl::sys::tString& sTo)
+    {
+#if defined(_WIN32) && defined(UNICODE)
+        _wremove(sTo.c_str());
+        return 0 == _wrename(sFrom.c_str(), sTo.c_str());
+#else
+        return 0 == rename(vpl::sys::tStringConv::toUtf8(sFrom).c_str(), vpl::sys::tStringConv::toUtf8(sTo).c_str());
+#endif
+    }
+
+    //! Simple stream helpers, values are stored in the native byte order.
+    template <typename T>
+    void writeValue(FILE *f, const T& value)
+    {
+        fwrite(&value, sizeof(T), 1, f);
+    }
+
+    template <typename T>
+    bool readValue(FILE *f, T& value)
+    {
+        return 1 == fread(&value, sizeof(T), 1, f);
+    }
+
+    void writeString(FILE *f, const std::string& s)
+    {
+        writeValue(f, vpl::sys::tUInt32(s.size()));
+        fwrite(s.data(), 1, s.size(), f);
+    }
+
+    bool readString(FILE *f, std::string& s)
+    {
+        vpl::sys::tUInt32 len = 0;
+        if (!readValue(f, len) || len > MAX_ITEM_SIZE)
+        {
+            return false;
+        }
+        s.resize(len);
+        return 0 == len || len == fread(&s[0], 1, len, f);
+    }
+
+    //! FNV-1a hash of the root path, names the index file.
+    vpl::sys::tUInt64 hashPath(const std::string& s)
+    {
+        vpl::sys::tUInt64 hash = 14695981039346656037ULL;
+        for (std::string::const_iterator it = s.begin(); it != s.end(); ++it)
+        {
+            hash ^= vpl::sys::tUInt64((unsigned char)*it);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+}
+
+//==============================================================================================
+CDicomIndexCache::CDicomIndexCache()
+    : m_bModified(false)
+{
+}
+
+//==============================================================================================
+bool CDicomIndexCache::load(const vpl::sys::tString& cacheDir, const vpl::sys::tString& root)
+{
+    m_Loaded.clear();
+    m_Current.clear();
+    m_bModified = false;
+
+    char name[64];
+    sprintf(name, "dicomindex_%016llx.idx", (unsigned long long)hashPath(vpl::sys::tStringConv::toUtf8(root)));
+    m_sFileName = cacheDir + vpl::sys::tChar(vplT('/')) + vpl::sys::tStringConv::fromUtf8(name);
+
+    FILE *f = openFile(m_sFileName, false);
+    if (NULL == f)
+    {
+        return false;
+    }
+
+    char magic[8];
+    vpl::sys::tUInt32 version = 0, count = 0;
+    bool bOk = (1 == fread(magic, sizeof(magic), 1, f))
+        && 0 == memcmp(magic, DICOM_INDEX_MAGIC, sizeof(magic))
+        && readValue(f, version) && VERSION == version
+        && readValue(f, count);
+
+    for (vpl::sys::tUInt32 i = 0; bOk && i < count; ++i)
+    {
+        std::string path;
+        SEntry entry;
+        vpl::sys::tUInt32 numIds = 0;
+        bOk = readString(f, path)
+            && readValue(f, entry.size)
+            && readValue(f, entry.mtime)
+            && readString(f, entry.info.serieId)
+            && readValue(f, entry.info.pixelSpacing)
+            && readValue(f, entry.info.bitsAllocated)
+            && readValue(f, entry.info.numOfFrames)
+            && readValue(f, numIds)
+            && numIds <= MAX_ITEM_SIZE;
+        if (bOk)
+        {
+            entry.info.sliceIds.resize(numIds);
+            bOk = 0 == numIds || numIds == fread(&entry.info.sliceIds[0], sizeof(double), numIds, f);
+        }
+        if (bOk)
+        {
+            m_Loaded[path] = entry;
+        }
+    }
+    fclose(f);
+
+    if (!bOk)
+    {
+        VPL_LOG_INFO("Invalid dicom index " << vpl::sys::tStringConv::toUtf8(m_sFileName));
+        m_Loaded.clear();
+        return false;
+    }
+    return true;
+}
+
+//==============================================================================================
+bool CDicomIndexCache::save()
+{
+    if (m_sFileName.empty() || (!m_bModified && m_Current.size() == m_Loaded.size()))
+    {
+        return true;
+    }
+
+    // Write a temporary file first, so that an interrupted write doesn't leave a broken index
+    vpl::sys::tString sTempName = m_sFileName + vpl::sys::tStringConv::fromUtf8(".tmp");
+    FILE *f = openFile(sTempName, true);
+    if (NULL == f)
+    {
+        return false;
+    }
+
+    fwrite(DICOM_INDEX_MAGIC, sizeof(DICOM_INDEX_MAGIC), 1, f);
+    writeValue(f, vpl::sys::tUInt32(VERSION));
+    writeValue(f, vpl::sys::tUInt32(m_Current.size()));
+    for (tEntries::const_iterator it = m_Current.begin(); it != m_Current.end(); ++it)
+    {
+        const SEntry& entry = it->second;
+        writeString(f, it->first);
+        writeValue(f, entry.size);
+        writeValue(f, entry.mtime);
+        writeString(f, entry.info.serieId);
+        writeValue(f, entry.info.pixelSpacing);
+        writeValue(f, entry.info.bitsAllocated);
+        writeValue(f, entry.info.numOfFrames);
+        writeValue(f, vpl::sys::tUInt32(entry.info.sliceIds.size()));
+        if (!entry.info.sliceIds.empty())
+        {
+            fwrite(&entry.info.sliceIds[0], sizeof(double), entry.info.sliceIds.size(), f);
+        }
+    }
+    bool bOk = 0 == ferror(f);
+    bOk = (0 == fclose(f)) && bOk;
+
+    bOk = bOk && replaceFile(sTempName, m_sFileName);
+    if (bOk)
+    {
+        m_Loaded = m_Current;
+        m_bModified = false;
+    }
+    return bOk;
+}
+
+//==============================================================================================
+const SDicomFileInfo *CDicomIndexCache::find(const vpl::sys::tString& path, vpl::sys::tUInt64 size, vpl::sys::tInt64 mtime)
+{
+    const std::string key = vpl::sys::tStringConv::toUtf8(path);
+    tEntries::const_iterator it = m_Loaded.find(key);
+    if (it == m_Loaded.end() || it->second.size != size || it->second.mtime != mtime)
+    {
+        return NULL;
+    }
+    return &(m_Current[key] = it->second).info;
+}
+
+//==============================================================================================
+void CDicomIndexCache::insert(const vpl::sys::tString& path, vpl::sys::tUInt64 size, vpl::sys::tInt64 mtime, const SDicomFileInfo& info)
+{
+    SEntry& entry = m_Current[vpl::sys::tStringConv::toUtf8(path)];
+    entry.size = size;
+    entry.mtime = mtime;
+    entry.info = info;
+    m_bModified = true;
+}
+
+//==============================================================================================
+bool CDicomIndexCache::getFileStamp(const vpl::sys::tString& path, vpl::sys::tUInt64& size, vpl::sys::tInt64& mtime)
+{
+#if defined(_WIN32) && defined(UNICODE)
+    struct _stat64 st;
+    if (0 != _wstat64(path.c_str(), &st))
+    {
+        return false;
+    }
+#elif defined(_WIN32)
+    struct _stat64 st;
+    if (0 != _stat64(path.c_str(), &st))
+    {
+        return false;
+    }
+#else
+    struct stat st;
+    if (0 != stat(vpl::sys::tStringConv::toUtf8(path).c_str(), &st))
+    {
+        return false;
+    }
+#endif
+    size = vpl::sys::tUInt64(st.st_size);
+    mtime = vpl::sys::tInt64(st.st_mtime);
+    return true;
+}
+
+} // namespace data
@@ -23,20 +23,28 @@
 #include <data/CDicomLoader.h>
 #include <data/CDicom.h>
 #include <data/CSeries.h>
+#include <data/CDicomIndexCache.h>
+#include <data/CDicomMemoryFiles.h>
 
 // VPL
+#include <VPL/Base/Logging.h>
 #include <VPL/Base/ScopedPtr.h>
+#include <VPL/Math/Base.h>
 #include <VPL/Image/Vector3.h>
 #include <VPL/System/FileBrowser.h>
 
 
 // STL
+#include <chrono>
 #include <deque>
 #include <cctype>
 #include <locale>
 #ifdef _WIN32
 #include <codecvt>
 #endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #if !defined(TRIDIM_USE_GDCM)
 
 #include <data/DicomTagUtils.h>
@@ -104,8 +112,11 @@ CSeries * CDicomLoader::preLoadDirectory( const vpl::sys::tString & path )
     // Create a new dicom series
     CSeries::tSmartPtr new_series;
 
-    // Number of loaded dicom files
-    int	total_dicoms = 0;
+    // Files found in the directory tree, headers are read later
+    tFileList candidates;
+
+    std::chrono::steady_clock::time_point scanStart = std::chrono::steady_clock::now();
+
     bool bCanceled = false;
     while( !directories.empty() && !bCanceled )
     {
@@ -181,15 +192,12 @@ CSeries * CDicomLoader::preLoadDirectory( const vpl::sys::tString & path )
                     }
                 }
 
-				// Preload the file - provide directory path and filename separately if possible (CPath would be nice)
-				if ( new_series->addDicomFile(current, files.m_sName) )
+				// Remember the file - provide directory path and filename separately if possible (CPath would be nice)
+				candidates.push_back(std::make_pair(current, files.m_sName));
+                if ( candidates.size() % 100 == 0 && !this->progress() )
                 {
-                    total_dicoms++;
-                    if ( total_dicoms % 20 == 0 && !this->progress() )
-                    {
-                        bCanceled = true;
-                        break;
-                    }
+                    bCanceled = true;
+                    break;
                 }
             }
         }
@@ -198,6 +206,78 @@ CSeries * CDicomLoader::preLoadDirectory( const vpl::sys::tString & path )
     // Change the working directory back
     browser.setDirectory( oldDir );
 
+    // Take headers of unchanged files from the index
+    const int numCandidates = int(candidates.size());
+    std::vector<SDicomFileInfo> infos(numCandidates);
+    std::vector<char> states(numCandidates, 0); // 0 - not read, 1 - dicom, 2 - not a dicom
+    std::vector<vpl::sys::tUInt64> sizes(numCandidates, 0);
+    std::vector<vpl::sys::tInt64> mtimes(numCandidates, 0);
+    CDicomIndexCache index;
+    const bool bUseIndex = !bCanceled && !m_sIndexCacheDir.empty();
+    int numIndexed = 0;
+    if (bUseIndex)
+    {
+        index.load(m_sIndexCacheDir, path);
+        for (int i = 0; i < numCandidates; ++i)
+        {
+            const vpl::sys::tString file = candidates[i].first + vplT('/') + candidates[i].second;
+            if (!CDicomIndexCache::getFileStamp(file, sizes[i], mtimes[i]))
+            {
+                states[i] = 2;
+                continue;
+            }
+            const SDicomFileInfo *pInfo = index.find(file, sizes[i], mtimes[i]);
+            if (NULL != pInfo)
+            {
+                infos[i] = *pInfo;
+                states[i] = 1;
+                ++numIndexed;
+            }
+        }
+    }
+
+    // Read headers of remaining files
+    std::vector<int> toRead;
+    for (int i = 0; i < numCandidates; ++i)
+    {
+        if (0 == states[i])
+        {
+            toRead.push_back(i);
+        }
+    }
+    bCanceled = bCanceled || !readFileInfos(candidates, toRead, infos, states);
+
+    if (bUseIndex && !bCanceled)
+    {
+        for (std::size_t j = 0; j < toRead.size(); ++j)
+        {
+            const int i = toRead[j];
+            if (1 == states[i])
+            {
+                index.insert(candidates[i].first + vplT('/') + candidates[i].second, sizes[i], mtimes[i], infos[i]);
+            }
+        }
+    }
+
+    // Sort files into series in the order they were found
+    int	total_dicoms = 0;
+    for (int i = 0; i < numCandidates && !bCanceled; ++i)
+    {
+        if (1 == states[i] && new_series->addDicomFile(candidates[i].first, candidates[i].second, infos[i]))
+        {
+            total_dicoms++;
+        }
+    }
+
+    if (bUseIndex && !bCanceled)
+    {
+        index.save();
+    }
+
+    VPL_LOG_INFO("Dicom scan: " << numCandidates << " files, " << numIndexed << " indexed, " << toRead.size() << " read, "
+                 << total_dicoms << " dicoms, "
+                 << std::chrono::duration<double>(std::chrono::steady_clock::now() - scanStart).count() << " s");
+
     // Finish the progress
     endProgress();
 
@@ -211,6 +291,90 @@ CSeries * CDicomLoader::preLoadDirectory( const vpl::sys::tString & path )
     }
 }
 
+//==============================================================================================
+bool CDicomLoader::readFileInfos(const tFileList& files, const std::vector<int>& toRead, std::vector<SDicomFileInfo>& infos, std::vector<char>& states)
+{
+    // Headers are read concurrently, in batches so that progress
+    // and cancellation are handled on the calling thread
+#ifdef _OPENMP
+    const int batchSize = vpl::math::getMax(1, 16 * omp_get_max_threads());
+#else
+    const int batchSize = 16;
+#endif
+    for (int batchStart = 0; batchStart < int(toRead.size()); batchStart += batchSize)
+    {
+        const int batchCount = vpl::math::getMin(batchSize, int(toRead.size()) - batchStart);
+
+        #pragma omp parallel for schedule(dynamic)
+        for (int b = 0; b < batchCount; ++b)
+        {
+            const int i = toRead[batchStart + b];
+            states[i] = CSeries::readDicomFileInfo(files[i].first, files[i].second, infos[i]) ? 1 : 2;
+        }
+
+        if (!this->progress())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//==============================================================================================
+CSeries * CDicomLoader::preLoadMemoryFiles( const vpl::sys::tString & dir )
+{
+    const CDicomMemoryFiles *pFiles = CDicomMemoryFiles::find(dir);
+    if (NULL == pFiles)
+    {
+        return NULL;
+    }
+
+    // Initialize the progress
+    setProgressMax(0);
+    beginProgress();
+
+    std::chrono::steady_clock::time_point scanStart = std::chrono::steady_clock::now();
+
+    // Every file is a candidate, names of memory files are plain ascii
+    const int numFiles = pFiles->getNumOfFiles();
+    tFileList files(numFiles);
+    std::vector<int> toRead(numFiles);
+    for (int i = 0; i < numFiles; ++i)
+    {
+        files[i] = std::make_pair(dir, vpl::sys::tStringConv::fromUtf8(pFiles->getFileName(i)));
+        toRead[i] = i;
+    }
+
+    std::vector<SDicomFileInfo> infos(numFiles);
+    std::vector<char> states(numFiles, 0);
+    const bool bCanceled = !readFileInfos(files, toRead, infos, states);
+
+    CSeries::tSmartPtr new_series;
+    int total_dicoms = 0;
+    for (int i = 0; i < numFiles && !bCanceled; ++i)
+    {
+        if (1 == states[i] && new_series->addDicomFile(files[i].first, files[i].second, infos[i]))
+        {
+            total_dicoms++;
+        }
+    }
+
+    VPL_LOG_INFO("Dicom memory scan: " << numFiles << " files, " << total_dicoms << " dicoms, "
+                 << std::chrono::duration<double>(std::chrono::steady_clock::now() - scanStart).count() << " s");
+
+    // Finish the progress
+    endProgress();
+
+    if ( !bCanceled && new_series->getNumSeries() > 0 )
+    {
+        return new_series.release();
+    }
+    else
+    {
+        return NULL;
+    }
+}
+
 //==============================================================================================
 CSeries * CDicomLoader::preLoadFile( const vpl::sys::tString & path )
 {
@@ -262,6 +426,12 @@ CSeries * CDicomLoader::preLoadFile( const vpl::sys::tString & path )
     }
 }
 
+//==============================================================================================
+void CDicomLoader::setIndexCacheDirectory(const vpl::sys::tString& dir)
+{
+    m_sIndexCacheDir = dir;
+}
+
 //==============================================================================================
 void CDicomLoader::allowNoExtension(bool bValue)
 {
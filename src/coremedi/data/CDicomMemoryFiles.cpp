@@ -0,0 +1,150 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <data/CDicomMemoryFiles.h>
+
+#include <VPL/System/Mutex.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace data
+{
+
+namespace
+{
+    //! Prefix of virtual directories, can't clash with a real path.
+    const char MEMORY_DIR_PREFIX[] = "memory:";
+
+    //! Registered file sets.
+    typedef std::map<vpl::sys::tString, const CDicomMemoryFiles *> tRegistry;
+
+    tRegistry& getRegistry()
+    {
+        static tRegistry registry;
+        return registry;
+    }
+
+    vpl::sys::CMutex& getRegistryMutex()
+    {
+        static vpl::sys::CMutex mutex;
+        return mutex;
+    }
+}
+
+//==============================================================================================
+CDicomMemoryFiles::CDicomMemoryFiles()
+{
+    static unsigned int counter = 0;
+
+    getRegistryMutex().lock();
+    char name[32];
+    sprintf(name, "%s%u", MEMORY_DIR_PREFIX, ++counter);
+    m_sDirectory = vpl::sys::tStringConv::fromUtf8(name);
+    getRegistry()[m_sDirectory] = this;
+    getRegistryMutex().unlock();
+}
+
+//==============================================================================================
+CDicomMemoryFiles::~CDicomMemoryFiles()
+{
+    getRegistryMutex().lock();
+    getRegistry().erase(m_sDirectory);
+    getRegistryMutex().unlock();
+}
+
+//==============================================================================================
+std::string CDicomMemoryFiles::addFile(tBuffer& data)
+{
+    m_Files.push_back(tBuffer());
+    m_Files.back().swap(data);
+    return getFileName(int(m_Files.size()) - 1);
+}
+
+//==============================================================================================
+std::string CDicomMemoryFiles::getFileName(int i) const
+{
+    // Plain ascii names survive any conversion done by the series
+    char name[32];
+    sprintf(name, "%06d.dcm", i);
+    return name;
+}
+
+//==============================================================================================
+int CDicomMemoryFiles::getFileIndex(const std::string& filename)
+{
+    // Accept a path too, only the name matters
+    std::string::size_type start = filename.find_last_of("/\\");
+    start = (std::string::npos == start) ? 0 : start + 1;
+    const char *begin = filename.c_str() + start;
+    char *end = NULL;
+    const long index = strtol(begin, &end, 10);
+    if (end == begin || 0 != strcmp(end, ".dcm"))
+    {
+        return -1;
+    }
+    return int(index);
+}
+
+//==============================================================================================
+bool CDicomMemoryFiles::isMemoryDirectory(const vpl::sys::tString& dir)
+{
+    return NULL != find(dir);
+}
+
+//==============================================================================================
+const CDicomMemoryFiles *CDicomMemoryFiles::find(const vpl::sys::tString& dir)
+{
+    // Cheap test first, most lookups are done for files on disk
+    const size_t prefixLength = sizeof(MEMORY_DIR_PREFIX) - 1;
+    if (dir.size() <= prefixLength || dir.compare(0, prefixLength, vpl::sys::tStringConv::fromUtf8(MEMORY_DIR_PREFIX)) != 0)
+    {
+        return NULL;
+    }
+
+    getRegistryMutex().lock();
+    tRegistry::const_iterator it = getRegistry().find(dir);
+    const CDicomMemoryFiles *pFiles = (it != getRegistry().end()) ? it->second : NULL;
+    getRegistryMutex().unlock();
+    return pFiles;
+}
+
+//==============================================================================================
+bool CDicomMemoryFiles::findFile(const vpl::sys::tString& dir, const std::string& filename, const char *& data, size_t& size)
+{
+    const CDicomMemoryFiles *pFiles = find(dir);
+    if (NULL == pFiles)
+    {
+        return false;
+    }
+    const int index = getFileIndex(filename);
+    if (index < 0 || index >= pFiles->getNumOfFiles() || pFiles->m_Files[index].empty())
+    {
+        return false;
+    }
+    data = &pFiles->m_Files[index][0];
+    size = pFiles->m_Files[index].size();
+    return true;
+}
+
+} // namespace data
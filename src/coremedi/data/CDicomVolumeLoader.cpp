@@ -0,0 +1,946 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <data/CDicomVolumeLoader.h>
+#include <data/CSeries.h>
+
+#include <VPL/Base/Logging.h>
+#include <VPL/Math/StaticVector.h>
+#include <VPL/Math/MatrixFunctions.h>
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <map>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace data
+{
+
+///////////////////////////////////////////////////////////////////////////////
+//! Functor that compares position of two slices.
+
+struct SCompareImagePosition
+{
+    //! Compares the position of two images.
+    bool operator()(const vpl::img::CDicomSlicePtr& p1, const vpl::img::CDicomSlicePtr& p2)
+    {
+        return p1->getPosition() < p2->getPosition();
+    }
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+CDicomVolumeLoader::CDicomVolumeLoader()
+    : m_bStreaming(true)
+    , m_bCompatibilityMode(false)
+    , m_sizeMultiple(1)
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Version 4
+// - inverse projection to the orthogonal volume
+// - added support for multi-frame dicom files
+
+bool CDicomVolumeLoader::load(CSerieInfo *serie,
+    sExtendedTags& tags,
+    vpl::mod::CProgress::tProgressFunc& Progress,
+    CDensityData& Data,
+    vpl::img::CDicomSlice& RepSlice
+    )
+{
+    // Get number of dicom files to load
+    int total_dicom_files = serie->getNumOfDicomFiles();
+
+    if (total_dicom_files <= 0)
+    {
+        return false;
+    }
+
+    // Get number of slices to load
+    int total_dicom_slices = serie->getNumOfSlices();
+
+    // No dicom files
+    if (total_dicom_slices <= 0)
+    {
+        return false;
+    }
+
+    // PRELOAD A REPRESENTATIVE SLICE
+
+    // Preload one of the slices
+    if (!serie->loadDicomFile(total_dicom_files / 2, RepSlice, tags))
+    {
+        return false;
+    }
+
+    // Remember both the X and the Y axis
+    vpl::img::CVector3D XAxis(RepSlice.m_ImageOrientationX);
+    vpl::img::CVector3D YAxis(RepSlice.m_ImageOrientationY);
+
+    // Calculate the Z axis (normal to the image plane)
+    vpl::img::CVector3D ZAxis;
+    ZAxis.vectorProduct(XAxis, YAxis);
+
+    // Normalize all vectors
+    XAxis.normalize();
+    YAxis.normalize();
+    ZAxis.normalize();
+
+    VPL_LOG_INFO("Axis  " << XAxis.getX() << "," << XAxis.getY() << "," << XAxis.getZ() << "  " << YAxis.getX() << "," << YAxis.getY() << "," << YAxis.getZ() << "  " << ZAxis.getX() << "," << ZAxis.getY() << "," << ZAxis.getZ());    
+    VPL_LOG_INFO("Slices " << total_dicom_slices);
+
+    // PRELOAD ALL SLICES
+
+    // Loaded dicom images
+    typedef std::deque<vpl::img::CDicomSlicePtr> tSliceQueue;
+    tSliceQueue slices;
+
+    // In the streaming mode only headers are read now and the image data of each file
+    // are decoded later directly into their final planes of the volume, so that the
+    // whole series is never held in memory twice. File and frame index of every slice
+    // is remembered for that purpose.
+    const bool bStreaming = m_bStreaming;
+    typedef std::map<const vpl::img::CDicomSlice *, std::pair<int, int> > tSliceOrigins;
+    tSliceOrigins sliceOrigins;
+
+    // Preload all slices
+    int counterMax = 2 * total_dicom_slices + 1;
+    int counter = 0;
+    int failures = 0;
+
+    // Files are decoded concurrently in batches of limited size, so that the number
+    // of slices held in memory is bounded and progress is reported (and cancellation
+    // checked) on the calling thread between batches. Decoded frames are then
+    // validated in the original file order.
+#ifdef _OPENMP
+    const int batchSize = vpl::math::getMax(1, 4 * omp_get_max_threads());
+#else
+    const int batchSize = 1;
+#endif
+    std::vector<tDicomSlices> batch(batchSize);
+    std::vector<sExtendedTags> batchTags(batchSize, tags);
+    data::CSerieInfo::prepareParallelLoading();
+    for (int batchStart = 0; batchStart < total_dicom_files; batchStart += batchSize)
+    {
+        const int batchCount = vpl::math::getMin(batchSize, total_dicom_files - batchStart);
+        std::atomic<bool> batchFailed(false);
+
+        // Load dicom files including the image data
+        #pragma omp parallel for schedule(dynamic)
+        for (int b = 0; b < batchCount; ++b)
+        {
+            if (batchFailed)
+            {
+                continue;
+            }
+            batch[b].clear();
+            if (!serie->loadDicomFile(batchStart + b, batch[b], batchTags[b], !bStreaming, m_bCompatibilityMode))
+            {
+                batchFailed = true;
+            }
+        }
+        if (batchFailed)
+        {
+            return false;
+        }
+
+        // Tags of the last loaded file are reported, as with sequential loading
+        tags = batchTags[batchCount - 1];
+
+        for (int b = 0; b < batchCount; ++b)
+        {
+            tDicomSlices &aux = batch[b];
+
+            // Process all frames
+            tDicomSlices::iterator it = aux.begin();
+            tDicomSlices::iterator itEnd = aux.end();
+            for (; it != itEnd; ++it, ++counter)
+            {
+                vpl::img::CDicomSlicePtr pSlice(*it);
+
+                // Normalize the image orientation
+                pSlice->m_ImageOrientationX.normalize();
+                pSlice->m_ImageOrientationY.normalize();
+
+                // Verify the image orientation
+                if ((vpl::img::CVector3D::dotProduct(XAxis, pSlice->m_ImageOrientationX) < 0.999999) || (vpl::img::CVector3D::dotProduct(YAxis, pSlice->m_ImageOrientationY) < 0.999999))
+                    //if (!(XAxis == pSlice->m_ImageOrientationX) || !(YAxis == pSlice->m_ImageOrientationY))
+                {
+                    ++failures;
+                    VPL_LOG_INFO("Warning: Differently oriented slice was found");
+                    continue;
+                }
+
+                // Vector from the origin to the slice position
+                vpl::img::CVector3D PositionVector(vpl::img::CPoint3D(0, 0, 0), pSlice->m_ImagePosition);
+
+                // Calculate the projection
+                double dPosition = vpl::img::CVector3D::dotProduct(ZAxis, PositionVector);
+
+                // Set the slice position
+                pSlice->setPosition(dPosition);
+
+                // Store the slice
+                slices.push_back(pSlice);
+                if (bStreaming)
+                {
+                    sliceOrigins[&(*pSlice)] = std::make_pair(batchStart + b, int(it - aux.begin()));
+                }
+
+                // Progress incrementation
+                if (!Progress(counter, counterMax))
+                {
+                    return false;
+                }
+            }
+
+            // Release references held by the batch buffer
+            aux.clear();
+        }
+    }
+
+    // Check the number of wrongly oriented slices
+    int failuresMax = total_dicom_slices / 10;
+    if (failures > failuresMax)
+    {
+        VPL_LOG_INFO("Warning: Cannot load DICOM datasets with varying image orientation");
+        return false;
+    }
+
+	//Correct slice position
+    if (slices.size() > 1)
+    {
+        double difference = vpl::math::getAbs(slices[0]->getPosition() - slices[1]->getPosition());
+        int difSliceNum = slices[0]->m_iSliceNumber - slices[1]->m_iSliceNumber;
+        //Slice position is not valid.
+        //Sometimes slices have the same values in tag Image Position (Patient), in this case  
+        //it's neccessary co compute real slice position from spacing between slices.
+        //Possibly dangerous, if slices are not correctly sorted
+        if (difference == 0.0)
+        {
+            //calculate image position from spacing between slices
+            double dX = slices[1]->getDX();
+            double f1, f2, f3;
+            f1 = f2 = f3 = 0;
+
+            vpl::img::CPoint3D zero_point(0, 0, 0);
+            vpl::img::CVector3D normal_image;
+
+            for (unsigned int i = 0; i < slices.size(); ++i)
+            {
+                f3 += dX;
+                std::vector<double> tmp;
+                tmp.push_back(f1);
+                tmp.push_back(f2);                
+                if (difSliceNum!=0)
+                    tmp.push_back(slices.at(i)->m_iSliceNumber * dX);
+                else
+                    tmp.push_back(f3);
+                
+
+                //set image position 
+                slices.at(i)->m_ImagePosition = vpl::img::CPoint3D(f1, f2, tmp[2]);
+
+                // slice position calculation
+                //Z-axis
+                normal_image.vectorProduct(slices.at(i)->m_ImageOrientationX, slices.at(i)->m_ImageOrientationY);
+                normal_image.normalize();
+
+                vpl::img::CVector3D position_vector(zero_point, slices.at(i)->m_ImagePosition);
+                slices.at(i)->setPosition(normal_image.dotProduct(normal_image, position_vector));
+            }
+        }
+    }
+
+    // RANK SLICES ACCORDING TO THEIR POSITION
+
+    // Create ranking of projected slice positions
+    std::sort(slices.begin(), slices.end(), SCompareImagePosition());
+
+    // Correct the minimal and maximal position
+    // - This is due to the fact that we have observed that dicom datasets may contain
+    //   a wrongly positioned slice sometimes!
+    if (slices.size() > 2)
+    {
+        double d1 = vpl::math::getAbs(slices[0]->getPosition() - slices[1]->getPosition());
+        double d2 = 2.0 * vpl::math::getAbs(slices[1]->getPosition() - slices[2]->getPosition());
+        if (d1 > d2)
+        {
+            ++counter;
+            slices.pop_front();
+            VPL_LOG_INFO("Warning: Wrongly positioned slice was found");
+        }
+    }
+    if (slices.size() > 2)
+    {
+        double d1 = vpl::math::getAbs( slices[slices.size() - 1]->getPosition() - slices[slices.size() - 2]->getPosition() );
+        double d2 = 2.0 * vpl::math::getAbs( slices[slices.size() - 2]->getPosition() - slices[slices.size() - 3]->getPosition() );
+        if( d1 > d2 )
+        {
+            ++counter;
+            slices.pop_back();
+            VPL_LOG_INFO("Warning: Wrongly positioned slice was found");
+        }
+    }
+
+    // Modify the number of slices
+    total_dicom_slices = int(slices.size());
+
+
+    // RECALCULATE THE SLICE THICKNESS
+
+    // Minimal and maximal position (absolute value)
+    double min_position = slices[0]->getPosition();
+    double max_position = slices[slices.size() - 1]->getPosition();
+
+    // Find optimal slice thickness
+    typedef std::vector<double> tRank;
+    double dThickness = RepSlice.getThickness();
+    if (total_dicom_slices > 1)
+    {
+        // Position differences of neighbouring slices
+        tRank DiffRank;
+        for (int j = 0; j < total_dicom_slices - 1; ++j)
+        {
+            double sliceThickness = vpl::math::getAbs(slices[j]->getPosition() - slices[j + 1]->getPosition());
+            if (sliceThickness > 0.0)
+            {
+                DiffRank.push_back(sliceThickness);
+            }
+        }
+
+        if (DiffRank.empty())
+        {
+            return false;
+        }
+
+        // Create ranking
+        std::sort(DiffRank.begin(), DiffRank.end());
+
+        // Choose the optimal thickness as a median value
+        //dThickness = DiffRank[total_dicom_slices / 2 - 1];
+        dThickness = DiffRank[(DiffRank.size() - 1) / 2];
+    }
+
+    // Check the thickness
+    if( dThickness <= 0.0 )
+    {
+        return false;
+    }
+    double dInvThickness = 1.0 / dThickness;
+
+    // Original slice dimensions
+    vpl::tSize orig_size_x = RepSlice.getXSize();
+    vpl::tSize orig_size_y = RepSlice.getYSize();
+
+    // Calculate the number of slices
+    vpl::tSize orig_size_z = vpl::tSize(vpl::math::round2Int((max_position - min_position) * dInvThickness) + 1);
+
+
+    // LOAD THE IMAGE DATA
+
+    // Create temporary loading volume
+    VPL_LOG_INFO("Loading volume " << orig_size_x << "x" << orig_size_y << "x" << orig_size_z);
+
+    vpl::tSize alignedSizeX = orig_size_x + (m_sizeMultiple - orig_size_x % m_sizeMultiple) % m_sizeMultiple;
+    vpl::tSize alignedSizeY = orig_size_y + (m_sizeMultiple - orig_size_y % m_sizeMultiple) % m_sizeMultiple;
+    vpl::tSize alignedSizeZ = orig_size_z + (m_sizeMultiple - orig_size_z % m_sizeMultiple) % m_sizeMultiple;
+    vpl::img::CDensityVolume AuxData(alignedSizeX, alignedSizeY, alignedSizeZ);
+
+    // Create a volume of corresponding size
+    AuxData.fillEntire(vpl::img::CPixelTraits<vpl::img::tDensityPixel>::getPixelMin());
+
+    // Set the voxel size
+    AuxData.setDX(RepSlice.getDX());
+    AuxData.setDY(RepSlice.getDY());
+    AuxData.setDZ(dThickness);
+
+    // Create a set of all possible slice positions
+    typedef std::vector<int> tInserted;
+    int size_p = orig_size_z;
+    tInserted Inserted(size_p, 0);
+
+    if (bStreaming)
+    {
+        // Assign target planes to frames of all files
+        std::vector<std::vector<int> > framePlanes(total_dicom_files);
+        std::vector<int> filesToLoad;
+        for (tSliceQueue::iterator it = slices.begin(); it != slices.end(); ++it)
+        {
+            vpl::img::CDicomSlicePtr pSlice(*it);
+            int slice_position = static_cast<int>((pSlice->getPosition() - min_position) * dInvThickness + 0.5);
+            if (slice_position < 0 || slice_position >= orig_size_z)
+            {
+                continue;
+            }
+
+            if (Inserted[slice_position] == 0)
+            {
+                const std::pair<int, int> &origin = sliceOrigins[&(*pSlice)];
+                std::vector<int> &planes = framePlanes[origin.first];
+                if (planes.empty())
+                {
+                    filesToLoad.push_back(origin.first);
+                }
+                if (int(planes.size()) <= origin.second)
+                {
+                    planes.resize(origin.second + 1, -1);
+                }
+                planes[origin.second] = slice_position;
+                Inserted[slice_position] = 1;
+            }
+            else
+            {
+                VPL_LOG_INFO("Warning: Overlapping slices was detected");
+            }
+        }
+        std::sort(filesToLoad.begin(), filesToLoad.end());
+        counter += int(slices.size()) - int(filesToLoad.size());
+
+        // Decode image data of the files and write them straight into the volume,
+        // every frame goes to a different plane so the batch can be written concurrently
+        for (int batchStart = 0; batchStart < int(filesToLoad.size()); batchStart += batchSize)
+        {
+            const int batchCount = vpl::math::getMin(batchSize, int(filesToLoad.size()) - batchStart);
+            std::atomic<bool> batchFailed(false);
+
+            #pragma omp parallel for schedule(dynamic)
+            for (int b = 0; b < batchCount; ++b)
+            {
+                if (batchFailed)
+                {
+                    continue;
+                }
+                const int file = filesToLoad[batchStart + b];
+                tDicomSlices frames;
+                sExtendedTags frameTags(tags);
+                if (!serie->loadDicomFile(file, frames, frameTags, true, m_bCompatibilityMode))
+                {
+                    batchFailed = true;
+                    continue;
+                }
+
+                const std::vector<int> &planes = framePlanes[file];
+                for (int f = 0; f < int(frames.size()) && f < int(planes.size()); ++f)
+                {
+                    if (planes[f] >= 0)
+                    {
+                        AuxData.setPlaneXY(planes[f], *frames[f]);
+                    }
+                }
+            }
+            if (batchFailed)
+            {
+                return false;
+            }
+
+            // Update the progress bar
+            counter += batchCount;
+            if (!Progress(counter, counterMax))
+            {
+                return false;
+            }
+        }
+    }
+
+    // Insert all slices into the temporary volume
+    tSliceQueue::iterator it = slices.begin();
+    tSliceQueue::iterator itEnd = bStreaming ? slices.begin() : slices.end();
+    for (; it != itEnd; ++it, ++counter)
+    {
+        vpl::img::CDicomSlicePtr pSlice(*it);
+        
+        // Estimate the slice position
+//        int slice_position = static_cast<int>( (pSlice->getPosition() - min_position) * dInvThickness );
+        int slice_position = static_cast<int>((pSlice->getPosition() - min_position) * dInvThickness + 0.5);
+        if (slice_position < 0 || slice_position >= orig_size_z)
+        {
+            continue;
+        }
+
+        // Check if any similar slice was already inserted?
+        if (Inserted[slice_position] == 0)
+        {
+            // Add current slice to the volume
+            AuxData.setPlaneXY(slice_position, *pSlice);
+
+            // Update the set of already loaded slices
+            Inserted[slice_position] = 1;
+
+            // Enforce deallocation of the data
+            pSlice->vpl::img::CDImage::resize(0, 0, 0);
+        }
+        else
+        {
+            VPL_LOG_INFO("Warning: Overlapping slices was detected");
+        }
+
+        // Update the progress bar
+        if (!Progress(counter, counterMax))
+        {
+            return false;
+        }
+    }
+
+
+    // INTERPOLATE MISSING DATA
+    // - This may happen sometimes...
+    
+    // Find leftmost and rightmost correctly imported slice
+    int LeftmostSlice = 0;
+    for (; LeftmostSlice < size_p && Inserted[LeftmostSlice] == 0; ++LeftmostSlice);
+
+    int RightmostSlice = size_p - 1;
+    for (; RightmostSlice >= 0 && Inserted[RightmostSlice] == 0; --RightmostSlice);
+
+    // Is an interpolation possible?
+    if (LeftmostSlice >= RightmostSlice)
+    {
+        VPL_LOG_INFO("Warning: Cannot interpolate missing slices");
+    }
+
+    // Interpolate the missing data
+    int LeftNeighbour = LeftmostSlice;
+    for (int z = LeftmostSlice + 1; z < RightmostSlice; ++z)
+    {
+        if (Inserted[z] != 0)
+        {
+            LeftNeighbour = z;
+            continue;
+        }
+
+        // Find the closest right neighbour
+        int RightNeighbour = z + 1;
+        for (; RightNeighbour < RightmostSlice && Inserted[RightNeighbour] == 0; ++RightNeighbour);
+
+        // Estimate interpolation coeeficients
+        int Distance = RightNeighbour - LeftNeighbour;
+        int DistLeft = z - LeftNeighbour;
+        if (Distance <= 0 || DistLeft <= 0)
+        {
+            continue;
+        }
+        double dInvDistance = 1.0 / Distance;
+        double dRightWeight = DistLeft * dInvDistance;
+        double dLeftWeight = 1.0 - dRightWeight;
+
+        // Interpolate from neighbours
+        for (int y = 0; y < orig_size_y; ++y)
+        {
+            for (int x = 0; x < orig_size_x; ++x)
+            {
+                double dValue = dLeftWeight * AuxData(x, y, LeftNeighbour) + dRightWeight * AuxData(x, y, RightNeighbour);
+                AuxData(x, y, z) = vpl::img::tDensityPixel(dValue);
+            }
+        }
+
+        VPL_LOG_INFO("Warning: Missing slice was interpolated");
+    }
+
+
+    // CHECK IF ANY TRANSFORMATION IS NECESSARY
+
+    // Is the transformation necessary?
+    if (vpl::math::getAbs(1.0 - XAxis.x()) < 0.001
+        && vpl::math::getAbs(1.0 - YAxis.y()) < 0.001
+        && vpl::math::getAbs(1.0 - ZAxis.z()) < 0.001)
+    {
+        // Just a reference to the existing data
+        Data.makeRef(AuxData);
+
+        // Set dicom meta data
+        Data.takeDicomData(RepSlice);
+
+        Data.setImagePosition(RepSlice.m_ImagePosition.getX(), RepSlice.m_ImagePosition.getY(), min_position);
+
+        // Set the voxel size
+        Data.setDX(RepSlice.getDX());
+        Data.setDY(RepSlice.getDY());
+        Data.setDZ(dThickness);
+        
+        return true;
+    }
+
+    VPL_LOG_INFO("Applying transformation");
+
+    // BEGIN - THE TRANSFORMATION
+    {
+        // Calculate the correct Z axis as the difference of position of two neighbouring slices
+        if (total_dicom_slices > 1)
+        {
+            vpl::img::CVector3D NewZAxis(slices[slices.size() / 2 - 1]->m_ImagePosition, slices[slices.size() / 2]->m_ImagePosition);
+            NewZAxis.normalize();
+            if (vpl::img::CVector3D::dotProduct(ZAxis, NewZAxis) < 0)
+            {
+                NewZAxis *= -1;
+            }
+            ZAxis = NewZAxis;
+        }
+
+        // Recalculate position of all slices after projection on the Z axis
+        for (int i = 0; i < total_dicom_slices; ++i)
+        {
+            // Vector from the origin to the slice position
+            vpl::img::CVector3D PositionVector(vpl::img::CPoint3D(0, 0, 0), slices[i]->m_ImagePosition);
+
+            // Calculate the projection
+            double dPosition = vpl::img::CVector3D::dotProduct(ZAxis, PositionVector);
+
+            // Store the position
+            slices[i]->setPosition(dPosition);
+        }
+
+        // Create ranking of projected slice positions
+        std::sort(slices.begin(), slices.end(), SCompareImagePosition());
+
+        // Minimal and maximal position (absolute value)
+        min_position = slices[0]->getPosition();
+        max_position = slices[slices.size() - 1]->getPosition();
+
+        // Find the optimal slice thickness again
+        if (total_dicom_slices > 1)
+        {
+            // Position differences of neighbouring slices
+            tRank DiffRank;
+            for (int j = 0; j < total_dicom_slices - 1; ++j)
+            {
+                double sliceThickness = vpl::math::getAbs(slices[j]->getPosition() - slices[j + 1]->getPosition());
+                if (sliceThickness > 0.0)
+                {
+                    DiffRank.push_back(sliceThickness);
+                }
+            }
+
+            if (DiffRank.empty())
+            {
+                return false;
+            }
+
+            // Create ranking
+            std::sort(DiffRank.begin(), DiffRank.end());
+
+            // Choose the optimal thickness as a median value
+            //dThickness = DiffRank[total_dicom_slices / 2 - 1];
+            dThickness = DiffRank[(DiffRank.size() - 1) / 2];
+        }
+
+        // Check the thickness
+        if (dThickness <= 0.0)
+        {
+            return false;
+        }
+
+        // Delete the loaded slices
+        slices.clear();
+
+        // Create the transformation matrix
+        CDensityData::tMatrix Transform;
+        Transform(0, 0) = XAxis.getX();
+        Transform(0, 1) = XAxis.getY();
+        Transform(0, 2) = XAxis.getZ();
+        Transform(1, 0) = YAxis.getX();
+        Transform(1, 1) = YAxis.getY();
+        Transform(1, 2) = YAxis.getZ();
+        Transform(2, 0) = ZAxis.getX();
+        Transform(2, 1) = ZAxis.getY();
+        Transform(2, 2) = ZAxis.getZ();
+
+        // Helper array of box corners
+        double Corners[8][3] = {
+            { 0, 0, 0 },
+            { 1, 0, 0 },
+            { 1, 1, 0 },
+            { 0, 1, 0 },
+            { 0, 0, 1 },
+            { 1, 0, 1 },
+            { 1, 1, 1 },
+            { 0, 1, 1 }
+        };
+
+        // Transform all corners of the volume and find min/max
+        vpl::math::CDVector3 Temp, OrigSize;
+        OrigSize(0) = (orig_size_x - 1) * Corners[0][0] * RepSlice.getDX();
+        OrigSize(1) = (orig_size_y - 1) * Corners[0][1] * RepSlice.getDY();
+        OrigSize(2) = (orig_size_z - 1) * Corners[0][2] * dThickness;
+        Temp.mult(OrigSize, Transform);
+        double Rminx = Temp(0), Rmaxx = Temp(0);
+        double Rminy = Temp(1), Rmaxy = Temp(1);
+        double Rminz = Temp(2), Rmaxz = Temp(2);
+
+        // All remaining corners
+        for (int i = 1; i < 8; ++i)
+        {
+            OrigSize(0) = (orig_size_x - 1) * Corners[i][0] * RepSlice.getDX();
+            OrigSize(1) = (orig_size_y - 1) * Corners[i][1] * RepSlice.getDY();
+            OrigSize(2) = (orig_size_z - 1) * Corners[i][2] * dThickness;
+            Temp.mult(OrigSize, Transform);
+
+            Rminx = vpl::math::getMin(Rminx, Temp(0));
+            Rminy = vpl::math::getMin(Rminy, Temp(1));
+            Rminz = vpl::math::getMin(Rminz, Temp(2));
+
+            Rmaxx = vpl::math::getMax(Rmaxx, Temp(0));
+            Rmaxy = vpl::math::getMax(Rmaxy, Temp(1));
+            Rmaxz = vpl::math::getMax(Rmaxz, Temp(2));
+        }
+
+        // Calculate the voxel size
+        vpl::math::CDVector3 Voxel;
+        Voxel(0) = Voxel(1) = Voxel(2) = 0;
+
+        // PRVNI VARIANTA - ponechava stejny rozmer voxelu (resi pouze prevraceni, apod.)
+
+        OrigSize(0) = 1;
+        OrigSize(1) = 0;
+        OrigSize(2) = 0;
+        Temp.mult(OrigSize, Transform);
+        if (OrigSize(0) > OrigSize(1))
+        {
+            if (OrigSize(0) > OrigSize(2))
+            {
+                Voxel(0) = RepSlice.getDX();
+            }
+            else
+            {
+                Voxel(2) = RepSlice.getDX();
+            }
+        }
+        else
+        {
+            if (OrigSize(1) > OrigSize(2))
+            {
+                Voxel(1) = RepSlice.getDX();
+            }
+            else
+            {
+                Voxel(2) = RepSlice.getDX();
+            }
+        }
+
+        OrigSize(0) = 0;
+        OrigSize(1) = 1;
+        OrigSize(2) = 0;
+        Temp.mult(OrigSize, Transform);
+        if (OrigSize(0) >= OrigSize(1))
+        {
+            if (OrigSize(0) >= OrigSize(2))
+            {
+                Voxel(0) = RepSlice.getDY();
+            }
+            else
+            {
+                Voxel(2) = RepSlice.getDY();
+            }
+        }
+        else
+        {
+            if (OrigSize(1) >= OrigSize(2))
+            {
+                Voxel(1) = RepSlice.getDY();
+            }
+            else
+            {
+                Voxel(2) = RepSlice.getDY();
+            }
+        }
+
+        OrigSize(0) = 0;
+        OrigSize(1) = 0;
+        OrigSize(2) = 1;
+        Temp.mult(OrigSize, Transform);
+        if (OrigSize(0) >= OrigSize(1))
+        {
+            if (OrigSize(0) > OrigSize(2))
+            {
+                Voxel(0) = dThickness;
+            }
+            else
+            {
+                Voxel(2) = dThickness;
+            }
+        }
+        else
+        {
+            if (OrigSize(1) > OrigSize(2))
+            {
+                Voxel(1) = dThickness;
+            }
+            else
+            {
+                Voxel(2) = dThickness;
+            }
+        }
+
+        // Final volume size
+        vpl::tSize new_size_x = vpl::math::round2Int((Rmaxx - Rminx) / Voxel(0) + 1);
+        vpl::tSize new_size_y = vpl::math::round2Int((Rmaxy - Rminy) / Voxel(1) + 1);
+        vpl::tSize new_size_z = vpl::math::round2Int((Rmaxz - Rminz) / Voxel(2) + 1);
+
+        // TRANSFORM THE VOLUME DATA
+
+        CDensityData::tMatrix InvTransform;
+        InvTransform = Transform;
+        try {
+            inverse(InvTransform);
+        }
+        catch (...)
+        {
+            return false;
+        }
+
+        // Translation vector
+        CDensityData::tVector Shift;
+        Shift(0) = Rminx;
+        Shift(1) = Rminy;
+        Shift(2) = Rminz;
+
+        // Create the final volume
+        Data.resize(new_size_x, new_size_y, new_size_z);
+        Data.fillEntire(vpl::img::CPixelTraits<vpl::img::tDensityPixel>::getPixelMin());
+
+        // Set dicom meta data
+        Data.takeDicomData( RepSlice );
+
+        // Set the voxel size
+        Data.setDX(Voxel(0));
+        Data.setDY(Voxel(1));
+        Data.setDZ(Voxel(2));
+
+        // Normalization against the voxel size
+        vpl::math::CDVector3 Norm;
+        Norm(0) = 1.0 / RepSlice.getDX();
+        Norm(1) = 1.0 / RepSlice.getDY();
+        Norm(2) = 1.0 / dThickness;
+
+        // Inverted number of steps in X and Y axis
+        double dInvSizeX = 1.0 / (new_size_x - 1);
+        double dInvSizeY = 1.0 / (new_size_y - 1);
+
+        // Interpolate the volume data
+        counterMax += Data.getZSize();
+        for (int z = 0; z < Data.getZSize(); ++z, ++counter)
+        {
+            // Four slice corners
+            vpl::math::CDVector3 A, B, C, D;
+            A(0) = 0;
+            A(1) = 0;
+            B(0) = A(0) + (Data.getXSize() - 1) * Data.getDX();
+            B(1) = A(1);
+            C(0) = A(0) + (Data.getXSize() - 1) * Data.getDX();
+            C(1) = A(1) + (Data.getYSize() - 1) * Data.getDY();
+            D(0) = A(0);
+            D(1) = A(1) + (Data.getYSize() - 1) * Data.getDY();
+            A(2) = B(2) = C(2) = D(2) = z * Data.getDZ();
+
+            // Shift all corners
+            A += Shift;
+            B += Shift;
+            C += Shift;
+            D += Shift;
+
+            // Use the inverse transformation matrix to calculate original positions of all corners
+            vpl::math::CDVector3 a, b, c, d;
+            a.mult(A, InvTransform);
+            b.mult(B, InvTransform);
+            c.mult(C, InvTransform);
+            d.mult(D, InvTransform);
+
+            // Normalization against the original voxel size
+            a *= Norm;
+            b *= Norm;
+            c *= Norm;
+            d *= Norm;
+
+            // Calculate steps in Y axis
+            vpl::img::CVector3D step_ad, step_bc;
+            step_ad.x() = (d(0) - a(0)) * dInvSizeY;
+            step_ad.y() = (d(1) - a(1)) * dInvSizeY;
+            step_ad.z() = (d(2) - a(2)) * dInvSizeY;
+            step_bc.x() = (c(0) - b(0)) * dInvSizeY;
+            step_bc.y() = (c(1) - b(1)) * dInvSizeY;
+            step_bc.z() = (c(2) - b(2)) * dInvSizeY;
+
+            // Starting points
+            vpl::img::CPoint3D ad(a(0), a(1), a(2));
+            vpl::img::CPoint3D bc(b(0), b(1), b(2));
+
+            // Add slice to the volume
+            for (int j = 0; j < Data.getYSize(); ++j)
+            {
+                // Calculate step in the X axis
+                vpl::img::CVector3D step_adbc;
+                step_adbc.x() = (bc.x() - ad.x()) * dInvSizeX;
+                step_adbc.y() = (bc.y() - ad.y()) * dInvSizeX;
+                step_adbc.z() = (bc.z() - ad.z()) * dInvSizeX;
+
+                // Initial point
+                vpl::img::CPoint3D adbc(ad);
+
+                // Get pointer to first voxel of actual row
+                vpl::tSize dst_index=Data.getIdx(0,j,z);
+
+                // Actual row voxels cycle
+                for (int i = 0; i < Data.getXSize(); ++i, dst_index += Data.getXOffset())
+                {
+                    if (AuxData.checkPosition(int(adbc.x()), int(adbc.y()), int(adbc.z())))
+                    {
+                        // Source voxel value
+                        Data.set(dst_index,AuxData.interpolate(adbc));
+                    }
+
+                    // Increment the position
+                    adbc += step_adbc;
+                }
+
+                // Increment the position
+                ad += step_ad;
+                bc += step_bc;
+            }
+
+            // Update the progress bar
+            if (!Progress(counter, counterMax))
+            {
+                return false;
+            }
+        }
+
+        // Destroy the temporary volume
+        AuxData.resize(0, 0, 0, 0);
+    }
+    // END - THE TRANSFORMATION
+
+    return true;
+}
+
+} // namespace data
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
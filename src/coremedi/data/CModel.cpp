@@ -114,6 +114,7 @@ void data::CModel::init()
     m_locked = false;
     m_bExamined = false;
     m_mesh_dirty = true;
+    m_slicer.clear();
     m_Color = CColor4f(1.0, 1.0, 1.0, 1.0);
     m_emission = geometry::Vec3(0.0, 0.0, 0.0);
     m_textures.clear();
@@ -77,6 +77,21 @@ void CModelCut::clear()
     m_indices->clear();
 }
 
+//
+void CModelCut::cutByAxis(data::CModel &model, geometry::CMesh *mesh, int axis, float planePosition)
+{
+    if (NULL == mesh)
+    {
+        return;
+    }
+
+    // the index is rebuilt only when the model changes, slice moves reuse it,
+    // all three cuts share it, the model entry stays locked while it is used
+    geometry::CMeshSlicer &slicer = model.getSlicer();
+    slicer.update(*mesh, APP_STORAGE.getEntry(m_modelId).get()->getLatestVersion());
+    slicer.cut(axis, planePosition, m_vertices, m_indices);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //
 void CModelCutSliceXY::update(const CChangedEntries &changedEntries)
@@ -120,7 +135,7 @@ void CModelCutSliceXY::update(const CChangedEntries &changedEntries)
     m_transformMatrix = matrix;
     if (matrix.isIdentity())
     {
-        geometry::CMesh::cutByZPlane(mesh, m_vertices, m_indices, planePosition);
+        cutByAxis(*spModel, mesh, 2, planePosition);
     }
     else
     {
@@ -173,7 +188,7 @@ void CModelCutSliceXZ::update(const CChangedEntries &changedEntries)
     m_transformMatrix = matrix;
     if (matrix.isIdentity())
     {
-        geometry::CMesh::cutByYPlane(mesh, m_vertices, m_indices, planePosition);
+        cutByAxis(*spModel, mesh, 1, planePosition);
     }
     else
     {
@@ -226,7 +241,7 @@ void CModelCutSliceYZ::update(const CChangedEntries &changedEntries)
     m_transformMatrix = matrix;
     if (matrix.isIdentity())
     {
-        geometry::CMesh::cutByXPlane(mesh, m_vertices, m_indices, planePosition);
+        cutByAxis(*spModel, mesh, 0, planePosition);
     }
     else
     {
@@ -41,9 +41,11 @@ CMultiClassRegionData::CMultiClassRegionData()
     : CBitVolume<tRegionVoxel>(1, 1, 1, DEFAULT_MARGIN )
     , m_bColoringEnabled(false)
     , m_sizeMutex(false)
-    , m_volumeUndo(NULL, data::Storage::MultiClassRegionData::Id, true)
+    , m_volumeUndo(this)
+    , m_lastStamp(0)
 {
-	m_volumeUndo.setVolumePtr( this );
+	// region data are mostly empty, so unmodified bricks are shared between snapshots
+	m_volumeUndo.enableBrickSnapshots( true );
 }
 
 
@@ -53,8 +55,11 @@ CMultiClassRegionData::CMultiClassRegionData(const CMultiClassRegionData& Data)
     : CBitVolume<tRegionVoxel>(Data)
     , m_sizeMutex(false)
     , m_bColoringEnabled(Data.m_bColoringEnabled)
+    , m_volumeUndo(this)
+    , m_planeStamps(Data.m_planeStamps)
+    , m_lastStamp(Data.m_lastStamp)
 {
-	m_volumeUndo.setVolumePtr( this );
+	m_volumeUndo.enableBrickSnapshots( true );
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -94,6 +99,14 @@ bool CMultiClassRegionData::checkDependency(CStorageEntry *pParent)
 
 void CMultiClassRegionData::update(const CChangedEntries& Changes)
 {
+    // Changes not limited to marked planes may affect any brick of the next snapshot
+    CChangedEntries::tFilter filter;
+    filter.insert(Storage::MultiClassRegionData::Id);
+    if (Changes.hasChanged(Storage::MultiClassRegionData::Id) && !Changes.checkFlagAll(PLANES_MODIFIED, filter))
+    {
+        m_volumeUndo.markModified();
+    }
+
     if (Changes.checkFlagAny(data::Storage::STORAGE_RESET))
     {
         init();
@@ -156,12 +169,75 @@ CMultiClassRegionData& CMultiClassRegionData::resizeSafe(vpl::tSize xSize, vpl::
 {
     m_sizeMutex.lock();
     resize(xSize, ySize, zSize, margin);
+    m_planeStamps.clear();
     m_sizeMutex.unlock();
 
     return *this;
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CMultiClassRegionData::markModifiedPlanes(vpl::tSize zMin, vpl::tSize zMax)
+{
+    stampPlanes(zMin, zMax);
+    m_volumeUndo.markModified(zMin, zMax);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CMultiClassRegionData::stampPlanes(vpl::tSize zMin, vpl::tSize zMax)
+{
+    if (vpl::tSize(m_planeStamps.size()) != getZSize())
+    {
+        m_planeStamps.assign(getZSize(), 0);
+    }
+
+    zMin = vpl::math::getMax<vpl::tSize>(zMin, 0);
+    zMax = vpl::math::getMin<vpl::tSize>(zMax, getZSize() - 1);
+
+    ++m_lastStamp;
+    for (vpl::tSize z = zMin; z <= zMax; ++z)
+    {
+        m_planeStamps[z] = m_lastStamp;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+CMultiClassRegionData::CRegionUndo::CRegionUndo(CMultiClassRegionData *pData)
+    : tVolumeUndo(pData, data::Storage::MultiClassRegionData::Id, true)
+    , m_pData(pData)
+{
+}
+
+void CMultiClassRegionData::CRegionUndo::restore(CSnapshot *snapshot)
+{
+    tVolumeUndo::restore(snapshot);
+
+    // Plane XY snapshots restore a single plane, other ones may change any plane
+    tSnapshotXY *sxy = dynamic_cast<tSnapshotXY *>(snapshot);
+    if (sxy)
+    {
+        m_pData->markModifiedPlanes(sxy->getPosition(), sxy->getPosition());
+    }
+    else if (dynamic_cast<tBrickSnapshot *>(snapshot))
+    {
+        // Brick snapshots leave the undo reference equal to the volume
+        m_pData->stampPlanes(0, m_pData->getZSize() - 1);
+    }
+    else
+    {
+        m_pData->markModifiedPlanes(0, m_pData->getZSize() - 1);
+    }
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 //
 
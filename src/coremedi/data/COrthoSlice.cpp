@@ -30,6 +30,7 @@
 #include <data/CRegionData.h>
 #include <data/CMultiClassRegionData.h>
 #include <data/CVolumeOfInterestData.h>
+#include <alg/CVolumeProjection.h>
 
 namespace data
 {
@@ -49,6 +50,9 @@ void COrthoSlice::init()
 {
     CSlice::init();
 
+    m_Cache.clear();
+    m_ProjectedFirst = m_ProjectedLast = -1;
+
     m_Position = CSlice::INIT_SIZE / 2;
     m_Mode = DEFAULT_MODE;
 }
@@ -56,6 +60,24 @@ void COrthoSlice::init()
 ///////////////////////////////////////////////////////////////////////////////
 //
 
+void COrthoSlice::getSlab(const CDensityData& Volume, int Axis, int& First, int& Last) const
+{
+    CVolumeProjection::getSlab(Volume, Axis, m_Position, m_SlabThickness, First, Last);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool COrthoSlice::isSlabChanged(const CDensityData& Volume, int Axis) const
+{
+    int First, Last;
+    getSlab(Volume, Axis, First, Last);
+    return (First != m_ProjectedFirst || Last != m_ProjectedLast);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
 void COrthoSliceXY::update(const CChangedEntries& Changes)
 {
     if (!m_updateEnabled)
@@ -120,7 +142,7 @@ void COrthoSliceXY::update(const CChangedEntries& Changes)
     // Check the imaging mode
     if( m_Mode == MODE_MIP )
     {
-        if( bDataChanged || Changes.checkFlagAny(MODE_CHANGED) )
+        if( bDataChanged || Changes.checkFlagAny(MODE_CHANGED) || isSlabChanged(*spVolume, CVolumeProjection::AXIS_Z))
         {
             updateMIP(*spVolume);
         }
@@ -128,7 +150,7 @@ void COrthoSliceXY::update(const CChangedEntries& Changes)
     }
     else if( m_Mode == MODE_RTG )
     {
-        if (bDataChanged || Changes.checkFlagAny(MODE_CHANGED) || bRTGDensityWindowChanged )
+        if (bDataChanged || Changes.checkFlagAny(MODE_CHANGED) || bRTGDensityWindowChanged || isSlabChanged(*spVolume, CVolumeProjection::AXIS_Z))
         {
             updateRTG(*spVolume);
         }
@@ -138,80 +160,25 @@ void COrthoSliceXY::update(const CChangedEntries& Changes)
     // Has the size changed?
     bool bSizeChanged = (m_DensityData.getXSize() != XSize || m_DensityData.getYSize() != YSize);
 
-    // Get the density data
-    m_DensityData.resize(XSize, YSize);
-    if( !spVolume->getPlaneXY(m_Position, m_DensityData) )
-    {
-        return;
-    }
+    // Number of slice positions
+    vpl::tSize NumPositions = spVolume->getZSize();
 
     // Unlock the density data
     spVolume.release();
 
-    // Check if region coloring is enabled
-//    if( APP_STORAGE.isEntryValid(Storage::RegionData::Id) )
-    if( APP_STORAGE.isEntryValid(Storage::RegionData::Id) && VPL_SIGNAL(SigIsRegionColoringEnabled).invoke2() )
-    {
-        // Get the segmented data
-        CObjectPtr<CRegionData> spRegionVolume( APP_STORAGE.getEntry(Storage::RegionData::Id) );
-
-        if (spRegionVolume->hasData())
-        {
-            if (spRegionVolume->getXSize() == XSize && spRegionVolume->getYSize() == YSize)
-            {
-                m_RegionData.resize(XSize, YSize);
-                if (!spRegionVolume->getPlaneXY(m_Position, m_RegionData))
-                {
-                    return;
-                }
-            }
-            else
-            {
-                if (m_RegionData.width() != 0 || m_RegionData.height() != 0)
-                    m_RegionData.resize(0, 0);
-            }
-        }
+    // The plane replaces any projection
+    m_ProjectedFirst = m_ProjectedLast = -1;
 
-        // Unlock the region data
-        spRegionVolume.release();
-    }
-    else
+    // Take the planes prefetched while scrolling, extract them otherwise
+    COrthoSliceCache::SSource Source(COrthoSliceCache::getSource(datasetId));
+    if (!m_Cache.get(m_Position, Source, m_DensityData, m_RegionData, m_multiClassRegionData)
+        && !COrthoSliceCache::extract(m_Plane, m_Position, Source, m_DensityData, m_RegionData, m_multiClassRegionData))
     {
-        if (m_RegionData.width()!=0 || m_RegionData.height()!=0)
-            m_RegionData.resize(0, 0);
+        return;
     }
 
-    // Check if region coloring is enabled
-    if (APP_STORAGE.isEntryValid(Storage::MultiClassRegionData::Id) && VPL_SIGNAL(SigIsMultiClassRegionColoringEnabled).invoke2())
-    {
-        // Get the segmented data
-        CObjectPtr<CMultiClassRegionData> spRegionVolume(APP_STORAGE.getEntry(Storage::MultiClassRegionData::Id));
-
-        if (spRegionVolume->hasData())
-        {
-            if (spRegionVolume->getXSize() == XSize && spRegionVolume->getYSize() == YSize)
-            {
-                m_multiClassRegionData.resize(XSize, YSize);
-                if (!spRegionVolume->getPlaneXY(m_Position, m_multiClassRegionData))
-                {
-                    return;
-                }
-            }
-            else
-            {
-                if (m_multiClassRegionData.width() != 0 || m_multiClassRegionData.height() != 0)
-                    m_multiClassRegionData.resize(0, 0);
-            }
-        }
-
-        // Unlock the region data
-        spRegionVolume.release();
-    }
-    else
-    {
-        if (m_multiClassRegionData.width() != 0 || m_multiClassRegionData.height() != 0)
-            m_multiClassRegionData.resize(0, 0);
-    }
+    // Extract the next planes in the scroll direction
+    m_Cache.prefetch(m_Position, NumPositions, Source);
 
     CSlicePropertyContainer::tPropertyList propertyList = m_properties.propertyList();
     for (CSlicePropertyContainer::tPropertyList::iterator it = propertyList.begin(); it != propertyList.end(); ++it)
@@ -245,19 +212,9 @@ void COrthoSliceXY::updateMIP(const CDensityData& Volume)
     m_RegionData.resize(0, 0);
     m_multiClassRegionData.resize(0, 0);
 
-    // MIP
-    for( vpl::tSize j = 0; j < Volume.getYSize(); ++j )
-    {
-        for( vpl::tSize i = 0; i < Volume.getXSize(); ++i )
-        {
-            vpl::img::tDensityPixel Max = Volume(i,j,0);
-            for( vpl::tSize k = 1; k < Volume.getZSize(); ++k )
-            {
-                Max = (Volume(i,j,k) > Max) ? Volume(i,j,k) : Max;
-            }
-            m_DensityData(i,j) = Max;
-        }
-    }
+    // MIP of the slab around the current position
+    getSlab(Volume, CVolumeProjection::AXIS_Z, m_ProjectedFirst, m_ProjectedLast);
+    CVolumeProjection::maximum(Volume, CVolumeProjection::AXIS_Z, m_ProjectedFirst, m_ProjectedLast, m_DensityData);
 
     // Update rgba data 
 	bSizeChanged = this->updateRGBData2(bSizeChanged);
@@ -290,26 +247,9 @@ void COrthoSliceXY::updateRTG(const CDensityData& Volume)
     m_RegionData.resize(0, 0);
     m_multiClassRegionData.resize(0, 0);
 
-    // RTG
-#pragma omp parallel for
-    for( vpl::tSize j = 0; j < Volume.getYSize(); ++j )
-    {
-        for( vpl::tSize i = 0; i < Volume.getXSize(); ++i )
-        {
-            double dSum = 0.0;
-            unsigned int samples = 0;
-            for( vpl::tSize k = 0; k < Volume.getZSize(); ++k )
-            {
-                vpl::img::tDensityPixel voxel = Volume(i,j,k);
-                if (voxel >= -1000)
-                {
-                    dSum += voxel;
-                    samples++;
-                }
-            }
-            m_DensityData(i,j) = vpl::img::tDensityPixel(samples == 0 ? vpl::img::CPixelTraits<vpl::img::tDensityPixel>::getPixelMin() : dSum / samples);
-        }
-    }
+    // RTG of the slab around the current position
+    getSlab(Volume, CVolumeProjection::AXIS_Z, m_ProjectedFirst, m_ProjectedLast);
+    CVolumeProjection::average(Volume, CVolumeProjection::AXIS_Z, m_ProjectedFirst, m_ProjectedLast, m_DensityData);
 
     // Recalculate density window if it should be used and was not user-modified.
     if (m_bUseDensityWindow)
@@ -400,7 +340,7 @@ void COrthoSliceXZ::update(const CChangedEntries& Changes)
     // Check the imaging mode
     if( m_Mode == MODE_MIP )
     {
-        if( bDataChanged || Changes.checkFlagAny(MODE_CHANGED) )
+        if( bDataChanged || Changes.checkFlagAny(MODE_CHANGED) || isSlabChanged(*spVolume, CVolumeProjection::AXIS_Y))
         {
             updateMIP(*spVolume);
         }
@@ -408,7 +348,7 @@ void COrthoSliceXZ::update(const CChangedEntries& Changes)
     }
     else if( m_Mode == MODE_RTG )
     {
-        if (bDataChanged || Changes.checkFlagAny(MODE_CHANGED) || bRTGDensityWindowChanged)
+        if (bDataChanged || Changes.checkFlagAny(MODE_CHANGED) || bRTGDensityWindowChanged || isSlabChanged(*spVolume, CVolumeProjection::AXIS_Y))
         {
             updateRTG(*spVolume);
         }
@@ -418,77 +358,25 @@ void COrthoSliceXZ::update(const CChangedEntries& Changes)
     // Has the size changed?
     bool bSizeChanged = (m_DensityData.getXSize() != XSize || m_DensityData.getYSize() != ZSize);
 
-    // Get the density data
-    m_DensityData.resize(XSize, ZSize);
-    if( !spVolume->getPlaneXZ(m_Position, m_DensityData) )
-    {
-        return;
-    }
+    // Number of slice positions
+    vpl::tSize NumPositions = spVolume->getYSize();
 
     // Unlock the density data
     spVolume.release();
 
-    // Check if region coloring is enabled
-//    if( APP_STORAGE.isEntryValid(Storage::RegionData::Id) )
-    if( APP_STORAGE.isEntryValid(Storage::RegionData::Id) && VPL_SIGNAL(SigIsRegionColoringEnabled).invoke2() )
-    {
-        // Get the segmented data
-        CObjectPtr<CRegionData> spRegionVolume( APP_STORAGE.getEntry(Storage::RegionData::Id) );
-
-        if(spRegionVolume->getXSize() == XSize && spRegionVolume->getZSize() == ZSize)
-        {
-            m_RegionData.resize(XSize, ZSize);
-            if( !spRegionVolume->getPlaneXZ(m_Position, m_RegionData) )
-            {
-                return;
-            }
-        }
-        else
-        {
-            if (m_RegionData.width()!=0 || m_RegionData.height()!=0)
-                m_RegionData.resize(0, 0);
-        }
+    // The plane replaces any projection
+    m_ProjectedFirst = m_ProjectedLast = -1;
 
-        // Unlock the region data
-        spRegionVolume.release();
-    }
-    else
+    // Take the planes prefetched while scrolling, extract them otherwise
+    COrthoSliceCache::SSource Source(COrthoSliceCache::getSource(datasetId));
+    if (!m_Cache.get(m_Position, Source, m_DensityData, m_RegionData, m_multiClassRegionData)
+        && !COrthoSliceCache::extract(m_Plane, m_Position, Source, m_DensityData, m_RegionData, m_multiClassRegionData))
     {
-        if (m_RegionData.width()!=0 || m_RegionData.height()!=0)
-            m_RegionData.resize(0, 0);
+        return;
     }
 
-    // Check if region coloring is enabled
-    if (APP_STORAGE.isEntryValid(Storage::MultiClassRegionData::Id) && VPL_SIGNAL(SigIsMultiClassRegionColoringEnabled).invoke2())
-    {
-        // Get the segmented data
-        CObjectPtr<CMultiClassRegionData> spRegionVolume(APP_STORAGE.getEntry(Storage::MultiClassRegionData::Id));
-
-        if (spRegionVolume->hasData())
-        {
-            if (spRegionVolume->getXSize() == XSize && spRegionVolume->getZSize() == ZSize)
-            {
-                m_multiClassRegionData.resize(XSize, ZSize);
-                if (!spRegionVolume->getPlaneXZ(m_Position, m_multiClassRegionData))
-                {
-                    return;
-                }
-            }
-            else
-            {
-                if (m_multiClassRegionData.width() != 0 || m_multiClassRegionData.height() != 0)
-                    m_multiClassRegionData.resize(0, 0);
-            }
-        }
-
-        // Unlock the region data
-        spRegionVolume.release();
-    }
-    else
-    {
-        if (m_multiClassRegionData.width() != 0 || m_multiClassRegionData.height() != 0)
-            m_multiClassRegionData.resize(0, 0);
-    }
+    // Extract the next planes in the scroll direction
+    m_Cache.prefetch(m_Position, NumPositions, Source);
 
     CSlicePropertyContainer::tPropertyList propertyList = m_properties.propertyList();
     for (CSlicePropertyContainer::tPropertyList::iterator it = propertyList.begin(); it != propertyList.end(); ++it)
@@ -522,19 +410,9 @@ void COrthoSliceXZ::updateMIP(const CDensityData& Volume)
     m_RegionData.resize(0, 0);
     m_multiClassRegionData.resize(0, 0);
 
-    // MIP
-    for( vpl::tSize j = 0; j < Volume.getZSize(); ++j )
-    {
-        for( vpl::tSize i = 0; i < Volume.getXSize(); ++i )
-        {
-            vpl::img::tDensityPixel Max = Volume(i,0,j);
-            for( vpl::tSize k = 1; k < Volume.getYSize(); ++k )
-            {
-                Max = (Volume(i,k,j) > Max) ? Volume(i,k,j) : Max;
-            }
-            m_DensityData(i,j) = Max;
-        }
-    }
+    // MIP of the slab around the current position
+    getSlab(Volume, CVolumeProjection::AXIS_Y, m_ProjectedFirst, m_ProjectedLast);
+    CVolumeProjection::maximum(Volume, CVolumeProjection::AXIS_Y, m_ProjectedFirst, m_ProjectedLast, m_DensityData);
 
     // Update RGB data
     bSizeChanged = updateRGBData2(bSizeChanged);
@@ -567,27 +445,9 @@ void COrthoSliceXZ::updateRTG(const CDensityData& Volume)
     m_RegionData.resize(0, 0);
     m_multiClassRegionData.resize(0, 0);
 
-    // RTG
-    // - Use "density window" to fill the RGB image
-#pragma omp parallel for
-    for( vpl::tSize j = 0; j < Volume.getZSize(); ++j )
-    {
-        for( vpl::tSize i = 0; i < Volume.getXSize(); ++i )
-        {
-            double dSum = 0.0;
-            unsigned int samples = 0;
-            for( vpl::tSize k = 0; k < Volume.getYSize(); ++k )
-            {
-                vpl::img::tDensityPixel voxel = Volume(i,k,j);
-                if (voxel >= -1000)
-                {
-                    dSum += voxel;
-                    samples++;
-                }
-            }
-            m_DensityData(i,j) = vpl::img::tDensityPixel(samples == 0 ? vpl::img::CPixelTraits<vpl::img::tDensityPixel>::getPixelMin() : dSum / samples);
-        }
-    }
+    // RTG of the slab around the current position
+    getSlab(Volume, CVolumeProjection::AXIS_Y, m_ProjectedFirst, m_ProjectedLast);
+    CVolumeProjection::average(Volume, CVolumeProjection::AXIS_Y, m_ProjectedFirst, m_ProjectedLast, m_DensityData);
 
     // Recalculate density window if it should be used and was not user-modified.
     if (m_bUseDensityWindow)
@@ -678,7 +538,7 @@ void COrthoSliceYZ::update(const CChangedEntries& Changes)
     // Check the imaging mode
     if( m_Mode == MODE_MIP )
     {
-        if( bDataChanged || Changes.checkFlagAny(MODE_CHANGED) )
+        if( bDataChanged || Changes.checkFlagAny(MODE_CHANGED) || isSlabChanged(*spVolume, CVolumeProjection::AXIS_X))
         {
             updateMIP(*spVolume);
         }
@@ -686,7 +546,7 @@ void COrthoSliceYZ::update(const CChangedEntries& Changes)
     }
     else if( m_Mode == MODE_RTG )
     {
-        if( bDataChanged || Changes.checkFlagAny(MODE_CHANGED) || bRTGDensityWindowChanged )
+        if( bDataChanged || Changes.checkFlagAny(MODE_CHANGED) || bRTGDensityWindowChanged || isSlabChanged(*spVolume, CVolumeProjection::AXIS_X))
         {
             updateRTG(*spVolume);
         }
@@ -696,78 +556,25 @@ void COrthoSliceYZ::update(const CChangedEntries& Changes)
     // Has the size changed?
     bool bSizeChanged = (m_DensityData.getXSize() != YSize || m_DensityData.getYSize() != ZSize);
 
-    // Get the density data
-    m_DensityData.resize(YSize, ZSize);
-    if( !spVolume->getPlaneYZ(m_Position, m_DensityData) )
-    {
-        return;
-    }
+    // Number of slice positions
+    vpl::tSize NumPositions = spVolume->getXSize();
 
     // Unlock the density data
     spVolume.release();
 
-    // Check if region coloring is enabled
-//    if( APP_STORAGE.isEntryValid(Storage::RegionData::Id) )
-    if( APP_STORAGE.isEntryValid(Storage::RegionData::Id) && VPL_SIGNAL(SigIsRegionColoringEnabled).invoke2() )
-    {
-        // Get the segmented data
-        CObjectPtr<CRegionData> spRegionVolume( APP_STORAGE.getEntry(Storage::RegionData::Id) );
+    // The plane replaces any projection
+    m_ProjectedFirst = m_ProjectedLast = -1;
 
-        // Check if region coloring is enabled
-        if(spRegionVolume->getYSize() == YSize && spRegionVolume->getZSize() == ZSize )
-        {
-            m_RegionData.resize(YSize, ZSize);
-            if( !spRegionVolume->getPlaneYZ(m_Position, m_RegionData) )
-            {
-                return;
-            }
-        }
-        else
-        {
-            if (m_RegionData.width()!=0 || m_RegionData.height()!=0)
-                m_RegionData.resize(0, 0);
-        }
-        
-        // Unlock the region data
-        spRegionVolume.release();
-    }
-    else
+    // Take the planes prefetched while scrolling, extract them otherwise
+    COrthoSliceCache::SSource Source(COrthoSliceCache::getSource(datasetId));
+    if (!m_Cache.get(m_Position, Source, m_DensityData, m_RegionData, m_multiClassRegionData)
+        && !COrthoSliceCache::extract(m_Plane, m_Position, Source, m_DensityData, m_RegionData, m_multiClassRegionData))
     {
-        if (m_RegionData.width()!=0 || m_RegionData.height()!=0)
-            m_RegionData.resize(0, 0);
+        return;
     }
 
-    // Check if region coloring is enabled
-    if (APP_STORAGE.isEntryValid(Storage::MultiClassRegionData::Id) && VPL_SIGNAL(SigIsMultiClassRegionColoringEnabled).invoke2())
-    {
-        // Get the segmented data
-        CObjectPtr<CMultiClassRegionData> spRegionVolume(APP_STORAGE.getEntry(Storage::MultiClassRegionData::Id));
-
-        if (spRegionVolume->hasData())
-        {
-            if (spRegionVolume->getYSize() == YSize && spRegionVolume->getZSize() == ZSize)
-            {
-                m_multiClassRegionData.resize(YSize, ZSize);
-                if (!spRegionVolume->getPlaneYZ(m_Position, m_multiClassRegionData))
-                {
-                    return;
-                }
-            }
-            else
-            {
-                if (m_multiClassRegionData.width() != 0 || m_multiClassRegionData.height() != 0)
-                    m_multiClassRegionData.resize(0, 0);
-            }
-        }
-
-        // Unlock the region data
-        spRegionVolume.release();
-    }
-    else
-    {
-        if (m_multiClassRegionData.width() != 0 || m_multiClassRegionData.height() != 0)
-            m_multiClassRegionData.resize(0, 0);
-    }
+    // Extract the next planes in the scroll direction
+    m_Cache.prefetch(m_Position, NumPositions, Source);
 
     CSlicePropertyContainer::tPropertyList propertyList = m_properties.propertyList();
     for (CSlicePropertyContainer::tPropertyList::iterator it = propertyList.begin(); it != propertyList.end(); ++it)
@@ -801,19 +608,9 @@ void COrthoSliceYZ::updateMIP(const CDensityData& Volume)
     m_RegionData.resize(0, 0);
     m_multiClassRegionData.resize(0, 0);
 
-    // MIP
-    for( vpl::tSize j = 0; j < Volume.getZSize(); ++j )
-    {
-        for( vpl::tSize i = 0; i < Volume.getYSize(); ++i )
-        {
-            vpl::img::tDensityPixel Max = Volume(0,i,j);
-            for( vpl::tSize k = 1; k < Volume.getXSize(); ++k )
-            {
-                Max = (Volume(k,i,j) > Max) ? Volume(k,i,j) : Max;
-            }
-            m_DensityData(i,j) = Max;
-        }
-    }
+    // MIP of the slab around the current position
+    getSlab(Volume, CVolumeProjection::AXIS_X, m_ProjectedFirst, m_ProjectedLast);
+    CVolumeProjection::maximum(Volume, CVolumeProjection::AXIS_X, m_ProjectedFirst, m_ProjectedLast, m_DensityData);
 
     // Update RGB data
     bSizeChanged = updateRGBData2(bSizeChanged);
@@ -846,27 +643,9 @@ void COrthoSliceYZ::updateRTG(const CDensityData& Volume)
     m_RegionData.resize(0, 0);
     m_multiClassRegionData.resize(0, 0);
 
-    // RTG
-    // - Use "density window" to fill the RGB image
-#pragma omp parallel for
-    for( vpl::tSize j = 0; j < Volume.getZSize(); ++j )
-    {
-        for( vpl::tSize i = 0; i < Volume.getYSize(); ++i )
-        {
-            double dSum = 0.0;
-            unsigned int samples = 0;
-            for( vpl::tSize k = 0; k < Volume.getXSize(); ++k )
-            {
-                vpl::img::tDensityPixel voxel = Volume(k,i,j);
-                if (voxel >= -1000)
-                {
-                    dSum += voxel;
-                    samples++;
-                }
-            }
-            m_DensityData(i,j) = vpl::img::tDensityPixel(samples == 0 ? vpl::img::CPixelTraits<vpl::img::tDensityPixel>::getPixelMin() : dSum / samples);
-        }
-    }
+    // RTG of the slab around the current position
+    getSlab(Volume, CVolumeProjection::AXIS_X, m_ProjectedFirst, m_ProjectedLast);
+    CVolumeProjection::average(Volume, CVolumeProjection::AXIS_X, m_ProjectedFirst, m_ProjectedLast, m_DensityData);
 
     // Recalculate density window if it should be used and was not user-modified.
     if (m_bUseDensityWindow)
@@ -0,0 +1,496 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// include files
+
+#include <data/COrthoSliceCache.h>
+#include <data/COrthoSlice.h>
+#include <data/CDensityData.h>
+#include <data/CRegionData.h>
+
+#include <coremedi/app/Signals.h>
+
+#include <cstring>
+#include <vector>
+
+
+namespace data
+{
+
+namespace
+{
+
+//! Copies image data, destination is resized to the size of source.
+template <typename T>
+void copyImage(const vpl::img::CImage<T>& Src, vpl::img::CImage<T>& Dst)
+{
+    if (Dst.getXSize() != Src.getXSize() || Dst.getYSize() != Src.getYSize())
+    {
+        Dst.resize(Src.getXSize(), Src.getYSize());
+    }
+    for (vpl::tSize y = 0; y < Src.getYSize(); ++y)
+    {
+        std::memcpy(&Dst(0, y), &Src(0, y), Src.getXSize() * sizeof(T));
+    }
+}
+
+//! Clears the image unless it is already empty.
+template <typename T>
+void clearImage(vpl::img::CImage<T>& Image)
+{
+    if (Image.getXSize() != 0 || Image.getYSize() != 0)
+    {
+        Image.resize(0, 0);
+    }
+}
+
+//! Returns plane size of a volume along a given axis.
+template <class V>
+void getPlaneSize(const V& Volume, int Plane, vpl::tSize& XSize, vpl::tSize& YSize)
+{
+    switch (Plane)
+    {
+    case COrthoSlice::PLANE_XY:
+        XSize = Volume.getXSize();
+        YSize = Volume.getYSize();
+        break;
+
+    case COrthoSlice::PLANE_XZ:
+        XSize = Volume.getXSize();
+        YSize = Volume.getZSize();
+        break;
+
+    default:
+        XSize = Volume.getYSize();
+        YSize = Volume.getZSize();
+        break;
+    }
+}
+
+//! Extracts plane of a volume along a given axis.
+template <class V, typename T>
+bool getPlane(V& Volume, int Plane, int Position, vpl::img::CImage<T>& Image)
+{
+    vpl::tSize XSize, YSize;
+    getPlaneSize(Volume, Plane, XSize, YSize);
+    Image.resize(XSize, YSize);
+
+    switch (Plane)
+    {
+    case COrthoSlice::PLANE_XY:
+        return Volume.getPlaneXY(Position, Image);
+
+    case COrthoSlice::PLANE_XZ:
+        return Volume.getPlaneXZ(Position, Image);
+
+    default:
+        return Volume.getPlaneYZ(Position, Image);
+    }
+}
+
+//! Returns the latest version of a storage entry.
+unsigned getEntryVersion(int Id)
+{
+    return APP_STORAGE.getEntry(Id, Storage::NO_UPDATE).get()->getLatestVersion();
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+COrthoSliceCache::SSource::SSource()
+    : datasetId(-1)
+    , bRegion(false)
+    , bMultiClass(false)
+    , densityVersion(0)
+    , regionVersion(0)
+    , multiClassVersion(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool COrthoSliceCache::SSource::operator==(const SSource& Source) const
+{
+    return datasetId == Source.datasetId
+        && bRegion == Source.bRegion
+        && bMultiClass == Source.bMultiClass
+        && densityVersion == Source.densityVersion
+        && regionVersion == Source.regionVersion
+        && multiClassVersion == Source.multiClassVersion;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+long long COrthoSliceCache::SPlanes::getSize() const
+{
+    return (long long)density.getXSize() * density.getYSize() * sizeof(vpl::img::tDensityPixel)
+        + (long long)region.getXSize() * region.getYSize() * sizeof(vpl::img::tPixel16)
+        + (long long)multiClass.getXSize() * multiClass.getYSize() * sizeof(tRegionVoxel);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+COrthoSliceCache::COrthoSliceCache(int Plane, int Prefetch, long long Budget)
+    : m_Plane(Plane)
+    , m_Prefetch(Prefetch)
+    , m_Budget(Budget)
+    , m_Size(0)
+    , m_Position(-1)
+    , m_Direction(0)
+    , m_NumPositions(0)
+    , m_Request(0)
+    , m_Mutex(false)
+    , m_Thread(prefetchLoop, this, false)
+    , m_bRunning(false)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+COrthoSliceCache::~COrthoSliceCache()
+{
+    m_Thread.terminate(true);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+COrthoSliceCache::SSource COrthoSliceCache::getSource(int DatasetId)
+{
+    SSource Source;
+    Source.datasetId = DatasetId;
+    Source.bRegion = APP_STORAGE.isEntryValid(Storage::RegionData::Id) && VPL_SIGNAL(SigIsRegionColoringEnabled).invoke2();
+    Source.bMultiClass = APP_STORAGE.isEntryValid(Storage::MultiClassRegionData::Id) && VPL_SIGNAL(SigIsMultiClassRegionColoringEnabled).invoke2();
+    return getVersions(Source);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+COrthoSliceCache::SSource COrthoSliceCache::getVersions(const SSource& Source)
+{
+    SSource Result(Source);
+    Result.densityVersion = getEntryVersion(Source.datasetId);
+    Result.regionVersion = Source.bRegion ? getEntryVersion(Storage::RegionData::Id) : 0;
+    Result.multiClassVersion = Source.bMultiClass ? getEntryVersion(Storage::MultiClassRegionData::Id) : 0;
+    return Result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool COrthoSliceCache::extract(int Plane, int Position, const SSource& Source, vpl::img::CDImage& Density, vpl::img::CImage16& Region, vpl::img::CImage<tRegionVoxel>& MultiClass, int Flags)
+{
+    vpl::tSize XSize, YSize;
+    {
+        CObjectPtr<CDensityData> spVolume(APP_STORAGE.getEntry(Source.datasetId, Flags));
+        getPlaneSize(*spVolume, Plane, XSize, YSize);
+        if (!getPlane(*spVolume, Plane, Position, Density))
+        {
+            return false;
+        }
+    }
+
+    // Region planes are used only if they match the density volume
+    bool bRegion = false;
+    if (Source.bRegion)
+    {
+        CObjectPtr<CRegionData> spRegionVolume(APP_STORAGE.getEntry(Storage::RegionData::Id, Flags));
+
+        vpl::tSize RegionXSize, RegionYSize;
+        getPlaneSize(*spRegionVolume, Plane, RegionXSize, RegionYSize);
+        if (spRegionVolume->hasData() && RegionXSize == XSize && RegionYSize == YSize)
+        {
+            if (!getPlane(*spRegionVolume, Plane, Position, Region))
+            {
+                return false;
+            }
+            bRegion = true;
+        }
+    }
+    if (!bRegion)
+    {
+        clearImage(Region);
+    }
+
+    bool bMultiClass = false;
+    if (Source.bMultiClass)
+    {
+        CObjectPtr<CMultiClassRegionData> spRegionVolume(APP_STORAGE.getEntry(Storage::MultiClassRegionData::Id, Flags));
+
+        vpl::tSize RegionXSize, RegionYSize;
+        getPlaneSize(*spRegionVolume, Plane, RegionXSize, RegionYSize);
+        if (spRegionVolume->hasData() && RegionXSize == XSize && RegionYSize == YSize)
+        {
+            if (!getPlane(*spRegionVolume, Plane, Position, MultiClass))
+            {
+                return false;
+            }
+            bMultiClass = true;
+        }
+    }
+    if (!bMultiClass)
+    {
+        clearImage(MultiClass);
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+COrthoSliceCache::tPlanes::iterator COrthoSliceCache::find(int Position, const SSource& Source)
+{
+    for (tPlanes::iterator it = m_Planes.begin(); it != m_Planes.end(); ++it)
+    {
+        if (it->position == Position && it->source == Source)
+        {
+            return it;
+        }
+    }
+    return m_Planes.end();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void COrthoSliceCache::trim()
+{
+    while (m_Size > m_Budget && m_Planes.size() > 1)
+    {
+        m_Size -= m_Planes.back().getSize();
+        m_Planes.pop_back();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool COrthoSliceCache::get(int Position, const SSource& Source, vpl::img::CDImage& Density, vpl::img::CImage16& Region, vpl::img::CImage<tRegionVoxel>& MultiClass)
+{
+    m_Mutex.lock();
+
+    tPlanes::iterator it = find(Position, Source);
+    if (it == m_Planes.end())
+    {
+        m_Mutex.unlock();
+        return false;
+    }
+
+    // Move the planes to the front of the list
+    m_Planes.splice(m_Planes.begin(), m_Planes, it);
+
+    copyImage(it->density, Density);
+    if (it->region.getXSize() > 0)
+    {
+        copyImage(it->region, Region);
+    }
+    else
+    {
+        clearImage(Region);
+    }
+    if (it->multiClass.getXSize() > 0)
+    {
+        copyImage(it->multiClass, MultiClass);
+    }
+    else
+    {
+        clearImage(MultiClass);
+    }
+
+    m_Mutex.unlock();
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void COrthoSliceCache::prefetch(int Position, int NumPositions, const SSource& Source)
+{
+    if (m_Prefetch <= 0)
+    {
+        return;
+    }
+
+    m_Mutex.lock();
+
+    // Planes read from other data will never be used again
+    if (Source != m_Source)
+    {
+        m_Planes.clear();
+        m_Size = 0;
+        m_Direction = 0;
+        m_Position = -1;
+    }
+
+    // Predict the scroll direction, keep the last one if the position has not changed
+    if (m_Position >= 0 && Position != m_Position)
+    {
+        m_Direction = (Position > m_Position) ? 1 : -1;
+    }
+    m_Position = Position;
+    m_NumPositions = NumPositions;
+    m_Source = Source;
+    ++m_Request;
+
+    m_Condition.notifyOne();
+    m_Mutex.unlock();
+
+    if (!m_bRunning)
+    {
+        m_bRunning = true;
+        m_Thread.resume();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void COrthoSliceCache::clear()
+{
+    m_Mutex.lock();
+    m_Planes.clear();
+    m_Size = 0;
+    m_Position = -1;
+    m_Direction = 0;
+    ++m_Request;
+    m_Mutex.unlock();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+VPL_THREAD_ROUTINE(COrthoSliceCache::prefetchLoop)
+{
+    COrthoSliceCache *pCache = static_cast<COrthoSliceCache *>(pThread->getData());
+    if (!pCache)
+    {
+        return -1;
+    }
+
+    unsigned Done = 0;
+
+    // Main thread loop
+    VPL_THREAD_MAIN_LOOP
+    {
+        pCache->m_Mutex.lock();
+        if (pCache->m_Request == Done)
+        {
+            // Wait for a new request
+            if (!pCache->m_Condition.wait(pCache->m_Mutex, 250))
+            {
+                pCache->m_Mutex.unlock();
+                continue;
+            }
+        }
+
+        // Local copy of the request
+        const unsigned Request = pCache->m_Request;
+        const int Position = pCache->m_Position;
+        const int Direction = pCache->m_Direction;
+        const int NumPositions = pCache->m_NumPositions;
+        const SSource Source = pCache->m_Source;
+
+        // Positions to extract, in the scroll direction or around if it is not known yet
+        std::vector<int> Positions;
+        for (int i = 1; i <= pCache->m_Prefetch && Position >= 0; ++i)
+        {
+            if (Direction != 0)
+            {
+                Positions.push_back(Position + i * Direction);
+            }
+            else
+            {
+                Positions.push_back(Position + (i + 1) / 2 * ((i & 1) ? 1 : -1));
+            }
+        }
+        pCache->m_Mutex.unlock();
+        Done = Request;
+
+        for (std::vector<int>::const_iterator it = Positions.begin(); it != Positions.end(); ++it)
+        {
+            if (*it < 0 || *it >= NumPositions)
+            {
+                continue;
+            }
+
+            // Skip planes already cached, stop if the request is outdated
+            pCache->m_Mutex.lock();
+            const bool bOutdated = (pCache->m_Request != Request);
+            const bool bCached = (pCache->find(*it, Source) != pCache->m_Planes.end());
+            pCache->m_Mutex.unlock();
+            if (bOutdated)
+            {
+                break;
+            }
+            if (bCached)
+            {
+                continue;
+            }
+
+            // Planes are extracted into a standalone list node which is then
+            // spliced into the cache without copying
+            tPlanes New(1);
+            SPlanes& Planes = New.front();
+            Planes.position = *it;
+            Planes.source = Source;
+            try
+            {
+                if (!extract(pCache->m_Plane, *it, Source, Planes.density, Planes.region, Planes.multiClass, Storage::NO_UPDATE))
+                {
+                    continue;
+                }
+
+                // Data may have changed during the extraction
+                if (getVersions(Source) != Source)
+                {
+                    break;
+                }
+            }
+            catch (...)
+            {
+                break;
+            }
+
+            pCache->m_Mutex.lock();
+            if (pCache->m_Source == Source && pCache->find(*it, Source) == pCache->m_Planes.end())
+            {
+                pCache->m_Size += Planes.getSize();
+                pCache->m_Planes.splice(pCache->m_Planes.begin(), New);
+                pCache->trim();
+            }
+            pCache->m_Mutex.unlock();
+        }
+    }
+
+    return 0;
+}
+
+} // namespace data
@@ -30,6 +30,7 @@
 #if !defined(TRIDIM_USE_GDCM)
 
 #include <data/DicomTagUtils.h>
+#include <data/CDicomMemoryFiles.h>
 
 #endif
 
@@ -166,6 +167,14 @@ bool data::CSerieInfo::addDicomFile( const vpl::sys::tString &dir, const vpl::sy
     return true;
 }
 
+//==============================================================================================
+void data::CSerieInfo::prepareParallelLoading()
+{
+#if !defined( TRIDIM_USE_GDCM )
+    CDicomDCTk::registerDecoders();
+#endif
+}
+
 //==============================================================================================
 void data::CSerieInfo::getDicomFileList( tDicomFileList& Files )
 {
@@ -565,52 +574,109 @@ data::CSerieInfo * data::CSeries::addDicomFile( const vpl::sys::tString &dir, co
   #endif
 #endif  
 
-    if (bOk)
+	browser.setDirectory(oldDir);
+
+    if (!bOk)
     {
-        // Retrieve serie id
-        std::string	id = dicom.getSerieId();
-        if( id.empty() )
-        {
-            int nFrames = dicom.getNumberOfFrames();
-            if (nFrames<7) // allow missing series id for multiframe dicoms
-            {
-			    browser.setDirectory(oldDir);
-			    return NULL;
-            }
-        }
-        CSerieInfo * serie = addSerie( id );
-        if( !serie )
+        return NULL;
+    }
+
+    SDicomFileInfo info;
+    getDicomFileInfo(dicom, info);
+    return addDicomFile(dir, filename, info);
+}
+
+//==============================================================================================
+data::CSerieInfo * data::CSeries::addDicomFile( const vpl::sys::tString &dir, const vpl::sys::tString &filename, const SDicomFileInfo &info )
+{
+    // Retrieve serie id
+    if( info.serieId.empty() )
+    {
+        if (info.numOfFrames<7) // allow missing series id for multiframe dicoms
         {
-			browser.setDirectory(oldDir);
             return NULL;
         }
-		// Add dicom file to the serie
-        serie->addDicomFile( dir, filename );
+    }
+    CSerieInfo * serie = addSerie( info.serieId );
+    if( !serie )
+    {
+        return NULL;
+    }
+	// Add dicom file to the serie
+    serie->addDicomFile( dir, filename );
 
-        double pixelSpacing = dicom.getPixelSpacing();
+    // Process slice numbers of all frames stored in the dicom file
+    CDicom::tDicomNumList::const_iterator it = info.sliceIds.begin();
+    CDicom::tDicomNumList::const_iterator itEnd = info.sliceIds.end();
+    for( ; it != itEnd; ++it )
+    {
+        serie->addSlice(*it, info.pixelSpacing);
+    }
 
-        // Retreive slice numbers of all frames stored in the dicom file
-        CDicom::tDicomNumList Ids;
-        dicom.getSliceIds( Ids );
+    // get dicom info
+    if (8==info.bitsAllocated)
+        serie->setHas8BitData(true);
 
-        // Process all slice numbers
-        CDicom::tDicomNumList::iterator it = Ids.begin();
-        CDicom::tDicomNumList::iterator itEnd = Ids.end();
-        for( ; it != itEnd; ++it )
+    // O.K.
+    return serie;
+}
+
+//==============================================================================================
+bool data::CSeries::readDicomFileInfo( const vpl::sys::tString &dir, const vpl::sys::tString &filename, SDicomFileInfo &info )
+{
+    bool bOk = false;
+
+#   if defined( TRIDIM_USE_GDCM )
+
+    CDicomGDCM dicom;
+    bOk = dicom.preLoadFile(dir, filename);
+
+#else
+
+    CDicomDCTk dicom;
+
+    // Files of virtual directories are parsed from memory
+    const char *pData = NULL;
+    size_t size = 0;
+    if (CDicomMemoryFiles::findFile(dir, vpl::sys::tStringConv::toUtf8(filename), pData, size))
+    {
+        bOk = dicom.loadBuffer(pData, size, vpl::sys::tStringConv::toUtf8(filename));
+    }
+    else
+    {
+        vpl::sys::tString path = dir + vpl::sys::tChar(vplT('/')) + filename;
+  #ifdef WIN32
+        std::string convPath = wcs2ACP(path);
+  #else
+        std::string convPath = vpl::sys::tStringConv::toUtf8(path);
+  #endif
+
+        bOk = dicom.loadFile(convPath);
+  #ifdef WIN32
+        if (!bOk) // workaround for issue #2496 - problems with swedish letters
         {
-            serie->addSlice(*it, pixelSpacing);
+            std::wstring unipath = shortName(path);
+            convPath = vpl::sys::tStringConv::toUtf8(unipath);
+            bOk = dicom.loadFile(convPath);
         }
+  #endif
+    }
+#endif
 
-        // get dicom info
-        int nBits = dicom.getBitsAllocated();
-        if (8==nBits)
-            serie->setHas8BitData(true);
-
-        // O.K.
-		browser.setDirectory(oldDir);
-        return serie;
+    if (bOk)
+    {
+        getDicomFileInfo(dicom, info);
     }
-    
-	browser.setDirectory(oldDir);
-    return NULL;
+    return bOk;
+}
+
+//==============================================================================================
+void data::CSeries::getDicomFileInfo( CDicom &dicom, SDicomFileInfo &info )
+{
+    info.serieId = dicom.getSerieId();
+    info.numOfFrames = dicom.getNumberOfFrames();
+    info.pixelSpacing = dicom.getPixelSpacing();
+    info.bitsAllocated = dicom.getBitsAllocated();
+    info.sliceIds.clear();
+    dicom.getSliceIds( info.sliceIds );
 }
@@ -30,6 +30,7 @@
 #include <data/CAppSettings.h>
 #include <data/CDensityData.h>
 #include <data/CColoringFunc.h>
+#include <data/CSliceColorizer.h>
 #include <data/CVolumeOfInterestData.h>
 
 #include <VPL/Image/ImageFunctions.h>
@@ -369,7 +370,34 @@ bool CSlice::updateRGBData(bool bSizeChanged, int densityWindowId )
     vpl::img::CDImage *pBackup = applyFilterAndGetBackup(false, 0, 0);
 
     // Is region coloring enabled?
-    if( (m_DensityData.getXSize() != m_RegionData.getXSize() || m_DensityData.getYSize() != m_RegionData.getYSize()) && (m_DensityData.getXSize() != m_multiClassRegionData.getXSize() || m_DensityData.getYSize() != m_multiClassRegionData.getYSize()) )
+    const bool bRegionColoring = !((m_DensityData.getXSize() != m_RegionData.getXSize() || m_DensityData.getYSize() != m_RegionData.getYSize()) && (m_DensityData.getXSize() != m_multiClassRegionData.getXSize() || m_DensityData.getYSize() != m_multiClassRegionData.getYSize()));
+
+    // Plain density window coloring is fused with region overlay into a single pass
+    if (CSliceColorizer::canColorize(*spDensityWindow))
+    {
+        CSliceColorizer colorizer(*spDensityWindow);
+        if (!bRegionColoring || spDensityWindow->getColoring()->overrideRegionColoring())
+        {
+            colorizer.colorize(m_RGBData, m_DensityData);
+        }
+        else
+        {
+            CObjectPtr<CMultiClassRegionData> spMultiClassRegionData(APP_STORAGE.getEntry(Storage::MultiClassRegionData::Id));
+            if (spMultiClassRegionData->hasData())
+            {
+                CObjectPtr<CMultiClassRegionColoring> spMultiClassColoring(APP_STORAGE.getEntry(Storage::MultiClassRegionColoring::Id));
+                colorizer.setMultiClassRegionColoring(*spMultiClassColoring);
+                colorizer.colorize(m_RGBData, m_DensityData, m_multiClassRegionData);
+            }
+            else
+            {
+                CObjectPtr<CRegionColoring> spColoring(APP_STORAGE.getEntry(Storage::RegionColoring::Id));
+                colorizer.setRegionColoring(*spColoring);
+                colorizer.colorize(m_RGBData, m_DensityData, m_RegionData);
+            }
+        }
+    }
+    else if( !bRegionColoring )
     {
         spDensityWindow->colorize(m_RGBData, m_DensityData, m_properties, NULL != pBackup ? *pBackup : m_DensityData);
     }
@@ -0,0 +1,242 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// include files
+
+#include <data/CSliceColorizer.h>
+#include <data/CDensityWindow.h>
+#include <data/CRegionColoring.h>
+#include <data/CMultiClassRegionColoring.h>
+
+#include <algorithm>
+
+
+namespace data
+{
+
+namespace
+{
+
+//! Returns color as a packed RGBA word.
+inline CSliceColorizer::tPacked pack(const CColor4b& color)
+{
+    return *reinterpret_cast<const CSliceColorizer::tPacked *>(color.getData());
+}
+
+//! Returns pointer to the first pixel of a row.
+template <typename T>
+inline CSliceColorizer::tPacked *rowPtr(vpl::img::CImage<T>& image, int y)
+{
+    return reinterpret_cast<CSliceColorizer::tPacked *>(&image(0, y));
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+CSliceColorizer::CSliceColorizer(const CDensityWindow& window)
+    : m_DensityLut(reinterpret_cast<const tPacked *>(window.getColor(CDensityWindow::getMinDensity()).getData()))
+    , m_MinDensity(CDensityWindow::getMinDensity())
+    , m_MaxDensity(CDensityWindow::getMaxDensity())
+    , m_RegionOutside(0)
+    , m_VisibleMask(0)
+    , m_ActiveRegion(-1)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool CSliceColorizer::canColorize(CDensityWindow& window)
+{
+    const int type = window.getColoring()->getType();
+    return type != ColoringFunc::CONST_COLORING_CUSTOM && type != ColoringFunc::COMPLEX_COLORING;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CSliceColorizer::setRegionColoring(CRegionColoring& coloring)
+{
+    static const CColor4b selected(255, 255, 0, 255);
+
+    const int numRegions = coloring.getNumOfRegions();
+    m_RegionTable.resize(std::max(numRegions, 0));
+    for (int i = 0; i < numRegions; ++i)
+    {
+        m_RegionTable[i] = pack(coloring.getRegionInfo(i).isSelected() ? selected : coloring.makeColor(i));
+    }
+    m_RegionOutside = pack(coloring.getRegionInfo(-1).isSelected() ? selected : coloring.makeColor(-1));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CSliceColorizer::setMultiClassRegionColoring(CMultiClassRegionColoring& coloring)
+{
+    const int numRegions = coloring.getNumOfRegions();
+    m_RegionTable.resize(std::max(numRegions, 0));
+    m_VisibleMask = 0;
+    for (int i = 0; i < numRegions; ++i)
+    {
+        m_RegionTable[i] = pack(coloring.getColor(i));
+        if (i < 32 && coloring.isVisible(i))
+        {
+            m_VisibleMask |= tRegionVoxel(1) << i;
+        }
+    }
+    m_ActiveRegion = coloring.getActiveRegion();
+    m_RegionOutside = pack(coloring.makeColor(0));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+template <class tRegionRow>
+void CSliceColorizer::colorizeRows(vpl::img::CRGBImage& rgbImage, const vpl::img::CDImage& densityImage, int xSize, int ySize, tRegionRow regionRow)
+{
+    if (xSize <= 0)
+    {
+        return;
+    }
+
+#pragma omp parallel
+    {
+        // region colors of one row, reused for all rows of this thread
+        std::vector<tPacked> overlay(xSize);
+
+#pragma omp for
+        for (int y = 0; y < ySize; ++y)
+        {
+            tPacked *dst = rowPtr(rgbImage, y);
+            densityRow(&densityImage(0, y), xSize, m_DensityLut, m_MinDensity, m_MaxDensity, dst);
+            if (regionRow(y, &overlay[0]))
+            {
+                blendRow(&overlay[0], xSize, dst);
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+namespace
+{
+
+//! No region overlay.
+struct SNoRegionRow
+{
+    bool operator()(int, CSliceColorizer::tPacked *) const
+    {
+        return false;
+    }
+};
+
+//! Region index overlay.
+struct SRegionRow
+{
+    const vpl::img::CImage16& image;
+    int xSize;
+    const CSliceColorizer::tPacked *table;
+    int tableSize;
+    CSliceColorizer::tPacked outside;
+
+    bool operator()(int y, CSliceColorizer::tPacked *dst) const
+    {
+        CSliceColorizer::regionRow(&image(0, y), xSize, table, tableSize, outside, dst);
+        return true;
+    }
+};
+
+//! Multi-class region overlay.
+struct SMultiClassRow
+{
+    const vpl::img::CImage<tRegionVoxel>& image;
+    int xSize;
+    const CSliceColorizer::tPacked *table;
+    int tableSize;
+    tRegionVoxel visibleMask;
+    int active;
+    CSliceColorizer::tPacked dummy;
+
+    bool operator()(int y, CSliceColorizer::tPacked *dst) const
+    {
+        CSliceColorizer::multiClassRow(&image(0, y), xSize, table, tableSize, visibleMask, active, dummy, dst);
+        return true;
+    }
+};
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CSliceColorizer::colorize(vpl::img::CRGBImage& rgbImage, const vpl::img::CDImage& densityImage)
+{
+    const int xSize = std::min(densityImage.getXSize(), rgbImage.getXSize());
+    const int ySize = std::min(densityImage.getYSize(), rgbImage.getYSize());
+
+    colorizeRows(rgbImage, densityImage, xSize, ySize, SNoRegionRow());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CSliceColorizer::colorize(vpl::img::CRGBImage& rgbImage, const vpl::img::CDImage& densityImage, const vpl::img::CImage16& regionImage)
+{
+    const int xSize = std::min(densityImage.getXSize(), rgbImage.getXSize());
+    const int ySize = std::min(densityImage.getYSize(), rgbImage.getYSize());
+
+    // region data are expected to have the size of the density slice
+    if (regionImage.getXSize() < xSize || regionImage.getYSize() < ySize)
+    {
+        colorize(rgbImage, densityImage);
+        return;
+    }
+
+    SRegionRow row = { regionImage, xSize, m_RegionTable.empty() ? NULL : &m_RegionTable[0], int(m_RegionTable.size()), m_RegionOutside };
+    colorizeRows(rgbImage, densityImage, xSize, ySize, row);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CSliceColorizer::colorize(vpl::img::CRGBImage& rgbImage, const vpl::img::CDImage& densityImage, const vpl::img::CImage<tRegionVoxel>& regionImage)
+{
+    const int xSize = std::min(densityImage.getXSize(), rgbImage.getXSize());
+    const int ySize = std::min(densityImage.getYSize(), rgbImage.getYSize());
+
+    // region data are expected to have the size of the density slice
+    if (regionImage.getXSize() < xSize || regionImage.getYSize() < ySize)
+    {
+        colorize(rgbImage, densityImage);
+        return;
+    }
+
+    SMultiClassRow row = { regionImage, xSize, m_RegionTable.empty() ? NULL : &m_RegionTable[0], int(m_RegionTable.size()), m_VisibleMask, m_ActiveRegion, m_RegionOutside };
+    colorizeRows(rgbImage, densityImage, xSize, ySize, row);
+}
+
+} // namespace data
@@ -27,6 +27,7 @@
 #include <data/CMultiClassRegionData.h>
 #include <data/CDensityData.h>
 #include <data/CMultiClassRegionColoring.h>
+#include <data/CBitOperations.h>
 
 #ifdef _OPENMP
 #    include <omp.h>
@@ -39,6 +40,8 @@ namespace data
 //
 
 CRegionDataCalculator::CRegionDataCalculator()
+	: m_numRegions(0)
+	, m_size(0, 0, 0)
 { }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -57,6 +60,106 @@ bool CRegionDataCalculator::checkDependency(CStorageEntry *pParent)
 }
 
 
+////////////////////////////////////////////////////////////
+//
+
+void CRegionDataCalculator::SRegionStats::reset()
+{
+	voxelsCnt = 0;
+	minDensity = 20000;
+	maxDensity = -20000;
+	sumDensity = 0;
+	sumSqrDensity = 0;
+	minX = 20000;
+	maxX = 0;
+	minY = 20000;
+	maxY = 0;
+	minZ = 20000;
+	maxZ = 0;
+}
+
+////////////////////////////////////////////////////////////
+//
+
+void CRegionDataCalculator::SRegionStats::merge(const SRegionStats& other)
+{
+	voxelsCnt += other.voxelsCnt;
+	minDensity = vpl::math::getMin(minDensity, other.minDensity);
+	maxDensity = vpl::math::getMax(maxDensity, other.maxDensity);
+	sumDensity += other.sumDensity;
+	sumSqrDensity += other.sumSqrDensity;
+	minX = vpl::math::getMin(minX, other.minX);
+	maxX = vpl::math::getMax(maxX, other.maxX);
+	minY = vpl::math::getMin(minY, other.minY);
+	maxY = vpl::math::getMax(maxY, other.maxY);
+	minZ = vpl::math::getMin(minZ, other.minZ);
+	maxZ = vpl::math::getMax(maxZ, other.maxZ);
+}
+
+////////////////////////////////////////////////////////////
+//
+
+void CRegionDataCalculator::updatePlane(vpl::tSize z, CMultiClassRegionData& rVolume, CDensityData& spVolume, int numRegions, SRegionStats *stats)
+{
+	for (int i = 0; i < numRegions; ++i)
+	{
+		stats[i].reset();
+	}
+
+	const vpl::tSize xSize = rVolume.getXSize();
+	const vpl::tSize ySize = rVolume.getYSize();
+
+	const vpl::tSize xOffsetDV = spVolume.getXOffset();
+	const vpl::tSize xOffset = rVolume.getXOffset();
+
+	// bits of regions which are not calculated are ignored
+	const data::CMultiClassRegionData::tVoxel regionMask = (numRegions >= 32) ? data::CMultiClassRegionData::tVoxel(-1) : data::CMultiClassRegionData::tVoxel((1u << numRegions) - 1);
+
+	for (vpl::tSize y = 0; y < ySize; ++y)
+	{
+		vpl::tSize index = rVolume.getIdx(0, y, z);
+		vpl::tSize indexDV = spVolume.getIdx(0, y, z);
+
+		for (vpl::tSize x = 0; x < xSize; ++x, index += xOffset, indexDV += xOffsetDV)
+		{
+			data::CMultiClassRegionData::tVoxel val = rVolume.at(index) & regionMask;
+			if (val == 0)
+			{
+				continue;
+			}
+
+			const int density = spVolume.at(indexDV);
+			const double sqrDensity = double(density) * density;
+
+			// visit set bits only
+			while (val)
+			{
+				SRegionStats &s = stats[getLowestBitIndex(val)];
+				val &= val - 1;
+
+				++s.voxelsCnt;
+				s.sumDensity += density;
+				s.sumSqrDensity += sqrDensity;
+				s.minDensity = vpl::math::getMin(s.minDensity, density);
+				s.maxDensity = vpl::math::getMax(s.maxDensity, density);
+				s.minX = vpl::math::getMin<int>(s.minX, x);
+				s.maxX = vpl::math::getMax<int>(s.maxX, x);
+				s.minY = vpl::math::getMin<int>(s.minY, y);
+				s.maxY = vpl::math::getMax<int>(s.maxY, y);
+			}
+		}
+	}
+
+	for (int i = 0; i < numRegions; ++i)
+	{
+		if (stats[i].voxelsCnt > 0)
+		{
+			stats[i].minZ = z;
+			stats[i].maxZ = z;
+		}
+	}
+}
+
 ////////////////////////////////////////////////////////////
 //
 
@@ -66,13 +169,8 @@ void CRegionDataCalculator::update(const CChangedEntries& Changes)
 	CObjectPtr< CMultiClassRegionData > rVolume(APP_STORAGE.getEntry(Storage::MultiClassRegionData::Id));
 	CObjectPtr< CDensityData> spVolume(APP_STORAGE.getEntry(Storage::PatientData::Id));
 
-	const vpl::tSize xSize = rVolume->getXSize();
-	const vpl::tSize ySize = rVolume->getYSize();
 	const vpl::tSize zSize = rVolume->getZSize();
 
-	const vpl::tSize xOffsetDV = spVolume->getXOffset();
-	const vpl::tSize xOffset = rVolume->getXOffset();
-
 	vpl::img::tPixel16 maxId = 0;
 
 	for (int i = 0; i < spColoring->getNumOfRegions(); ++i)
@@ -88,6 +186,63 @@ void CRegionDataCalculator::update(const CChangedEntries& Changes)
 		maxId = spColoring->getNumOfRegions();
 	}
 
+	const int numRegions = vpl::math::getMin<int>(maxId + 1, CMultiClassRegionData::MAX_REGIONS);
+
+	// Per-plane statistics are reused only when the region data says which planes were modified
+	CChangedEntries::tFilter filter;
+	filter.insert(Storage::MultiClassRegionData::Id);
+	const bool bIncremental = Changes.hasChanged(Storage::MultiClassRegionData::Id)
+		&& Changes.checkFlagAll(CMultiClassRegionData::PLANES_MODIFIED, filter)
+		&& numRegions == m_numRegions
+		&& rVolume->getXSize() == m_size.x() && rVolume->getYSize() == m_size.y() && zSize == m_size.z()
+		&& vpl::tSize(m_planeStamps.size()) == zSize;
+
+	if (!bIncremental)
+	{
+		m_numRegions = numRegions;
+		m_size = vpl::img::CSize3i(rVolume->getXSize(), rVolume->getYSize(), zSize);
+		m_planeStats.resize(zSize * numRegions);
+		m_planeStamps.assign(zSize, 0);
+	}
+
+	// Planes to be recalculated
+	std::vector<vpl::tSize> planes;
+	planes.reserve(zSize);
+	for (vpl::tSize z = 0; z < zSize; ++z)
+	{
+		const vpl::sys::tUInt32 stamp = rVolume->getPlaneStamp(z);
+		if (!bIncremental || stamp != m_planeStamps[z])
+		{
+			planes.push_back(z);
+			m_planeStamps[z] = stamp;
+		}
+	}
+
+	// Every plane is calculated separately, so no synchronization is needed
+#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < int(planes.size()); ++i)
+	{
+		updatePlane(planes[i], *rVolume, *spVolume, numRegions, &m_planeStats[planes[i] * numRegions]);
+	}
+
+	// Reduce per-plane statistics
+	std::vector<SRegionStats> total(maxId + 1);
+	for (int i = 0; i < maxId + 1; ++i)
+	{
+		total[i].reset();
+	}
+	for (vpl::tSize z = 0; z < zSize; ++z)
+	{
+		const SRegionStats *stats = &m_planeStats[z * numRegions];
+		for (int i = 0; i < numRegions; ++i)
+		{
+			if (stats[i].voxelsCnt > 0)
+			{
+				total[i].merge(stats[i]);
+			}
+		}
+	}
+
 	m_voxelsCnt.resize(maxId + 1);
 	m_minDensity.resize(maxId + 1);
 	m_maxDensity.resize(maxId + 1);
@@ -102,108 +257,24 @@ void CRegionDataCalculator::update(const CChangedEntries& Changes)
 
 	for (int i = 0; i < maxId + 1; ++i)
 	{
-		m_voxelsCnt[i] = 0;
-		m_minDensity[i] = 20000;
-		m_maxDensity[i] = -20000;
-		m_sumDensity[i] = 0;
+		m_voxelsCnt[i] = total[i].voxelsCnt;
+		m_minDensity[i] = total[i].minDensity;
+		m_maxDensity[i] = total[i].maxDensity;
+		m_sumDensity[i] = total[i].sumDensity;
 		m_densityVariance[i] = 0;
-		m_minXCoord[i] = 20000;
-		m_maxXCoord[i] = 0;
-		m_minYCoord[i] = 20000;
-		m_maxYCoord[i] = 0;
-		m_minZCoord[i] = 20000;
-		m_maxZCoord[i] = 0;
-	}
-
-	std::vector<double> sumSqrt(maxId + 1, 0);
+		m_minXCoord[i] = total[i].minX;
+		m_maxXCoord[i] = total[i].maxX;
+		m_minYCoord[i] = total[i].minY;
+		m_maxYCoord[i] = total[i].maxY;
+		m_minZCoord[i] = total[i].minZ;
+		m_maxZCoord[i] = total[i].maxZ;
 
-	data::CMultiClassRegionData::tVoxel val;
-
-	for (int z = 0; z < zSize; ++z)
-	{
-		for (int y = 0; y < ySize; ++y)
-		{
-			vpl::tSize index = rVolume->getIdx(0, y, z);
-			vpl::tSize indexDV = spVolume->getIdx(0, y, z);
-
-			for (int x = 0; x < xSize; ++x, index += xOffset, indexDV += xOffsetDV)
-			{
-				val = rVolume->at(index);
-
-                if (val > 0)
-                {
-                    vpl::img::tDensityPixel density = spVolume->at(indexDV);
-                    double sgrtDensity = density * density;
-
-                    int pos = 0;
-
-                    while (pos <= maxId)
-                    {
-                        if (val & 1)
-                        {
-                            ++(m_voxelsCnt[pos]);
-
-                            sumSqrt[pos] += sgrtDensity;
-
-                            m_sumDensity[pos] += density;
-
-                            if (density < m_minDensity[pos])
-                            {
-                                m_minDensity[pos] = density;
-                            }
-
-                            if (density > m_maxDensity[pos])
-                            {
-                                m_maxDensity[pos] = density;
-                            }
-
-                            if (x < m_minXCoord[pos])
-                            {
-                                m_minXCoord[pos] = x;
-                            }
-
-                            if (y < m_minYCoord[pos])
-                            {
-                                m_minYCoord[pos] = y;
-                            }
-
-                            if (z < m_minZCoord[pos])
-                            {
-                                m_minZCoord[pos] = z;
-                            }
-
-                            if (x > m_maxXCoord[pos])
-                            {
-                                m_maxXCoord[pos] = x;
-                            }
-
-                            if (y > m_maxYCoord[pos])
-                            {
-                                m_maxYCoord[pos] = y;
-                            }
-
-                            if (z > m_maxZCoord[pos])
-                            {
-                                m_maxZCoord[pos] = z;
-                            }
-                        }
-
-                        val >>= 1;
-                        ++pos;
-                    }
-				}
-			}
-		}
-	}
-
-	for (int i = 0; i < maxId + 1; ++i)
-	{
 		if (m_voxelsCnt[i] == 0)
 			continue;
 
 		double tmp = 1.0 / m_voxelsCnt[i];
 
-		m_densityVariance[i] = (sumSqrt[i] * tmp) - (m_sumDensity[i] * tmp * m_sumDensity[i] * tmp);
+		m_densityVariance[i] = (total[i].sumSqrDensity * tmp) - (m_sumDensity[i] * tmp * m_sumDensity[i] * tmp);
 	}
 }
 
@@ -212,6 +283,10 @@ void CRegionDataCalculator::update(const CChangedEntries& Changes)
 
 void CRegionDataCalculator::init()
 {
+	m_planeStats.clear();
+	m_planeStamps.clear();
+	m_numRegions = 0;
+	m_size = vpl::img::CSize3i(0, 0, 0);
 	m_voxelsCnt.clear();
 	m_minDensity.clear();
 	m_maxDensity.clear();
@@ -0,0 +1,259 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <geometry/base/CIndexedMesh.h>
+#include <geometry/base/CMesh.h>
+
+#include <unordered_map>
+#include <fstream>
+#include <cstring>
+#include <cmath>
+#include <assert.h>
+
+namespace
+{
+    //! Hashable key made of exact vertex coordinates.
+    struct SVertexKey
+    {
+        float v[3];
+
+        bool operator==(const SVertexKey &other) const
+        {
+            return v[0] == other.v[0] && v[1] == other.v[1] && v[2] == other.v[2];
+        }
+    };
+
+    struct SVertexKeyHash
+    {
+        size_t operator()(const SVertexKey &key) const
+        {
+            unsigned int bits[3];
+            std::memcpy(bits, key.v, sizeof(bits));
+            size_t hash = bits[0];
+            hash = hash * 73856093u ^ bits[1];
+            hash = hash * 19349663u ^ bits[2];
+            return hash;
+        }
+    };
+}
+
+geometry::CIndexedMesh::CIndexedMesh()
+    : m_welded(true)
+{
+}
+
+geometry::CIndexedMesh::~CIndexedMesh()
+{
+}
+
+void geometry::CIndexedMesh::clear()
+{
+    m_vertices.clear();
+    m_indices.clear();
+    m_welded = true;
+}
+
+void geometry::CIndexedMesh::reserve(size_t vertices, size_t triangles)
+{
+    m_vertices.reserve(vertices * 3);
+    m_indices.reserve(triangles * 3);
+}
+
+void geometry::CIndexedMesh::addVertex(double x, double y, double z)
+{
+    m_vertices.push_back(float(x));
+    m_vertices.push_back(float(y));
+    m_vertices.push_back(float(z));
+    m_welded = false;
+}
+
+void geometry::CIndexedMesh::addIndex(int index)
+{
+    assert(index >= 0);
+    m_indices.push_back((unsigned int)index);
+}
+
+void geometry::CIndexedMesh::append(const CIndexedMesh &other)
+{
+    const unsigned int offset = (unsigned int)n_vertices();
+    m_vertices.insert(m_vertices.end(), other.m_vertices.begin(), other.m_vertices.end());
+    m_indices.reserve(m_indices.size() + other.m_indices.size());
+    for (size_t i = 0; i < other.m_indices.size(); ++i)
+    {
+        m_indices.push_back(other.m_indices[i] + offset);
+    }
+    m_welded = m_welded && other.n_vertices() == 0;
+}
+
+void geometry::CIndexedMesh::weldVertices()
+{
+    if (m_welded)
+    {
+        return;
+    }
+
+    const size_t count = n_vertices();
+    std::unordered_map<SVertexKey, unsigned int, SVertexKeyHash> map;
+    map.reserve(count);
+    std::vector<unsigned int> remap(count);
+    size_t written = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        SVertexKey key;
+        key.v[0] = m_vertices[i * 3];
+        key.v[1] = m_vertices[i * 3 + 1];
+        key.v[2] = m_vertices[i * 3 + 2];
+
+        std::pair<std::unordered_map<SVertexKey, unsigned int, SVertexKeyHash>::iterator, bool> inserted = map.insert(std::make_pair(key, (unsigned int)written));
+        if (inserted.second)
+        {
+            // compact in place, written index is never ahead of i
+            m_vertices[written * 3] = key.v[0];
+            m_vertices[written * 3 + 1] = key.v[1];
+            m_vertices[written * 3 + 2] = key.v[2];
+            written++;
+        }
+        remap[i] = inserted.first->second;
+    }
+    m_vertices.resize(written * 3);
+
+    for (size_t i = 0; i < m_indices.size(); ++i)
+    {
+        m_indices[i] = remap[m_indices[i]];
+    }
+
+    // drop triangles degenerated by welding
+    size_t tri = 0;
+    for (size_t i = 0; i + 2 < m_indices.size(); i += 3)
+    {
+        const unsigned int a = m_indices[i], b = m_indices[i + 1], c = m_indices[i + 2];
+        if (a == b || b == c || a == c)
+        {
+            continue;
+        }
+        m_indices[tri++] = a;
+        m_indices[tri++] = b;
+        m_indices[tri++] = c;
+    }
+    m_indices.resize(tri);
+
+    m_welded = true;
+}
+
+bool geometry::CIndexedMesh::toMesh(geometry::CMesh &mesh)
+{
+    weldVertices();
+
+    mesh.clear();
+    mesh.reserve(n_vertices(), n_faces() * 3 / 2, n_faces());
+    for (size_t i = 0; i < n_vertices(); ++i)
+    {
+        mesh.add_vertex(geometry::CMesh::Point(m_vertices[i * 3], m_vertices[i * 3 + 1], m_vertices[i * 3 + 2]));
+    }
+
+    bool ok = true;
+    for (size_t i = 0; i < n_faces(); ++i)
+    {
+        geometry::CMesh::FaceHandle face = mesh.add_face(
+            geometry::CMesh::VertexHandle(int(m_indices[i * 3])),
+            geometry::CMesh::VertexHandle(int(m_indices[i * 3 + 1])),
+            geometry::CMesh::VertexHandle(int(m_indices[i * 3 + 2])));
+        ok = ok && face.is_valid();
+    }
+    return ok;
+}
+
+void geometry::CIndexedMesh::fromMesh(const geometry::CMesh &mesh)
+{
+    clear();
+    reserve(mesh.n_vertices(), mesh.n_faces());
+
+    // deleted vertices are skipped, so map handles to compact indices
+    std::vector<int> index(mesh.n_vertices(), -1);
+    int current = 0;
+    for (geometry::CMesh::ConstVertexIter vit = mesh.vertices_begin(); vit != mesh.vertices_end(); ++vit)
+    {
+        const geometry::CMesh::Point &point = mesh.point(vit.handle());
+        m_vertices.push_back(point[0]);
+        m_vertices.push_back(point[1]);
+        m_vertices.push_back(point[2]);
+        index[vit.handle().idx()] = current++;
+    }
+
+    for (geometry::CMesh::ConstFaceIter fit = mesh.faces_begin(); fit != mesh.faces_end(); ++fit)
+    {
+        for (geometry::CMesh::ConstFaceVertexIter fvit = mesh.cfv_begin(fit.handle()); fvit != mesh.cfv_end(fit.handle()); ++fvit)
+        {
+            m_indices.push_back((unsigned int)index[fvit.handle().idx()]);
+        }
+    }
+    m_welded = true;
+}
+
+bool geometry::CIndexedMesh::saveSTL(const std::string &filename) const
+{
+    std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    char header[80];
+    std::memset(header, 0, sizeof(header));
+    std::strncpy(header, "3DimViewer binary STL", sizeof(header) - 1);
+    file.write(header, sizeof(header));
+
+    const unsigned int triangles = (unsigned int)n_faces();
+    file.write(reinterpret_cast<const char *>(&triangles), sizeof(triangles));
+
+    for (size_t i = 0; i < n_faces(); ++i)
+    {
+        const float *p[3];
+        for (int j = 0; j < 3; ++j)
+        {
+            p[j] = &m_vertices[m_indices[i * 3 + j] * 3];
+        }
+
+        const float u[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+        const float v[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+        float record[12] = { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+        const float length = std::sqrt(record[0] * record[0] + record[1] * record[1] + record[2] * record[2]);
+        if (length > 0.0f)
+        {
+            record[0] /= length;
+            record[1] /= length;
+            record[2] /= length;
+        }
+        for (int j = 0; j < 3; ++j)
+        {
+            record[3 + j * 3] = p[j][0];
+            record[4 + j * 3] = p[j][1];
+            record[5 + j * 3] = p[j][2];
+        }
+
+        const unsigned short attributes = 0;
+        file.write(reinterpret_cast<const char *>(record), sizeof(record));
+        file.write(reinterpret_cast<const char *>(&attributes), sizeof(attributes));
+    }
+
+    return file.good();
+}
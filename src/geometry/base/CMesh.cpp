@@ -1412,6 +1412,14 @@ void CMesh::updateOctree()
 	m_octreeVersion = 0;
 }
 
+//! Drops the octree of mesh
+void CMesh::invalidateOctree()
+{
+    delete m_octree;
+    m_octree = NULL;
+    m_octreeVersion = 0;
+}
+
 //! updates octree of mesh
 void CMesh::updateOctree(int version)
 {
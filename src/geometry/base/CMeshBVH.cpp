@@ -0,0 +1,485 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <geometry/base/CMeshBVH.h>
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace geometry
+{
+
+namespace
+{
+
+//! Maximal depth of the tree, enough for any median split tree.
+const int MAX_STACK = 64;
+
+//! Closest point on a segment, returns squared distance.
+float closestPointOnSegment(const CMesh::Point &p, const CMesh::Point &a, const CMesh::Point &b, CMesh::Point &closest)
+{
+    const CMesh::Point ab(b - a);
+    const float len2 = OpenMesh::dot(ab, ab);
+    float t = (len2 > 0.0f) ? OpenMesh::dot(p - a, ab) / len2 : 0.0f;
+    t = std::min(1.0f, std::max(0.0f, t));
+    closest = a + ab * t;
+    return (p - closest).sqrnorm();
+}
+
+//! Angle between two vectors leaving a corner.
+float cornerAngle(const CMesh::Point &e1, const CMesh::Point &e2)
+{
+    const float len = e1.norm() * e2.norm();
+    if (len <= 0.0f)
+    {
+        return 0.0f;
+    }
+    return std::acos(std::min(1.0f, std::max(-1.0f, OpenMesh::dot(e1, e2) / len)));
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CMeshBVH::clear()
+{
+    m_nodes.clear();
+    m_triangles.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CMeshBVH::build(const CMesh &mesh)
+{
+    clear();
+
+    const int numFaces = int(mesh.n_faces());
+    const int numVertices = int(mesh.n_vertices());
+    const bool hasStatus = mesh.has_face_status();
+
+    // Vertices and normals of faces
+    std::vector<int> vertices(3 * size_t(numFaces), -1);
+    std::vector<CMesh::Point> faceNormals(numFaces, CMesh::Point(0.0f, 0.0f, 0.0f));
+
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (int f = 0; f < numFaces; ++f)
+    {
+        const CMesh::FaceHandle fh(f);
+        if (hasStatus && mesh.status(fh).deleted())
+        {
+            continue;
+        }
+
+        int i = 0;
+        for (CMesh::ConstFaceVertexIter fvit = mesh.cfv_iter(fh); fvit && i < 3; ++fvit, ++i)
+        {
+            vertices[3 * f + i] = fvit.handle().idx();
+        }
+
+        const CMesh::Point &a = mesh.point(CMesh::VertexHandle(vertices[3 * f]));
+        const CMesh::Point &b = mesh.point(CMesh::VertexHandle(vertices[3 * f + 1]));
+        const CMesh::Point &c = mesh.point(CMesh::VertexHandle(vertices[3 * f + 2]));
+        CMesh::Point normal((b - a) % (c - a));
+        const float length = normal.norm();
+        if (length > 0.0f)
+        {
+            normal /= length;
+        }
+        faceNormals[f] = normal;
+    }
+
+    // Angle weighted vertex normals
+    std::vector<CMesh::Point> vertexNormals(numVertices, CMesh::Point(0.0f, 0.0f, 0.0f));
+    for (int f = 0; f < numFaces; ++f)
+    {
+        const int *v = &vertices[3 * f];
+        if (v[0] < 0)
+        {
+            continue;
+        }
+        for (int i = 0; i < 3; ++i)
+        {
+            const CMesh::Point &p = mesh.point(CMesh::VertexHandle(v[i]));
+            const CMesh::Point e1(mesh.point(CMesh::VertexHandle(v[(i + 1) % 3])) - p);
+            const CMesh::Point e2(mesh.point(CMesh::VertexHandle(v[(i + 2) % 3])) - p);
+            vertexNormals[v[i]] += faceNormals[f] * cornerAngle(e1, e2);
+        }
+    }
+
+    // Triangles
+    std::vector<STriangle> triangles;
+    triangles.reserve(numFaces);
+    for (int f = 0; f < numFaces; ++f)
+    {
+        const int *v = &vertices[3 * f];
+        if (v[0] < 0)
+        {
+            continue;
+        }
+
+        STriangle triangle;
+        triangle.a = mesh.point(CMesh::VertexHandle(v[0]));
+        triangle.b = mesh.point(CMesh::VertexHandle(v[1]));
+        triangle.c = mesh.point(CMesh::VertexHandle(v[2]));
+        triangle.normal = faceNormals[f];
+        triangle.face = f;
+        for (int i = 0; i < 3; ++i)
+        {
+            triangle.vertexNormals[i] = vertexNormals[v[i]];
+            triangle.edgeNormals[i] = faceNormals[f] * 2.0f;
+        }
+
+        // Edge i goes from vertex i to vertex i + 1
+        for (CMesh::ConstFaceHalfedgeIter fhit = mesh.cfh_iter(CMesh::FaceHandle(f)); fhit; ++fhit)
+        {
+            const CMesh::HalfedgeHandle heh = fhit.handle();
+            const CMesh::FaceHandle opposite = mesh.face_handle(mesh.opposite_halfedge_handle(heh));
+            if (!opposite.is_valid() || (hasStatus && mesh.status(opposite).deleted()))
+            {
+                continue;
+            }
+
+            const int from = mesh.from_vertex_handle(heh).idx();
+            for (int i = 0; i < 3; ++i)
+            {
+                if (v[i] == from)
+                {
+                    triangle.edgeNormals[i] = faceNormals[f] + faceNormals[opposite.idx()];
+                    break;
+                }
+            }
+        }
+
+        triangles.push_back(triangle);
+    }
+
+    if (triangles.empty())
+    {
+        return;
+    }
+
+    // Tree
+    std::vector<int> order(triangles.size());
+    std::vector<CMesh::Point> centroids(triangles.size());
+    for (size_t i = 0; i < triangles.size(); ++i)
+    {
+        order[i] = int(i);
+        centroids[i] = (triangles[i].a + triangles[i].b + triangles[i].c) / 3.0f;
+    }
+
+    m_nodes.reserve(2 * triangles.size() / MAX_LEAF_TRIANGLES + 1);
+    buildNode(order, 0, int(order.size()), centroids, triangles);
+
+    m_triangles.resize(triangles.size());
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        m_triangles[i] = triangles[order[i]];
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+int CMeshBVH::buildNode(std::vector<int> &order, int begin, int end, const std::vector<CMesh::Point> &centroids, const std::vector<STriangle> &triangles)
+{
+    const int index = int(m_nodes.size());
+    m_nodes.push_back(SNode());
+
+    SNode node;
+    for (int j = 0; j < 3; ++j)
+    {
+        node.min[j] = std::numeric_limits<float>::max();
+        node.max[j] = -std::numeric_limits<float>::max();
+    }
+
+    // Bounds of triangles and of their centroids
+    CMesh::Point cmin(node.min[0], node.min[1], node.min[2]);
+    CMesh::Point cmax(node.max[0], node.max[1], node.max[2]);
+    for (int i = begin; i < end; ++i)
+    {
+        const STriangle &triangle = triangles[order[i]];
+        for (int j = 0; j < 3; ++j)
+        {
+            node.min[j] = std::min(node.min[j], std::min(triangle.a[j], std::min(triangle.b[j], triangle.c[j])));
+            node.max[j] = std::max(node.max[j], std::max(triangle.a[j], std::max(triangle.b[j], triangle.c[j])));
+        }
+        cmin.minimize(centroids[order[i]]);
+        cmax.maximize(centroids[order[i]]);
+    }
+
+    if (end - begin <= MAX_LEAF_TRIANGLES)
+    {
+        node.first = begin;
+        node.count = end - begin;
+        m_nodes[index] = node;
+        return index;
+    }
+
+    // Median split along the longest axis of centroids
+    const CMesh::Point extent(cmax - cmin);
+    const int axis = (extent[0] >= extent[1] && extent[0] >= extent[2]) ? 0 : (extent[1] >= extent[2] ? 1 : 2);
+    const int middle = begin + (end - begin) / 2;
+    std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+        [&centroids, axis](int l, int r) { return centroids[l][axis] < centroids[r][axis]; });
+
+    buildNode(order, begin, middle, centroids, triangles);
+    node.first = buildNode(order, middle, end, centroids, triangles);
+    node.count = 0;
+    m_nodes[index] = node;
+
+    return index;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+float CMeshBVH::boxDistance2(const SNode &node, const CMesh::Point &p)
+{
+    float distance2 = 0.0f;
+    for (int j = 0; j < 3; ++j)
+    {
+        const float d = std::max(0.0f, std::max(node.min[j] - p[j], p[j] - node.max[j]));
+        distance2 += d * d;
+    }
+    return distance2;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+float CMeshBVH::closestPointOnTriangle(const CMesh::Point &p, const CMesh::Point &a, const CMesh::Point &b, const CMesh::Point &c, CMesh::Point &closest, int &feature)
+{
+    // Voronoi regions of the triangle, see Ericson, Real-Time Collision Detection, 5.1.5
+    const CMesh::Point ab(b - a), ac(c - a), ap(p - a);
+    const float d1 = OpenMesh::dot(ab, ap);
+    const float d2 = OpenMesh::dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f)
+    {
+        closest = a;
+        feature = FEATURE_VERTEX0;
+        return (p - closest).sqrnorm();
+    }
+
+    const CMesh::Point bp(p - b);
+    const float d3 = OpenMesh::dot(ab, bp);
+    const float d4 = OpenMesh::dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3)
+    {
+        closest = b;
+        feature = FEATURE_VERTEX1;
+        return (p - closest).sqrnorm();
+    }
+
+    const float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+    {
+        closest = a + ab * (d1 / (d1 - d3));
+        feature = FEATURE_EDGE01;
+        return (p - closest).sqrnorm();
+    }
+
+    const CMesh::Point cp(p - c);
+    const float d5 = OpenMesh::dot(ab, cp);
+    const float d6 = OpenMesh::dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6)
+    {
+        closest = c;
+        feature = FEATURE_VERTEX2;
+        return (p - closest).sqrnorm();
+    }
+
+    const float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+    {
+        closest = a + ac * (d2 / (d2 - d6));
+        feature = FEATURE_EDGE20;
+        return (p - closest).sqrnorm();
+    }
+
+    const float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+    {
+        closest = b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        feature = FEATURE_EDGE12;
+        return (p - closest).sqrnorm();
+    }
+
+    const float sum = va + vb + vc;
+    if (sum <= 0.0f)
+    {
+        // Degenerate triangle, take the closest of its edges
+        CMesh::Point candidate;
+        float best = closestPointOnSegment(p, a, b, closest);
+        feature = FEATURE_EDGE01;
+        float distance2 = closestPointOnSegment(p, b, c, candidate);
+        if (distance2 < best)
+        {
+            best = distance2;
+            closest = candidate;
+            feature = FEATURE_EDGE12;
+        }
+        distance2 = closestPointOnSegment(p, c, a, candidate);
+        if (distance2 < best)
+        {
+            best = distance2;
+            closest = candidate;
+            feature = FEATURE_EDGE20;
+        }
+        return best;
+    }
+
+    closest = a + ab * (vb / sum) + ac * (vc / sum);
+    feature = FEATURE_FACE;
+    return (p - closest).sqrnorm();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool CMeshBVH::findClosest(const CMesh::Point &point, float maxDistance, SClosestPoint &result) const
+{
+    result.triangle = -1;
+    result.feature = FEATURE_FACE;
+    result.distance = maxDistance;
+    if (m_nodes.empty())
+    {
+        return false;
+    }
+
+    float best2 = (maxDistance < std::sqrt(std::numeric_limits<float>::max())) ? maxDistance * maxDistance : std::numeric_limits<float>::max();
+
+    int stack[MAX_STACK];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const int index = stack[--top];
+        const SNode &node = m_nodes[index];
+        if (boxDistance2(node, point) > best2)
+        {
+            continue;
+        }
+
+        if (node.count > 0)
+        {
+            for (int i = node.first; i < node.first + node.count; ++i)
+            {
+                const STriangle &triangle = m_triangles[i];
+                CMesh::Point closest;
+                int feature;
+                const float distance2 = closestPointOnTriangle(point, triangle.a, triangle.b, triangle.c, closest, feature);
+                if (distance2 <= best2)
+                {
+                    best2 = distance2;
+                    result.point = closest;
+                    result.triangle = i;
+                    result.feature = feature;
+                }
+            }
+            continue;
+        }
+
+        // Nearer child is visited first
+        const int left = index + 1;
+        const int right = node.first;
+        const float dl = boxDistance2(m_nodes[left], point);
+        const float dr = boxDistance2(m_nodes[right], point);
+        const int nearChild = (dl <= dr) ? left : right;
+        const int farChild = (dl <= dr) ? right : left;
+        if (std::max(dl, dr) <= best2)
+        {
+            stack[top++] = farChild;
+        }
+        if (std::min(dl, dr) <= best2)
+        {
+            stack[top++] = nearChild;
+        }
+    }
+
+    if (result.triangle < 0)
+    {
+        return false;
+    }
+
+    result.distance = std::sqrt(best2);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool CMeshBVH::findClosest(const CMesh::Point &point, SClosestPoint &result) const
+{
+    return findClosest(point, std::numeric_limits<float>::max(), result);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+const CMesh::Point &CMeshBVH::getPseudoNormal(const SClosestPoint &closest) const
+{
+    const STriangle &triangle = m_triangles[closest.triangle];
+    switch (closest.feature)
+    {
+    case FEATURE_VERTEX0:
+    case FEATURE_VERTEX1:
+    case FEATURE_VERTEX2:
+        return triangle.vertexNormals[closest.feature - FEATURE_VERTEX0];
+
+    case FEATURE_EDGE01:
+    case FEATURE_EDGE12:
+    case FEATURE_EDGE20:
+        return triangle.edgeNormals[closest.feature - FEATURE_EDGE01];
+
+    default:
+        return triangle.normal;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool CMeshBVH::getSignedDistance(const CMesh::Point &point, float &distance) const
+{
+    SClosestPoint closest;
+    if (!findClosest(point, closest))
+    {
+        return false;
+    }
+
+    // Sign from the angle weighted pseudo normal, exact for closed meshes
+    distance = closest.distance;
+    if (OpenMesh::dot(point - closest.point, getPseudoNormal(closest)) < 0.0f)
+    {
+        distance = -distance;
+    }
+    return true;
+}
+
+} // namespace geometry
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
@@ -0,0 +1,473 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <geometry/base/CMeshQuery.h>
+
+// STL
+#include <algorithm>
+#include <cmath>
+
+namespace geometry
+{
+
+namespace
+{
+
+//! Maximal depth of the tree.
+const int MAX_STACK = 64;
+
+//! Margin of node boxes in line queries, the same as used with the octree.
+const double LINE_MARGIN = 0.1;
+
+//! Visits leaves of the tree whose nodes pass a test, stops when the visitor returns true.
+//! Returns true if stopped.
+template <class tTest, class tVisitor>
+bool traverse(const CMeshBVH &bvh, const tTest &test, tVisitor &visitor)
+{
+    const std::vector<CMeshBVH::SNode> &nodes = bvh.getNodes();
+    if (nodes.empty())
+    {
+        return false;
+    }
+
+    int stack[MAX_STACK];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const int index = stack[--top];
+        const CMeshBVH::SNode &node = nodes[index];
+        if (!test(node))
+        {
+            continue;
+        }
+
+        if (node.count > 0)
+        {
+            for (int i = node.first; i < node.first + node.count; ++i)
+            {
+                if (visitor(i))
+                {
+                    return true;
+                }
+            }
+            continue;
+        }
+
+        stack[top++] = node.first;
+        stack[top++] = index + 1;
+    }
+    return false;
+}
+
+//! Parameter interval of a line inside of a node box enlarged by a margin.
+bool lineBoxInterval(const CMeshBVH::SNode &node, const geometry::Vec3 &origin, const geometry::Vec3 &direction, double margin, double &tmin, double &tmax)
+{
+    for (int j = 0; j < 3; ++j)
+    {
+        const double min = node.min[j] - margin;
+        const double max = node.max[j] + margin;
+        if (direction[j] == 0.0)
+        {
+            if (origin[j] < min || origin[j] > max)
+            {
+                return false;
+            }
+            continue;
+        }
+
+        double t0 = (min - origin[j]) / direction[j];
+        double t1 = (max - origin[j]) / direction[j];
+        if (t0 > t1)
+        {
+            std::swap(t0, t1);
+        }
+        tmin = std::max(tmin, t0);
+        tmax = std::min(tmax, t1);
+        if (tmin > tmax)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//! Checks if a node box overlaps a box.
+bool boxOverlap(const CMeshBVH::SNode &node, const geometry::Vec3 &min, const geometry::Vec3 &max)
+{
+    for (int j = 0; j < 3; ++j)
+    {
+        if (node.max[j] < min[j] || node.min[j] > max[j])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//! Returns triangle vertices as a vector used by geometry functions.
+void getTriangle(const CMeshBVH::STriangle &triangle, std::vector<geometry::Vec3> &vertices)
+{
+    vertices.resize(3);
+    vertices[0] = geometry::convert3<geometry::Vec3>(triangle.a);
+    vertices[1] = geometry::convert3<geometry::Vec3>(triangle.b);
+    vertices[2] = geometry::convert3<geometry::Vec3>(triangle.c);
+}
+
+//! Ray triangle intersection (Moller-Trumbore), returns ray parameter of the hit.
+bool rayTriangle(const CMeshBVH::STriangle &triangle, const geometry::Vec3 &origin, const geometry::Vec3 &direction, double &t)
+{
+    const double e1[3] = { double(triangle.b[0]) - triangle.a[0], double(triangle.b[1]) - triangle.a[1], double(triangle.b[2]) - triangle.a[2] };
+    const double e2[3] = { double(triangle.c[0]) - triangle.a[0], double(triangle.c[1]) - triangle.a[1], double(triangle.c[2]) - triangle.a[2] };
+    const double p[3] = { direction[1] * e2[2] - direction[2] * e2[1], direction[2] * e2[0] - direction[0] * e2[2], direction[0] * e2[1] - direction[1] * e2[0] };
+    const double det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+    if (std::fabs(det) < 1e-12)
+    {
+        return false;
+    }
+
+    const double invDet = 1.0 / det;
+    const double s[3] = { origin[0] - triangle.a[0], origin[1] - triangle.a[1], origin[2] - triangle.a[2] };
+    const double u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * invDet;
+    if (u < 0.0 || u > 1.0)
+    {
+        return false;
+    }
+
+    const double q[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+    const double v = (direction[0] * q[0] + direction[1] * q[1] + direction[2] * q[2]) * invDet;
+    if (v < 0.0 || u + v > 1.0)
+    {
+        return false;
+    }
+
+    t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * invDet;
+    return true;
+}
+
+//! Box enclosing a cylinder.
+void cylinderBox(const geometry::Vec3 &center, const geometry::Vec3 &direction, double height, double radius, geometry::Vec3 &min, geometry::Vec3 &max)
+{
+    const double length = direction.length();
+    for (int j = 0; j < 3; ++j)
+    {
+        const double d = (length > 0.0) ? direction[j] / length : 0.0;
+        const double extent = std::fabs(d) * height * 0.5 + radius * std::sqrt(std::max(0.0, 1.0 - d * d));
+        min[j] = center[j] - extent;
+        max[j] = center[j] + extent;
+    }
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+CMeshQuery::CMeshQuery()
+    : m_version(-1)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CMeshQuery::update(const geometry::CMesh &mesh)
+{
+    m_bvh.build(mesh);
+    m_version = -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CMeshQuery::update(const geometry::CMesh &mesh, int version)
+{
+    if (m_version == version && version != -1)
+    {
+        return;
+    }
+    update(mesh);
+    m_version = version;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CMeshQuery::getExtent(const geometry::Vec3 &direction, double &minDot, double &maxDot) const
+{
+    // Branch and bound over node boxes, instead of a scan of all vertices
+    minDot = std::numeric_limits<double>::max();
+    maxDot = -std::numeric_limits<double>::max();
+
+    const std::vector<CMeshBVH::SNode> &nodes = m_bvh.getNodes();
+    if (nodes.empty())
+    {
+        return;
+    }
+
+    int stack[MAX_STACK];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const int index = stack[--top];
+        const CMeshBVH::SNode &node = nodes[index];
+
+        double boxMin = 0.0, boxMax = 0.0;
+        for (int j = 0; j < 3; ++j)
+        {
+            boxMin += direction[j] * ((direction[j] > 0.0) ? node.min[j] : node.max[j]);
+            boxMax += direction[j] * ((direction[j] > 0.0) ? node.max[j] : node.min[j]);
+        }
+        if (boxMin >= minDot && boxMax <= maxDot)
+        {
+            continue;
+        }
+
+        if (node.count > 0)
+        {
+            for (int i = node.first; i < node.first + node.count; ++i)
+            {
+                const CMeshBVH::STriangle &triangle = m_bvh.getTriangle(i);
+                const CMesh::Point *points[3] = { &triangle.a, &triangle.b, &triangle.c };
+                for (int k = 0; k < 3; ++k)
+                {
+                    const double d = direction[0] * (*points[k])[0] + direction[1] * (*points[k])[1] + direction[2] * (*points[k])[2];
+                    minDot = std::min(minDot, d);
+                    maxDot = std::max(maxDot, d);
+                }
+            }
+            continue;
+        }
+
+        stack[top++] = node.first;
+        stack[top++] = index + 1;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool CMeshQuery::isPointInside(const geometry::Vec3 &point, const geometry::Vec3 &upVector) const
+{
+    double minDot, maxDot;
+    getExtent(upVector, minDot, maxDot);
+    return isPointInside(point, upVector, minDot, maxDot);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool CMeshQuery::isPointInside(const geometry::Vec3 &point, const geometry::Vec3 &upVector, double minDot, double maxDot) const
+{
+    if (m_bvh.isEmpty())
+    {
+        return false;
+    }
+
+    // dimensions of model along upVector relative to the point, as in closestPointOnLine()
+    const double upLength2 = upVector * upVector;
+    const double pointDot = upVector * point;
+    const double minDist = (minDot - pointDot) / upLength2;
+    const double maxDist = (maxDot - pointDot) / upLength2;
+
+    // point lies outside of model dimensions
+    if (maxDist < 0.0 || minDist > 0.0)
+        return false;
+
+    // find all faces that intersects with the line
+    std::vector<SLineIntersection> intersections;
+    std::vector<geometry::Vec3> triangle;
+    auto test = [&](const CMeshBVH::SNode &node)
+    {
+        double tmin = -std::numeric_limits<double>::max();
+        double tmax = std::numeric_limits<double>::max();
+        return lineBoxInterval(node, point, upVector, LINE_MARGIN, tmin, tmax);
+    };
+    auto visitor = [&](int i)
+    {
+        const CMeshBVH::STriangle &tri = m_bvh.getTriangle(i);
+        getTriangle(tri, triangle);
+
+        geometry::Vec3 triangleNormal = geometry::convert3<geometry::Vec3>(tri.normal);
+        triangleNormal.normalize();
+
+        geometry::Vec3 intersection;
+        double distance = 0.0;
+        if (lineTriangleIntersection(triangle, triangleNormal, point, upVector, intersection, distance))
+        {
+            const bool faceUp = (upVector * triangleNormal) > 0.0;
+            intersections.push_back({ intersection, distance, faceUp, false });
+        }
+        return false;
+    };
+    traverse(m_bvh, test, visitor);
+
+    return isPointInsideIntersections(intersections, point, upVector, minDist, maxDist);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CMeshQuery::arePointsInside(const std::vector<geometry::Vec3> &points, const geometry::Vec3 &upVector, std::vector<unsigned char> &inside) const
+{
+    inside.assign(points.size(), 0);
+
+    // the extent is shared by all points
+    double minDot, maxDot;
+    getExtent(upVector, minDot, maxDot);
+
+    const int count = int(points.size());
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int i = 0; i < count; ++i)
+    {
+        inside[i] = isPointInside(points[i], upVector, minDot, maxDot) ? 1 : 0;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool CMeshQuery::raycast(const geometry::Vec3 &origin, const geometry::Vec3 &direction, SRayHit &hit, double maxDistance) const
+{
+    hit.face = -1;
+    hit.distance = maxDistance;
+
+    const std::vector<CMeshBVH::SNode> &nodes = m_bvh.getNodes();
+    if (nodes.empty())
+    {
+        return false;
+    }
+
+    int stack[MAX_STACK];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const int index = stack[--top];
+        const CMeshBVH::SNode &node = nodes[index];
+
+        double tmin = 0.0, tmax = hit.distance;
+        if (!lineBoxInterval(node, origin, direction, 0.0, tmin, tmax))
+        {
+            continue;
+        }
+
+        if (node.count > 0)
+        {
+            for (int i = node.first; i < node.first + node.count; ++i)
+            {
+                double t;
+                if (rayTriangle(m_bvh.getTriangle(i), origin, direction, t) && t >= 0.0 && t <= hit.distance)
+                {
+                    hit.distance = t;
+                    hit.face = m_bvh.getTriangle(i).face;
+                }
+            }
+            continue;
+        }
+
+        stack[top++] = node.first;
+        stack[top++] = index + 1;
+    }
+
+    if (hit.face < 0)
+    {
+        return false;
+    }
+
+    hit.point = origin + direction * geometry::Scalar(hit.distance);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CMeshQuery::raycast(const std::vector<SRay> &rays, std::vector<SRayHit> &hits) const
+{
+    hits.resize(rays.size());
+
+    const int count = int(rays.size());
+#pragma omp parallel for schedule(dynamic, 64)
+    for (int i = 0; i < count; ++i)
+    {
+        raycast(rays[i].origin, rays[i].direction, hits[i]);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool CMeshQuery::isCylinderInCollision(const geometry::Vec3 &center, const geometry::Vec3 &direction, double height, double radius) const
+{
+    geometry::Vec3 min, max;
+    cylinderBox(center, direction, height, radius, min, max);
+
+    std::vector<geometry::Vec3> triangle;
+    auto test = [&](const CMeshBVH::SNode &node)
+    {
+        return boxOverlap(node, min, max);
+    };
+    auto visitor = [&](int i)
+    {
+        getTriangle(m_bvh.getTriangle(i), triangle);
+        return geometry::triangleCylinderIntersection(triangle, center, direction, height, radius);
+    };
+    return traverse(m_bvh, test, visitor);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool CMeshQuery::isGuideTubeInCollision(const geometry::SGuideTubeCollision &collision) const
+{
+    for (int i = 0; i < 2; ++i)
+    {
+        if (isCylinderInCollision(collision.cylinderCenter[i], collision.direction, collision.cylinderHeight[i], collision.cylinderRadius[i]))
+        {
+            return true;
+        }
+    }
+
+    // cylinder tests handle only mesh surface, the metal cylinder is approximated by one point inside of the mesh
+    return isPointInside(collision.center, collision.upVector);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CMeshQuery::areGuideTubesInCollision(const std::vector<geometry::SGuideTubeCollision> &collisions, std::vector<unsigned char> &results) const
+{
+    results.assign(collisions.size(), 0);
+
+    const int count = int(collisions.size());
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < count; ++i)
+    {
+        results[i] = isGuideTubeInCollision(collisions[i]) ? 1 : 0;
+    }
+}
+
+} // namespace geometry
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
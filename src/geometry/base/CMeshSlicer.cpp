@@ -0,0 +1,541 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <geometry/base/CMeshSlicer.h>
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace geometry
+{
+
+namespace
+{
+
+//! Shorter segments are merged, some drivers crash on extremely short lines.
+const float OUTPUT_PRECISION = 0.001f;
+
+inline int sign(float value)
+{
+    return (0.0f < value) - (value < 0.0f);
+}
+
+//! Key of a contour point lying on a mesh edge or on a mesh vertex (a == b).
+inline unsigned long long pointKey(int a, int b)
+{
+    return (static_cast<unsigned long long>(static_cast<unsigned int>(std::min(a, b))) << 32) | static_cast<unsigned int>(std::max(a, b));
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+CMeshSlicer::CMeshSlicer()
+    : m_version(-1)
+{ }
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CMeshSlicer::clear()
+{
+    m_points.clear();
+    m_triangles.clear();
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        m_axes[axis] = SAxis();
+    }
+    m_version = -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CMeshSlicer::update(const geometry::CMesh &mesh, int version)
+{
+    if (version >= 0 && version == m_version)
+    {
+        return;
+    }
+    build(mesh);
+    m_version = version;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CMeshSlicer::build(const geometry::CMesh &mesh)
+{
+    clear();
+
+    const int numVertices = int(mesh.n_vertices());
+    const int numFaces = int(mesh.n_faces());
+    const bool hasStatus = mesh.has_face_status();
+
+    m_points.resize(numVertices);
+#pragma omp parallel for schedule(static)
+    for (int v = 0; v < numVertices; ++v)
+    {
+        const CMesh::Point &point = mesh.point(CMesh::VertexHandle(v));
+        m_points[v] = osg::Vec3(point[0], point[1], point[2]);
+    }
+
+    // Vertices of faces, faces which are deleted or are not triangles are skipped
+    std::vector<int> vertices(3 * size_t(numFaces), -1);
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (int f = 0; f < numFaces; ++f)
+    {
+        const CMesh::FaceHandle fh(f);
+        if (hasStatus && mesh.status(fh).deleted())
+        {
+            continue;
+        }
+
+        int face[3];
+        int i = 0;
+        for (CMesh::ConstFaceVertexIter fvit = mesh.cfv_iter(fh); fvit; ++fvit, ++i)
+        {
+            if (i < 3)
+            {
+                face[i] = fvit.handle().idx();
+            }
+        }
+        if (3 == i)
+        {
+            std::copy(face, face + 3, vertices.begin() + 3 * f);
+        }
+    }
+
+    m_triangles.reserve(vertices.size());
+    for (int f = 0; f < numFaces; ++f)
+    {
+        if (vertices[3 * f] >= 0)
+        {
+            m_triangles.insert(m_triangles.end(), vertices.begin() + 3 * f, vertices.begin() + 3 * f + 3);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CMeshSlicer::buildAxis(int axis)
+{
+    SAxis &index = m_axes[axis];
+    index.built = true;
+
+    // Extents of triangles along the axis
+    const int numTriangles = int(m_triangles.size() / 3);
+    index.min.resize(numTriangles);
+    index.max.resize(numTriangles);
+#pragma omp parallel for schedule(static)
+    for (int t = 0; t < numTriangles; ++t)
+    {
+        const float a = m_points[m_triangles[3 * t]][axis];
+        const float b = m_points[m_triangles[3 * t + 1]][axis];
+        const float c = m_points[m_triangles[3 * t + 2]][axis];
+        index.min[t] = std::min(a, std::min(b, c));
+        index.max[t] = std::max(a, std::max(b, c));
+    }
+
+    if (0 == numTriangles)
+    {
+        return;
+    }
+
+    std::vector<int> order(numTriangles);
+    for (int t = 0; t < numTriangles; ++t)
+    {
+        order[t] = t;
+    }
+    index.byMin.reserve(numTriangles);
+    index.byMax.reserve(numTriangles);
+    buildNode(index, order, 0, numTriangles);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+int CMeshSlicer::buildNode(SAxis &index, std::vector<int> &order, int begin, int end)
+{
+    if (begin >= end)
+    {
+        return -1;
+    }
+
+    // Median of interval centers, at most half of triangles lies on each side of it
+    std::vector<float> centers;
+    centers.reserve(end - begin);
+    for (int i = begin; i < end; ++i)
+    {
+        centers.push_back(index.min[order[i]] + index.max[order[i]]);
+    }
+    std::nth_element(centers.begin(), centers.begin() + centers.size() / 2, centers.end());
+    const float center = 0.5f * centers[centers.size() / 2];
+
+    // Triangles below the center, crossing it and above it
+    const std::vector<float> &minima = index.min;
+    const std::vector<float> &maxima = index.max;
+    std::vector<int>::iterator itCross = std::partition(order.begin() + begin, order.begin() + end, [&maxima, center](int t) { return maxima[t] < center; });
+    std::vector<int>::iterator itAbove = std::partition(itCross, order.begin() + end, [&minima, center](int t) { return minima[t] <= center; });
+    const int cross = int(itCross - order.begin());
+    const int above = int(itAbove - order.begin());
+
+    const int current = int(index.nodes.size());
+    SNode node;
+    node.center = center;
+    node.left = node.right = -1;
+    node.first = int(index.byMin.size());
+    node.count = above - cross;
+    index.nodes.push_back(node);
+
+    index.byMin.insert(index.byMin.end(), order.begin() + cross, order.begin() + above);
+    index.byMax.insert(index.byMax.end(), order.begin() + cross, order.begin() + above);
+    std::sort(index.byMin.begin() + node.first, index.byMin.end(), [&minima](int a, int b) { return minima[a] < minima[b]; });
+    std::sort(index.byMax.begin() + node.first, index.byMax.end(), [&maxima](int a, int b) { return maxima[a] > maxima[b]; });
+
+    const int left = buildNode(index, order, begin, cross);
+    const int right = buildNode(index, order, above, end);
+    index.nodes[current].left = left;
+    index.nodes[current].right = right;
+    return current;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CMeshSlicer::findTriangles(const SAxis &index, float position, std::vector<int> &triangles) const
+{
+    int current = index.nodes.empty() ? -1 : 0;
+    while (current >= 0)
+    {
+        const SNode &node = index.nodes[current];
+        const int last = node.first + node.count;
+        if (position < node.center)
+        {
+            for (int i = node.first; i < last && index.min[index.byMin[i]] <= position; ++i)
+            {
+                triangles.push_back(index.byMin[i]);
+            }
+            current = node.left;
+        }
+        else if (position > node.center)
+        {
+            for (int i = node.first; i < last && index.max[index.byMax[i]] >= position; ++i)
+            {
+                triangles.push_back(index.byMax[i]);
+            }
+            current = node.right;
+        }
+        else
+        {
+            triangles.insert(triangles.end(), index.byMin.begin() + node.first, index.byMin.begin() + last);
+            current = -1;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool CMeshSlicer::intersect(int axis, int triangle, float position, SSegment &segment) const
+{
+    const int *v = &m_triangles[3 * triangle];
+    const float d[3] = { m_points[v[0]][axis] - position, m_points[v[1]][axis] - position, m_points[v[2]][axis] - position };
+    const int s[3] = { sign(d[0]), sign(d[1]), sign(d[2]) };
+
+    // completely above or completely below plane
+    if (s[0] == s[1] && s[0] == s[2] && s[0] != 0)
+    {
+        return false;
+    }
+
+    // Edges in the same order as CMeshCutter, only the first two intersections are used
+    static const int edges[3][2] = { { 0, 1 }, { 1, 2 }, { 0, 2 } };
+    int found = 0;
+    for (int e = 0; e < 3 && found < 2; ++e)
+    {
+        int i = edges[e][0];
+        int j = edges[e][1];
+        if (s[i] == s[j])
+        {
+            continue;
+        }
+
+        if (0 == s[i] || 0 == s[j])
+        {
+            // The plane passes through a vertex, both its edges report it once
+            const int k = (0 == s[i]) ? i : j;
+            if (found > 0 && segment.keys[0] == pointKey(v[k], v[k]))
+            {
+                continue;
+            }
+            segment.keys[found] = pointKey(v[k], v[k]);
+            segment.points[found] = m_points[v[k]];
+        }
+        else
+        {
+            // Interpolate from the vertex with the lower index so that both faces of the edge give the same point
+            if (v[i] > v[j])
+            {
+                std::swap(i, j);
+            }
+            const float ai = std::fabs(d[i]);
+            const float aj = std::fabs(d[j]);
+            segment.keys[found] = pointKey(v[i], v[j]);
+            segment.points[found] = m_points[v[i]] + (m_points[v[j]] - m_points[v[i]]) * (ai / (ai + aj));
+        }
+        ++found;
+    }
+
+    return 2 == found && segment.keys[0] != segment.keys[1];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void CMeshSlicer::computeContour(int axis, float position, std::vector<SPolyline> &polylines) const
+{
+    polylines.clear();
+
+    std::vector<int> triangles;
+    findTriangles(m_axes[axis], position, triangles);
+    const int numTriangles = int(triangles.size());
+    if (0 == numTriangles)
+    {
+        return;
+    }
+
+    // Every triangle writes only its own slot
+    std::vector<SSegment> segments(numTriangles);
+    std::vector<unsigned char> valid(numTriangles, 0);
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (int i = 0; i < numTriangles; ++i)
+    {
+        valid[i] = intersect(axis, triangles[i], position, segments[i]) ? 1 : 0;
+    }
+
+    // Compact, segments lying in the plane come from both adjacent faces and are kept once
+    int numSegments = 0;
+    for (int i = 0; i < numTriangles; ++i)
+    {
+        if (valid[i])
+        {
+            SSegment &segment = segments[i];
+            if (segment.keys[0] > segment.keys[1])
+            {
+                std::swap(segment.keys[0], segment.keys[1]);
+                std::swap(segment.points[0], segment.points[1]);
+            }
+            segments[numSegments++] = segment;
+        }
+    }
+    segments.resize(numSegments);
+    std::sort(segments.begin(), segments.end(), [](const SSegment &a, const SSegment &b)
+    {
+        return a.keys[0] < b.keys[0] || (a.keys[0] == b.keys[0] && a.keys[1] < b.keys[1]);
+    });
+    segments.erase(std::unique(segments.begin(), segments.end(), [](const SSegment &a, const SSegment &b)
+    {
+        return a.keys[0] == b.keys[0] && a.keys[1] == b.keys[1];
+    }), segments.end());
+    numSegments = int(segments.size());
+
+    // Link segment ends sharing a key, ends are numbered 2 * segment + end
+    std::vector<std::pair<unsigned long long, int> > ends;
+    ends.reserve(2 * numSegments);
+    for (int i = 0; i < numSegments; ++i)
+    {
+        ends.push_back(std::make_pair(segments[i].keys[0], 2 * i));
+        ends.push_back(std::make_pair(segments[i].keys[1], 2 * i + 1));
+    }
+    std::sort(ends.begin(), ends.end());
+
+    std::vector<int> links(2 * numSegments, -1);
+    for (size_t i = 0; i + 1 < ends.size(); ++i)
+    {
+        if (ends[i].first == ends[i + 1].first)
+        {
+            // Ends of non manifold edges are paired in order
+            links[ends[i].second] = ends[i + 1].second;
+            links[ends[i + 1].second] = ends[i].second;
+            ++i;
+        }
+    }
+
+    // Walks from open ends first, segments left over form closed loops
+    std::vector<unsigned char> visited(numSegments, 0);
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (int start = 0; start < numSegments; ++start)
+        {
+            if (visited[start])
+            {
+                continue;
+            }
+
+            int end = 0;
+            if (0 == pass)
+            {
+                if (links[2 * start] >= 0 && links[2 * start + 1] >= 0)
+                {
+                    continue;
+                }
+                end = (links[2 * start] < 0) ? 0 : 1;
+            }
+
+            SPolyline polyline;
+            polyline.closed = false;
+            polyline.points.push_back(segments[start].points[end]);
+
+            int current = start;
+            while (true)
+            {
+                visited[current] = 1;
+                const int other = 1 - end;
+                const osg::Vec3 &point = segments[current].points[other];
+                if ((point - polyline.points.back()).length() >= OUTPUT_PRECISION)
+                {
+                    polyline.points.push_back(point);
+                }
+
+                const int next = links[2 * current + other];
+                if (next < 0)
+                {
+                    break;
+                }
+                if (visited[next / 2])
+                {
+                    polyline.closed = (next / 2 == start);
+                    break;
+                }
+                current = next / 2;
+                end = next % 2;
+            }
+
+            if (polyline.closed && polyline.points.size() > 1 && (polyline.points.back() - polyline.points.front()).length() < OUTPUT_PRECISION)
+            {
+                polyline.points.pop_back();
+            }
+            if (polyline.points.size() > 1)
+            {
+                polylines.push_back(polyline);
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+const std::vector<CMeshSlicer::SPolyline> &CMeshSlicer::slice(int axis, float position)
+{
+    static const std::vector<SPolyline> empty;
+    if (axis < 0 || axis > 2)
+    {
+        return empty;
+    }
+
+    SAxis &axisIndex = m_axes[axis];
+    if (!axisIndex.built)
+    {
+        buildAxis(axis);
+    }
+    std::vector<SCacheEntry> &cache = axisIndex.cache;
+    ++axisIndex.useCounter;
+
+    // Cached contour
+    for (size_t i = 0; i < cache.size(); ++i)
+    {
+        if (cache[i].position == position)
+        {
+            cache[i].lastUse = axisIndex.useCounter;
+            return cache[i].polylines;
+        }
+    }
+
+    // The least recently used entry is replaced
+    size_t index = cache.size();
+    if (cache.size() < CACHE_SIZE)
+    {
+        cache.push_back(SCacheEntry());
+    }
+    else
+    {
+        index = 0;
+        for (size_t i = 1; i < cache.size(); ++i)
+        {
+            if (cache[i].lastUse < cache[index].lastUse)
+            {
+                index = i;
+            }
+        }
+    }
+
+    SCacheEntry &entry = cache[index];
+    entry.position = position;
+    entry.lastUse = axisIndex.useCounter;
+    computeContour(axis, position, entry.polylines);
+    return entry.polylines;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool CMeshSlicer::cut(int axis, float position, osg::Vec3Array *vertices, osg::DrawElementsUInt *indices)
+{
+    if (NULL == vertices || NULL == indices)
+    {
+        return false;
+    }
+
+    const std::vector<SPolyline> &polylines = slice(axis, position);
+    for (size_t p = 0; p < polylines.size(); ++p)
+    {
+        const SPolyline &polyline = polylines[p];
+        const unsigned int first = (unsigned int)vertices->size();
+        const unsigned int count = (unsigned int)polyline.points.size();
+        vertices->insert(vertices->end(), polyline.points.begin(), polyline.points.end());
+        for (unsigned int i = 0; i + 1 < count; ++i)
+        {
+            indices->push_back(first + i);
+            indices->push_back(first + i + 1);
+        }
+        if (polyline.closed && count > 2)
+        {
+            indices->push_back(first + count - 1);
+            indices->push_back(first);
+        }
+    }
+
+    vertices->dirty();
+    indices->dirty();
+    return true;
+}
+
+} // namespace geometry
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
@@ -40,6 +40,12 @@ void geometry::CTrianglesContainer::init()
     m_indicies.resize(0);
 }
 
+void geometry::CTrianglesContainer::reserve(size_t vertices, size_t triangles)
+{
+    m_vertices.reserve(vertices);
+    m_indicies.reserve(triangles * 3);
+}
+
 void geometry::CTrianglesContainer::addVertex(double x, double y, double z)
 {
     m_vertices.push_back(geometry::Vec3(x, y, z));
@@ -827,18 +827,10 @@ bool isPointInsideMesh(geometry::CMesh& mesh, const geometry::Vec3& point, const
         faceHandles.insert(faceHandles.end(), (*itn)->faces.begin(), (*itn)->faces.end());
     }
 
-    // structure for intersections data
-    typedef struct SIntersection {
-        geometry::Vec3 point;
-        double distance;
-        bool faceUp;
-        bool invalid;
-    } SIntersection;
-
-    std::vector<SIntersection> intersections(faceHandles.size());
+    std::vector<SLineIntersection> intersections(faceHandles.size());
 
     // find all faces that intersects with the line
-    SIntersection invalidIntersection = { geometry::Vec3(), 0.0, false, true };
+    SLineIntersection invalidIntersection = { geometry::Vec3(), 0.0, false, true };
 #pragma omp parallel for shared (intersections)
     for (int i = 0; i < static_cast<int>(faceHandles.size()); ++i)
     {
@@ -873,8 +865,25 @@ bool isPointInsideMesh(geometry::CMesh& mesh, const geometry::Vec3& point, const
         intersections[i] = { intersection, distance, faceUp, false };
     }
 
+    return isPointInsideIntersections(intersections, point, upVector, minDist, maxDist);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//!\brief   Decides if point is inside of mesh from intersections of mesh with a line going through the point
+//! the line has direction of upVector, mesh dimensions along the line are used as caps of opened meshes
+//!
+//!\param   intersections   Intersections of the line with mesh triangles, sorted in place
+//!\param   point           Point in question
+//!\param   upVector        Vector pointing upwards
+//!\param   minDist         Lower dimension of mesh along the line
+//!\param   maxDist         Upper dimension of mesh along the line
+//!
+//!\return  True if the point is inside of mesh
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool isPointInsideIntersections(std::vector<SLineIntersection>& intersections, const geometry::Vec3& point, const geometry::Vec3& upVector, double minDist, double maxDist)
+{
     // clear invalid intersections
-    intersections.erase(std::remove_if(intersections.begin(), intersections.end(), [](SIntersection intersection) {return intersection.invalid; }), intersections.end());
+    intersections.erase(std::remove_if(intersections.begin(), intersections.end(), [](SLineIntersection intersection) {return intersection.invalid; }), intersections.end());
 
     // no intersection, point is outside
     double size = intersections.size();
@@ -882,9 +891,9 @@ bool isPointInsideMesh(geometry::CMesh& mesh, const geometry::Vec3& point, const
         return false;
 
     // sort intersections from bottom up
-    std::sort(intersections.begin(), intersections.end(), [](SIntersection a, SIntersection b) { return a.distance < b.distance; });
+    std::sort(intersections.begin(), intersections.end(), [](SLineIntersection a, SLineIntersection b) { return a.distance < b.distance; });
 
-    std::vector<SIntersection> copy;
+    std::vector<SLineIntersection> copy;
     copy.reserve(intersections.size()+2);
 
     // Go through intersections and store only change of state
@@ -898,7 +907,7 @@ bool isPointInsideMesh(geometry::CMesh& mesh, const geometry::Vec3& point, const
     //        out    in       out      in      out      
     ////////////////////////////////////////////////////////////////////////////////
     bool inside = false;
-    std::vector<SIntersection>::iterator it = intersections.begin(), itEnd = intersections.end();
+    std::vector<SLineIntersection>::iterator it = intersections.begin(), itEnd = intersections.end();
     for (; it != itEnd; ++it)
     {
         if (inside)
@@ -925,7 +934,7 @@ bool isPointInsideMesh(geometry::CMesh& mesh, const geometry::Vec3& point, const
                 if (copy.empty())
                 { 
                     // insert cap to "close" the model
-                    copy.push_back({ (point + upVector * vpl::CScalar<double>(minDist)), minDist, false });
+                    copy.push_back({ (point + upVector * vpl::CScalar<double>(minDist)), minDist, false, false });
                     // insert current intersectin  to close the inside reguion
                     copy.push_back(*it);
                 }
@@ -939,11 +948,11 @@ bool isPointInsideMesh(geometry::CMesh& mesh, const geometry::Vec3& point, const
     }
     if (!copy.empty() && !copy.back().faceUp)
     { // insert cap to "close" the model
-        copy.push_back({ (point + upVector * vpl::CScalar<double>(maxDist)), maxDist, true });
+        copy.push_back({ (point + upVector * vpl::CScalar<double>(maxDist)), maxDist, true, false });
     }
 
     // go through intersections vector and check if point is inside, 0.0 is position of point
-    std::vector<SIntersection>::iterator it2 = copy.begin(), it2End = copy.end();
+    std::vector<SLineIntersection>::iterator it2 = copy.begin(), it2End = copy.end();
     for (; it2 != it2End; ++it2)
     {
         if (it2->faceUp && it2->distance >= 0.0)
@@ -1140,7 +1149,16 @@ bool compareMatrices(const geometry::Matrix &a, const geometry::Matrix &b)
     return true;
 }
 
-bool isGuideTubeInCollisionWithMesh(geometry::CMesh& mesh, const geometry::Matrix& modelMatrix, const double GTOffset, const double GTHeight, const double GTDistance, const double GTAllowance, const double MCHeight, const double MCDiameter, const double MCLipWidth, const geometry::Vec3& IPosition, const geometry::Vec3& IDirection)
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//!\brief   Computes collision volume of a guide tube in model coordinates
+//! the volume consists of the inside of the guide tube and of the space on top of it
+//!
+//!\param   modelMatrix     Model matrix of the mesh
+//!\param   IPosition       Implant position in world coordinates
+//!\param   IDirection      Implant direction in world coordinates
+//!\param   collision       Output collision volume
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void getGuideTubeCollision(const geometry::Matrix& modelMatrix, const double GTOffset, const double GTHeight, const double GTDistance, const double GTAllowance, const double MCHeight, const double MCDiameter, const double MCLipWidth, const geometry::Vec3& IPosition, const geometry::Vec3& IDirection, SGuideTubeCollision& collision)
 {
     // get implant position and direction in model coordinates
     geometry::Matrix invModelMat = geometry::Matrix::inverse(modelMatrix);
@@ -1149,27 +1167,45 @@ bool isGuideTubeInCollisionWithMesh(geometry::CMesh& mesh, const geometry::Matri
     invModelMat.setTrans(translation);
     geometry::Vec3 direction((invModelMat * IDirection) - translation);
     direction.normalize();
+    collision.direction = direction;
 
     // compute center point and up vector
-    geometry::Vec3 center = position - direction * geometry::Scalar(GTOffset);
-    geometry::Vec3 upVector((invModelMat * geometry::Vec3(0.0, 0.0, 1.0)) - translation);
-    upVector.normalize();
+    collision.center = position - direction * geometry::Scalar(GTOffset);
+    collision.upVector = (invModelMat * geometry::Vec3(0.0, 0.0, 1.0)) - translation;
+    collision.upVector.normalize();
 
     // Compute dimmension of first collision cylinder (inside of guide tube)
-    double cyl1radius = (MCDiameter + GTDistance) * 0.5;
-    double cyl1height = std::max(0.0, GTHeight - GTAllowance);
-    geometry::Vec3 cyl1center = position - direction * geometry::Scalar(GTOffset - (cyl1height * 0.5));
+    collision.cylinderRadius[0] = (MCDiameter + GTDistance) * 0.5;
+    collision.cylinderHeight[0] = std::max(0.0, GTHeight - GTAllowance);
+    collision.cylinderCenter[0] = position - direction * geometry::Scalar(GTOffset - (collision.cylinderHeight[0] * 0.5));
 
     // Compute dimmension of second collision cylinder (on top of guide tube)
-    double cyl2radius = ((MCDiameter + GTDistance) * 0.5) + MCLipWidth;
-    double cyl2height = MCHeight;
-    geometry::Vec3 cyl2center = position - direction * geometry::Scalar(GTOffset + (cyl2height * 0.5));
+    collision.cylinderRadius[1] = ((MCDiameter + GTDistance) * 0.5) + MCLipWidth;
+    collision.cylinderHeight[1] = MCHeight;
+    collision.cylinderCenter[1] = position - direction * geometry::Scalar(GTOffset + (collision.cylinderHeight[1] * 0.5));
 
     // Compute bounding box of collision cylinders
-    geometry::Vec3 bbcenter = center;
-    double bbhside = std::sqrt((cyl2radius * cyl2radius) + (cyl2height * cyl2height));
+    double bbhside = std::sqrt((collision.cylinderRadius[1] * collision.cylinderRadius[1]) + (collision.cylinderHeight[1] * collision.cylinderHeight[1]));
     geometry::Vec3 bbhdist(bbhside, bbhside, bbhside);
-    osg::BoundingBox bb(geometry::convert3<osg::Vec3>(bbcenter - bbhdist), geometry::convert3<osg::Vec3>(bbcenter + bbhdist));
+    collision.boxMin = collision.center - bbhdist;
+    collision.boxMax = collision.center + bbhdist;
+}
+
+bool isGuideTubeInCollisionWithMesh(geometry::CMesh& mesh, const geometry::Matrix& modelMatrix, const double GTOffset, const double GTHeight, const double GTDistance, const double GTAllowance, const double MCHeight, const double MCDiameter, const double MCLipWidth, const geometry::Vec3& IPosition, const geometry::Vec3& IDirection)
+{
+    SGuideTubeCollision collision;
+    getGuideTubeCollision(modelMatrix, GTOffset, GTHeight, GTDistance, GTAllowance, MCHeight, MCDiameter, MCLipWidth, IPosition, IDirection, collision);
+
+    const geometry::Vec3& direction = collision.direction;
+    const geometry::Vec3& center = collision.center;
+    const geometry::Vec3& upVector = collision.upVector;
+    const geometry::Vec3& cyl1center = collision.cylinderCenter[0];
+    const geometry::Vec3& cyl2center = collision.cylinderCenter[1];
+    const double cyl1radius = collision.cylinderRadius[0];
+    const double cyl2radius = collision.cylinderRadius[1];
+    const double cyl1height = collision.cylinderHeight[0];
+    const double cyl2height = collision.cylinderHeight[1];
+    osg::BoundingBox bb(geometry::convert3<osg::Vec3>(collision.boxMin), geometry::convert3<osg::Vec3>(collision.boxMax));
 
     if (nullptr == mesh.getOctree())
     {
@@ -0,0 +1,310 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <geometry/metrics/surfaceDistance.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+
+namespace geometry
+{
+const char *SurfaceDistance::DISTANCE_PROPERTY = "surfaceDistance";
+
+SurfaceDistance::SurfaceDistance(const CMesh& reference)
+    : m_isVertexSample(true)
+    , m_isFaceSample(true)
+    , m_maxSamples(100000)
+    , m_seed(std::mt19937::default_seed)
+    , m_min(0)
+    , m_max(0)
+    , m_sum(0)
+    , m_sum2(0)
+    , m_samplesCount(0)
+{
+    m_bvh.build(reference);
+}
+
+void SurfaceDistance::setSampleType(const bool isVertexSampling, const bool isFaceSampling)
+{
+    m_isVertexSample = isVertexSampling;
+    m_isFaceSample = isFaceSampling;
+}
+
+void SurfaceDistance::setSampleCount(const size_t sampleCount)
+{
+    m_maxSamples = sampleCount;
+}
+
+void SurfaceDistance::setSeed(const unsigned seed)
+{
+    m_seed = seed;
+}
+
+const CMeshBVH& SurfaceDistance::getBVH() const
+{
+    return m_bvh;
+}
+
+double SurfaceDistance::getMinDistance() const
+{
+    return m_min;
+}
+
+double SurfaceDistance::getMaxDistance() const
+{
+    return m_max;
+}
+
+double SurfaceDistance::getMeanDistance() const
+{
+    return m_samplesCount > 0 ? m_sum / m_samplesCount : 0.0;
+}
+
+double SurfaceDistance::getRmsDistance() const
+{
+    return m_samplesCount > 0 ? std::sqrt(m_sum2 / m_samplesCount) : 0.0;
+}
+
+size_t SurfaceDistance::getSamplesCount() const
+{
+    return m_samplesCount;
+}
+
+void SurfaceDistance::generateSamples(const CMesh& mesh, std::vector<CMesh::Point>& samples) const
+{
+    std::mt19937 generator(m_seed);
+    const bool hasStatus = mesh.has_face_status();
+
+    //! Vertex samples, all vertices or a random subset of them.
+    if (m_isVertexSample)
+    {
+        const bool hasVertexStatus = mesh.has_vertex_status();
+        std::vector<int> indices;
+        indices.reserve(mesh.n_vertices());
+        for (CMesh::ConstVertexIter vit = mesh.vertices_begin(); vit != mesh.vertices_end(); ++vit)
+        {
+            if (!hasVertexStatus || !mesh.status(vit.handle()).deleted())
+            {
+                indices.push_back(vit.handle().idx());
+            }
+        }
+
+        const size_t vertexCount = indices.size();
+        if (m_maxSamples >= vertexCount)
+        {
+            for (size_t v = 0; v < vertexCount; ++v)
+            {
+                samples.push_back(mesh.point(CMesh::VertexHandle(indices[v])));
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < m_maxSamples; ++i)
+            {
+                std::uniform_int_distribution<size_t> pick(i, vertexCount - 1);
+                std::swap(indices[i], indices[pick(generator)]);
+                samples.push_back(mesh.point(CMesh::VertexHandle(indices[i])));
+            }
+        }
+    }
+
+    //! Face samples, triangles are selected with probability given by their area.
+    if (m_isFaceSample && m_maxSamples > 0)
+    {
+        std::vector<CMesh::FaceHandle> faces;
+        std::vector<double> areas;
+        double area = 0;
+        for (CMesh::ConstFaceIter fit = mesh.faces_begin(); fit != mesh.faces_end(); ++fit)
+        {
+            if (hasStatus && mesh.status(fit.handle()).deleted())
+            {
+                continue;
+            }
+            CMesh::ConstFaceVertexIter fvit = mesh.cfv_iter(fit.handle());
+            const CMesh::Point& a = mesh.point(fvit.handle());
+            ++fvit;
+            const CMesh::Point& b = mesh.point(fvit.handle());
+            ++fvit;
+            const CMesh::Point& c = mesh.point(fvit.handle());
+
+            area += 0.5 * ((b - a) % (c - a)).norm();
+            faces.push_back(fit.handle());
+            areas.push_back(area);
+        }
+
+        if (area <= 0)
+        {
+            return;
+        }
+
+        std::uniform_real_distribution<double> unif01(0, 1);
+        for (size_t i = 0; i < m_maxSamples; ++i)
+        {
+            const size_t index = std::min<size_t>(std::lower_bound(areas.begin(), areas.end(), area * unif01(generator)) - areas.begin(), faces.size() - 1);
+
+            double u = unif01(generator);
+            double v = unif01(generator);
+            if (u + v > 1.0)
+            {
+                u = 1.0 - u;
+                v = 1.0 - v;
+            }
+
+            CMesh::ConstFaceVertexIter fvit = mesh.cfv_iter(faces[index]);
+            const CMesh::Point& a = mesh.point(fvit.handle());
+            ++fvit;
+            const CMesh::Point& b = mesh.point(fvit.handle());
+            ++fvit;
+            const CMesh::Point& c = mesh.point(fvit.handle());
+
+            samples.push_back(a + (b - a) * float(u) + (c - a) * float(v));
+        }
+    }
+}
+
+bool SurfaceDistance::compute(const CMesh& mesh)
+{
+    m_min = 0;
+    m_max = 0;
+    m_sum = 0;
+    m_sum2 = 0;
+    m_samplesCount = 0;
+
+    if (m_bvh.isEmpty())
+    {
+        return false;
+    }
+
+    std::vector<CMesh::Point> samples;
+    generateSamples(mesh, samples);
+    if (samples.empty())
+    {
+        return false;
+    }
+
+    const int count = int(samples.size());
+    double min = std::numeric_limits<double>::max();
+    double max = 0;
+    double sum = 0;
+    double sum2 = 0;
+    size_t found = 0;
+
+#pragma omp parallel
+    {
+        //! Per thread accumulators, merged once at the end.
+        double threadMin = std::numeric_limits<double>::max();
+        double threadMax = 0;
+        double threadSum = 0;
+        double threadSum2 = 0;
+        size_t threadFound = 0;
+
+#pragma omp for schedule(dynamic, 256) nowait
+        for (int i = 0; i < count; ++i)
+        {
+            CMeshBVH::SClosestPoint closest;
+            if (m_bvh.findClosest(samples[i], closest))
+            {
+                const double distance = closest.distance;
+                threadMin = std::min(threadMin, distance);
+                threadMax = std::max(threadMax, distance);
+                threadSum += distance;
+                threadSum2 += distance * distance;
+                ++threadFound;
+            }
+        }
+
+#pragma omp critical
+        {
+            min = std::min(min, threadMin);
+            max = std::max(max, threadMax);
+            sum += threadSum;
+            sum2 += threadSum2;
+            found += threadFound;
+        }
+    }
+
+    if (found == 0)
+    {
+        return false;
+    }
+
+    m_min = min;
+    m_max = max;
+    m_sum = sum;
+    m_sum2 = sum2;
+    m_samplesCount = found;
+    return true;
+}
+
+bool SurfaceDistance::computeVertexDistances(CMesh& mesh, const std::string& propertyName, const bool isPersistent) const
+{
+    if (m_bvh.isEmpty())
+    {
+        return false;
+    }
+
+    OpenMesh::VPropHandleT<float> vProp_distance;
+    if (!mesh.get_property_handle(vProp_distance, propertyName))
+    {
+        mesh.add_property(vProp_distance, propertyName);
+    }
+    if (isPersistent)
+    {
+        mesh.setSerializedProperty(propertyName, CMesh::PPT_VERTEX, CMesh::PPV_FLOAT);
+    }
+
+    const int count = int(mesh.n_vertices());
+
+#pragma omp parallel for schedule(dynamic, 256)
+    for (int v = 0; v < count; ++v)
+    {
+        const CMesh::VertexHandle vh(v);
+        float distance = 0.0f;
+        m_bvh.getSignedDistance(mesh.point(vh), distance);
+        mesh.property(vProp_distance, vh) = distance;
+    }
+    return true;
+}
+
+bool SurfaceDistance::colorVertices(CMesh& mesh, const float range, const std::string& propertyName)
+{
+    OpenMesh::VPropHandleT<float> vProp_distance;
+    if (range <= 0.0f || !mesh.get_property_handle(vProp_distance, propertyName))
+    {
+        return false;
+    }
+
+    const int count = int(mesh.n_vertices());
+
+#pragma omp parallel for schedule(static)
+    for (int v = 0; v < count; ++v)
+    {
+        const CMesh::VertexHandle vh(v);
+        const float t = std::min(1.0f, std::fabs(mesh.property(vProp_distance, vh)) / range);
+        const unsigned char fade = static_cast<unsigned char>(255.0f * (1.0f - t) + 0.5f);
+        mesh.set_color(vh, mesh.property(vProp_distance, vh) >= 0.0f ? CMesh::Color(255, fade, fade) : CMesh::Color(fade, fade, 255));
+    }
+    return true;
+}
+}
@@ -1187,6 +1187,7 @@ CMarchingCubesWorkerFast::CMarchingCubesWorkerFast()
     // initialization of work matrices to NULL value
     m_state_matrix_up = NULL;
     m_state_matrix_down = NULL;
+    m_row_bits = NULL;
     m_node_matrix_up_h = NULL;
     m_node_matrix_up_v = NULL;
     m_node_matrix_down_h = NULL;
@@ -1278,16 +1279,19 @@ unsigned char CMarchingCubesWorkerFast::getCubeCodeLeft(int x, int y)
 //! Create actual cube code and save it into code matrix
 unsigned char CMarchingCubesWorkerFast::makeCubeCode(int x, int y)
 {
+    // states of the run loaded by loadCubeRun()
+    const int shift = x % CVoxelRowClassifier::WORD_BITS;
+    const unsigned down = unsigned(m_run_states[0] >> shift) & 3;
+    const unsigned down_next = unsigned(m_run_states[1] >> shift) & 3;
+    const unsigned up = unsigned(m_run_states[2] >> shift) & 3;
+    const unsigned up_next = unsigned(m_run_states[3] >> shift) & 3;
+
     // create cube code
     unsigned char code = 0;
-    code += m_state_matrix_down[y * m_work_matrices_size_x + x];
-    code += m_state_matrix_down[y * m_work_matrices_size_x + x + 1] << 1;
-    code += m_state_matrix_down[((y + 1) * m_work_matrices_size_x) + x + 1] << 2;
-    code += m_state_matrix_down[((y + 1) * m_work_matrices_size_x) + x] << 3;
-    code += m_state_matrix_up[y * m_work_matrices_size_x + x] << 4;
-    code += m_state_matrix_up[y * m_work_matrices_size_x + x + 1] << 5;
-    code += m_state_matrix_up[((y + 1) * m_work_matrices_size_x) + x + 1] << 6;
-    code += m_state_matrix_up[((y + 1) * m_work_matrices_size_x) + x] << 7;
+    code += down;
+    code += ((down_next & 1) << 3) | ((down_next & 2) << 1);
+    code += up << 4;
+    code += ((up_next & 1) << 7) | ((up_next & 2) << 5);
 
     // save cube code into code matrix
     m_cube_code_matrix[(y + 1) * m_work_matrices_size_x + x + 1] = code;
@@ -1295,6 +1299,57 @@ unsigned char CMarchingCubesWorkerFast::makeCubeCode(int x, int y)
     return code;
 }
 
+//! Loads states of the run of cubes and checks whether it is uniform
+bool CMarchingCubesWorkerFast::loadCubeRun(int x, int y)
+{
+    // cubes [x, x + 32) use state bits [x, x + 32] of rows y and y + 1
+    const int word = x / CVoxelRowClassifier::WORD_BITS;
+    const CVoxelRowClassifier::tWord *rows[4] = {
+        &m_state_matrix_down[y * m_state_row_words + word],
+        &m_state_matrix_down[(y + 1) * m_state_row_words + word],
+        &m_state_matrix_up[y * m_state_row_words + word],
+        &m_state_matrix_up[(y + 1) * m_state_row_words + word]
+    };
+
+    bool uniform = true;
+    for (int i = 0; i < 4; ++i)
+    {
+        m_run_states[i] = rows[i][0] | (vpl::sys::tUInt64(rows[i][1]) << CVoxelRowClassifier::WORD_BITS);
+        uniform = uniform && rows[i][0] == rows[0][0] && (rows[i][1] & 1) == (rows[0][0] & 1);
+    }
+    if (!uniform || (rows[0][0] != 0 && rows[0][0] != ~CVoxelRowClassifier::tWord(0)))
+    {
+        return false;
+    }
+
+    // cleared code matrix already holds zero codes
+    if (0 != rows[0][0])
+    {
+        memset(&m_cube_code_matrix[(y + 1) * m_work_matrices_size_x + x + 1], 255, CVoxelRowClassifier::WORD_BITS);
+    }
+
+    return true;
+}
+
+//! Classifies row of voxels and saves it into up state matrix.
+void CMarchingCubesWorkerFast::classifyStateRow(const IMarchingCubesFastFunctor *volumeFunctor, int y, int z, int volume_size_x)
+{
+    CVoxelRowClassifier::tWord *row = &m_state_matrix_up[(y + 1) * m_state_row_words];
+
+    // voxels left of the volume are skipped, bit c of the row holds voxel c - 1
+    const int firstX = (m_volume_start_x == 0) ? 0 : -1;
+    const int count = volume_size_x - firstX + 1;
+    if (firstX < 0)
+    {
+        volumeFunctor->classifyRow(firstX + m_volume_start_x, y + m_volume_start_y, z + m_volume_start_z, count, row);
+    }
+    else
+    {
+        volumeFunctor->classifyRow(m_volume_start_x, y + m_volume_start_y, z + m_volume_start_z, count, m_row_bits);
+        CVoxelRowClassifier::copyBits(m_row_bits, count, row, 1);
+    }
+}
+
 //! Calculate number of nodes for cube code.
 int CMarchingCubesWorkerFast::cubeCodeNodeNumber(unsigned char cube_code)
 {
@@ -1314,7 +1369,8 @@ bool CMarchingCubesWorkerFast::generateMesh(std::vector<double> &xCoords, std::v
     m_voxelSize = volumeFunctor->getVoxelSize();
 
     unsigned char cube_code; // code of actual cube
-    unsigned char *state_matrix_ptr, *cube_code_matrix_ptr; // help pointers on state and code matrix
+    CVoxelRowClassifier::tWord *state_matrix_ptr; // help pointer on state matrix
+    unsigned char *cube_code_matrix_ptr; // help pointer on code matrix
     bool *node_matrix_ptr; // help pointer on node matrix
     int *node_matrix_index_ptr;
 
@@ -1342,16 +1398,8 @@ bool CMarchingCubesWorkerFast::generateMesh(std::vector<double> &xCoords, std::v
                 continue;
             }
 
-            for (int x = -1; x <= volume_size_x; ++x)
-            {
-                if ((x < 0) && (m_volume_start_x == 0))
-                {
-                    continue;
-                }
-
-                // get volume voxel state and save it into up voxel state matrix
-                m_state_matrix_up[((y + 1) * m_work_matrices_size_x) + x + 1] = volumeFunctor->operator()(x + m_volume_start_x, y + m_volume_start_y, z + m_volume_start_z);
-            }
+            // get states of the whole row of volume voxels and save them into up voxel state matrix
+            classifyStateRow(volumeFunctor, y, z, volume_size_x);
         }
 
         if (z != -1)
@@ -1362,6 +1410,13 @@ bool CMarchingCubesWorkerFast::generateMesh(std::vector<double> &xCoords, std::v
 
                 for (int x = 0; x <= volume_size_x; ++x)
                 {
+                    // skip runs of cubes lying completely outside or inside of the surface
+                    if (0 == x % CVoxelRowClassifier::WORD_BITS && loadCubeRun(x, y))
+                    {
+                        x += CVoxelRowClassifier::WORD_BITS - 1;
+                        continue;
+                    }
+
                     setCodeCoordinateX((x + m_volume_start_x - 0.5) * m_voxelSize.x(), m_voxelSize.x());
 
                     cube_code = makeCubeCode(x, y);
@@ -1410,7 +1465,7 @@ bool CMarchingCubesWorkerFast::generateMesh(std::vector<double> &xCoords, std::v
         // clearing state, node and code matrices
         int workMatrixSize = m_work_matrices_size_x * m_work_matrices_size_y;
 
-        memset(m_state_matrix_up, 0, workMatrixSize * sizeof(unsigned char));
+        memset(m_state_matrix_up, 0, m_state_row_words * m_work_matrices_size_y * sizeof(CVoxelRowClassifier::tWord));
         memset(m_cube_code_matrix, 0, workMatrixSize * sizeof(unsigned char));
 
         memset(m_node_matrix_up_h, false, workMatrixSize * sizeof(bool));
@@ -1440,8 +1495,11 @@ void CMarchingCubesWorkerFast::allocWorktMem(int size_x, int size_y)
     // allocation of work matrices
     int workMatrixSize = m_work_matrices_size_x * m_work_matrices_size_y;
 
-    m_state_matrix_up = new unsigned char[workMatrixSize];
-    m_state_matrix_down = new unsigned char[workMatrixSize];
+    m_state_row_words = CVoxelRowClassifier::wordCount(m_work_matrices_size_x) + 1;
+    const int stateMatrixSize = m_state_row_words * m_work_matrices_size_y;
+    m_state_matrix_up = new CVoxelRowClassifier::tWord[stateMatrixSize];
+    m_state_matrix_down = new CVoxelRowClassifier::tWord[stateMatrixSize];
+    m_row_bits = new CVoxelRowClassifier::tWord[m_state_row_words];
     m_cube_code_matrix = new unsigned char[workMatrixSize];
     m_down_cube_code_matrix = new unsigned char[workMatrixSize];
 
@@ -1458,8 +1516,8 @@ void CMarchingCubesWorkerFast::allocWorktMem(int size_x, int size_y)
     m_node_matrix_middle_index = new int[workMatrixSize];
 
     // clearing work matrices
-    memset(m_state_matrix_up, 0, workMatrixSize * sizeof(unsigned char));
-    memset(m_state_matrix_down, 0, workMatrixSize * sizeof(unsigned char));
+    memset(m_state_matrix_up, 0, stateMatrixSize * sizeof(CVoxelRowClassifier::tWord));
+    memset(m_state_matrix_down, 0, stateMatrixSize * sizeof(CVoxelRowClassifier::tWord));
     memset(m_cube_code_matrix, 0, workMatrixSize * sizeof(unsigned char));
     memset(m_down_cube_code_matrix, 0, workMatrixSize * sizeof(unsigned char));
 
@@ -1481,6 +1539,7 @@ void CMarchingCubesWorkerFast::deallocWorktMem()
     // free allocated work matrices memory
     delete[] m_state_matrix_up;
     delete[] m_state_matrix_down;
+    delete[] m_row_bits;
     delete[] m_node_matrix_up_h;
     delete[] m_node_matrix_up_v;
     delete[] m_node_matrix_down_h;
@@ -1497,6 +1556,7 @@ void CMarchingCubesWorkerFast::deallocWorktMem()
     // initialization of work matrices to NULL value
     m_state_matrix_up = NULL;
     m_state_matrix_down = NULL;
+    m_row_bits = NULL;
     m_node_matrix_up_h = NULL;
     m_node_matrix_up_v = NULL;
     m_node_matrix_down_h = NULL;
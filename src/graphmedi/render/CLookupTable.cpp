@@ -780,3 +780,133 @@ float CLookupTable::blendAlpha(float colorAAlpha, float colorBAlpha)
 {
     return colorAAlpha + colorBAlpha * (1.0 - colorAAlpha);
 }
+
+
+///////////////////////////////////////////////////////////////////////////////
+// 
+void createBuiltinLookupTables(std::map<std::string, CLookupTable> &lookupTables)
+{
+    CLookupTable &mipSoft = lookupTables["MIP_SOFT"];
+    CLookupTable &mipHard = lookupTables["MIP_HARD"];
+    CLookupTable &xraySoft = lookupTables["XRAY_SOFT"];
+    CLookupTable &xrayHard = lookupTables["XRAY_HARD"];
+    CLookupTable &shadingAir = lookupTables["SHA_AIR"];
+    CLookupTable &shadingTransparent = lookupTables["SHA_TRAN"];
+    CLookupTable &shadingBone0 = lookupTables["SHA_BONE0"];
+    CLookupTable &shadingBone1 = lookupTables["SHA_BONE1"];
+    CLookupTable &shadingBone2 = lookupTables["SHA_BONE2"];
+    CLookupTable &surfaceSkin = lookupTables["SURFACE_SKIN"];
+    CLookupTable &surfaceBone = lookupTables["SURFACE_BONE"];
+
+    mipSoft.setName("MIP soft");
+    mipSoft.clear();
+    mipSoft.addComponent();
+    mipSoft.setName(0, "component0");
+    mipSoft.addPoint(0, osg::Vec2d(0.000, 0.0), osg::Vec4(0.000, 0.000, 0.000, 0.000), true, false, 0.0);
+    mipSoft.addPoint(0, osg::Vec2d(0.123, 0.0), osg::Vec4(0.870, 0.705, 0.262, 1.000), true, false, 0.0);
+    mipSoft.addPoint(0, osg::Vec2d(0.246, 0.0), osg::Vec4(0.000, 0.000, 0.000, 0.000), true, false, 0.0);
+
+    mipHard.setName("MIP hard");
+    mipHard.clear();
+    mipHard.addComponent();
+    mipHard.setName(0, "component0");
+    mipHard.addPoint(0, osg::Vec2d(0.174, 0.0), osg::Vec4(0.000, 0.000, 0.000, 0.000), true, false, 0.0);
+    mipHard.addPoint(0, osg::Vec2d(0.533, 0.0), osg::Vec4(0.988, 0.988, 0.988, 1.000), true, false, 0.0);
+    mipHard.addPoint(0, osg::Vec2d(1.000, 0.0), osg::Vec4(1.000, 1.000, 1.000, 1.000), true, false, 0.0);
+
+    xraySoft.setName("X-ray soft");
+    xraySoft.clear();
+    xraySoft.addComponent();
+    xraySoft.setName(0, "component0");
+    xraySoft.addPoint(0, osg::Vec2d(0.038, 0.0), osg::Vec4(0.000, 0.000, 0.000, 0.000), true, false, 0.0);
+    xraySoft.addPoint(0, osg::Vec2d(0.130, 0.0), osg::Vec4(0.341, 0.266, 0.101, 0.139), true, false, 0.0);
+    xraySoft.addPoint(0, osg::Vec2d(0.309, 0.0), osg::Vec4(0.015, 0.039, 0.109, 0.000), true, false, 0.0);
+    xraySoft.addPoint(0, osg::Vec2d(0.310, 0.0), osg::Vec4(0.000, 0.000, 0.000, 0.000), true, false, 0.0);
+
+    xrayHard.setName("X-ray hard");
+    xrayHard.clear();
+    xrayHard.addComponent();
+    xrayHard.setName(0, "component0");
+    xrayHard.addPoint(0, osg::Vec2d(0.147, 0.0), osg::Vec4(0.000, 0.000, 0.000, 1.000), true, false, 0.0);
+    xrayHard.addPoint(0, osg::Vec2d(0.148, 0.0), osg::Vec4(0.043, 0.070, 0.101, 1.000), true, false, 0.0);
+    xrayHard.addPoint(0, osg::Vec2d(1.000, 0.0), osg::Vec4(1.000, 1.000, 1.000, 1.000), true, false, 0.0);
+
+    shadingAir.setName("Shading - air");
+    shadingAir.clear();
+    shadingAir.addComponent();
+    shadingAir.setName(0, "component0");
+    shadingAir.addPoint(0, osg::Vec2d(0.105, 0.0), osg::Vec4(0.000, 0.000, 0.000, 0.000), true, false, 0.0);
+    shadingAir.addPoint(0, osg::Vec2d(0.106, 0.0), osg::Vec4(0.000, 0.000, 0.000, 0.040), true, false, 0.0);
+    shadingAir.addPoint(0, osg::Vec2d(0.139, 0.0), osg::Vec4(0.407, 0.988, 0.960, 0.204), true, false, 0.0);
+    shadingAir.addPoint(0, osg::Vec2d(0.162, 0.0), osg::Vec4(0.000, 0.000, 0.000, 0.000), true, false, 0.0);
+
+    shadingTransparent.setName("Shading - transparent");
+    shadingTransparent.clear();
+    shadingTransparent.addComponent();
+    shadingTransparent.setName(0, "component0");
+    shadingTransparent.addPoint(0, osg::Vec2d(0.071, 0.0), osg::Vec4(0.000, 0.000, 0.000, 0.000), true, false, 0.0);
+    shadingTransparent.addPoint(0, osg::Vec2d(0.129, 0.0), osg::Vec4(0.988, 0.000, 0.000, 0.034), true, false, 0.0);
+    shadingTransparent.addPoint(0, osg::Vec2d(0.181, 0.0), osg::Vec4(0.952, 0.968, 0.019, 0.034), true, false, 0.0);
+    shadingTransparent.addPoint(0, osg::Vec2d(0.223, 0.0), osg::Vec4(0.082, 0.980, 0.000, 0.051), true, false, 0.0);
+    shadingTransparent.addPoint(0, osg::Vec2d(0.273, 0.0), osg::Vec4(0.529, 1.000, 0.952, 0.170), true, false, 0.0);
+    shadingTransparent.addPoint(0, osg::Vec2d(0.412, 0.0), osg::Vec4(0.788, 0.843, 1.000, 1.000), true, false, 0.0);
+    shadingTransparent.addPoint(0, osg::Vec2d(1.000, 0.0), osg::Vec4(0.007, 0.027, 0.980, 1.000), true, false, 0.0);
+
+    shadingBone0.setName("Shading - bone (skull)");
+    shadingBone0.clear();
+    shadingBone0.addComponent();
+    shadingBone0.setName(0, "bone");
+    shadingBone0.setAlphaFactor(0, 0.172);
+    shadingBone0.addPoint(0, osg::Vec2d(0.265, 0.0), osg::Vec4(1.000, 0.992, 0.949, 0.000), true, false, 0.0);
+    shadingBone0.addPoint(0, osg::Vec2d(0.273, 0.0), osg::Vec4(1.000, 0.988, 0.917, 1.000), true, false, 0.0);
+    shadingBone0.addComponent();
+    shadingBone0.setName(1, "skin");
+    shadingBone0.setAlphaFactor(1, 0.028);
+    shadingBone0.addPoint(1, osg::Vec2d(0.126, 0.0), osg::Vec4(1.000, 0.498, 0.498, 0.000), true, false, 0.0);
+    shadingBone0.addPoint(1, osg::Vec2d(0.170, 0.0), osg::Vec4(1.000, 0.498, 0.498, 1.000), true, false, 0.0);
+    shadingBone0.addPoint(1, osg::Vec2d(0.223, 0.0), osg::Vec4(1.000, 0.498, 0.498, 0.000), true, false, 0.0);
+
+    shadingBone1.setName("Shading - bone (spine)");
+    shadingBone1.clear();
+    shadingBone1.addComponent();
+    shadingBone1.setName(0, "bone");
+    shadingBone1.setAlphaFactor(0, 0.217);
+    shadingBone1.addPoint(0, osg::Vec2d(0.190, 0.0), osg::Vec4(1.000, 0.992, 0.949, 0.000), true, false, 0.0);
+    shadingBone1.addPoint(0, osg::Vec2d(0.201, 0.0), osg::Vec4(1.000, 0.988, 0.917, 1.000), true, false, 0.0);
+    shadingBone1.addComponent();
+    shadingBone1.setName(1, "skin");
+    shadingBone1.setAlphaFactor(1, 0.028);
+    shadingBone1.addPoint(1, osg::Vec2d(0.126, 0.0), osg::Vec4(1.000, 0.498, 0.498, 0.000), true, false, 0.0);
+    shadingBone1.addPoint(1, osg::Vec2d(0.170, 0.0), osg::Vec4(1.000, 0.498, 0.498, 1.000), true, false, 0.0);
+    shadingBone1.addPoint(1, osg::Vec2d(0.223, 0.0), osg::Vec4(1.000, 0.498, 0.498, 0.000), true, false, 0.0);
+
+    shadingBone2.setName("Shading - bone (pelvis)");
+    shadingBone2.clear();
+    shadingBone2.addComponent();
+    shadingBone2.setName(0, "bone");
+    shadingBone2.setAlphaFactor(0, 0.172);
+    shadingBone2.addPoint(0, osg::Vec2d(0.184, 0.0), osg::Vec4(1.000, 0.992, 0.949, 0.000), true, false, 0.0);
+    shadingBone2.addPoint(0, osg::Vec2d(0.198, 0.0), osg::Vec4(1.000, 0.988, 0.917, 1.000), true, false, 0.0);
+    shadingBone2.addComponent();
+    shadingBone2.setName(1, "skin");
+    shadingBone2.setAlphaFactor(1, 0.037);
+    shadingBone2.addPoint(1, osg::Vec2d(0.111, 0.0), osg::Vec4(1.000, 0.498, 0.498, 0.000), true, false, 0.0);
+    shadingBone2.addPoint(1, osg::Vec2d(0.149, 0.0), osg::Vec4(1.000, 0.498, 0.498, 1.000), true, false, 0.0);
+    shadingBone2.addPoint(1, osg::Vec2d(0.193, 0.0), osg::Vec4(1.000, 0.498, 0.498, 0.000), true, false, 0.0);
+
+    surfaceSkin.setName("Surface - skin");
+    surfaceSkin.clear();
+    surfaceSkin.addComponent();
+    surfaceSkin.setName(0, "component0");
+    surfaceSkin.addPoint(0, osg::Vec2d(0.000, 0.0), osg::Vec4(0.000, 0.000, 0.000, 0.000), true, false, 0.0);
+    surfaceSkin.addPoint(0, osg::Vec2d(0.102, 0.0), osg::Vec4(1.000, 0.996, 0.988, 1.000), true, false, 0.0);
+    surfaceSkin.addPoint(0, osg::Vec2d(1.000, 0.0), osg::Vec4(0.498, 0.498, 0.498, 1.000), true, false, 0.0);
+
+    surfaceBone.setName("Surface - bones");
+    surfaceBone.clear();
+    surfaceBone.addComponent();
+    surfaceBone.setName(0, "component0");
+    surfaceBone.addPoint(0, osg::Vec2d(0.172, 0.0), osg::Vec4(0.000, 0.000, 0.000, 0.000), true, false, 0.0);
+    surfaceBone.addPoint(0, osg::Vec2d(0.173, 0.0), osg::Vec4(0.380, 0.258, 0.066, 0.000), true, false, 0.0);
+    surfaceBone.addPoint(0, osg::Vec2d(0.269, 0.0), osg::Vec4(1.000, 1.000, 1.000, 1.000), true, false, 0.0);
+}
@@ -0,0 +1,653 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// 3DimViewer
+// Lightweight 3D DICOM viewer.
+//
+// Copyright 2008-2016 3Dim Laboratory s.r.o.
+// Copyright 2016-2018 Tescan 3Dim s.r.o.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <render/PSVRraycaster.h>
+
+#include <VPL/Math/Base.h>
+
+// STL
+#include <algorithm>
+#include <cmath>
+
+namespace PSVR
+{
+
+namespace
+{
+
+//! Texture sizes are rounded down to multiples of four, as in PSVolumeRendering.
+const int RoundingMask = ~3;
+
+//! Inverse of the maximal length of the gradient.
+const float MaxNormalLength = 0.577350269f;
+
+//! Distance of samples used to estimate the gradient, in voxels.
+const float GradientStep = 1.25f;
+
+//! Neighbouring samples behind the cutting plane are weighted by this value.
+const float MinVoxel = 0.7f;
+
+//! Samples with the stored transparency above this value are not shaded.
+const float MaxTransparency = 0.99f;
+
+//! Minimal gradient magnitude of shaded samples.
+const float MinGradient = 0.005f;
+
+//! Clamps a value to <0, 1>.
+inline float saturate(float value)
+{
+    return std::min(std::max(value, 0.0f), 1.0f);
+}
+
+inline osg::Vec3 saturate(const osg::Vec3& value)
+{
+    return osg::Vec3(saturate(value.x()), saturate(value.y()), saturate(value.z()));
+}
+
+//! Clamps an index of a voxel to the volume.
+inline int clampIndex(int i, int size)
+{
+    return std::min(std::max(i, 0), size - 1);
+}
+
+//! Quantizes a value to 16 bits the same way the GPU lookup texture is filled.
+inline float quantize(double value)
+{
+    return float(static_cast<unsigned short>(value * 65535.0)) / 65535.0f;
+}
+
+//! Converts a color component to 8 bits.
+inline vpl::img::tRGBPixel::tComponent toByte(float value)
+{
+    return vpl::img::tRGBPixel::tComponent(saturate(value) * 255.0f + 0.5f);
+}
+
+//! Deterministic noise in <0, 1) replacing the shader noise texture.
+inline float noise(int x, int y)
+{
+    unsigned int h = unsigned(x) * 73856093u ^ unsigned(y) * 19349663u;
+    h ^= h >> 13;
+    h *= 0x5bd1e995u;
+    h ^= h >> 15;
+    return float(h & 0xffff) / 65536.0f;
+}
+
+//! Clips the segment from a to b by the box <-1, 1>^3, returns false if it misses.
+bool clipToBox(const osg::Vec3& a, const osg::Vec3& b, osg::Vec3& start, osg::Vec3& end)
+{
+    const osg::Vec3 dir = b - a;
+    float t0 = 0.0f, t1 = 1.0f;
+    for (int i = 0; i < 3; ++i)
+    {
+        if (std::fabs(dir[i]) < 1e-12f)
+        {
+            if (a[i] < -1.0f || a[i] > 1.0f)
+            {
+                return false;
+            }
+            continue;
+        }
+
+        float ta = (-1.0f - a[i]) / dir[i];
+        float tb = (1.0f - a[i]) / dir[i];
+        if (ta > tb)
+        {
+            std::swap(ta, tb);
+        }
+        t0 = std::max(t0, ta);
+        t1 = std::min(t1, tb);
+    }
+    if (t0 >= t1)
+    {
+        return false;
+    }
+
+    start = a + dir * t0;
+    end = a + dir * t1;
+    return true;
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+PSVolumeRaycaster::SParams::SParams()
+    : mode(EMode::SHADING)
+    , dataPreMultiplication(1.0f)
+    , dataOffset(0.0f)
+    , imageBrightness(0.0f)
+    , imageContrast(1.0f)
+    , samplingDistance(0.5f)
+    , plane(0.0f, 0.0f, 0.0f, 1.0f)
+    , surfaceNormalMult(15.0f)
+    , surfaceNormalExp(2.0f)
+    , stopCondition(0.01f)
+    , jitter(true)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+PSVolumeRaycaster::PSVolumeRaycaster()
+    : m_XSize(0), m_YSize(0), m_ZSize(0)
+    , m_AuxXSize(0), m_AuxYSize(0), m_AuxZSize(0)
+    , m_RealXSize(1.0f), m_RealYSize(1.0f), m_RealZSize(1.0f)
+    , m_Lut(LUT_SIZE)
+    , m_SkipCondition(1.0f, 0.0f, 1.0f, 0.0f)
+{
+    SLutEntry Empty = { 0.0f, 0.0f, 0.0f, 1.0f };
+    std::fill(m_Lut.begin(), m_Lut.end(), Empty);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool PSVolumeRaycaster::setData(const vpl::img::CDensityVolume& Data, float SubSampling)
+{
+    int XSize = Data.getXSize();
+    int YSize = Data.getYSize();
+    int ZSize = Data.getZSize();
+
+    // Volume sizes as in PSVolumeRendering::internalUploadData()
+    if (SubSampling != 1.0f)
+    {
+        XSize = vpl::math::round2Int(float(XSize) * SubSampling);
+        YSize = vpl::math::round2Int(float(YSize) * SubSampling);
+        ZSize = vpl::math::round2Int(float(ZSize) * SubSampling);
+    }
+    XSize &= RoundingMask;
+    YSize &= RoundingMask;
+    ZSize &= RoundingMask;
+
+    if (XSize <= 0 || YSize <= 0 || ZSize <= 0)
+    {
+        m_Volume.resize(0, 0, 0, 0);
+        m_Aux.resize(0, 0, 0, 0);
+        updateSizes(1.0f, 1.0f, 1.0f);
+        return false;
+    }
+
+    m_Volume.resize(XSize, YSize, ZSize, 0);
+    m_Aux.resize(((XSize + 7) / 8 + 3) & RoundingMask, ((YSize + 7) / 8 + 3) & RoundingMask, ((ZSize + 7) / 8 + 3) & RoundingMask, 0);
+
+    bool bResult = CVolumeRenderingPreprocessor::process(Data, SubSampling != 1.0f, m_Volume, m_Aux);
+
+    updateSizes(float(Data.getXSize() * Data.getDX()), float(Data.getYSize() * Data.getDY()), float(Data.getZSize() * Data.getDZ()));
+
+    return bResult;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void PSVolumeRaycaster::setVolumes(const CVolumeRenderingPreprocessor::tVolume& Volume,
+                                   const CVolumeRenderingPreprocessor::tAuxVolume& Aux,
+                                   float RealXSize, float RealYSize, float RealZSize)
+{
+    m_Volume.copy(Volume);
+    m_Aux.copy(Aux);
+
+    updateSizes(RealXSize, RealYSize, RealZSize);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void PSVolumeRaycaster::updateSizes(float RealXSize, float RealYSize, float RealZSize)
+{
+    m_XSize = m_Volume.getXSize();
+    m_YSize = m_Volume.getYSize();
+    m_ZSize = m_Volume.getZSize();
+
+    m_AuxXSize = m_Aux.getXSize();
+    m_AuxYSize = m_Aux.getYSize();
+    m_AuxZSize = m_Aux.getZSize();
+
+    m_RealXSize = RealXSize;
+    m_RealYSize = RealYSize;
+    m_RealZSize = RealZSize;
+
+    // Texture coordinates to indices of blocks (skipTexSize * aux texture size)
+    const float BlockSize = float(CVolumeRenderingPreprocessor::BLOCK_SIZE);
+    m_SkipScale.set(m_XSize / BlockSize, m_YSize / BlockSize, m_ZSize / BlockSize);
+
+    // Without a skipping volume nothing can be rendered
+    if (m_AuxXSize <= 0 || m_AuxYSize <= 0 || m_AuxZSize <= 0)
+    {
+        m_XSize = m_YSize = m_ZSize = 0;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void PSVolumeRaycaster::setLookupTable(const CLookupTable& LookupTable)
+{
+    m_SkipCondition.set(1.0f, 0.0f, 1.0f, 0.0f);
+
+    // Shaders sample the middle row of the lookup texture
+    const double Row = double(LUT_ROWS / 2) / double(LUT_ROWS);
+
+    for (int x = 0; x < LUT_SIZE; ++x)
+    {
+        const osg::Vec2d Position(double(x) / double(LUT_SIZE), Row);
+        const osg::Vec4 Color = LookupTable.color(Position);
+
+        SLutEntry& Entry = m_Lut[x];
+        Entry.r = quantize(Color.r());
+        Entry.g = quantize(Color.g());
+        Entry.b = quantize(Color.b());
+        Entry.a = quantize(1.0 - Color.a());
+
+        if (Color.a() > 0.0f)
+        {
+            m_SkipCondition[0] = std::min(m_SkipCondition[0], float(Position[0]));
+            m_SkipCondition[1] = std::max(m_SkipCondition[1], float(Position[0]));
+            m_SkipCondition[2] = std::min(m_SkipCondition[2], float(Position[1]));
+            m_SkipCondition[3] = std::max(m_SkipCondition[3], float(Position[1]));
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void PSVolumeRaycaster::setLookupTable(const unsigned short *pRow, const osg::Vec4& SkipCondition)
+{
+    if (!pRow)
+    {
+        return;
+    }
+
+    for (int x = 0; x < LUT_SIZE; ++x, pRow += 4)
+    {
+        SLutEntry& Entry = m_Lut[x];
+        Entry.r = pRow[0] / 65535.0f;
+        Entry.g = pRow[1] / 65535.0f;
+        Entry.b = pRow[2] / 65535.0f;
+        Entry.a = pRow[3] / 65535.0f;
+    }
+    m_SkipCondition = SkipCondition;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+float PSVolumeRaycaster::sample(const osg::Vec3& pos) const
+{
+    // Texel centers are at (i + 0.5) / size
+    const float fx = pos.x() * m_XSize - 0.5f;
+    const float fy = pos.y() * m_YSize - 0.5f;
+    const float fz = pos.z() * m_ZSize - 0.5f;
+
+    const float flx = std::floor(fx), fly = std::floor(fy), flz = std::floor(fz);
+    const float wx = fx - flx, wy = fy - fly, wz = fz - flz;
+    const int ix = int(flx), iy = int(fly), iz = int(flz);
+
+    const vpl::tSize x0 = clampIndex(ix, m_XSize), x1 = clampIndex(ix + 1, m_XSize);
+    const vpl::tSize y0 = clampIndex(iy, m_YSize) * m_Volume.getYOffset(), y1 = clampIndex(iy + 1, m_YSize) * m_Volume.getYOffset();
+    const vpl::tSize z0 = clampIndex(iz, m_ZSize) * m_Volume.getZOffset(), z1 = clampIndex(iz + 1, m_ZSize) * m_Volume.getZOffset();
+
+    const vpl::img::tPixel16 *p = &m_Volume(0, 0, 0);
+
+    const float c00 = p[z0 + y0 + x0] + wx * (float(p[z0 + y0 + x1]) - float(p[z0 + y0 + x0]));
+    const float c01 = p[z0 + y1 + x0] + wx * (float(p[z0 + y1 + x1]) - float(p[z0 + y1 + x0]));
+    const float c10 = p[z1 + y0 + x0] + wx * (float(p[z1 + y0 + x1]) - float(p[z1 + y0 + x0]));
+    const float c11 = p[z1 + y1 + x0] + wx * (float(p[z1 + y1 + x1]) - float(p[z1 + y1 + x0]));
+
+    const float c0 = c00 + wy * (c01 - c00);
+    const float c1 = c10 + wy * (c11 - c10);
+
+    return (c0 + wz * (c1 - c0)) / 65535.0f;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+float PSVolumeRaycaster::cuttingPlane(const osg::Vec3& pos) const
+{
+    const osg::Vec4& pl = m_Params.plane;
+    return pl.x() * pos.x() + pl.y() * pos.y() + pl.z() * pos.z() + pl.w();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+float PSVolumeRaycaster::remap(float value) const
+{
+    return saturate((value * m_Params.dataPreMultiplication + 0.001f) - m_Params.dataOffset);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+const PSVolumeRaycaster::SLutEntry& PSVolumeRaycaster::lookup(float value) const
+{
+    return m_Lut[std::min(int(value * LUT_SIZE), LUT_SIZE - 1)];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool PSVolumeRaycaster::isMeaningful(const osg::Vec3& pos) const
+{
+    if (cuttingPlane(pos) < 0.0f)
+    {
+        return false;
+    }
+
+    const int x = clampIndex(int(std::floor(pos.x() * m_SkipScale.x())), m_AuxXSize);
+    const int y = clampIndex(int(std::floor(pos.y() * m_SkipScale.y())), m_AuxYSize);
+    const int z = clampIndex(int(std::floor(pos.z() * m_SkipScale.z())), m_AuxZSize);
+
+    const vpl::img::tRGBPixel& Block = m_Aux(x, y, z);
+    const float vmin = remap(Block.r() / 255.0f);
+    const float vmax = remap(Block.g() / 255.0f);
+
+    // MIP looks up the ray maximum and X-ray sums colors regardless of alpha,
+    // a block above the visible range must not be skipped
+    if (m_Params.mode == EMode::MIP || m_Params.mode == EMode::XRAY)
+    {
+        return !(vmax < m_SkipCondition.x());
+    }
+
+    return !(vmin > m_SkipCondition.y() || vmax < m_SkipCondition.x());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void PSVolumeRaycaster::composite(const osg::Vec3& pos, const osg::Vec3& light, const SLutEntry& entry, osg::Vec3& color, float& trans) const
+{
+    const osg::Vec3 dx(GradientStep / m_XSize, 0.0f, 0.0f);
+    const osg::Vec3 dy(0.0f, GradientStep / m_YSize, 0.0f);
+    const osg::Vec3 dz(0.0f, 0.0f, GradientStep / m_ZSize);
+
+    // Neighbours behind the cutting plane are attenuated
+    osg::Vec3 Normal;
+    const osg::Vec3 *Steps[3] = { &dx, &dy, &dz };
+    for (int i = 0; i < 3; ++i)
+    {
+        const osg::Vec3 Plus = pos + *Steps[i];
+        const osg::Vec3 Minus = pos - *Steps[i];
+        Normal[i] = (cuttingPlane(Plus) > 0.0f ? 1.0f : MinVoxel) * sample(Plus)
+                  - (cuttingPlane(Minus) > 0.0f ? 1.0f : MinVoxel) * sample(Minus);
+    }
+
+    const float Length = Normal.length();
+    float AlphaDiv = Length * MaxNormalLength;
+    if (m_Params.mode == EMode::SURFACE)
+    {
+        AlphaDiv = std::pow(AlphaDiv * m_Params.surfaceNormalMult, m_Params.surfaceNormalExp);
+    }
+    if (!(AlphaDiv > MinGradient) || Length <= 0.0f)
+    {
+        return;
+    }
+
+    // Lambertian shading with the light at the viewer
+    const float Diffuse = saturate((Normal / Length) * light);
+    const osg::Vec3 Rgb(entry.r, entry.g, entry.b);
+
+    osg::Vec3 Shade;
+    float Alpha;
+    if (m_Params.mode == EMode::SURFACE)
+    {
+        Shade = Rgb * Diffuse + Rgb * 0.05f;
+        Alpha = saturate(1.0f - saturate(entry.a / AlphaDiv));
+    }
+    else
+    {
+        Shade = Rgb * (0.75f * Diffuse + 0.25f);
+        Alpha = saturate(1.0f - entry.a);
+    }
+    Alpha *= m_Params.samplingDistance;
+
+    color += saturate(Shade) * (Alpha * trans);
+    trans *= 1.0f - Alpha;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+osg::Vec4 PSVolumeRaycaster::castRay(const SRay& ray) const
+{
+    const osg::Vec3 RayPath = ray.end - ray.start;
+    const float tDistance = RayPath.length();
+    if (tDistance <= 0.0f)
+    {
+        return osg::Vec4(0.0f, 0.0f, 0.0f, 0.0f);
+    }
+
+    const osg::Vec3 nPath = RayPath / tDistance;
+
+    // Coarse steps over skipping blocks, fine steps inside
+    const float tFineStep = m_Params.samplingDistance / m_XSize;
+    const float tCoarseStep = float(CVolumeRenderingPreprocessor::BLOCK_SIZE) / m_XSize;
+    const osg::Vec3 FinePath = nPath * tFineStep;
+    const osg::Vec3 CoarsePath = nPath * tCoarseStep;
+    const int NumOfFineSteps = int(tCoarseStep / tFineStep);
+
+    const bool bCompositing = (m_Params.mode == EMode::SHADING || m_Params.mode == EMode::SURFACE);
+
+    // MIP and X-ray
+    osg::Vec3 Texel(0.0f, 0.0f, 0.0f);
+    float OldMonochromatic = 0.0f;
+
+    // Shading and surface
+    osg::Vec3 Color(0.0f, 0.0f, 0.0f);
+    float Trans = 1.0f;
+
+    float tPositionStart = (m_Params.jitter ? noise(ray.x, ray.y) : 0.5f) * tFineStep;
+    osg::Vec3 vtPositionStart = ray.start + nPath * tPositionStart;
+    bool bFlagStart = isMeaningful(vtPositionStart);
+
+    for (int i = 0; i < MAX_COARSE_STEPS; ++i)
+    {
+        // Early ray termination
+        if ((bCompositing && Trans <= m_Params.stopCondition) || tPositionStart > tDistance)
+        {
+            break;
+        }
+
+        const osg::Vec3 vtPositionEnd = vtPositionStart + CoarsePath;
+        const float tPositionEnd = tPositionStart + tCoarseStep;
+        const bool bFlagEnd = isMeaningful(vtPositionEnd);
+
+        // Empty space skipping
+        if (bFlagStart || bFlagEnd)
+        {
+            osg::Vec3 vtPosition = vtPositionStart;
+            for (int j = 0; j < NumOfFineSteps; ++j, vtPosition += FinePath)
+            {
+                if (bCompositing && Trans <= m_Params.stopCondition)
+                {
+                    break;
+                }
+
+                const float Voxel = (cuttingPlane(vtPosition) > 0.0f) ? remap(sample(vtPosition)) : 0.0f;
+                const SLutEntry& Entry = lookup(Voxel);
+
+                switch (m_Params.mode)
+                {
+                case EMode::MIP:
+                    {
+                        const float NewMonochromatic = 0.2989f * Entry.r + 0.5870f * Entry.g + 0.1140f * Entry.b;
+                        if (NewMonochromatic > OldMonochromatic)
+                        {
+                            Texel.set(Entry.r, Entry.g, Entry.b);
+                            OldMonochromatic = NewMonochromatic;
+                        }
+                    }
+                    break;
+
+                case EMode::XRAY:
+                    Texel += osg::Vec3(Entry.r * Entry.r * Entry.r * Entry.r, Entry.g * Entry.g * Entry.g * Entry.g, Entry.b * Entry.b * Entry.b * Entry.b);
+                    break;
+
+                default:
+                    if (Entry.a < MaxTransparency)
+                    {
+                        composite(vtPosition, nPath, Entry, Color, Trans);
+                    }
+                    break;
+                }
+            }
+        }
+
+        vtPositionStart = vtPositionEnd;
+        tPositionStart = tPositionEnd;
+        bFlagStart = bFlagEnd;
+    }
+
+    const float Brightness = m_Params.imageBrightness;
+    const float Contrast = m_Params.imageContrast;
+
+    switch (m_Params.mode)
+    {
+    case EMode::MIP:
+        {
+            const osg::Vec3 Output = saturate(Texel * Contrast + osg::Vec3(Brightness, Brightness, Brightness));
+            return osg::Vec4(Output, saturate(Output.x() * 3.0f));
+        }
+
+    case EMode::XRAY:
+        {
+            // Logarithmic scale
+            const float Scale = 1.0f / std::log(tPositionStart / tFineStep + 1.01f);
+            const osg::Vec3 LogColor(std::log(Texel.x() * m_Params.samplingDistance + 1.0f) * Scale,
+                                     std::log(Texel.y() * m_Params.samplingDistance + 1.0f) * Scale,
+                                     std::log(Texel.z() * m_Params.samplingDistance + 1.0f) * Scale);
+            const osg::Vec3 Output = saturate(LogColor * (Contrast * 25.0f) + osg::Vec3(Brightness, Brightness, Brightness));
+            return osg::Vec4(Output, (Output.x() + Output.y() + Output.z()) / 3.0f);
+        }
+
+    default:
+        if (tPositionStart > tDistance && Color.x() < 0.01f && Color.y() < 0.01f && Color.z() < 0.01f)
+        {
+            return osg::Vec4(0.0f, 0.0f, 0.0f, 0.0f);
+        }
+        return osg::Vec4(saturate(Color * Contrast + osg::Vec3(Brightness, Brightness, Brightness)), 1.0f - Trans);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool PSVolumeRaycaster::render(const osg::Matrix& ModelView, const osg::Matrix& Projection, int Width, int Height, vpl::img::CRGBImage& Image) const
+{
+    Width = std::max(Width, 0);
+    Height = std::max(Height, 0);
+
+    Image.resize(Width, Height);
+    Image.fillEntire(vpl::img::tRGBPixel(0));
+
+    if (!hasData() || Width == 0 || Height == 0)
+    {
+        return false;
+    }
+
+    // The volume box spans <-1, 1>^3 in its own space, as in PSVolumeRendering::renderVolume()
+    const osg::Matrix BoxModelView = osg::Matrix::scale(m_RealXSize * 0.5f, m_RealYSize * 0.5f, m_RealZSize * 0.5f) * ModelView;
+    const osg::Matrix Unproject = osg::Matrix::inverse(BoxModelView * Projection);
+
+    const int TilesX = (Width + TILE_SIZE - 1) / TILE_SIZE;
+    const int TilesY = (Height + TILE_SIZE - 1) / TILE_SIZE;
+    const int NumTiles = TilesX * TilesY;
+
+#pragma omp parallel for schedule(dynamic)
+    for (int t = 0; t < NumTiles; ++t)
+    {
+        const int BeginX = (t % TilesX) * TILE_SIZE;
+        const int BeginY = (t / TilesX) * TILE_SIZE;
+        const int EndX = std::min(BeginX + TILE_SIZE, Width);
+        const int EndY = std::min(BeginY + TILE_SIZE, Height);
+
+        for (int y = BeginY; y < EndY; ++y)
+        {
+            // The first image row is the top one, OpenGL counts rows from the bottom
+            const int ViewportY = Height - 1 - y;
+            const float NdcY = (ViewportY + 0.5f) * 2.0f / Height - 1.0f;
+
+            for (int x = BeginX; x < EndX; ++x)
+            {
+                const float NdcX = (x + 0.5f) * 2.0f / Width - 1.0f;
+
+                const osg::Vec3 Near = osg::Vec3(NdcX, NdcY, -1.0f) * Unproject;
+                const osg::Vec3 Far = osg::Vec3(NdcX, NdcY, 1.0f) * Unproject;
+
+                SRay Ray;
+                if (!clipToBox(Near, Far, Ray.start, Ray.end))
+                {
+                    continue;
+                }
+
+                // Texture coordinates of the entry and exit points
+                const osg::Vec3 Half(0.5f, 0.5f, 0.5f);
+                Ray.start = Ray.start * 0.5f + Half;
+                Ray.end = Ray.end * 0.5f + Half;
+                Ray.x = x;
+                Ray.y = ViewportY;
+
+                const osg::Vec4 Result = castRay(Ray);
+
+                vpl::img::tRGBPixel& Pixel = Image(x, y);
+                Pixel.r() = toByte(Result.r());
+                Pixel.g() = toByte(Result.g());
+                Pixel.b() = toByte(Result.b());
+                Pixel.a() = toByte(Result.a());
+            }
+        }
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+bool PSVolumeRaycaster::renderThumbnail(const osg::Vec3& Direction, const osg::Vec3& Up, int Size, vpl::img::CRGBImage& Image) const
+{
+    const float Radius = 0.5f * osg::Vec3(m_RealXSize, m_RealYSize, m_RealZSize).length();
+    if (!hasData() || Radius <= 0.0f)
+    {
+        Image.resize(std::max(Size, 0), std::max(Size, 0));
+        Image.fillEntire(vpl::img::tRGBPixel(0));
+        return false;
+    }
+
+    osg::Vec3 Dir = Direction;
+    Dir.normalize();
+
+    // The camera stays outside of the bounding sphere which spans the depth range
+    const osg::Matrix ModelView = osg::Matrix::lookAt(Dir * (-2.0f * Radius), osg::Vec3(0.0f, 0.0f, 0.0f), Up);
+    const osg::Matrix Projection = osg::Matrix::ortho(-Radius, Radius, -Radius, Radius, Radius, 3.0f * Radius);
+
+    return render(ModelView, Projection, Size, Size, Image);
+}
+
+} // namespace PSVR
+
+////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
@@ -39,8 +39,11 @@
 #include <VPL/Math/Base.h>
 #include <VPL/Math/Random.h>
 #include <VPL/System/Sleep.h>
-#include <VPL/Image/VolumeFilters/Sobel.h>
-#include <VPL/Image/VolumeFilters/Gaussian.h>
+
+#include <alg/CVolumeRenderingPreprocessor.h>
+#include <render/PSVRraycaster.h>
+
+#include <limits>
 
 #ifdef __APPLE__
     #define LOOKUP_TEXTURE_FORMAT   GL_RGBA12
@@ -394,6 +397,68 @@ float PSVolumeRendering::getRealZSize() const
     return m_spParams->RealZSize;
 }
 
+bool PSVolumeRendering::setupRaycaster(PSVolumeRaycaster& raycaster)
+{
+    PSVolumeRaycaster::SParams rayParams;
+    float subSampling = 1.0f;
+    {
+        tLock Lock(*this);
+
+        switch (m_spParams->selectedShader)
+        {
+        case EShaders::XRAY:
+            rayParams.mode = PSVolumeRaycaster::EMode::XRAY;
+            break;
+
+        case EShaders::MIP:
+            rayParams.mode = PSVolumeRaycaster::EMode::MIP;
+            break;
+
+        case EShaders::SHADING:
+            rayParams.mode = PSVolumeRaycaster::EMode::SHADING;
+            break;
+
+        case EShaders::SURFACE:
+            rayParams.mode = PSVolumeRaycaster::EMode::SURFACE;
+            break;
+
+        default:
+            return false;
+        }
+
+        rayParams.dataPreMultiplication = m_spParams->dataPreMultiplication;
+        rayParams.dataOffset = m_spParams->dataOffset;
+        rayParams.imageBrightness = m_spParams->imageBrightness;
+        rayParams.imageContrast = m_spParams->imageContrast;
+        rayParams.samplingDistance = m_spParams->volumeSamplingDistance;
+        rayParams.plane = osg::Vec4(m_spParams->planeA, m_spParams->planeB, m_spParams->planeC, m_spParams->planeD + m_spParams->planeDeltaNear * Sqrt3Div2);
+        rayParams.surfaceNormalMult = m_spParams->surfaceNormalMult;
+        rayParams.surfaceNormalExp = m_spParams->surfaceNormalExp;
+
+        // the same lookup texture row the shaders sample
+        int lut = static_cast<int>(m_spParams->selectedLut);
+        raycaster.setLookupTable(m_internalLookupTables[lut] + 4 * (LUT_2D_H / 2) * LUT_2D_W, m_skipConditions[lut]);
+
+        subSampling = conf::DataSampling[m_spParams->currentQuality];
+    }
+    raycaster.setParams(rayParams);
+
+    int datasetID = data::PATIENT_DATA;
+    {   // get active data set
+        data::CObjectPtr<data::CActiveDataSet> spDataSet(APP_STORAGE.getEntry(data::Storage::ActiveDataSet::Id));
+        datasetID = spDataSet->getId();
+    }
+    data::CObjectPtr<data::CDensityData> spVolumeData(APP_STORAGE.getEntry(datasetID));
+    vpl::img::CDensityVolume *workingPtr = spVolumeData.get();
+
+    if (!workingPtr || workingPtr->getZSize() <= 0)
+    {
+        return false;
+    }
+
+    return raycaster.setData(*workingPtr, subSampling);
+}
+
 void PSVolumeRendering::redraw(bool bEraseBackground)
 {
     if (m_pCanvas)
@@ -476,129 +541,7 @@ void PSVolumeRendering::createLookupTables()
         m_skipConditions.push_back(osg::Vec4(0.0f, 1.0f, 0.0f, 1.0f));
     }
 
-    CLookupTable &mipSoft = m_lookupTables["MIP_SOFT"];
-    CLookupTable &mipHard = m_lookupTables["MIP_HARD"];
-    CLookupTable &xraySoft = m_lookupTables["XRAY_SOFT"];
-    CLookupTable &xrayHard = m_lookupTables["XRAY_HARD"];
-    CLookupTable &shadingAir = m_lookupTables["SHA_AIR"];
-    CLookupTable &shadingTransparent = m_lookupTables["SHA_TRAN"];
-    CLookupTable &shadingBone0 = m_lookupTables["SHA_BONE0"];
-    CLookupTable &shadingBone1 = m_lookupTables["SHA_BONE1"];
-    CLookupTable &shadingBone2 = m_lookupTables["SHA_BONE2"];
-    CLookupTable &surfaceSkin = m_lookupTables["SURFACE_SKIN"];
-    CLookupTable &surfaceBone = m_lookupTables["SURFACE_BONE"];
-
-    mipSoft.setName("MIP soft");
-    mipSoft.clear();
-    mipSoft.addComponent();
-    mipSoft.setName(0, "component0");
-    mipSoft.addPoint(0, osg::Vec2d(0.000, 0.0), osg::Vec4(0.000, 0.000, 0.000, 0.000), true, false, 0.0);
-    mipSoft.addPoint(0, osg::Vec2d(0.123, 0.0), osg::Vec4(0.870, 0.705, 0.262, 1.000), true, false, 0.0);
-    mipSoft.addPoint(0, osg::Vec2d(0.246, 0.0), osg::Vec4(0.000, 0.000, 0.000, 0.000), true, false, 0.0);
-
-    mipHard.setName("MIP hard");
-    mipHard.clear();
-    mipHard.addComponent();
-    mipHard.setName(0, "component0");
-    mipHard.addPoint(0, osg::Vec2d(0.174, 0.0), osg::Vec4(0.000, 0.000, 0.000, 0.000), true, false, 0.0);
-    mipHard.addPoint(0, osg::Vec2d(0.533, 0.0), osg::Vec4(0.988, 0.988, 0.988, 1.000), true, false, 0.0);
-    mipHard.addPoint(0, osg::Vec2d(1.000, 0.0), osg::Vec4(1.000, 1.000, 1.000, 1.000), true, false, 0.0);
-
-    xraySoft.setName("X-ray soft");
-    xraySoft.clear();
-    xraySoft.addComponent();
-    xraySoft.setName(0, "component0");
-    xraySoft.addPoint(0, osg::Vec2d(0.038, 0.0), osg::Vec4(0.000, 0.000, 0.000, 0.000), true, false, 0.0);
-    xraySoft.addPoint(0, osg::Vec2d(0.130, 0.0), osg::Vec4(0.341, 0.266, 0.101, 0.139), true, false, 0.0);
-    xraySoft.addPoint(0, osg::Vec2d(0.309, 0.0), osg::Vec4(0.015, 0.039, 0.109, 0.000), true, false, 0.0);
-    xraySoft.addPoint(0, osg::Vec2d(0.310, 0.0), osg::Vec4(0.000, 0.000, 0.000, 0.000), true, false, 0.0);
-
-    xrayHard.setName("X-ray hard");
-    xrayHard.clear();
-    xrayHard.addComponent();
-    xrayHard.setName(0, "component0");
-    xrayHard.addPoint(0, osg::Vec2d(0.147, 0.0), osg::Vec4(0.000, 0.000, 0.000, 1.000), true, false, 0.0);
-    xrayHard.addPoint(0, osg::Vec2d(0.148, 0.0), osg::Vec4(0.043, 0.070, 0.101, 1.000), true, false, 0.0);
-    xrayHard.addPoint(0, osg::Vec2d(1.000, 0.0), osg::Vec4(1.000, 1.000, 1.000, 1.000), true, false, 0.0);
-
-    shadingAir.setName("Shading - air");
-    shadingAir.clear();
-    shadingAir.addComponent();
-    shadingAir.setName(0, "component0");
-    shadingAir.addPoint(0, osg::Vec2d(0.105, 0.0), osg::Vec4(0.000, 0.000, 0.000, 0.000), true, false, 0.0);
-    shadingAir.addPoint(0, osg::Vec2d(0.106, 0.0), osg::Vec4(0.000, 0.000, 0.000, 0.040), true, false, 0.0);
-    shadingAir.addPoint(0, osg::Vec2d(0.139, 0.0), osg::Vec4(0.407, 0.988, 0.960, 0.204), true, false, 0.0);
-    shadingAir.addPoint(0, osg::Vec2d(0.162, 0.0), osg::Vec4(0.000, 0.000, 0.000, 0.000), true, false, 0.0);
-
-    shadingTransparent.setName("Shading - transparent");
-    shadingTransparent.clear();
-    shadingTransparent.addComponent();
-    shadingTransparent.setName(0, "component0");
-    shadingTransparent.addPoint(0, osg::Vec2d(0.071, 0.0), osg::Vec4(0.000, 0.000, 0.000, 0.000), true, false, 0.0);
-    shadingTransparent.addPoint(0, osg::Vec2d(0.129, 0.0), osg::Vec4(0.988, 0.000, 0.000, 0.034), true, false, 0.0);
-    shadingTransparent.addPoint(0, osg::Vec2d(0.181, 0.0), osg::Vec4(0.952, 0.968, 0.019, 0.034), true, false, 0.0);
-    shadingTransparent.addPoint(0, osg::Vec2d(0.223, 0.0), osg::Vec4(0.082, 0.980, 0.000, 0.051), true, false, 0.0);
-    shadingTransparent.addPoint(0, osg::Vec2d(0.273, 0.0), osg::Vec4(0.529, 1.000, 0.952, 0.170), true, false, 0.0);
-    shadingTransparent.addPoint(0, osg::Vec2d(0.412, 0.0), osg::Vec4(0.788, 0.843, 1.000, 1.000), true, false, 0.0);
-    shadingTransparent.addPoint(0, osg::Vec2d(1.000, 0.0), osg::Vec4(0.007, 0.027, 0.980, 1.000), true, false, 0.0);
-
-    shadingBone0.setName("Shading - bone (skull)");
-    shadingBone0.clear();
-    shadingBone0.addComponent();
-    shadingBone0.setName(0, "bone");
-    shadingBone0.setAlphaFactor(0, 0.172);
-    shadingBone0.addPoint(0, osg::Vec2d(0.265, 0.0), osg::Vec4(1.000, 0.992, 0.949, 0.000), true, false, 0.0);
-    shadingBone0.addPoint(0, osg::Vec2d(0.273, 0.0), osg::Vec4(1.000, 0.988, 0.917, 1.000), true, false, 0.0);
-    shadingBone0.addComponent();
-    shadingBone0.setName(1, "skin");
-    shadingBone0.setAlphaFactor(1, 0.028);
-    shadingBone0.addPoint(1, osg::Vec2d(0.126, 0.0), osg::Vec4(1.000, 0.498, 0.498, 0.000), true, false, 0.0);
-    shadingBone0.addPoint(1, osg::Vec2d(0.170, 0.0), osg::Vec4(1.000, 0.498, 0.498, 1.000), true, false, 0.0);
-    shadingBone0.addPoint(1, osg::Vec2d(0.223, 0.0), osg::Vec4(1.000, 0.498, 0.498, 0.000), true, false, 0.0);
-
-    shadingBone1.setName("Shading - bone (spine)");
-    shadingBone1.clear();
-    shadingBone1.addComponent();
-    shadingBone1.setName(0, "bone");
-    shadingBone1.setAlphaFactor(0, 0.217);
-    shadingBone1.addPoint(0, osg::Vec2d(0.190, 0.0), osg::Vec4(1.000, 0.992, 0.949, 0.000), true, false, 0.0);
-    shadingBone1.addPoint(0, osg::Vec2d(0.201, 0.0), osg::Vec4(1.000, 0.988, 0.917, 1.000), true, false, 0.0);
-    shadingBone1.addComponent();
-    shadingBone1.setName(1, "skin");
-    shadingBone1.setAlphaFactor(1, 0.028);
-    shadingBone1.addPoint(1, osg::Vec2d(0.126, 0.0), osg::Vec4(1.000, 0.498, 0.498, 0.000), true, false, 0.0);
-    shadingBone1.addPoint(1, osg::Vec2d(0.170, 0.0), osg::Vec4(1.000, 0.498, 0.498, 1.000), true, false, 0.0);
-    shadingBone1.addPoint(1, osg::Vec2d(0.223, 0.0), osg::Vec4(1.000, 0.498, 0.498, 0.000), true, false, 0.0);
-
-    shadingBone2.setName("Shading - bone (pelvis)");
-    shadingBone2.clear();
-    shadingBone2.addComponent();
-    shadingBone2.setName(0, "bone");
-    shadingBone2.setAlphaFactor(0, 0.172);
-    shadingBone2.addPoint(0, osg::Vec2d(0.184, 0.0), osg::Vec4(1.000, 0.992, 0.949, 0.000), true, false, 0.0);
-    shadingBone2.addPoint(0, osg::Vec2d(0.198, 0.0), osg::Vec4(1.000, 0.988, 0.917, 1.000), true, false, 0.0);
-    shadingBone2.addComponent();
-    shadingBone2.setName(1, "skin");
-    shadingBone2.setAlphaFactor(1, 0.037);
-    shadingBone2.addPoint(1, osg::Vec2d(0.111, 0.0), osg::Vec4(1.000, 0.498, 0.498, 0.000), true, false, 0.0);
-    shadingBone2.addPoint(1, osg::Vec2d(0.149, 0.0), osg::Vec4(1.000, 0.498, 0.498, 1.000), true, false, 0.0);
-    shadingBone2.addPoint(1, osg::Vec2d(0.193, 0.0), osg::Vec4(1.000, 0.498, 0.498, 0.000), true, false, 0.0);
-
-    surfaceSkin.setName("Surface - skin");
-    surfaceSkin.clear();
-    surfaceSkin.addComponent();
-    surfaceSkin.setName(0, "component0");
-    surfaceSkin.addPoint(0, osg::Vec2d(0.000, 0.0), osg::Vec4(0.000, 0.000, 0.000, 0.000), true, false, 0.0);
-    surfaceSkin.addPoint(0, osg::Vec2d(0.102, 0.0), osg::Vec4(1.000, 0.996, 0.988, 1.000), true, false, 0.0);
-    surfaceSkin.addPoint(0, osg::Vec2d(1.000, 0.0), osg::Vec4(0.498, 0.498, 0.498, 1.000), true, false, 0.0);
-
-    surfaceBone.setName("Surface - bones");
-    surfaceBone.clear();
-    surfaceBone.addComponent();
-    surfaceBone.setName(0, "component0");
-    surfaceBone.addPoint(0, osg::Vec2d(0.172, 0.0), osg::Vec4(0.000, 0.000, 0.000, 0.000), true, false, 0.0);
-    surfaceBone.addPoint(0, osg::Vec2d(0.173, 0.0), osg::Vec4(0.380, 0.258, 0.066, 0.000), true, false, 0.0);
-    surfaceBone.addPoint(0, osg::Vec2d(0.269, 0.0), osg::Vec4(1.000, 1.000, 1.000, 1.000), true, false, 0.0);
+    createBuiltinLookupTables(m_lookupTables);
 
     updateLookupTables();
 }
@@ -622,27 +565,6 @@ void PSVolumeRendering::release()
     m_Flags = PSVR_NO_FLAGS;
 }
 
-///////////////////////////////////////////////////////////////////////////////
-// Faster gauss filter implementation
-float getFilteredVal(vpl::img::CDensityVolume * pVolume, int x, int y, int z)
-{
-    vpl::tSize zSums[3] = { };
-    vpl::tSize xOff = pVolume->getXOffset();
-    for (int dz = -1; dz <= 1; dz++)
-    {
-        vpl::tSize ySums[3] = { };
-        for (int dy = -1; dy <= 1; dy++)
-        {
-            vpl::tSize idx = pVolume->getIdx(x, y + dy, z + dz);
-            ySums[dy + 1] = pVolume->at(idx - xOff) + 3 * pVolume->at(idx) + pVolume->at(idx + xOff);
-        }
-        zSums[dz + 1] = ySums[0] + 3 * ySums[1] + ySums[2];
-    }
-    //float val = pVolume->at(x,y,z);
-    float sum = (zSums[0] + 3 * zSums[1] + zSums[2]) / 125.0;
-    return sum;
-}
-
 bool PSVolumeRendering::internalUploadData()
 {
 	int datasetID = data::PATIENT_DATA;
@@ -737,138 +659,9 @@ bool PSVolumeRendering::internalUploadData()
     m_spParams->AuxTexYSize = float(m_spParams->YSize) / float(m_spParams->AuxYSize * 8);
     m_spParams->AuxTexZSize = float(m_spParams->ZSize) / float(m_spParams->AuxZSize * 8);
 
-    // Clear the volume
-    m_AuxVolumeData.fillEntire(vpl::img::tRGBPixel(0));
-
-    // Scaling factor
-    static const vpl::img::tDensityPixel voxelMax = vpl::img::CPixelTraits<vpl::img::tDensityPixel>::getPixelMax();
-    static const vpl::img::tDensityPixel voxelMin = vpl::img::CPixelTraits<vpl::img::tDensityPixel>::getPixelMin();
-
-    static const float dataScale = 65536.0f / float(voxelMax - voxelMin);
-    static const float skipScale = 255.0f / 65536.0f;
-
-    // Check if the data are empty (i.e. reset of the storage, etc.)
-    vpl::img::tDensityPixel MaxValue = vpl::img::getMax<vpl::img::tDensityPixel>(*workingPtr);
-    bool bEmptyData = (MaxValue == voxelMin) ? true : false;
-
-    // No need to interpolate and copy the data if they are empty
-    if (bEmptyData)
-    {
-        // Just clear the internal volume
-        m_VolumeData.fillEntire(vpl::img::CVolume<vpl::img::tPixel16>::tVoxel(0));
-    }
-    else
-    {
-        // Copy (and interpolate) data voxel by voxel
-        //if (SubSampling < 1.0f)
-        if (SubSampling != 1.0f)
-        {
-            double XStep = double(workingPtr->getXSize() - 1) / (m_spParams->XSize - 1);
-            double YStep = double(workingPtr->getYSize() - 1) / (m_spParams->YSize - 1);
-            double ZStep = double(workingPtr->getZSize() - 1) / (m_spParams->ZSize - 1);
-#pragma omp parallel for schedule(static) default(shared)
-            for (vpl::tSize z = 0; z < m_spParams->ZSize; z++)
-            {
-                vpl::img::CPoint3D Point(0.0, 0.0, z * ZStep);
-                for (vpl::tSize y = 0; y < m_spParams->YSize; y++, Point.y() += YStep)
-                {
-                    Point.x() = 0.0;
-                    for (vpl::tSize x = 0; x < m_spParams->XSize; x++, Point.x() += XStep)
-                    {
-                        auto normalizedPixel = vpl::img::CVolume<vpl::img::tPixel16>::tVoxel(float(workingPtr->interpolate(Point) - voxelMin) * dataScale);
-                        m_VolumeData(x, y, z) = normalizedPixel;
-                    }
-                }
-            }
-        }
-
-        // No sub-sampling is required...
-        else
-        {
-//#define MDSTK_GAUSS
-#ifdef MDSTK_GAUSS
-            // Gaussian filter
-            vpl::img::CVolumeGauss3Filter<vpl::img::CDensityVolume> GaussFilter;
-            // initialize kernel (before multiple threads kick in)
-            float tmpPixel = float(GaussFilter.getResponse(*workingPtr, 0, 0, 0));
-            m_VolumeData(0, 0, 0) = tmpPixel;
-#endif
-
-#pragma omp parallel for schedule(static) default(shared)
-            for (vpl::tSize z = 0; z < m_spParams->ZSize; z++)
-            {
-                for (vpl::tSize y = 0; y < m_spParams->YSize; y++)
-                {
-                    for (vpl::tSize x = 0; x < m_spParams->XSize; x++)
-                    {
-#ifdef MDSTK_GAUSS
-                        float Pixel = float(GaussFilter.getResponse(*workingPtr, x, y, z));
-#else
-                        float Pixel = float(getFilteredVal(workingPtr, x, y, z));
-#endif
-                        auto normalizedPixel = vpl::img::CVolume<vpl::img::tPixel16>::tVoxel((Pixel - voxelMin) * dataScale);
-                        m_VolumeData(x, y, z) = normalizedPixel;
-                   }
-                }
-            }
-        }
-
-        // Sobel filters
-        vpl::img::CVolumeSobelX<vpl::img::CVolume<vpl::img::tPixel16>> SobelX;
-        vpl::img::CVolumeSobelY<vpl::img::CVolume<vpl::img::tPixel16>> SobelY;
-        vpl::img::CVolumeSobelZ<vpl::img::CVolume<vpl::img::tPixel16>> SobelZ;
-
-        // Gradient normalization
-        float gradScale = 0.33f * skipScale;
-
-        // Skipping volume - min/max
-        vpl::img::tRGBPixel::tComponent pixelMin = vpl::img::CPixelTraits<vpl::img::tRGBPixel>::getPixelMin().r();
-        vpl::img::tRGBPixel::tComponent pixelMax = vpl::img::CPixelTraits<vpl::img::tRGBPixel>::getPixelMax().r();
-
-#pragma omp parallel for schedule(static,8) default(shared)
-        for (vpl::tSize z = 0; z < m_spParams->ZSize; z++)
-        {
-            vpl::tSize sz = z / 8;
-            for (vpl::tSize y = 0; y < m_spParams->YSize; y++)
-            {
-                vpl::tSize sy = y / 8;
-                for (vpl::tSize x = 0; x < m_spParams->XSize; x++)
-                {
-                    vpl::tSize sx = x / 8;
-                    vpl::img::tRGBPixel& RGBPixel = m_AuxVolumeData(sx, sy, sz);
-
-                    // Min/Max
-                    vpl::img::tRGBPixel::tComponent SkipPixel = vpl::img::tRGBPixel::tComponent(skipScale * float(m_VolumeData(x, y, z)));
-                    RGBPixel.r() = vpl::math::getMin<vpl::img::tRGBPixel::tComponent>(RGBPixel.r(), vpl::math::getMax<vpl::img::tRGBPixel::tComponent>(SkipPixel - 1, pixelMin));
-                    RGBPixel.g() = vpl::math::getMax<vpl::img::tRGBPixel::tComponent>(RGBPixel.g(), vpl::math::getMin<vpl::img::tRGBPixel::tComponent>(SkipPixel + 1, pixelMax));
-                }
-            }
-        }
-
-        // Skipping volume - gradient magnitude
-#pragma omp parallel for schedule(static,8) default(shared)
-        for (vpl::tSize z = 1; z < (m_spParams->ZSize - 1); z += 2)
-        {
-            vpl::tSize sz = z / 8;
-            for (vpl::tSize y = 1; y < (m_spParams->YSize - 1); y += 2)
-            {
-                vpl::tSize sy = y / 8;
-                for (vpl::tSize x = 1; x < (m_spParams->XSize - 1); x += 2)
-                {
-                    vpl::tSize sx = x / 8;
-                    vpl::img::tRGBPixel& RGBPixel = m_AuxVolumeData(sx, sy, sz);
-                
-                    // Edge magnitude
-                    float GradX = float(SobelX.getResponse(m_VolumeData, x, y, z));
-                    float GradY = float(SobelY.getResponse(m_VolumeData, x, y, z));
-                    float GradZ = float(SobelZ.getResponse(m_VolumeData, x, y, z));
-                    float GradMag = vpl::math::getAbs(GradX) + vpl::math::getAbs(GradY) + vpl::math::getAbs(GradZ);
-                    vpl::img::tRGBPixel::tComponent Grad = vpl::img::tRGBPixel::tComponent(gradScale * GradMag);
-                    RGBPixel.b() = vpl::math::getMax(RGBPixel.b(), Grad);
-                }
-            }
-        }
-    }
+    // Normalized volume (resampled or smoothed) and the skipping volume in one pass over the data,
+    // both are cleared if the data are empty (i.e. reset of the storage, etc.)
+    CVolumeRenderingPreprocessor::process(*workingPtr, SubSampling != 1.0f, m_VolumeData, m_AuxVolumeData);
 
     // O.K.
     return true;
@@ -2082,7 +1875,14 @@ void PSVolumeRendering::updateShaderUniforms(PSVR::PSVolumeRendering::PSVolumeRe
     m_uniform_plFar->set(osg::Vec4(params.planeA, params.planeB, params.planeC, params.planeD + params.planeDeltaFar * Sqrt3Div2));
     m_uniform_invProjectionMatrix->set(params.invProjectionMatrix);
     m_uniform_invModelViewMatrix->set(params.invModelViewMatrix);
-    m_uniform_skipCondition->set(m_skipConditions[static_cast<int>(params.selectedLut)]);
+    osg::Vec4 skipCondition = m_skipConditions[static_cast<int>(params.selectedLut)];
+    if (params.selectedShader == EShaders::MIP || params.selectedShader == EShaders::XRAY)
+    {
+        // MIP looks up the ray maximum and X-ray sums colors regardless of alpha,
+        // a block above the visible range must not be skipped
+        skipCondition[1] = std::numeric_limits<float>::max();
+    }
+    m_uniform_skipCondition->set(skipCondition);
 
     // surface rendering parameters
     if (params.selectedShader == EShaders::SURFACE)